@@ -0,0 +1,74 @@
+#include "global.h"
+#include "ActiveHolds.h"
+
+#include <algorithm>
+
+/**
+ * @brief Determine if a TapNote needs a hold note style judgment.
+ * @param tn the TapNote in question.
+ * @return true if it does, false otherwise. */
+static bool NeedsHoldJudging( const TapNote &tn )
+{
+	switch( tn.type )
+	{
+	DEFAULT_FAIL( tn.type );
+	case TapNoteType_HoldHead:
+		return tn.HoldResult.hns == HNS_None;
+	case TapNoteType_Tap:
+	case TapNoteType_HoldTail:
+	case TapNoteType_Mine:
+	case TapNoteType_Lift:
+	case TapNoteType_Attack:
+	case TapNoteType_AutoKeysound:
+	case TapNoteType_Fake:
+	case TapNoteType_Empty:
+		return false;
+	}
+}
+
+void ActiveHolds::Reset( int iStartRow )
+{
+	m_vHolds.clear();
+	m_iNextRow = iStartRow;
+}
+
+void ActiveHolds::Update( NoteData &nd, int iSongRow )
+{
+	if( iSongRow >= m_iNextRow )
+	{
+		AddHolds( nd, m_iNextRow, iSongRow+1 );
+		m_iNextRow = iSongRow+1;
+	}
+	DropJudged();
+}
+
+void ActiveHolds::Rebuild( NoteData &nd, int iFirstChangedRow )
+{
+	/* Every hold reached before the first in the list has been judged, and
+	 * nothing before iFirstChangedRow has moved. */
+	int iStartRow = m_vHolds.empty()? m_iNextRow : m_vHolds.front().iRow;
+	iStartRow = std::max( std::min(iStartRow, iFirstChangedRow), 0 );
+
+	m_vHolds.clear();
+	AddHolds( nd, iStartRow, m_iNextRow );
+	DropJudged();
+}
+
+void ActiveHolds::AddHolds( NoteData &nd, int iStartRow, int iEndRow )
+{
+	NoteData::all_tracks_iterator iter = nd.GetTapNoteRangeAllTracks( iStartRow, iEndRow );
+	for( ; !iter.IsAtEnd(); ++iter )
+	{
+		if( iter->type != TapNoteType_HoldHead )
+			continue;
+		TrackRowTapNote trtn = { iter.Track(), iter.Row(), &*iter };
+		m_vHolds.push_back( trtn );
+	}
+}
+
+void ActiveHolds::DropJudged()
+{
+	std::vector<TrackRowTapNote>::iterator it = std::find_if( m_vHolds.begin(), m_vHolds.end(),
+		[]( const TrackRowTapNote &trtn ) { return NeedsHoldJudging(*trtn.pTN); } );
+	m_vHolds.erase( m_vHolds.begin(), it );
+}
@@ -0,0 +1,53 @@
+/* ActiveHolds - The holds and rolls Player::Update judges each frame. */
+
+#ifndef ACTIVE_HOLDS_H
+#define ACTIVE_HOLDS_H
+
+#include "NoteData.h"
+
+#include <vector>
+
+struct TrackRowTapNote
+{
+	int iTrack;
+	int iRow;
+	TapNote *pTN;
+};
+
+/* Each update judges every hold head reached, from the first that still needs
+ * judging, in NoteData order.  Finding them by walking NoteData from that
+ * hold costs a tree walk over every note since, each frame, and more the
+ * longer a hold or roll is held.  This keeps them in a vector instead: new
+ * holds are added as they're reached, and the judged ones dropped from the
+ * front.
+ *
+ * The list holds pointers into NoteData, so it must be rebuilt whenever notes
+ * are replaced. */
+class ActiveHolds
+{
+public:
+	ActiveHolds(): m_iNextRow( 0 ) { }
+
+	/* Forget every hold, and start looking for them at iStartRow. */
+	void Reset( int iStartRow );
+
+	/* Add the holds up to iSongRow, and drop judged holds before the first
+	 * that isn't. */
+	void Update( NoteData &nd, int iSongRow );
+
+	/* Notes from iFirstChangedRow on have been replaced; find the holds we've
+	 * reached again. */
+	void Rebuild( NoteData &nd, int iFirstChangedRow );
+
+	const std::vector<TrackRowTapNote> &Get() const { return m_vHolds; }
+
+private:
+	void AddHolds( NoteData &nd, int iStartRow, int iEndRow );
+	void DropJudged();
+
+	std::vector<TrackRowTapNote> m_vHolds;
+	/* The first row we haven't looked for holds on. */
+	int m_iNextRow;
+};
+
+#endif
@@ -14,13 +14,18 @@
 #include "ActorUtil.h"
 #include "Preference.h"
 #include "GameLoop.h"
+#include "RageProfiler.h"
 
+#include <algorithm>
 #include <cmath>
 #include <cstddef>
+#include <cstring>
+#include <limits>
 #include <typeinfo>
 #include <vector>
 
 static Preference<bool> g_bShowMasks("ShowMasks", false);
+static Preference<bool> g_bSleepIdleActors("SleepIdleActors", true);
 static const float default_effect_period= 1.0f;
 
 /**
@@ -155,7 +160,7 @@ static bool GetMessageNameFromCommandName( const RString &sCommandName, RString
 Actor::Actor()
 {
 	m_pLuaInstance = new LuaClass;
-	Lua *L = LUA->Get();
+	Lua *L = LUA->Get( "Actor::Actor" );
 		m_pLuaInstance->PushSelf( L );
 		lua_newtable( L );
 		lua_pushvalue( L, -1 );
@@ -169,6 +174,7 @@ Actor::Actor()
 	m_pParent = nullptr;
 	m_FakeParent = nullptr;
 	m_bFirstUpdate = true;
+	m_bAsleep = false;
 	m_tween_uses_effect_delta = false;
 	rate_scaling_enabled_ = true;
 }
@@ -214,10 +220,10 @@ Actor::Actor( const Actor &cpy ):
 	CPY( m_size );
 	CPY( m_current );
 	CPY( m_start );
-	for( unsigned i = 0; i < cpy.m_Tweens.size(); ++i )
-		m_Tweens.push_back( new TweenStateAndInfo(*cpy.m_Tweens[i]) );
+	CPY( m_Tweens );
 
 	CPY( m_bFirstUpdate );
+	m_bAsleep = false;
 
 	CPY( m_fHorizAlign );
 	CPY( m_fVertAlign );
@@ -335,6 +341,7 @@ Actor &Actor::operator=(Actor other)
 
 	SWAP( m_mapNameToCommands );
 #undef SWAP
+	WakeUp();
 	return *this;
 }
 
@@ -352,7 +359,7 @@ bool Actor::IsAlias(const std::string& name) {
  * former is more important. */
 void Actor::LoadFromNode( const XNode* pNode )
 {
-	Lua *L = LUA->Get();
+	Lua *L = LUA->Get( "Actor::LoadFromNode" );
 	FOREACH_CONST_Attr( pNode, pAttr )
 	{
 		// Load Name, if any.
@@ -412,6 +419,8 @@ void Actor::Draw()
 		}
 	}
 
+	PROFILE_SCOPE( "Actor::Draw" );
+
 	if(m_FakeParent)
 	{
 		m_FakeParent->BeginDraw();
@@ -682,85 +691,102 @@ void Actor::PreDraw() // calculate actor properties
 	}
 }
 
-void Actor::BeginDraw()
+Actor::LocalTransform::LocalTransform()
 {
-	DISPLAY->PushMatrix(); // Save the current transformation matrix
+	// NaN never compares equal, so the first BeginDraw builds the matrices.
+	std::fill( fKey, fKey+NUM_KEYS, std::numeric_limits<float>::quiet_NaN() );
+}
 
-	// Get the position of the actor
-	const float posX = m_pTempState->pos.x;
-	const float posY = m_pTempState->pos.y;
-	const float posZ = m_pTempState->pos.z;
+void Actor::LocalTransform::Build( const float fNewKey[NUM_KEYS] )
+{
+	std::copy( fNewKey, fNewKey+NUM_KEYS, fKey );
+	const float *pos = &fKey[0], *rotation = &fKey[3], *scale = &fKey[6];
+	const float fHorizAlign = fKey[9], fVertAlign = fKey[10];
+	const float fWidth = fKey[11], fHeight = fKey[12];
+	const float fSkewX = fKey[13], fSkewY = fKey[14];
 
-	if (posX != 0 || posY != 0 || posZ != 0)
+	RageMatrix m;
+	RageMatrixIdentity( &mPlacement );
+	bPlacementIdentity = true;
+	if( pos[0] != 0 || pos[1] != 0 || pos[2] != 0 )
 	{
-		RageMatrix m;
-		RageMatrixTranslate(&m, posX, posY, posZ);
-		DISPLAY->PreMultMatrix(m);
+		RageMatrixTranslate( &m, pos[0], pos[1], pos[2] );
+		RageMatrixMultiply( &mPlacement, &mPlacement, &m );
+		bPlacementIdentity = false;
 	}
-
-	// Get the rotation of the actor
+	if( rotation[0] != 0 || rotation[1] != 0 || rotation[2] != 0 )
 	{
-		const float rotationX = m_pTempState->rotation.x + m_baseRotation.x;
-		const float rotationY = m_pTempState->rotation.y + m_baseRotation.y;
-		const float rotationZ = m_pTempState->rotation.z + m_baseRotation.z;
-
-		if (rotationX != 0 || rotationY != 0 || rotationZ != 0)
-		{
-			RageMatrix m;
-			RageMatrixRotationXYZ(&m, rotationX, rotationY, rotationZ);
-			DISPLAY->PreMultMatrix(m);
-		}
+		RageMatrixRotationXYZ( &m, rotation[0], rotation[1], rotation[2] );
+		RageMatrixMultiply( &mPlacement, &mPlacement, &m );
+		bPlacementIdentity = false;
 	}
-
-	// Get the scale of the actor
+	if( scale[0] != 1 || scale[1] != 1 || scale[2] != 1 )
 	{
-		const float scaleX = m_pTempState->scale.x * m_baseScale.x;
-		const float scaleY = m_pTempState->scale.y * m_baseScale.y;
-		const float scaleZ = m_pTempState->scale.z * m_baseScale.z;
-
-		if (scaleX != 1 || scaleY != 1 || scaleZ != 1)
-		{
-			RageMatrix m;
-			RageMatrixScale(&m, scaleX, scaleY, scaleZ);
-			DISPLAY->PreMultMatrix(m);
-		}
+		RageMatrixScale( &m, scale[0], scale[1], scale[2] );
+		RageMatrixMultiply( &mPlacement, &mPlacement, &m );
+		bPlacementIdentity = false;
 	}
-
-	// Adjust the alignment of the actor
-	if (unlikely(m_fHorizAlign != 0.5f || m_fVertAlign != 0.5f))
+	if( fHorizAlign != 0.5f || fVertAlign != 0.5f )
 	{
-		float fX = SCALE(m_fHorizAlign, 0.0f, 1.0f, +m_size.x / 2.0f, -m_size.x / 2.0f);
-		float fY = SCALE(m_fVertAlign, 0.0f, 1.0f, +m_size.y / 2.0f, -m_size.y / 2.0f);
-		RageMatrix m;
-		RageMatrixTranslate(&m, fX, fY, 0);
-		DISPLAY->PreMultMatrix(m);
+		float fX = SCALE( fHorizAlign, 0.0f, 1.0f, +fWidth / 2.0f, -fWidth / 2.0f );
+		float fY = SCALE( fVertAlign, 0.0f, 1.0f, +fHeight / 2.0f, -fHeight / 2.0f );
+		RageMatrixTranslate( &m, fX, fY, 0 );
+		RageMatrixMultiply( &mPlacement, &mPlacement, &m );
+		bPlacementIdentity = false;
 	}
 
-	// Get the quaternion of the actor
-	const float quatX = m_pTempState->quat.x;
-	const float quatY = m_pTempState->quat.y;
-	const float quatZ = m_pTempState->quat.z;
-	const float quatW = m_pTempState->quat.w;
-
-	if (quatX != 0 || quatY != 0 || quatZ != 0 || quatW != 1)
+	RageMatrixIdentity( &mSkew );
+	bSkewIdentity = true;
+	if( fSkewX != 0 )
 	{
-		RageMatrix mat;
-		RageMatrixFromQuat(&mat, m_pTempState->quat);
-		DISPLAY->MultMatrix(mat);
+		RageMatrixSkewX( &m, fSkewX );
+		RageMatrixMultiply( &mSkew, &mSkew, &m );
+		bSkewIdentity = false;
 	}
-
-	// Get the skew of the actor along the X-axis
-	const float skewX = m_pTempState->fSkewX;
-	if (skewX != 0)
+	if( fSkewY != 0 )
 	{
-		DISPLAY->SkewX(skewX); 
+		RageMatrixSkewY( &m, fSkewY );
+		RageMatrixMultiply( &mSkew, &mSkew, &m );
+		bSkewIdentity = false;
 	}
 
-	// Get the skew of the actor along the Y-axis
-	const float skewY = m_pTempState->fSkewY;
-	if (skewY != 0)
+	RageMatrixMultiply( &mAll, &mPlacement, &mSkew );
+}
+
+void Actor::BeginDraw()
+{
+	DISPLAY->PushMatrix(); // Save the current transformation matrix
+
+	/* Everything the local transform is built from.  The size only matters
+	 * when the actor isn't centered, so leave it out otherwise; sprites
+	 * change size more often than they move. */
+	const TweenState &ts = *m_pTempState;
+	const bool bAligned = unlikely(m_fHorizAlign != 0.5f || m_fVertAlign != 0.5f);
+	const float fKey[LocalTransform::NUM_KEYS] = {
+		ts.pos.x, ts.pos.y, ts.pos.z,
+		ts.rotation.x + m_baseRotation.x, ts.rotation.y + m_baseRotation.y, ts.rotation.z + m_baseRotation.z,
+		ts.scale.x * m_baseScale.x, ts.scale.y * m_baseScale.y, ts.scale.z * m_baseScale.z,
+		m_fHorizAlign, m_fVertAlign,
+		bAligned? m_size.x:0, bAligned? m_size.y:0,
+		ts.fSkewX, ts.fSkewY,
+	};
+	if( memcmp(fKey, m_LocalTransform.fKey, sizeof(fKey)) != 0 )
+		m_LocalTransform.Build( fKey );
+
+	if (likely(ts.quat.x == 0 && ts.quat.y == 0 && ts.quat.z == 0 && ts.quat.w == 1))
+	{
+		if( !m_LocalTransform.bPlacementIdentity || !m_LocalTransform.bSkewIdentity )
+			DISPLAY->PreMultMatrix( m_LocalTransform.mAll );
+	}
+	else
 	{
-		DISPLAY->SkewY(skewY);
+		if( !m_LocalTransform.bPlacementIdentity )
+			DISPLAY->PreMultMatrix( m_LocalTransform.mPlacement );
+		RageMatrix mat;
+		RageMatrixFromQuat( &mat, ts.quat );
+		DISPLAY->MultMatrix( mat );
+		if( !m_LocalTransform.bSkewIdentity )
+			DISPLAY->PreMultMatrix( m_LocalTransform.mSkew );
 	}
 
 	// If the texture is not at the origin, translate the texture
@@ -808,8 +834,8 @@ void Actor::EndDraw()
 
 void Actor::CalcPercentThroughTween()
 {
-	TweenState& TS = m_Tweens[0]->state;
-	TweenInfo& TI = m_Tweens[0]->info;
+	TweenState& TS = m_Tweens.front().state;
+	TweenInfo& TI = m_Tweens.front().info;
 	const float percent_through = 1 - (TI.m_fTimeLeftInTween / TI.m_fTweenTime);
 	// distort the percentage if appropriate
 	float percent_along = TI.m_pTween->Tween(percent_through);
@@ -821,7 +847,7 @@ void Actor::UpdateTweening(float fDeltaTime)
 {
 	if (fDeltaTime < 0.0 && !m_Tweens.empty())
 	{
-		m_Tweens[0]->info.m_fTimeLeftInTween -= fDeltaTime;
+		m_Tweens.front().info.m_fTimeLeftInTween -= fDeltaTime;
 		CalcPercentThroughTween();
 		return;
 	}
@@ -830,9 +856,9 @@ void Actor::UpdateTweening(float fDeltaTime)
 	{
 		// update current tween state
 		// earliest tween
-		auto& firstTween = m_Tweens[0];
-		TweenState& TS = firstTween->state;
-		TweenInfo& TI = firstTween->info;
+		TweenStateAndInfo &firstTween = m_Tweens.front();
+		TweenState& TS = firstTween.state;
+		TweenInfo& TI = firstTween.info;
 
 		bool bBeginning = TI.m_fTimeLeftInTween == TI.m_fTweenTime;
 
@@ -852,8 +878,7 @@ void Actor::UpdateTweening(float fDeltaTime)
 			m_current = TS;
 
 			// delete the head tween
-			delete firstTween;
-			m_Tweens.erase(m_Tweens.begin());
+			m_Tweens.pop_front();
 			EraseHeadTween();
 		}
 		else    // in the middle of tweening. Recalcute the current position.
@@ -881,6 +906,11 @@ bool Actor::IsFirstUpdate() const
 	return m_bFirstUpdate;
 }
 
+/* Actor::Update calls this frame and last frame.  A sleeping ActorFrame
+ * counts once; its children aren't visited. */
+static int g_iActorsUpdated = 0, g_iActorsSkipped = 0;
+static int g_iLastFrameActorsUpdated = 0, g_iLastFrameActorsSkipped = 0;
+
 void Actor::Update( float fDeltaTime )
 {
 //	LOG->Trace( "Actor::Update( %f )", fDeltaTime );
@@ -895,6 +925,13 @@ void Actor::Update( float fDeltaTime )
 
 	ASSERT_M( fDeltaTime >= 0, ssprintf("DeltaTime: %f",fDeltaTime) );
 
+	if( m_bAsleep )
+	{
+		++g_iActorsSkipped;
+		return;
+	}
+	++g_iActorsUpdated;
+
 	if( m_fHibernateSecondsLeft > 0 )
 	{
 		m_fHibernateSecondsLeft -= fDeltaTime;
@@ -913,6 +950,46 @@ void Actor::Update( float fDeltaTime )
 	}
 
 	this->UpdateInternal( fDeltaTime );
+
+	if( g_bSleepIdleActors && CanSleep() )
+		m_bAsleep = true;
+}
+
+void Actor::WakeUp()
+{
+	m_bAsleep = false;
+	for( Actor *p = m_pParent; p != nullptr && p->m_bAsleep; p = p->m_pParent )
+		p->m_bAsleep = false;
+}
+
+bool Actor::HasUpdateWork() const
+{
+	if( m_bFirstUpdate || !m_Tweens.empty() || m_Effect != no_effect ||
+		m_fHibernateSecondsLeft > 0 || !m_WrapperStates.empty() )
+		return true;
+
+	/* The effect delta for the other clocks is the change since the last
+	 * update, which would be the whole time spent asleep. */
+	return m_tween_uses_effect_delta && m_EffectClock != CLOCK_TIMER;
+}
+
+bool Actor::CanSleep() const
+{
+	if( typeid(*this) != typeid(Actor) && typeid(*this) != typeid(HiddenActor) )
+		return false;
+	return !HasUpdateWork();
+}
+
+void Actor::EndUpdateFrame()
+{
+	g_iLastFrameActorsUpdated = g_iActorsUpdated;
+	g_iLastFrameActorsSkipped = g_iActorsSkipped;
+	g_iActorsUpdated = g_iActorsSkipped = 0;
+}
+
+RString Actor::GetUpdateStats()
+{
+	return ssprintf( "Actors: %i updated, %i asleep", g_iLastFrameActorsUpdated, g_iLastFrameActorsSkipped );
 }
 
 static void generic_global_timer_update(float new_time, float& effect_delta_time, float& time_into_effect)
@@ -1003,6 +1080,7 @@ void Actor::AddWrapperState()
 	ActorFrame* wrapper= new ActorFrame;
 	wrapper->InitState();
 	m_WrapperStates.push_back(wrapper);
+	WakeUp();
 }
 
 void Actor::RemoveWrapperState(size_t i)
@@ -1018,7 +1096,7 @@ Actor* Actor::GetWrapperState(size_t i)
 	return m_WrapperStates[i];
 }
 
-void Actor::BeginTweening( float time, ITween *pTween )
+void Actor::BeginTweening( float time, ITweenPtr pTween )
 {
 	ASSERT( time >= 0 );
 
@@ -1031,16 +1109,17 @@ void Actor::BeginTweening( float time, ITween *pTween )
 	}
 
 	// add a new TweenState to the tail, and initialize it
-	m_Tweens.push_back( new TweenStateAndInfo );
+	m_Tweens.push_back();
+	WakeUp();
 
 	// latest
-	TweenState &TS = m_Tweens.back()->state;
-	TweenInfo  &TI = m_Tweens.back()->info;
+	TweenState &TS = m_Tweens.back().state;
+	TweenInfo  &TI = m_Tweens.back().info;
 
 	if( m_Tweens.size() >= 2 )		// if there was already a TS on the stack
 	{
 		// initialize the new TS from the last TS in the list
-		TS = m_Tweens[m_Tweens.size()-2]->state;
+		TS = m_Tweens[m_Tweens.size()-2].state;
 	}
 	else
 	{
@@ -1049,7 +1128,7 @@ void Actor::BeginTweening( float time, ITween *pTween )
 		TS = m_current;
 	}
 
-	TI.m_pTween = pTween;
+	TI.m_pTween = std::move( pTween );
 	TI.m_fTweenTime = time;
 	TI.m_fTimeLeftInTween = time;
 }
@@ -1058,14 +1137,11 @@ void Actor::BeginTweening( float time, TweenType tt )
 {
 	ASSERT( time >= 0 );
 
-	ITween *pTween = ITween::CreateFromType( tt );
-	this->BeginTweening( time, pTween );
+	this->BeginTweening( time, ITween::CreateFromType(tt) );
 }
 
 void Actor::StopTweening()
 {
-	for( unsigned i = 0; i < m_Tweens.size(); ++i )
-		delete m_Tweens[i];
 	m_Tweens.clear();
 }
 
@@ -1078,10 +1154,10 @@ void Actor::FinishTweening()
 
 void Actor::HurryTweening( float factor )
 {
-	for( unsigned i = 0; i < m_Tweens.size(); ++i )
+	for( int i = 0; i < m_Tweens.size(); ++i )
 	{
-		m_Tweens[i]->info.m_fTimeLeftInTween *= factor;
-		m_Tweens[i]->info.m_fTweenTime *= factor;
+		m_Tweens[i].info.m_fTimeLeftInTween *= factor;
+		m_Tweens[i].info.m_fTweenTime *= factor;
 	}
 }
 
@@ -1213,6 +1289,7 @@ void Actor::ResetEffectTimeIfDifferent(Effect new_effect)
 		m_Effect= new_effect;
 		m_fSecsIntoEffect = 0;
 	}
+	WakeUp();
 }
 
 void Actor::SetEffectDiffuseBlink( float fEffectPeriodSeconds, RageColor c1, RageColor c2 )
@@ -1297,6 +1374,7 @@ void Actor::SetEffectBounce( float fPeriod, RageVector3 vect )
 	ASSERT( fPeriod > 0 );
 	// todo: account for SSC_FUTURES -aj
 	m_Effect = bounce;
+	WakeUp();
 	SetEffectPeriod( fPeriod );
 	m_vEffectMagnitude = vect;
 	m_fSecsIntoEffect = 0;
@@ -1306,6 +1384,7 @@ void Actor::SetEffectBob( float fPeriod, RageVector3 vect )
 {
 	ASSERT( fPeriod > 0 );
 	// todo: account for SSC_FUTURES -aj
+	WakeUp();
 	if( m_Effect!=bob || GetEffectPeriod() != fPeriod )
 	{
 		m_Effect = bob;
@@ -1320,6 +1399,7 @@ void Actor::SetEffectSpin( RageVector3 vect )
 	// todo: account for SSC_FUTURES -aj
 	m_Effect = spin;
 	m_vEffectMagnitude = vect;
+	WakeUp();
 }
 
 void Actor::SetEffectVibrate( RageVector3 vect )
@@ -1327,6 +1407,7 @@ void Actor::SetEffectVibrate( RageVector3 vect )
 	// todo: account for SSC_FUTURES -aj
 	m_Effect = vibrate;
 	m_vEffectMagnitude = vect;
+	WakeUp();
 }
 
 void Actor::SetEffectPulse( float fPeriod, float fMinZoom, float fMaxZoom )
@@ -1334,6 +1415,7 @@ void Actor::SetEffectPulse( float fPeriod, float fMinZoom, float fMaxZoom )
 	ASSERT( fPeriod > 0 );
 	// todo: account for SSC_FUTURES -aj
 	m_Effect = pulse;
+	WakeUp();
 	SetEffectPeriod( fPeriod );
 	m_vEffectMagnitude[0] = fMinZoom;
 	m_vEffectMagnitude[1] = fMaxZoom;
@@ -1363,7 +1445,10 @@ void Actor::RunCommands( const LuaReference& cmds, const LuaReference *pParamTab
 		return;
 	}
 
-	Lua *L = LUA->Get();
+	/* Commands can change anything. */
+	WakeUp();
+
+	Lua *L = LUA->Get( "Actor::RunCommands" );
 
 	// function
 	cmds.PushSelf( L );
@@ -1396,8 +1481,8 @@ float Actor::GetTweenTimeLeft() const
 
 	tot += m_fHibernateSecondsLeft;
 
-	for( unsigned i=0; i<m_Tweens.size(); ++i )
-		tot += m_Tweens[i]->info.m_fTimeLeftInTween;
+	for( int i=0; i<m_Tweens.size(); ++i )
+		tot += m_Tweens[i].info.m_fTimeLeftInTween;
 
 	return tot;
 }
@@ -1413,11 +1498,11 @@ void Actor::SetGlobalDiffuseColor( RageColor c )
 {
 	for( int i=0; i<NUM_DIFFUSE_COLORS; i++ ) // color, not alpha
 	{
-		for( unsigned ts = 0; ts < m_Tweens.size(); ++ts )
+		for( int ts = 0; ts < m_Tweens.size(); ++ts )
 		{
-			m_Tweens[ts]->state.diffuse[i].r = c.r;
-			m_Tweens[ts]->state.diffuse[i].g = c.g;
-			m_Tweens[ts]->state.diffuse[i].b = c.b;
+			m_Tweens[ts].state.diffuse[i].r = c.r;
+			m_Tweens[ts].state.diffuse[i].g = c.g;
+			m_Tweens[ts].state.diffuse[i].b = c.b;
 		}
 		m_current.diffuse[i].r = c.r;
 		m_current.diffuse[i].g = c.g;
@@ -1474,28 +1559,22 @@ bool Actor::TweenState::operator==(const TweenState& other) const {
 
 void Actor::TweenState::MakeWeightedAverage( TweenState& average_out, const TweenState& ts1, const TweenState& ts2, float fPercentBetween )
 {
-	average_out.pos		= lerp( fPercentBetween, ts1.pos,         ts2.pos );
-	average_out.scale	= lerp( fPercentBetween, ts1.scale,       ts2.scale );
-	average_out.rotation	= lerp( fPercentBetween, ts1.rotation,    ts2.rotation );
-	RageQuatSlerp( &average_out.quat, ts1.quat, ts2.quat, fPercentBetween );
-	average_out.fSkewX	= lerp( fPercentBetween, ts1.fSkewX,      ts2.fSkewX );
-	average_out.fSkewY	= lerp( fPercentBetween, ts1.fSkewY,      ts2.fSkewY );
-
-	average_out.crop.left	= lerp( fPercentBetween, ts1.crop.left,   ts2.crop.left	);
-	average_out.crop.top	= lerp( fPercentBetween, ts1.crop.top,    ts2.crop.top );
-	average_out.crop.right	= lerp( fPercentBetween, ts1.crop.right,  ts2.crop.right );
-	average_out.crop.bottom	= lerp( fPercentBetween, ts1.crop.bottom, ts2.crop.bottom );
-
-	average_out.fade.left	= lerp( fPercentBetween, ts1.fade.left,   ts2.fade.left );
-	average_out.fade.top	= lerp( fPercentBetween, ts1.fade.top,    ts2.fade.top );
-	average_out.fade.right	= lerp( fPercentBetween, ts1.fade.right,  ts2.fade.right );
-	average_out.fade.bottom	= lerp( fPercentBetween, ts1.fade.bottom, ts2.fade.bottom );
-
-	for( int i=0; i<NUM_DIFFUSE_COLORS; ++i )
-		average_out.diffuse[i] = lerp( fPercentBetween, ts1.diffuse[i], ts2.diffuse[i] );
-
-	average_out.glow	= lerp( fPercentBetween, ts1.glow,        ts2.glow );
-	average_out.aux		= lerp( fPercentBetween, ts1.aux,         ts2.aux );
+	/* Everything before the quaternion is a float, interpolated on its own,
+	 * so do them all in one loop the compiler can vectorize. */
+	static_assert( offsetof(TweenState, quat) % sizeof(float) == 0, "TweenState must be floats" );
+	static_assert( sizeof(TweenState) == offsetof(TweenState, quat) + sizeof(RageVector4), "TweenState must be floats" );
+	const int iNumFloats = offsetof( TweenState, quat ) / sizeof(float);
+	const float *p1 = reinterpret_cast<const float *>( &ts1 );
+	const float *p2 = reinterpret_cast<const float *>( &ts2 );
+	float *pOut = reinterpret_cast<float *>( &average_out );
+	for( int i = 0; i < iNumFloats; ++i )
+		pOut[i] = fPercentBetween * (p2[i] - p1[i]) + p1[i];
+
+	// Most actors never use the quaternion.
+	if( ts1.quat == ts2.quat )
+		average_out.quat = ts1.quat;
+	else
+		RageQuatSlerp( &average_out.quat, ts1.quat, ts2.quat, fPercentBetween );
 }
 
 void Actor::Sleep( float time )
@@ -1509,7 +1588,7 @@ void Actor::Sleep( float time )
 void Actor::QueueCommand( const RString& sCommandName )
 {
 	BeginTweening( 0, TWEEN_LINEAR );
-	TweenInfo  &TI = m_Tweens.back()->info;
+	TweenInfo  &TI = m_Tweens.back().info;
 	TI.m_sCommandName = sCommandName;
 }
 
@@ -1519,7 +1598,7 @@ void Actor::QueueMessage( const RString& sMessageName )
 	// command, so we don't have to add yet another element to every tween
 	// state for this rarely-used command.
 	BeginTweening( 0, TWEEN_LINEAR );
-	TweenInfo &TI = m_Tweens.back()->info;
+	TweenInfo &TI = m_Tweens.back().info;
 	TI.m_sCommandName = "!" + sMessageName;
 }
 
@@ -1581,8 +1660,9 @@ void Actor::PushContext( lua_State *L )
 void Actor::SetParent( Actor *pParent )
 {
 	m_pParent = pParent;
+	WakeUp();
 
-	Lua *L = LUA->Get();
+	Lua *L = LUA->Get( "Actor::SetParent" );
 		int iTop = lua_gettop( L );
 
 		this->PushContext( L );
@@ -1594,30 +1674,60 @@ void Actor::SetParent( Actor *pParent )
 	LUA->Release( L );
 }
 
-Actor::TweenInfo::TweenInfo()
+Actor::TweenQueue::TweenQueue():
+	m_pSlots( m_Inline ), m_iCapacity( NUM_INLINE ), m_iHead( 0 ), m_iSize( 0 )
 {
-	m_pTween = nullptr;
 }
 
-Actor::TweenInfo::~TweenInfo()
+Actor::TweenQueue::TweenQueue( const TweenQueue &cpy ):
+	TweenQueue()
 {
-	delete m_pTween;
+	*this = cpy;
 }
 
-Actor::TweenInfo::TweenInfo( const TweenInfo &cpy )
+Actor::TweenQueue &Actor::TweenQueue::operator=( const TweenQueue &rhs )
 {
-	m_pTween = nullptr;
-	*this = cpy;
+	if( this == &rhs )
+		return *this;
+	clear();
+	for( int i = 0; i < rhs.size(); ++i )
+		push_back() = rhs[i];
+	return *this;
 }
 
-Actor::TweenInfo &Actor::TweenInfo::operator=( const TweenInfo &rhs )
+Actor::TweenStateAndInfo &Actor::TweenQueue::push_back()
 {
-	delete m_pTween;
-	m_pTween = (rhs.m_pTween? rhs.m_pTween->Copy():nullptr);
-	m_fTimeLeftInTween = rhs.m_fTimeLeftInTween;
-	m_fTweenTime = rhs.m_fTweenTime;
-	m_sCommandName = rhs.m_sCommandName;
-	return *this;
+	if( m_iSize == m_iCapacity )
+	{
+		const int iNewCapacity = m_iCapacity * 2;
+		std::unique_ptr<TweenStateAndInfo[]> pNew( new TweenStateAndInfo[iNewCapacity] );
+		for( int i = 0; i < m_iSize; ++i )
+			pNew[i] = std::move( (*this)[i] );
+		m_pHeap = std::move( pNew );
+		m_pSlots = m_pHeap.get();
+		m_iCapacity = iNewCapacity;
+		m_iHead = 0;
+	}
+
+	++m_iSize;
+	return back();
+}
+
+void Actor::TweenQueue::pop_front()
+{
+	ASSERT( m_iSize > 0 );
+	/* Drop the interpolator and command now, rather than when the slot is
+	 * reused. */
+	front().info = TweenInfo();
+	m_iHead = (m_iHead + 1) & (m_iCapacity - 1);
+	--m_iSize;
+}
+
+void Actor::TweenQueue::clear()
+{
+	while( m_iSize > 0 )
+		pop_front();
+	m_iHead = 0;
 }
 
 // lua start
@@ -1691,10 +1801,10 @@ public:
 			LuaHelpers::ReportScriptErrorFmt("Lua: tween(%f): tween time must not be negative", fTime);
 			COMMON_RETURN_SELF;
 		}
-		ITween *pTween = ITween::CreateFromStack( L, 2 );
+		ITweenPtr pTween = ITween::CreateFromStack( L, 2 );
 		if(pTween != nullptr)
 		{
-			p->BeginTweening(fTime, pTween);
+			p->BeginTweening(fTime, std::move(pTween));
 		}
 		COMMON_RETURN_SELF;
 	}
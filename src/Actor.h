@@ -14,6 +14,7 @@ class LuaClass;
 
 #include <cstddef>
 #include <map>
+#include <memory>
 #include <vector>
 
 typedef AutoPtrCopyOnWrite<LuaReference> apActorCommands;
@@ -209,10 +210,12 @@ public:
 		bool operator==( const TweenState &other ) const;
 		bool operator!=( const TweenState &other ) const { return !operator==(other); }
 
+		/* Everything up to quat is floats, and is interpolated linearly;
+		 * MakeWeightedAverage relies on that. */
+
 		// start and end position for tweening
 		RageVector3	pos;
 		RageVector3	rotation;
-		RageVector4	quat;
 		RageVector3	scale;
 		float		fSkewX, fSkewY;
 		/**
@@ -234,6 +237,8 @@ public:
 		RageColor	glow;
 		/** @brief A magical value that nobody really knows the use for. ;) */
 		float		aux;
+
+		RageVector4	quat;
 	};
 
 	// PartiallyOpaque broken out of Draw for reuse and clarity.
@@ -285,13 +290,29 @@ public:
 	virtual void Update( float fDeltaTime );		// this can short circuit UpdateInternal
 	virtual void UpdateInternal( float fDeltaTime );	// override this
 	void UpdateTweening( float fDeltaTime );
+
+	/* An actor with nothing to animate falls asleep after an update, and
+	 * Update returns immediately until something wakes it: a command, a new
+	 * tween or effect, or a new child.  A sleeping ActorFrame's children are
+	 * all asleep, so its whole subtree is skipped.  WakeUp also wakes the
+	 * parents. */
+	bool IsAsleep() const { return m_bAsleep; }
+	void WakeUp();
+	/* Return true if Update would have nothing to do.  Only classes that know
+	 * everything their Update does override this; anything derived from them
+	 * that overrides Update stays awake. */
+	virtual bool CanSleep() const;
+	/* Actors updated and skipped while asleep last frame, for the stats overlay.
+	 * Call EndUpdateFrame once per frame. */
+	static void EndUpdateFrame();
+	static RString GetUpdateStats();
 	void CalcPercentThroughTween();
 	// These next functions should all be overridden by a derived class that has its own tweening states to handle.
 	virtual void SetCurrentTweenStart() {}
 	virtual void EraseHeadTween() {}
 	virtual void UpdatePercentThroughTween( float PercentThroughTween ) {}
 	bool get_tween_uses_effect_delta() { return m_tween_uses_effect_delta; }
-	void set_tween_uses_effect_delta(bool t) { m_tween_uses_effect_delta= t; }
+	void set_tween_uses_effect_delta(bool t) { m_tween_uses_effect_delta= t; WakeUp(); }
 
 	/**
 	 * @brief Retrieve the Actor's name.
@@ -485,7 +506,7 @@ public:
 	void SetAux( float f )				{ DestTweenState().aux = f; }
 	float GetAux() const				{ return m_current.aux; }
 
-	virtual void BeginTweening( float time, ITween *pInterp );
+	virtual void BeginTweening( float time, ITweenPtr pInterp );
 	virtual void BeginTweening( float time, TweenType tt = TWEEN_LINEAR );
 	virtual void StopTweening();
 	void Sleep( float time );
@@ -500,7 +521,7 @@ public:
 		if( m_Tweens.empty() )	// not tweening
 			return m_current;
 		else
-			return m_Tweens.back()->state;
+			return m_Tweens.back().state;
 	}
 	const TweenState& DestTweenState() const { return const_cast<Actor*>(this)->DestTweenState(); }
 
@@ -579,11 +600,11 @@ public:
 	void SetShadowLengthY( float fLengthY )		{ m_fShadowLengthY = fLengthY; }
 	void SetShadowColor( RageColor c )		{ m_ShadowColor = c; }
 	// TODO: Implement hibernate as a tween type?
-	void SetHibernate( float fSecs )		{ m_fHibernateSecondsLeft = fSecs; }
+	void SetHibernate( float fSecs )		{ m_fHibernateSecondsLeft = fSecs; WakeUp(); }
 	void SetDrawOrder( int iOrder )			{ m_iDrawOrder = iOrder; }
 	int GetDrawOrder() const			{ return m_iDrawOrder; }
 
-	virtual void EnableAnimation( bool b ) 		{ m_bIsAnimating = b; }	// Sprite needs to overload this
+	virtual void EnableAnimation( bool b ) 		{ m_bIsAnimating = b; WakeUp(); }	// Sprite needs to overload this
 	void StartAnimating()				{ this->EnableAnimation(true); }
 	void StopAnimating()				{ this->EnableAnimation(false); }
 
@@ -657,13 +678,7 @@ protected:
 	/** @brief Some general information about the Tween. */
 	struct TweenInfo
 	{
-		// counters for tweening
-		TweenInfo();
-		~TweenInfo();
-		TweenInfo( const TweenInfo &cpy );
-		TweenInfo &operator=( const TweenInfo &rhs );
-
-		ITween		*m_pTween;
+		ITweenPtr	m_pTween;
 		/** @brief How far into the tween are we? */
 		float		m_fTimeLeftInTween;
 		/** @brief The number of seconds between Start and End positions/zooms. */
@@ -687,12 +702,65 @@ protected:
 		TweenState state;
 		TweenInfo info;
 	};
-	std::vector<TweenStateAndInfo *>	m_Tweens;
+
+	/* The queued tweens, oldest first, in a ring.  The first few live inside
+	 * the actor, so a typical command doesn't allocate; a longer queue moves
+	 * to the heap, and keeps that storage for the next one. */
+	class TweenQueue
+	{
+	public:
+		TweenQueue();
+		TweenQueue( const TweenQueue &cpy );
+		TweenQueue &operator=( const TweenQueue &rhs );
+
+		bool empty() const { return m_iSize == 0; }
+		int size() const { return m_iSize; }
+		TweenStateAndInfo &operator[]( int i ) { return m_pSlots[(m_iHead + i) & (m_iCapacity - 1)]; }
+		const TweenStateAndInfo &operator[]( int i ) const { return m_pSlots[(m_iHead + i) & (m_iCapacity - 1)]; }
+		TweenStateAndInfo &front() { return (*this)[0]; }
+		TweenStateAndInfo &back() { return (*this)[m_iSize - 1]; }
+
+		/* Add an empty tween to the end, and return it.  This may move the
+		 * others. */
+		TweenStateAndInfo &push_back();
+		void pop_front();
+		void clear();
+
+	private:
+		enum { NUM_INLINE = 4 }; // must be a power of two
+		TweenStateAndInfo m_Inline[NUM_INLINE];
+		std::unique_ptr<TweenStateAndInfo[]> m_pHeap;
+		TweenStateAndInfo *m_pSlots;
+		int m_iCapacity, m_iHead, m_iSize;
+	};
+	TweenQueue	m_Tweens;
 
 	/** @brief Temporary variables that are filled just before drawing */
 	TweenState *m_pTempState;
 
+	/* BeginDraw's local transform, and the state it was built from, so it's
+	 * only rebuilt when the state changes.  The quaternion is applied from the
+	 * other side, between the alignment and the skew, so those are kept apart. */
+	struct LocalTransform
+	{
+		enum { NUM_KEYS = 15 };
+		float fKey[NUM_KEYS];
+		RageMatrix mPlacement;	// translate, rotate, scale, align
+		RageMatrix mSkew;
+		RageMatrix mAll;	// mPlacement * mSkew
+		bool bPlacementIdentity, bSkewIdentity;
+
+		LocalTransform();
+		void Build( const float fNewKey[NUM_KEYS] );
+	};
+	LocalTransform m_LocalTransform;
+
 	bool	m_bFirstUpdate;
+	bool	m_bAsleep;
+
+	/* True if the base Actor part of Update has work: tweens, an effect,
+	 * hibernation or wrapper states. */
+	bool HasUpdateWork() const;
 
 	// Stuff for alignment
 	/** @brief The particular horizontal alignment.
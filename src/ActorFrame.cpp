@@ -11,6 +11,7 @@
 #include "ScreenDimensions.h"
 
 #include <cstdint>
+#include <typeinfo>
 #include <vector>
 
 /* Tricky: We need ActorFrames created in Lua to auto delete their children.
@@ -501,6 +502,20 @@ void ActorFrame::UpdateInternal( float fDeltaTime )
 	}
 }
 
+bool ActorFrame::CanSleep() const
+{
+	if( typeid(*this) != typeid(ActorFrame) || HasUpdateWork() || !m_UpdateFunction.IsNil() )
+		return false;
+
+	/* A child that's somebody else's child wouldn't wake us up. */
+	for( Actor *pActor : m_SubActors )
+	{
+		if( !pActor->IsAsleep() || pActor->GetParent() != this )
+			return false;
+	}
+	return true;
+}
+
 #define PropagateActorFrameCommand( cmd ) \
 	void ActorFrame::cmd()				\
 	{									\
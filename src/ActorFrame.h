@@ -47,7 +47,7 @@ public:
 	void SetDrawByZPosition( bool b );
 
 	void SetDrawFunction( const LuaReference &DrawFunction ) { m_DrawFunction = DrawFunction; }
-	void SetUpdateFunction( const LuaReference &UpdateFunction ) { m_UpdateFunction = UpdateFunction; }
+	void SetUpdateFunction( const LuaReference &UpdateFunction ) { m_UpdateFunction = UpdateFunction; WakeUp(); }
 
 	LuaReference GetDrawFunction() const { return m_DrawFunction; }
 	virtual bool AutoLoadChildren() const { return false; } // derived classes override to automatically LoadChildrenFromNode
@@ -67,6 +67,7 @@ public:
 	virtual void RunCommandsOnLeaves( const LuaReference& cmds, const LuaReference *pParamTable = nullptr ); /* but not on self */
 
 	virtual void UpdateInternal( float fDeltaTime );
+	virtual bool CanSleep() const;
 	virtual void BeginDraw();
 	virtual void DrawPrimitives();
 	virtual void EndDraw();
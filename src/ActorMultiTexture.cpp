@@ -72,6 +72,9 @@ int ActorMultiTexture::AddTexture( RageTexture *pTexture )
 	}
 	LOG->Trace( "ActorMultiTexture::AddTexture( %s )", pTexture->GetID().filename.c_str() );
 
+	// We use our own texture coordinates, so it can't stay in an atlas.
+	pTexture->RemoveFromAtlas();
+
 	m_aTextureUnits.push_back( TextureUnitState() );
 	m_aTextureUnits.back().m_pTexture = TEXTUREMAN->CopyTexture( pTexture );
 	return m_aTextureUnits.size();
@@ -133,6 +133,9 @@ void ActorMultiVertex::SetTexture( RageTexture *Texture )
 	{
 		UnloadTexture();
 		_Texture = Texture;
+		// We use our own texture coordinates, so it can't stay in an atlas.
+		if( _Texture != nullptr )
+			_Texture->RemoveFromAtlas();
 	}
 }
 
@@ -621,9 +624,9 @@ void ActorMultiVertex::UpdatePercentThroughTween( float PercentThroughTween )
 	AMV_TweenState::MakeWeightedAverage( AMV_current, AMV_start, AMV_Tweens[0], PercentThroughTween );
 }
 
-void ActorMultiVertex::BeginTweening( float time, ITween *pTween )
+void ActorMultiVertex::BeginTweening( float time, ITweenPtr pTween )
 {
-	Actor::BeginTweening( time, pTween );
+	Actor::BeginTweening( time, std::move(pTween) );
 
 	if (!AMV_Tweens.empty()) // if there was already a TS on the stack
 	{
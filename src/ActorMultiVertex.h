@@ -80,7 +80,7 @@ public:
 	void SetCurrentTweenStart() override;
 	void EraseHeadTween() override;
 	void UpdatePercentThroughTween( float PercentThroughTween ) override;
-	void BeginTweening( float time, ITween *pInterp ) override;
+	void BeginTweening( float time, ITweenPtr pInterp ) override;
 
 	void StopTweening() override;
 	void FinishTweening() override;
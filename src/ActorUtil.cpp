@@ -47,11 +47,15 @@ bool ActorUtil::ResolvePath( RString &sPath, const RString &sName, bool optional
 
 	// If we know this is an exact match, don't bother with the GetDirListing,
 	// so "foo" doesn't partial match "foobar" if "foo" exists.
-	RageFileManager::FileType ft = FILEMAN->GetFileType( sPath );
+	// Files in the theme are answered from THEME's index.
+	RageFileManager::FileType ft;
+	if( !THEME->GetIndexedFileType(sPath, ft) )
+		ft = FILEMAN->GetFileType( sPath );
 	if( ft != RageFileManager::TYPE_FILE && ft != RageFileManager::TYPE_DIR )
 	{
 		std::vector<RString> asPaths;
-		GetDirListing( sPath + "*", asPaths, false, true );	// return path too
+		if( !THEME->GetIndexedFiles(sPath, false, asPaths) )
+			GetDirListing( sPath + "*", asPaths, false, true );	// return path too
 
 		if( asPaths.empty() )
 		{
@@ -67,6 +71,7 @@ bool ActorUtil::ResolvePath( RString &sPath, const RString &sName, bool optional
 				break;
 			case Dialog::retry:
 				FILEMAN->FlushDirCache();
+				THEME->RebuildPathIndex();
 				return ResolvePath( sPath, sName );
 			case Dialog::ignore:
 				return false;
@@ -88,6 +93,7 @@ bool ActorUtil::ResolvePath( RString &sPath, const RString &sName, bool optional
 				break;
 			case Dialog::retry:
 				FILEMAN->FlushDirCache();
+				THEME->RebuildPathIndex();
 				return ResolvePath( sPath, sName );
 			case Dialog::ignore:
 				asPaths.erase( asPaths.begin()+1, asPaths.end() );
@@ -103,7 +109,7 @@ bool ActorUtil::ResolvePath( RString &sPath, const RString &sName, bool optional
 	if( ft == RageFileManager::TYPE_DIR )
 	{
 		RString sLuaPath = sPath + "/default.lua";
-		if( DoesFileExist(sLuaPath) )
+		if( THEME->DoesIndexedFileExist(sLuaPath) )
 		{
 			sPath = sLuaPath;
 			return true;
@@ -240,14 +246,10 @@ namespace
 {
 	XNode *LoadXNodeFromLuaShowErrors( const RString &sFile )
 	{
-		RString sScript;
-		if( !GetFileContents(sFile, sScript) )
-			return nullptr;
-
 		Lua *L = LUA->Get();
 
 		RString sError;
-		if( !LuaHelpers::LoadScript(L, sScript, "@" + sFile, sError) )
+		if( !LuaHelpers::LoadScriptFile(L, sFile, sError) )
 		{
 			LUA->Release( L );
 			sError = ssprintf( "Lua runtime error: %s", sError.c_str() );
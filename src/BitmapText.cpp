@@ -12,6 +12,7 @@
 
 #include <cmath>
 #include <cstddef>
+#include <typeinfo>
 #include <vector>
 
 
@@ -120,6 +121,11 @@ BitmapText::BitmapText( const BitmapText &cpy ):
 	*this = cpy;
 }
 
+bool BitmapText::CanSleep() const
+{
+	return typeid(*this) == typeid(BitmapText) && !HasUpdateWork();
+}
+
 void BitmapText::SetCurrentTweenStart()
 {
 	BMT_start= BMT_current;
@@ -137,9 +143,9 @@ void BitmapText::UpdatePercentThroughTween(float between)
 		between);
 }
 
-void BitmapText::BeginTweening(float time, ITween* interp)
+void BitmapText::BeginTweening(float time, ITweenPtr interp)
 {
-	Actor::BeginTweening(time, interp);
+	Actor::BeginTweening(time, std::move(interp));
 	if(!BMT_Tweens.empty())
 	{
 		BMT_Tweens.push_back(BMT_Tweens.back());
@@ -47,10 +47,11 @@ public:
 	}
 	BMT_TweenState const& BMT_DestTweenState() const { return const_cast<BitmapText*>(this)->BMT_DestTweenState(); }
 
+	virtual bool CanSleep() const override;
 	virtual void SetCurrentTweenStart() override;
 	virtual void EraseHeadTween() override;
 	virtual void UpdatePercentThroughTween(float between) override;
-	virtual void BeginTweening(float time, ITween* interp) override;
+	virtual void BeginTweening(float time, ITweenPtr interp) override;
 	// This function exists because the compiler tried to connect a call of
 	// "BeginTweening(1.2f)" to the function above. -Kyz
 	virtual void BeginTweening(float time, TweenType tt = TWEEN_LINEAR) override
@@ -287,12 +287,14 @@ else() # Unix/Linux
   if(LINUX)
     list(APPEND SMDATA_ARCH_INPUT_SRC
                 "arch/InputHandler/LinuxInputManager.cpp"
+                "arch/InputHandler/LinuxEventClock.cpp"
                 "arch/InputHandler/InputHandler_Linux_Joystick.cpp"
                 "arch/InputHandler/InputHandler_Linux_Event.cpp"
                 "arch/InputHandler/InputHandler_Linux_PIUIO.cpp"
                 "arch/InputHandler/InputHandler_SextetStream.cpp")
     list(APPEND SMDATA_ARCH_INPUT_SRC
                 "arch/InputHandler/LinuxInputManager.h"
+                "arch/InputHandler/LinuxEventClock.h"
                 "arch/InputHandler/InputHandler_Linux_Joystick.h"
                 "arch/InputHandler/InputHandler_Linux_Event.h"
                 "arch/InputHandler/InputHandler_Linux_PIUIO.h"
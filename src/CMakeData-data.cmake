@@ -174,6 +174,7 @@ source_group("Data Structures\\\\Steps and Styles"
              ${SM_DATA_STEPS_HPP})
 
 list(APPEND SM_DATA_REST_SRC
+            "ActiveHolds.cpp"
             "AdjustSync.cpp"
             "Attack.cpp"
             "AutoKeysounds.cpp"
@@ -198,11 +199,16 @@ list(APPEND SM_DATA_REST_SRC
             "GameConstantsAndTypes.cpp"
             "GameInput.cpp"
             "GameplayAssist.cpp"
+            "GameplayReplay.cpp"
+            "GameplayTelemetry.cpp"
             "GamePreferences.cpp"
             "Grade.cpp"
             "HighScore.cpp"
             "Inventory.cpp"
             "JsonUtil.cpp"
+            "JudgmentIndex.cpp"
+            "JudgmentThread.cpp"
+            "LifeRecord.cpp"
             "LocalizedString.cpp"
             "LyricsLoader.cpp"
             "ModsGroup.cpp"
@@ -226,6 +232,7 @@ list(APPEND SM_DATA_REST_SRC
             "TitleSubstitution.cpp")
 
 list(APPEND SM_DATA_REST_HPP
+            "ActiveHolds.h"
             "AdjustSync.h"
             "Attack.h"
             "AutoKeysounds.h"
@@ -250,12 +257,17 @@ list(APPEND SM_DATA_REST_HPP
             "GameConstantsAndTypes.h"
             "GameInput.h"
             "GameplayAssist.h"
+            "GameplayReplay.h"
+            "GameplayTelemetry.h"
             "GamePreferences.h"
             "Grade.h"
             "HighScore.h"
             "InputEventPlus.h"
             "Inventory.h"
             "JsonUtil.h"
+            "JudgmentIndex.h"
+            "JudgmentThread.h"
+            "LifeRecord.h"
             "LocalizedString.h"
             "LyricsLoader.h"
             "ModsGroup.h"
@@ -15,6 +15,7 @@ list(APPEND SMDATA_RAGE_UTILS_HPP
             "RageUtil_CharConversions.h"
             "RageUtil_CircularBuffer.h"
             "RageUtil_FileDB.h"
+            "RageUtil_SPSCQueue.h"
             "RageUtil_WorkerThread.h")
 
 source_group("Rage\\\\Utils"
@@ -28,6 +29,7 @@ list(APPEND SMDATA_RAGE_MISC_SRC
             "RageInputDevice.cpp"
             "RageLog.cpp"
             "RageMath.cpp"
+            "RageProfiler.cpp"
             "RageTypes.cpp"
             "RageThreads.cpp"
             "RageTimer.cpp")
@@ -38,6 +40,7 @@ list(APPEND SMDATA_RAGE_MISC_HPP
             "RageInputDevice.h"
             "RageLog.h"
             "RageMath.h"
+            "RageProfiler.h"
             "RageTypes.h"
             "RageThreads.h"
             "RageTimer.h")
@@ -69,6 +72,7 @@ list(APPEND SMDATA_RAGE_GRAPHICS_SRC
             "RageSurfaceUtils_Palettize.cpp"
             "RageSurfaceUtils_Zoom.cpp"
             "RageTexture.cpp"
+            "RageTextureAtlas.cpp"
             "RageTextureID.cpp"
             "RageTextureManager.cpp"
             "RageTexturePreloader.cpp"
@@ -94,8 +98,10 @@ list(APPEND SMDATA_RAGE_GRAPHICS_HPP
             "RageSurfaceUtils.h"
             "RageSurfaceUtils_Dither.h"
             "RageSurfaceUtils_Palettize.h"
+            "RageSurfaceUtils_SIMD.h"
             "RageSurfaceUtils_Zoom.h"
             "RageTexture.h"
+            "RageTextureAtlas.h"
             "RageTextureID.h"
             "RageTextureManager.h"
             "RageTexturePreloader.h"
@@ -16,6 +16,8 @@
 #include "Preference.h"
 #include "JsonUtil.h"
 #include "ScreenInstallOverlay.h"
+#include "GameplayTelemetry.h"
+#include "RageLog.h"
 #include "ver.h"
 
 #include <vector>
@@ -66,6 +68,16 @@ static void Version()
 	#endif // WIN32
 }
 
+/** @brief Print the percentiles of a gameplay telemetry recording. */
+static void TelemetrySummary( const RString &sPath )
+{
+	RString sSummary, sError;
+	if( !GameplayTelemetry::Summarize(sPath, sSummary, sError) )
+		sSummary = ssprintf( "Couldn't read \"%s\": %s\n", sPath.c_str(), sError.c_str() );
+	LOG->Info( "%s", sSummary.c_str() );
+	fprintf( stdout, "%s", sSummary.c_str() );
+}
+
 void CommandLineActions::Handle(LoadingWindow* pLW)
 {
 	CommandLineArgs args;
@@ -84,6 +96,12 @@ void CommandLineActions::Handle(LoadingWindow* pLW)
 		Version();
 		bExitAfter = true;
 	}
+	RString sTelemetryPath;
+	if( GetCommandlineArgument("TelemetrySummary", &sTelemetryPath) )
+	{
+		TelemetrySummary( sTelemetryPath );
+		bExitAfter = true;
+	}
 	if( bExitAfter )
 		exit(0);
 }
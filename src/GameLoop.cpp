@@ -18,8 +18,12 @@
 #include "InputMapper.h"
 #include "RageFileManager.h"
 #include "LightsManager.h"
+#include "MessageManager.h"
 #include "RageTimer.h"
 #include "RageInput.h"
+#include "RageProfiler.h"
+#include "Actor.h"
+#include "GameplayReplay.h"
 
 #include <cmath>
 #include <vector>
@@ -284,21 +288,38 @@ void GameLoop::UpdateAllButDraw(bool bRunningFromVBLANK)
 
 	fDeltaTime *= g_fUpdateRate;
 
+	/* Play a replay back as fast as we can, at the speed it was recorded. */
+	if( GameplayReplay::GetPlayback() != nullptr )
+		GameplayReplay::GetPlayback()->GetFrameDelta( fDeltaTime );
+
 	// Update SOUNDMAN early (before any RageSound::GetPosition calls), to flush position data.
-	SOUNDMAN->Update();
+	{
+		PROFILE_SCOPE( "Sound" );
+		SOUNDMAN->Update();
 
-	/* Update song beat information -before- calling update on all the classes that
-	 * depend on it. If you don't do this first, the classes are all acting on old
-	 * information and will lag. (but no longer fatally, due to timestamping -glenn) */
-	SOUND->Update(fDeltaTime);
+		/* Update song beat information -before- calling update on all the classes that
+		 * depend on it. If you don't do this first, the classes are all acting on old
+		 * information and will lag. (but no longer fatally, due to timestamping -glenn) */
+		SOUND->Update(fDeltaTime);
+	}
 	TEXTUREMAN->Update(fDeltaTime);
-	GAMESTATE->Update(fDeltaTime);
+	{
+		PROFILE_SCOPE( "GameState::Update" );
+		GAMESTATE->Update(fDeltaTime);
+	}
 	SCREENMAN->Update(fDeltaTime);
+	Actor::EndUpdateFrame();
 	MEMCARDMAN->Update();
 
 	/* Important: Process input AFTER updating game logic, or input will be
 	 * acting on song beat from last frame */
-	HandleInputEvents(fDeltaTime);
+	{
+		PROFILE_SCOPE( "Input" );
+		HandleInputEvents(fDeltaTime);
+	}
+
+	// Messages deferred while judging this frame's notes and input.
+	MESSAGEMAN->DispatchDeferred();
 
 	// Update the lights
 	LIGHTSMAN->Update(fDeltaTime);
@@ -322,13 +343,18 @@ void GameLoop::RunGameLoop()
 			DoChangeTheme();
 		}
 
-		CheckFocus();
+		{
+			PROFILE_SCOPE( "Frame" );
+
+			CheckFocus();
+
+			UpdateAllButDraw(false);
 
-		UpdateAllButDraw(false);
-		
-		CallEveryNFrames(500, CheckInputDevices);
-		
-		SCREENMAN->Draw();
+			CallEveryNFrames(500, CheckInputDevices);
+
+			SCREENMAN->Draw();
+		}
+		RageProfiler::EndFrame();
 	}
 
 	// If we ended mid-game, finish up.
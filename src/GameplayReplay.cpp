@@ -0,0 +1,726 @@
+#include "global.h"
+#include "GameplayReplay.h"
+#include "arch/ArchHooks/ArchHooks.h"
+#include "Game.h"
+#include "GameManager.h"
+#include "GamePreferences.h"
+#include "GameState.h"
+#include "InputEventPlus.h"
+#include "InputFilter.h"
+#include "InputMapper.h"
+#include "PlayerState.h"
+#include "Preference.h"
+#include "Profile.h"
+#include "ProfileManager.h"
+#include "RageLog.h"
+#include "RageUtil.h"
+#include "ScreenManager.h"
+#include "Song.h"
+#include "StatsManager.h"
+#include "Steps.h"
+#include "Style.h"
+#include "ThemeManager.h"
+#include "XmlFile.h"
+#include "XmlFileUtil.h"
+
+#include <cinttypes>
+#include <cstdlib>
+
+GameplayReplay *GameplayReplay::s_pPlayback = nullptr;
+
+/* Everything besides the chart and options that judging and scoring depend on. */
+static const char *g_szJudgmentPreferences[] =
+{
+	"TimingWindowScale",
+	"TimingWindowAdd",
+	"TimingWindowJump",
+	"MaxInputLatencySeconds",
+	"MinTnsToScoreTapNote",
+	"LifeDifficultyScale",
+	"RegenComboAfterMiss",
+	"MaxRegenComboAfterMiss",
+	"MercifulDrain",
+	"HarshHotLifePenalty",
+	"MercifulBeginner",
+	"MercifulSuperMeter",
+	"PadStickSeconds",
+};
+
+static int64_t ToMicroseconds( const RageTimer &tm )
+{
+	return int64_t(tm.m_secs) * 1000000 + int64_t(tm.m_us);
+}
+
+static RageTimer FromMicroseconds( int64_t iUs )
+{
+	return RageTimer( iUs / 1000000, iUs % 1000000 );
+}
+
+/* Floats are written with enough digits to read back exactly. */
+static RString FloatToExactString( float f )
+{
+	return ssprintf( "%.9g", f );
+}
+
+GameplayReplay::GameplayReplay()
+{
+	m_bPlayback = false;
+	m_iGameSeed = 0;
+	m_iStageSeed = 0;
+	m_tmClock.SetZero();
+	m_tmFrame.SetZero();
+	m_iNextEvent = 0;
+	m_iMissedSteps = 0;
+	m_bFinished = false;
+	m_bMatched = false;
+}
+
+void GameplayReplay::BeginRecording( const RString &sScreenName )
+{
+	m_sScreenName = sScreenName;
+	m_sGame = GAMESTATE->GetCurrentGame()->m_szName;
+	m_sStyle = GAMESTATE->GetCurrentStyle(PLAYER_INVALID)->m_szName;
+	m_sTheme = THEME->GetCurThemeName();
+	m_Song.FromSong( GAMESTATE->m_pCurSong );
+	m_sSongOptions = GAMESTATE->m_SongOptions.GetStage().GetString();
+	m_iGameSeed = GAMESTATE->m_iGameSeed;
+	m_iStageSeed = GAMESTATE->m_iStageSeed;
+
+	m_vPreferences.clear();
+	std::vector<RString> vsNames( g_szJudgmentPreferences, g_szJudgmentPreferences+ARRAYLEN(g_szJudgmentPreferences) );
+	FOREACH_ENUM( TimingWindow, tw )
+		vsNames.push_back( "TimingWindowSeconds" + TimingWindowToString(tw) );
+	for( const RString &sName : vsNames )
+	{
+		IPreference *pPref = IPreference::GetPreferenceByName( sName );
+		if( pPref != nullptr )
+			m_vPreferences.push_back( std::make_pair(sName, pPref->ToString()) );
+	}
+
+	m_vPlayers.clear();
+	FOREACH_HumanPlayer( pn )
+	{
+		PlayerReplay pr;
+		pr.pn = pn;
+		pr.sPlayerOptions = GAMESTATE->m_pPlayerState[pn]->m_PlayerOptions.GetStage().GetString( true );
+		pr.steps.FromSteps( GAMESTATE->m_pCurSteps[pn] );
+		m_vPlayers.push_back( pr );
+	}
+}
+
+void GameplayReplay::BeginScreen()
+{
+	/* Recorded times are relative to the last update, so playback can start
+	 * its clock anywhere. */
+	m_tmFrame.Touch();
+	m_tmClock = m_tmFrame;
+	m_iNextEvent = 0;
+}
+
+void GameplayReplay::BeginFrame( float &fDeltaTime )
+{
+	if( !m_bPlayback )
+	{
+		const RageTimer now;
+		Event e;
+		e.type = EVENT_FRAME;
+		e.fValue = fDeltaTime;
+		e.iTimeUs = ToMicroseconds( now ) - ToMicroseconds( m_tmFrame );
+		AddEvent( e );
+		m_tmFrame = now;
+		m_tmClock = now;
+		return;
+	}
+
+	/* Steps we pressed last update should have arrived by now. */
+	m_iMissedSteps += m_vDelivering.size();
+	m_vDelivering.clear();
+
+	while( m_iNextEvent < m_vEvents.size() && m_vEvents[m_iNextEvent].type != EVENT_FRAME )
+		++m_iNextEvent;
+
+	int64_t iAdvanceUs;
+	if( m_iNextEvent < m_vEvents.size() )
+	{
+		const Event &e = m_vEvents[m_iNextEvent++];
+		fDeltaTime = e.fValue;
+		iAdvanceUs = e.iTimeUs;
+	}
+	else
+	{
+		/* We've run past the end of the recording; keep going in real time
+		 * until gameplay finishes. */
+		iAdvanceUs = std::llround( fDeltaTime * 1000000.0 );
+	}
+	m_tmFrame = FromMicroseconds( ToMicroseconds(m_tmFrame) + iAdvanceUs );
+	m_tmClock = m_tmFrame;
+}
+
+void GameplayReplay::GetFrameDelta( float &fDeltaTime ) const
+{
+	for( unsigned i = m_iNextEvent; i < m_vEvents.size(); ++i )
+	{
+		if( m_vEvents[i].type == EVENT_FRAME )
+		{
+			fDeltaTime = m_vEvents[i].fValue;
+			return;
+		}
+	}
+}
+
+void GameplayReplay::RecordSongPosition( bool bPlaying, float fSeconds, const RageTimer &tm )
+{
+	Event e;
+	e.type = EVENT_POSITION;
+	e.bPlaying = bPlaying;
+	e.fValue = fSeconds;
+	e.iTimeUs = bPlaying? ToMicroseconds(tm) - ToMicroseconds(m_tmFrame):0;
+	AddEvent( e );
+}
+
+bool GameplayReplay::GetSongPosition( float &fSeconds, RageTimer &tm )
+{
+	if( m_iNextEvent < m_vEvents.size() && m_vEvents[m_iNextEvent].type == EVENT_POSITION )
+	{
+		const Event &e = m_vEvents[m_iNextEvent++];
+		if( !e.bPlaying )
+			return false;
+		fSeconds = e.fValue;
+		tm = FromMicroseconds( ToMicroseconds(m_tmFrame) + e.iTimeUs );
+		return true;
+	}
+
+	/* Past the end of the recording, carry on from the last position. */
+	if( GAMESTATE->m_Position.m_LastBeatUpdate.IsZero() )
+		return false;
+	const float fRate = GAMESTATE->m_SongOptions.GetCurrent().m_fMusicRate;
+	fSeconds = GAMESTATE->m_Position.m_fMusicSeconds + (m_tmFrame - GAMESTATE->m_Position.m_LastBeatUpdate) * fRate;
+	tm = m_tmFrame;
+	return true;
+}
+
+void GameplayReplay::BeginInput( const InputEventPlus &input )
+{
+	if( !m_bPlayback )
+	{
+		m_tmClock.Touch();
+		return;
+	}
+
+	m_tmClock = m_tmFrame;
+	if( input.type != IET_FIRST_PRESS && input.type != IET_RELEASE )
+		return;
+	for( auto it = m_vDelivering.begin(); it != m_vDelivering.end(); ++it )
+	{
+		if( it->gi == input.GameI && it->bRelease == (input.type == IET_RELEASE) )
+		{
+			m_tmClock = FromMicroseconds( ToMicroseconds(m_tmFrame) + it->iDelayUs );
+			m_vDelivering.erase( it );
+			return;
+		}
+	}
+}
+
+void GameplayReplay::RecordStep( const InputEventPlus &input )
+{
+	Event e;
+	e.type = EVENT_STEP;
+	e.gi = input.GameI;
+	e.di = input.DeviceI;
+	e.bRelease = input.type == IET_RELEASE;
+	e.iTimeUs = ToMicroseconds( input.DeviceI.ts ) - ToMicroseconds( m_tmFrame );
+	e.iDelayUs = ToMicroseconds( m_tmClock ) - ToMicroseconds( m_tmFrame );
+	AddEvent( e );
+}
+
+void GameplayReplay::EndFrame()
+{
+	if( !m_bPlayback )
+		return;
+
+	/* Press the buttons as they were pressed, so INPUTFILTER knows which are
+	 * held; they reach ScreenGameplay::Input once it's updated. */
+	for( ; m_iNextEvent < m_vEvents.size() && m_vEvents[m_iNextEvent].type != EVENT_FRAME; ++m_iNextEvent )
+	{
+		const Event &e = m_vEvents[m_iNextEvent];
+		if( e.type != EVENT_STEP )
+			continue;
+
+		/* Use the recorded device if it's still mapped to the same button, so
+		 * holding a button from two devices works the same. */
+		DeviceInput di = e.di;
+		GameInput gi;
+		if( !INPUTMAPPER->DeviceToGame(di, gi) || !(gi == e.gi) )
+		{
+			if( !INPUTMAPPER->GameToDevice(e.gi, 0, di) )
+			{
+				++m_iMissedSteps;
+				continue;
+			}
+		}
+
+		di.bDown = !e.bRelease;
+		di.level = di.bDown? 1.0f:0.0f;
+		di.ts = FromMicroseconds( ToMicroseconds(m_tmFrame) + e.iTimeUs );
+		INPUTFILTER->ButtonPressed( di );
+
+		DeliveringStep ds = { e.gi, e.bRelease, e.iDelayUs };
+		m_vDelivering.push_back( ds );
+	}
+}
+
+GameplayReplay::ClockScope::ClockScope( const GameplayReplay *pReplay )
+{
+	m_bSet = pReplay != nullptr;
+	m_pOldClock = m_bSet? RageTimer::SetThreadClock( &pReplay->m_tmClock ):nullptr;
+}
+
+GameplayReplay::ClockScope::~ClockScope()
+{
+	if( m_bSet )
+		RageTimer::SetThreadClock( m_pOldClock );
+}
+
+/* Calories are left out; they depend on the profile's weight, not the steps. */
+void GameplayReplay::GetResults( const PlayerStageStats &pss, std::vector<std::pair<RString,RString>> &vOut )
+{
+	vOut.clear();
+	FOREACH_ENUM( TapNoteScore, tns )
+		vOut.push_back( std::make_pair("Tap"+TapNoteScoreToString(tns), ssprintf("%i", pss.m_iTapNoteScores[tns])) );
+	FOREACH_ENUM( HoldNoteScore, hns )
+		vOut.push_back( std::make_pair("Hold"+HoldNoteScoreToString(hns), ssprintf("%i", pss.m_iHoldNoteScores[hns])) );
+	vOut.push_back( std::make_pair("MaxCombo", ssprintf("%u", pss.m_iMaxCombo)) );
+	vOut.push_back( std::make_pair("CurCombo", ssprintf("%u", pss.m_iCurCombo)) );
+	vOut.push_back( std::make_pair("CurMissCombo", ssprintf("%u", pss.m_iCurMissCombo)) );
+	vOut.push_back( std::make_pair("ActualDancePoints", ssprintf("%i", pss.m_iActualDancePoints)) );
+	vOut.push_back( std::make_pair("PossibleDancePoints", ssprintf("%i", pss.m_iPossibleDancePoints)) );
+	vOut.push_back( std::make_pair("CurPossibleDancePoints", ssprintf("%i", pss.m_iCurPossibleDancePoints)) );
+	vOut.push_back( std::make_pair("Score", ssprintf("%u", pss.m_iScore)) );
+	vOut.push_back( std::make_pair("CurMaxScore", ssprintf("%u", pss.m_iCurMaxScore)) );
+	vOut.push_back( std::make_pair("MaxScore", ssprintf("%u", pss.m_iMaxScore)) );
+	vOut.push_back( std::make_pair("Failed", ssprintf("%i", pss.m_bFailed)) );
+	vOut.push_back( std::make_pair("AliveSeconds", FloatToExactString(pss.m_fAliveSeconds)) );
+	vOut.push_back( std::make_pair("RadarActual", pss.m_radarActual.ToString()) );
+	std::vector<RString> vsLife;
+	for( const std::pair<float,float> &s : pss.m_LifeRecord.GetSamples() )
+		vsLife.push_back( FloatToExactString(s.first) + ":" + FloatToExactString(s.second) );
+	vOut.push_back( std::make_pair("LifeRecord", join(",", vsLife)) );
+	vOut.push_back( std::make_pair("CurrentLife", FloatToExactString(pss.GetCurrentLife())) );
+	vOut.push_back( std::make_pair("Combos", ssprintf("%i", (int) pss.m_ComboList.size())) );
+}
+
+RString GameplayReplay::GetEventsString() const
+{
+	std::vector<RString> vsLines;
+	vsLines.reserve( m_vEvents.size() );
+	for( const Event &e : m_vEvents )
+	{
+		switch( e.type )
+		{
+		case EVENT_FRAME:
+			vsLines.push_back( ssprintf("F %s %" PRId64, FloatToExactString(e.fValue).c_str(), e.iTimeUs) );
+			break;
+		case EVENT_POSITION:
+			if( e.bPlaying )
+				vsLines.push_back( ssprintf("P %s %" PRId64, FloatToExactString(e.fValue).c_str(), e.iTimeUs) );
+			else
+				vsLines.push_back( "P -" );
+			break;
+		case EVENT_STEP:
+			vsLines.push_back( ssprintf("S %i %i %i %" PRId64 " %" PRId64 " %s", e.gi.controller, e.gi.button,
+				e.bRelease, e.iTimeUs, e.iDelayUs, e.di.ToString().c_str()) );
+			break;
+		}
+	}
+	return join( "\n", vsLines );
+}
+
+bool GameplayReplay::LoadEventsString( const RString &sEvents, RString &sError )
+{
+	std::vector<RString> vsLines;
+	split( sEvents, "\n", vsLines, true );
+	m_vEvents.clear();
+	m_vEvents.reserve( vsLines.size() );
+	for( RString sLine : vsLines )
+	{
+		TrimLeft( sLine );
+		TrimRight( sLine );
+		if( sLine.empty() )
+			continue;
+
+		Event e;
+		e.fValue = 0;
+		e.iTimeUs = e.iDelayUs = 0;
+		e.bPlaying = false;
+		e.bRelease = false;
+		bool bOK = false;
+		switch( sLine[0] )
+		{
+		case 'F':
+		{
+			e.type = EVENT_FRAME;
+			char *p;
+			e.fValue = strtof( sLine.c_str()+1, &p );
+			e.iTimeUs = strtoll( p, &p, 10 );
+			bOK = true;
+			break;
+		}
+		case 'P':
+		{
+			e.type = EVENT_POSITION;
+			e.bPlaying = sLine != "P -";
+			if( e.bPlaying )
+			{
+				char *p;
+				e.fValue = strtof( sLine.c_str()+1, &p );
+				e.iTimeUs = strtoll( p, &p, 10 );
+			}
+			bOK = true;
+			break;
+		}
+		case 'S':
+		{
+			e.type = EVENT_STEP;
+			int iController, iButton, iRelease, iLength = 0;
+			int64_t iTimeUs, iDelayUs;
+			if( sscanf(sLine.c_str(), "S %i %i %i %" SCNd64 " %" SCNd64 " %n", &iController, &iButton,
+				&iRelease, &iTimeUs, &iDelayUs, &iLength) == 5 && iLength > 0 )
+			{
+				e.gi = GameInput( (GameController) iController, (GameButton) iButton );
+				e.bRelease = iRelease != 0;
+				e.iTimeUs = iTimeUs;
+				e.iDelayUs = iDelayUs;
+				e.di.FromString( sLine.substr(iLength) );
+				bOK = e.gi.IsValid();
+			}
+			break;
+		}
+		}
+
+		if( !bOK )
+		{
+			sError = ssprintf( "invalid event \"%s\"", sLine.c_str() );
+			return false;
+		}
+		m_vEvents.push_back( e );
+	}
+	return true;
+}
+
+XNode *GameplayReplay::CreateNode() const
+{
+	XNode *p = new XNode( "ReplayData" );
+	// append version number (in case the format changes)
+	p->AppendAttr( "Version", 1 );
+	p->AppendChild( "Screen", m_sScreenName );
+	p->AppendChild( "Game", m_sGame );
+	p->AppendChild( "Style", m_sStyle );
+	p->AppendChild( "Theme", m_sTheme );
+
+	// song information node
+	XNode *pSongInfoNode = m_Song.CreateNode();
+	Song *pSong = m_Song.ToSong();
+	if( pSong != nullptr )
+	{
+		pSongInfoNode->AppendChild( "Title", pSong->GetDisplayFullTitle() );
+		pSongInfoNode->AppendChild( "Artist", pSong->GetDisplayArtist() );
+	}
+	p->AppendChild( pSongInfoNode );
+
+	p->AppendChild( "SongOptions", m_sSongOptions );
+	p->AppendChild( "GameSeed", m_iGameSeed );
+	p->AppendChild( "StageSeed", m_iStageSeed );
+
+	XNode *pPrefs = p->AppendChild( "Preferences" );
+	for( const auto &pref : m_vPreferences )
+		pPrefs->AppendChild( pref.first, pref.second );
+
+	for( const PlayerReplay &pr : m_vPlayers )
+	{
+		XNode *pPlayer = p->AppendChild( "Player" );
+		pPlayer->AppendAttr( "Number", (int) pr.pn );
+		const Profile *pProfile = PROFILEMAN->GetProfile( pr.pn );
+		pPlayer->AppendChild( "DisplayName", pProfile->m_sDisplayName );
+		pPlayer->AppendChild( "Guid", pProfile->m_sGuid );
+		pPlayer->AppendChild( pr.steps.CreateNode() );
+		pPlayer->AppendChild( "PlayerOptions", pr.sPlayerOptions );
+
+		std::vector<std::pair<RString,RString>> vResults;
+		GetResults( STATSMAN->m_CurStageStats.m_player[pr.pn], vResults );
+		XNode *pResults = pPlayer->AppendChild( "Results" );
+		for( const auto &result : vResults )
+			pResults->AppendChild( result.first, result.second );
+	}
+
+	p->AppendChild( "Events", GetEventsString() );
+	return p;
+}
+
+bool GameplayReplay::LoadFromNode( const XNode *pNode, RString &sError )
+{
+	int iVersion = 0;
+	pNode->GetAttrValue( "Version", iVersion );
+	if( pNode->GetName() != "ReplayData" || iVersion != 1 )
+	{
+		sError = ssprintf( "not a version 1 replay" );
+		return false;
+	}
+
+	pNode->GetChildValue( "Screen", m_sScreenName );
+	pNode->GetChildValue( "Game", m_sGame );
+	pNode->GetChildValue( "Style", m_sStyle );
+	pNode->GetChildValue( "Theme", m_sTheme );
+	pNode->GetChildValue( "SongOptions", m_sSongOptions );
+	pNode->GetChildValue( "GameSeed", m_iGameSeed );
+	pNode->GetChildValue( "StageSeed", m_iStageSeed );
+
+	const XNode *pSongNode = pNode->GetChild( "Song" );
+	if( pSongNode == nullptr )
+	{
+		sError = "no song";
+		return false;
+	}
+	m_Song.LoadFromNode( pSongNode );
+
+	m_vPreferences.clear();
+	const XNode *pPrefs = pNode->GetChild( "Preferences" );
+	if( pPrefs != nullptr )
+	{
+		FOREACH_CONST_Child( pPrefs, pref )
+		{
+			RString sValue;
+			pref->GetTextValue( sValue );
+			m_vPreferences.push_back( std::make_pair(pref->GetName(), sValue) );
+		}
+	}
+
+	m_vPlayers.clear();
+	FOREACH_CONST_Child( pNode, pPlayer )
+	{
+		if( pPlayer->GetName() != "Player" )
+			continue;
+
+		PlayerReplay pr;
+		int iPlayer = -1;
+		pPlayer->GetAttrValue( "Number", iPlayer );
+		if( iPlayer < 0 || iPlayer >= NUM_PLAYERS )
+		{
+			sError = ssprintf( "invalid player %i", iPlayer );
+			return false;
+		}
+		pr.pn = (PlayerNumber) iPlayer;
+		pPlayer->GetChildValue( "PlayerOptions", pr.sPlayerOptions );
+		const XNode *pSteps = pPlayer->GetChild( "Steps" );
+		if( pSteps != nullptr )
+			pr.steps.LoadFromNode( pSteps );
+
+		const XNode *pResults = pPlayer->GetChild( "Results" );
+		if( pResults != nullptr )
+		{
+			FOREACH_CONST_Child( pResults, result )
+			{
+				RString sValue;
+				result->GetTextValue( sValue );
+				pr.vResults.push_back( std::make_pair(result->GetName(), sValue) );
+			}
+		}
+		m_vPlayers.push_back( pr );
+	}
+	if( m_vPlayers.empty() )
+	{
+		sError = "no players";
+		return false;
+	}
+
+	RString sEvents;
+	pNode->GetChildValue( "Events", sEvents );
+	return LoadEventsString( sEvents, sError );
+}
+
+void GameplayReplay::OverridePreference( const RString &sName, const RString &sValue )
+{
+	IPreference *pPref = IPreference::GetPreferenceByName( sName );
+	if( pPref == nullptr )
+	{
+		LOG->Warn( "Replay: unknown preference \"%s\"", sName.c_str() );
+		return;
+	}
+
+	/* Remember the first value, if this is overridden twice. */
+	bool bSaved = false;
+	for( const auto &pref : m_vOverridden )
+		bSaved |= pref.first == sName;
+	if( !bSaved )
+		m_vOverridden.push_back( std::make_pair(sName, pPref->ToString()) );
+	pPref->FromString( sValue );
+}
+
+void GameplayReplay::ParseCommandLine()
+{
+	RString sPath;
+	if( !GetCommandlineArgument("replay", &sPath) )
+		return;
+
+	XNode xml;
+	RString sError;
+	GameplayReplay *pReplay = new GameplayReplay;
+	pReplay->m_bPlayback = true;
+	if( !XmlFileUtil::LoadFromFileShowErrors(xml, sPath) )
+		sError = "couldn't read it";
+	else
+		pReplay->LoadFromNode( &xml, sError );
+	if( !sError.empty() )
+		RageException::Throw( "Couldn't load replay \"%s\": %s", sPath.c_str(), sError.c_str() );
+
+	/* Run headless.  None of these are saved; EndPlayback puts them back. */
+	pReplay->OverridePreference( "ShowLoadingWindow", "0" );
+	pReplay->OverridePreference( "VideoRenderers", "null" );
+	pReplay->OverridePreference( "SoundDrivers", "Null" );
+	pReplay->OverridePreference( "AutoPlay", "Human" );
+	/* Steps are pressed as fast as we play them back; don't hold them back. */
+	pReplay->OverridePreference( "InputDebounceTime", "0" );
+
+	LOG->Info( "Playing replay \"%s\": %i events", sPath.c_str(), (int) pReplay->m_vEvents.size() );
+	s_pPlayback = pReplay;
+}
+
+bool GameplayReplay::SetUpGameState( RString &sError )
+{
+	const Game *pGame = GAMESTATE->GetCurrentGame();
+	if( m_sGame != pGame->m_szName )
+	{
+		sError = ssprintf( "it's for %s; run with --game=%s", m_sGame.c_str(), m_sGame.c_str() );
+		return false;
+	}
+	if( m_sTheme != THEME->GetCurThemeName() )
+		LOG->Warn( "Replay was recorded with the theme \"%s\"; its metrics may judge differently", m_sTheme.c_str() );
+
+	Song *pSong = m_Song.ToSong();
+	if( pSong == nullptr )
+	{
+		sError = ssprintf( "song \"%s\" isn't loaded", m_Song.ToString().c_str() );
+		return false;
+	}
+
+	const Style *pStyle = GAMEMAN->GameAndStringToStyle( pGame, m_sStyle );
+	if( pStyle == nullptr )
+	{
+		sError = ssprintf( "unknown style \"%s\"", m_sStyle.c_str() );
+		return false;
+	}
+
+	GAMESTATE->m_PlayMode.Set( PLAY_MODE_REGULAR );
+	for( const PlayerReplay &pr : m_vPlayers )
+		GAMESTATE->JoinPlayer( pr.pn );
+	GAMESTATE->SetCurrentStyle( pStyle, PLAYER_INVALID );
+	GAMESTATE->m_pCurSong.Set( pSong );
+
+	for( const PlayerReplay &pr : m_vPlayers )
+	{
+		Steps *pSteps = pr.steps.ToSteps( pSong, true );
+		if( pSteps == nullptr )
+		{
+			sError = ssprintf( "steps \"%s\" aren't in the song", pr.steps.ToString().c_str() );
+			return false;
+		}
+		GAMESTATE->m_pCurSteps[pr.pn].Set( pSteps );
+
+		PlayerOptions po;
+		po.FromString( pr.sPlayerOptions );
+		GAMESTATE->m_pPlayerState[pr.pn]->m_PlayerOptions.Assign( ModsLevel_Preferred, po );
+	}
+
+	SongOptions so;
+	so.FromString( m_sSongOptions );
+	so.m_bSaveReplay = false;
+	GAMESTATE->m_SongOptions.Assign( ModsLevel_Preferred, so );
+
+	for( const auto &pref : m_vPreferences )
+		OverridePreference( pref.first, pref.second );
+	return true;
+}
+
+void GameplayReplay::StartPlayback()
+{
+	GameplayReplay *pReplay = s_pPlayback;
+	ASSERT( pReplay != nullptr );
+
+	RString sError;
+	if( !pReplay->SetUpGameState(sError) )
+		RageException::Throw( "Couldn't play replay: %s", sError.c_str() );
+
+	RString sScreen = pReplay->m_sScreenName;
+	if( !SCREENMAN->IsScreenNameValid(sScreen) )
+		sScreen = "ScreenGameplay";
+	SCREENMAN->SetNewScreen( sScreen );
+}
+
+void GameplayReplay::ApplyStage()
+{
+	GAMESTATE->m_iGameSeed = m_iGameSeed;
+	GAMESTATE->m_iStageSeed = m_iStageSeed;
+
+	for( const PlayerReplay &pr : m_vPlayers )
+	{
+		PlayerOptions po;
+		po.FromString( pr.sPlayerOptions );
+		GAMESTATE->m_pPlayerState[pr.pn]->m_PlayerOptions.Assign( ModsLevel_Stage, po );
+	}
+
+	SongOptions so;
+	so.FromString( m_sSongOptions );
+	so.m_bSaveReplay = false;
+	GAMESTATE->m_SongOptions.Assign( ModsLevel_Stage, so );
+}
+
+void GameplayReplay::FinishPlayback( bool bCompleted )
+{
+	if( m_bFinished )
+		return;
+	m_bFinished = true;
+
+	m_bMatched = bCompleted;
+	if( !bCompleted )
+		LOG->Warn( "Replay: gameplay was backed out of" );
+
+	for( const PlayerReplay &pr : m_vPlayers )
+	{
+		std::vector<std::pair<RString,RString>> vResults;
+		GetResults( STATSMAN->m_CurStageStats.m_player[pr.pn], vResults );
+		for( const auto &recorded : pr.vResults )
+		{
+			RString sActual = "(missing)";
+			for( const auto &result : vResults )
+				if( result.first == recorded.first )
+					sActual = result.second;
+			if( sActual == recorded.second )
+				continue;
+
+			LOG->Warn( "Replay: %s %s is %s; recorded %s", PlayerNumberToString(pr.pn).c_str(),
+				recorded.first.c_str(), sActual.c_str(), recorded.second.c_str() );
+			m_bMatched = false;
+		}
+	}
+
+	if( m_iMissedSteps )
+		LOG->Warn( "Replay: %i steps didn't reach gameplay", m_iMissedSteps );
+	LOG->Info( "Replay %s", m_bMatched? "matched":"DID NOT MATCH" );
+	ArchHooks::SetUserQuit();
+}
+
+int GameplayReplay::EndPlayback()
+{
+	GameplayReplay *pReplay = s_pPlayback;
+	if( pReplay == nullptr )
+		return 0;
+	s_pPlayback = nullptr;
+
+	for( const auto &pref : pReplay->m_vOverridden )
+		IPreference::GetPreferenceByName( pref.first )->FromString( pref.second );
+
+	const bool bMatched = pReplay->m_bFinished && pReplay->m_bMatched;
+	if( !pReplay->m_bFinished )
+		LOG->Warn( "Replay: quit before gameplay finished" );
+	delete pReplay;
+	return bMatched? 0:1;
+}
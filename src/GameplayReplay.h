@@ -0,0 +1,158 @@
+/* GameplayReplay - Record a stage's steps, and play them back headless. */
+
+#ifndef GAMEPLAY_REPLAY_H
+#define GAMEPLAY_REPLAY_H
+
+#include "GameInput.h"
+#include "PlayerNumber.h"
+#include "RageInputDevice.h"
+#include "RageTimer.h"
+#include "SongUtil.h"
+#include "StepsUtil.h"
+
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+class InputEventPlus;
+class PlayerStageStats;
+class XNode;
+
+/* A replay holds what a stage was played with (song, steps, style, options,
+ * seeds and judgment preferences), and everything that happened to it over
+ * time: each ScreenGameplay update's delta, each music position, and each
+ * step, timed against the update it arrived after.  Playing that back against
+ * the same chart gives the same PlayerStageStats, however fast it runs.
+ *
+ * While a replay is recording or playing, ScreenGameplay runs its updates and
+ * input on the replay's clock (see RageTimer::SetThreadClock).  Recording, that
+ * is the time the update or input began; playing back, it's the recorded time,
+ * so anything gameplay measures with a RageTimer comes out the same. */
+class GameplayReplay
+{
+public:
+	GameplayReplay();
+
+	/* Recording: */
+	/* Note the stage GAMESTATE is set up for, after BeginStage. */
+	void BeginRecording( const RString &sScreenName );
+	void RecordSongPosition( bool bPlaying, float fSeconds, const RageTimer &tm );
+	void RecordStep( const InputEventPlus &input );
+	/* Return the replay, with each player's results so far. */
+	XNode *CreateNode() const;
+
+	/* Playback: */
+	bool IsPlayback() const { return m_bPlayback; }
+	/* Set seeds and stage options, after BeginStage. */
+	void ApplyStage();
+	/* Return false if there's no music position, as when the music isn't
+	 * playing yet. */
+	bool GetSongPosition( float &fSeconds, RageTimer &tm );
+	/* Compare the results with the recording, log the result, and quit. */
+	void FinishPlayback( bool bCompleted );
+
+	/* Both: */
+	void BeginScreen();
+	/* Called at the start of each ScreenGameplay update.  When playing back,
+	 * replace fDeltaTime with the recorded one. */
+	void BeginFrame( float &fDeltaTime );
+	/* When playing back, press and release the buttons stepped on since the
+	 * recorded update. */
+	void EndFrame();
+	void BeginInput( const InputEventPlus &input );
+
+	/* Run this thread on the replay's clock while in scope.  A null replay
+	 * leaves the clock alone. */
+	class ClockScope
+	{
+	public:
+		explicit ClockScope( const GameplayReplay *pReplay );
+		~ClockScope();
+	private:
+		const RageTimer *m_pOldClock;
+		bool m_bSet;
+	};
+
+	/* --replay=<file>: play the replay in <file> on the null renderer and
+	 * sound driver, then quit.  ParseCommandLine is called before the display
+	 * and sound are set up; StartPlayback instead of loading the initial
+	 * screen. */
+	static void ParseCommandLine();
+	static GameplayReplay *GetPlayback() { return s_pPlayback; }
+	static void StartPlayback();
+	/* Restore any preferences playback overrode.  Return the exit code:
+	 * nonzero if a replay was played and didn't match. */
+	static int EndPlayback();
+
+	/* When playing back, replace the game loop's delta with the next recorded
+	 * update's. */
+	void GetFrameDelta( float &fDeltaTime ) const;
+
+private:
+	enum EventType { EVENT_FRAME, EVENT_POSITION, EVENT_STEP };
+	struct Event
+	{
+		EventType type;
+		float fValue;		// frame delta, or music position
+		int64_t iTimeUs;	// frame: clock advance; position, step: timestamp after the frame
+		int64_t iDelayUs;	// step: delivery after the frame
+		bool bPlaying;		// position: the music was playing
+		GameInput gi;
+		DeviceInput di;
+		bool bRelease;
+	};
+	struct PlayerReplay
+	{
+		PlayerNumber pn;
+		RString sPlayerOptions;
+		StepsID steps;
+		std::vector<std::pair<RString,RString>> vResults;
+	};
+
+	bool LoadFromNode( const XNode *pNode, RString &sError );
+	bool SetUpGameState( RString &sError );
+	static void GetResults( const PlayerStageStats &pss, std::vector<std::pair<RString,RString>> &vOut );
+	void OverridePreference( const RString &sName, const RString &sValue );
+	void AddEvent( const Event &e ) { m_vEvents.push_back( e ); }
+	RString GetEventsString() const;
+	bool LoadEventsString( const RString &sEvents, RString &sError );
+
+	bool m_bPlayback;
+	RString m_sScreenName;
+	RString m_sGame;
+	RString m_sStyle;
+	RString m_sTheme;
+	SongID m_Song;
+	RString m_sSongOptions;
+	int m_iGameSeed;
+	int m_iStageSeed;
+	std::vector<std::pair<RString,RString>> m_vPreferences;
+	std::vector<PlayerReplay> m_vPlayers;
+	std::vector<Event> m_vEvents;
+
+	/* The clock gameplay runs on while in a ClockScope, and the start of the
+	 * current update. */
+	RageTimer m_tmClock;
+	RageTimer m_tmFrame;
+
+	/* Playback: */
+	unsigned m_iNextEvent;
+	struct DeliveringStep
+	{
+		GameInput gi;
+		bool bRelease;
+		int64_t iDelayUs;
+	};
+	std::vector<DeliveringStep> m_vDelivering;
+	int m_iMissedSteps;
+	std::vector<std::pair<RString,RString>> m_vOverridden;	// preference, original value
+	bool m_bFinished;
+	bool m_bMatched;
+
+	static GameplayReplay *s_pPlayback;
+
+	GameplayReplay( const GameplayReplay &rhs );
+	GameplayReplay &operator=( const GameplayReplay &rhs );
+};
+
+#endif
@@ -0,0 +1,261 @@
+#include "global.h"
+#include "GameplayTelemetry.h"
+#include "DateTime.h"
+#include "Preference.h"
+#include "RageFile.h"
+#include "RageLog.h"
+#include "RageUtil.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <vector>
+
+static Preference<bool> g_bGameplayTelemetry( "GameplayTelemetry", false );
+
+bool GameplayTelemetry::g_bRecording = false;
+
+namespace
+{
+	/* About 18 minutes at 60 FPS, in 1.5MB. */
+	const unsigned RING_SIZE = 1 << 16;
+
+	const char FILE_MAGIC[4] = { 'S', 'M', 'G', 'T' };
+	const uint32_t FILE_VERSION = 1;
+
+	/* A frame, as written to the file.  Times are in microseconds. */
+	struct Frame
+	{
+		uint32_t iFrameUs;
+		uint32_t iTimerUs[GameplayTelemetry::NUM_TIMERS];
+		int32_t iSoundDriftUs;	// music position minus where the clock put it
+		uint32_t iMaxStepLatencyUs;
+		uint16_t iSteps;
+		uint16_t iClockReads;	// made by the telemetry itself
+	};
+
+	/* The file is this, then iNumFrames Frames, oldest first, in the byte
+	 * order of the machine that wrote it. */
+	struct FileHeader
+	{
+		char szMagic[4];
+		uint32_t iVersion;
+		uint32_t iFrameSize;
+		uint32_t iNumFrames;
+		uint64_t iTotalFrames;	// including any the ring dropped
+		float fClockReadNs;	// what one of the telemetry's clock reads costs
+		uint32_t iPadding;
+	};
+
+	std::vector<Frame> g_vRing;
+	uint64_t g_iTotalFrames = 0;
+	Frame g_Current;
+	uint64_t g_iFrameStartUs = 0;
+	float g_fClockReadNs = 0;
+
+	uint32_t ClampToUint32( uint64_t i ) { return (uint32_t) std::min<uint64_t>( i, UINT32_MAX ); }
+
+	float MeasureClockReadNs()
+	{
+		const int iReads = 1000;
+		const uint64_t iStartUs = RageTimer::GetTimeSinceStartMicroseconds();
+		uint64_t iEndUs = iStartUs;
+		for( int i = 0; i < iReads; ++i )
+			iEndUs = RageTimer::GetTimeSinceStartMicroseconds();
+		return (iEndUs - iStartUs) * 1000.0f / iReads;
+	}
+
+	/* Append a line of percentiles of vValues, in microseconds, as ms. */
+	void AddPercentileLine( RString &sOut, const char *szName, std::vector<float> vValues )
+	{
+		if( vValues.empty() )
+		{
+			sOut += ssprintf( "%-20s %8s\n", szName, "-" );
+			return;
+		}
+
+		std::sort( vValues.begin(), vValues.end() );
+		static const float fPercentiles[] = { 50, 90, 99, 99.9f };
+		sOut += ssprintf( "%-20s", szName );
+		for( float fPercentile : fPercentiles )
+		{
+			const size_t i = std::min( vValues.size()-1, (size_t) (vValues.size() * fPercentile / 100) );
+			sOut += ssprintf( " %8.2f", vValues[i] / 1000 );
+		}
+		sOut += ssprintf( " %8.2f\n", vValues.back() / 1000 );
+	}
+
+	RString DescribeFrames( const std::vector<Frame> &vFrames, uint64_t iTotalFrames, float fClockReadNs )
+	{
+		std::vector<float> vFrameUs, vUpdateUs, vDrawUs, vDriftUs, vLatencyUs;
+		double fTotalFrameUs = 0, fTotalClockReads = 0;
+		for( const Frame &f : vFrames )
+		{
+			vFrameUs.push_back( (float) f.iFrameUs );
+			vUpdateUs.push_back( (float) f.iTimerUs[GameplayTelemetry::TIMER_PLAYER_UPDATE] );
+			vDrawUs.push_back( (float) f.iTimerUs[GameplayTelemetry::TIMER_NOTEFIELD_DRAW] );
+			vDriftUs.push_back( (float) std::abs(f.iSoundDriftUs) );
+			if( f.iSteps != 0 )
+				vLatencyUs.push_back( (float) f.iMaxStepLatencyUs );
+			fTotalFrameUs += f.iFrameUs;
+			fTotalClockReads += f.iClockReads;
+		}
+
+		RString sOut = ssprintf( "%u frames (%llu recorded); measuring took %.3f%% of frame time\n",
+			(unsigned) vFrames.size(), (unsigned long long) iTotalFrames,
+			fTotalFrameUs > 0? fTotalClockReads * fClockReadNs / 1000 / fTotalFrameUs * 100:0.0 );
+		sOut += ssprintf( "%-20s %8s %8s %8s %8s %8s\n", "(ms)", "p50", "p90", "p99", "p99.9", "max" );
+		AddPercentileLine( sOut, "Frame", vFrameUs );
+		AddPercentileLine( sOut, "Player::Update", vUpdateUs );
+		AddPercentileLine( sOut, "NoteField draw", vDrawUs );
+		AddPercentileLine( sOut, "Sound drift", vDriftUs );
+		AddPercentileLine( sOut, "Step latency", vLatencyUs );
+
+		if( !vFrameUs.empty() )
+		{
+			std::vector<float> vSorted = vFrameUs;
+			std::nth_element( vSorted.begin(), vSorted.begin() + vSorted.size()/2, vSorted.end() );
+			const float fMedianUs = vSorted[vSorted.size()/2];
+			int iHitches = 0;
+			for( float fUs : vFrameUs )
+			{
+				if( fUs > fMedianUs * 2 )
+					++iHitches;
+			}
+			sOut += ssprintf( "%i frames took over twice the median\n", iHitches );
+		}
+		return sOut;
+	}
+}
+
+void GameplayTelemetry::BeginStage()
+{
+	g_bRecording = g_bGameplayTelemetry.Get();
+	if( !g_bRecording )
+		return;
+
+	if( g_vRing.empty() )
+		g_vRing.resize( RING_SIZE );
+	g_iTotalFrames = 0;
+	g_Current = Frame();
+	g_fClockReadNs = MeasureClockReadNs();
+	g_iFrameStartUs = RageTimer::GetTimeSinceStartMicroseconds();
+}
+
+void GameplayTelemetry::NextFrame()
+{
+	if( !g_bRecording )
+		return;
+
+	const uint64_t iNowUs = RageTimer::GetTimeSinceStartMicroseconds();
+	g_Current.iFrameUs = ClampToUint32( iNowUs - g_iFrameStartUs );
+	++g_Current.iClockReads;
+	g_vRing[g_iTotalFrames % RING_SIZE] = g_Current;
+	++g_iTotalFrames;
+
+	g_Current = Frame();
+	g_iFrameStartUs = iNowUs;
+}
+
+void GameplayTelemetry::AddTime( Timer t, uint64_t iUs )
+{
+	g_Current.iTimerUs[t] = ClampToUint32( g_Current.iTimerUs[t] + iUs );
+	g_Current.iClockReads += 2;
+}
+
+void GameplayTelemetry::AddStepLatency( float fSeconds )
+{
+	if( !g_bRecording )
+		return;
+	const uint32_t iUs = (uint32_t) std::max( 0.0f, fSeconds * 1000000 );
+	g_Current.iMaxStepLatencyUs = std::max( g_Current.iMaxStepLatencyUs, iUs );
+	if( g_Current.iSteps != UINT16_MAX )
+		++g_Current.iSteps;
+}
+
+void GameplayTelemetry::SetSoundDrift( float fSeconds )
+{
+	if( !g_bRecording )
+		return;
+	g_Current.iSoundDriftUs = (int32_t) std::lrint( fSeconds * 1000000 );
+}
+
+void GameplayTelemetry::EndStage()
+{
+	if( !g_bRecording )
+		return;
+	g_bRecording = false;
+	if( g_iTotalFrames == 0 )
+		return;
+
+	/* Oldest first. */
+	std::vector<Frame> vFrames;
+	const unsigned iNumFrames = (unsigned) std::min<uint64_t>( g_iTotalFrames, RING_SIZE );
+	const unsigned iFirst = g_iTotalFrames > RING_SIZE? unsigned(g_iTotalFrames % RING_SIZE):0;
+	vFrames.reserve( iNumFrames );
+	for( unsigned i = 0; i < iNumFrames; ++i )
+		vFrames.push_back( g_vRing[(iFirst + i) % RING_SIZE] );
+
+	const DateTime now = DateTime::GetNowDateTime();
+	const RString sPath = ssprintf( "/Logs/telemetry-%04d%02d%02d-%02d%02d%02d.bin",
+		now.tm_year+1900, now.tm_mon+1, now.tm_mday, now.tm_hour, now.tm_min, now.tm_sec );
+
+	FileHeader header;
+	memcpy( header.szMagic, FILE_MAGIC, sizeof(header.szMagic) );
+	header.iVersion = FILE_VERSION;
+	header.iFrameSize = sizeof(Frame);
+	header.iNumFrames = iNumFrames;
+	header.iTotalFrames = g_iTotalFrames;
+	header.fClockReadNs = g_fClockReadNs;
+	header.iPadding = 0;
+
+	RageFile f;
+	if( !f.Open(sPath, RageFile::WRITE) ||
+		f.Write(&header, sizeof(header)) != (int) sizeof(header) ||
+		f.Write(&vFrames[0], sizeof(Frame) * vFrames.size()) != (int) (sizeof(Frame) * vFrames.size()) )
+	{
+		LOG->Warn( "Couldn't write gameplay telemetry to \"%s\": %s", sPath.c_str(), f.GetError().c_str() );
+		return;
+	}
+
+	LOG->Info( "Wrote gameplay telemetry to \"%s\":\n%s", sPath.c_str(),
+		DescribeFrames(vFrames, g_iTotalFrames, g_fClockReadNs).c_str() );
+}
+
+bool GameplayTelemetry::Summarize( const RString &sPath, RString &sOut, RString &sError )
+{
+	RageFile f;
+	if( !f.Open(sPath, RageFile::READ) )
+	{
+		sError = f.GetError();
+		return false;
+	}
+
+	FileHeader header;
+	if( f.Read(&header, sizeof(header)) != (int) sizeof(header) ||
+		memcmp(header.szMagic, FILE_MAGIC, sizeof(header.szMagic)) != 0 )
+	{
+		sError = "not a telemetry file";
+		return false;
+	}
+	if( header.iVersion != FILE_VERSION || header.iFrameSize != sizeof(Frame) )
+	{
+		sError = ssprintf( "unsupported version %u", header.iVersion );
+		return false;
+	}
+
+	if( header.iNumFrames == 0 || header.iNumFrames > RING_SIZE )
+	{
+		sError = ssprintf( "bad frame count %u", header.iNumFrames );
+		return false;
+	}
+	std::vector<Frame> vFrames( header.iNumFrames );
+	if( f.Read(&vFrames[0], sizeof(Frame) * vFrames.size()) != (int) (sizeof(Frame) * vFrames.size()) )
+	{
+		sError = "truncated";
+		return false;
+	}
+
+	sOut = DescribeFrames( vFrames, header.iTotalFrames, header.fClockReadNs );
+	return true;
+}
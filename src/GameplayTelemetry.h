@@ -0,0 +1,67 @@
+/* GameplayTelemetry - What each gameplay frame cost, for tracking down stutters. */
+
+#ifndef GAMEPLAY_TELEMETRY_H
+#define GAMEPLAY_TELEMETRY_H
+
+#include "RageTimer.h"
+
+#include <cstdint>
+
+/* With the GameplayTelemetry preference on, ScreenGameplay records, for every
+ * frame of a stage: the frame's length, the time spent in Player::Update and
+ * NoteField::DrawPrimitives, how far the music position moved from where the
+ * clock said it should be, and the longest time from a step's input to its
+ * judgment.  Frames go into a ring buffer, keeping the most recent, which is
+ * written to /Logs/telemetry-<date>-<time>.bin at the end of the stage.
+ * --TelemetrySummary=<file> prints the percentiles of a recording.
+ *
+ * Everything here is called from the game loop thread.  While not recording,
+ * a scope costs a bool load; while recording, two clock reads. */
+namespace GameplayTelemetry
+{
+	extern bool g_bRecording;
+	inline bool IsRecording() { return g_bRecording; }
+
+	enum Timer
+	{
+		TIMER_PLAYER_UPDATE,
+		TIMER_NOTEFIELD_DRAW,
+		NUM_TIMERS
+	};
+
+	/* Start recording, if the preference is on. */
+	void BeginStage();
+	/* Write what was recorded, if anything, and stop. */
+	void EndStage();
+	/* Close the current frame and start the next; call once per update. */
+	void NextFrame();
+
+	void AddTime( Timer t, uint64_t iUs );
+	void AddStepLatency( float fSeconds );
+	void SetSoundDrift( float fSeconds );
+
+	/* Read a recording and describe it, or return false and set sError. */
+	bool Summarize( const RString &sPath, RString &sOut, RString &sError );
+}
+
+class GameplayTelemetryScope
+{
+public:
+	GameplayTelemetryScope( GameplayTelemetry::Timer t ): m_Timer( t ), m_bActive( GameplayTelemetry::IsRecording() )
+	{
+		if( m_bActive )
+			m_iStartUs = RageTimer::GetTimeSinceStartMicroseconds();
+	}
+	~GameplayTelemetryScope()
+	{
+		if( m_bActive )
+			GameplayTelemetry::AddTime( m_Timer, RageTimer::GetTimeSinceStartMicroseconds() - m_iStartUs );
+	}
+
+private:
+	GameplayTelemetry::Timer m_Timer;
+	bool m_bActive;
+	uint64_t m_iStartUs;
+};
+
+#endif
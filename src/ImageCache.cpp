@@ -11,6 +11,7 @@
 #include "RageDisplay.h"
 #include "RageTexture.h"
 #include "RageTextureManager.h"
+#include "RageTextureAtlas.h"
 #include "RageSurface.h"
 #include "RageSurfaceUtils.h"
 #include "RageSurfaceUtils_Palettize.h"
@@ -24,6 +25,7 @@
 #include <cstdint>
 
 static Preference<bool> g_bPalettedImageCache( "PalettedImageCache", false );
+static Preference<bool> g_bImageCacheAtlas( "ImageCacheAtlas", true );
 
 /* Neither a global or a file scope static can be used for this because
  * the order of initialization of nonlocal objects is unspecified. */
@@ -187,16 +189,29 @@ void ImageCache::ReadFromDisk()
 	ImageData.ReadFile( IMAGE_CACHE_INDEX );	// don't care if this fails
 }
 
+/* Cached images are small, and a wheel full of banners would otherwise bind
+ * a different texture for every item, so they share pages in an atlas.  The
+ * atlas is created on demand and deleted when the last image leaves it; it
+ * can't belong to ImageCache, since textures outlive it. */
+static RageTextureAtlas *g_pImageAtlas = nullptr;
+static const int IMAGE_ATLAS_PAGE_SIZE = 2048;
+
 struct ImageTexture: public RageTexture
 {
 	uintptr_t m_uTexHandle;
-	uintptr_t GetTexHandle() const { return m_uTexHandle; };	// accessed by RageDisplay
+	uintptr_t GetTexHandle() const	// accessed by RageDisplay
+	{
+		return m_bInAtlas? g_pImageAtlas->GetTexHandle( m_AtlasSlot ):m_uTexHandle;
+	}
 	/* This is a reference to a pointer in g_ImagePathToImage. */
 	RageSurface *&m_pImage;
 	int m_iWidth, m_iHeight;
+	RageTextureAtlas::Slot m_AtlasSlot;
+	bool m_bNoAtlas;
 
 	ImageTexture( RageTextureID id, RageSurface *&pImage, int iWidth, int iHeight ):
-		RageTexture(id), m_pImage(pImage), m_iWidth(iWidth), m_iHeight(iHeight)
+		RageTexture(id), m_uTexHandle(0), m_pImage(pImage), m_iWidth(iWidth), m_iHeight(iHeight),
+		m_bNoAtlas(false)
 	{
 		Create();
 	}
@@ -245,13 +260,43 @@ struct ImageTexture: public RageTexture
 		ASSERT( DISPLAY->SupportsTextureFormat(pf) );
 
 		ASSERT(m_pImage != nullptr);
-		m_uTexHandle = DISPLAY->CreateTexture( pf, m_pImage, false );
+		if( g_bImageCacheAtlas && !m_bNoAtlas && AddToAtlas() )
+			m_AtlasRect = g_pImageAtlas->GetTextureRect( m_AtlasSlot );
+		else
+			m_uTexHandle = DISPLAY->CreateTexture( pf, m_pImage, false );
 
 		CreateFrameRects();
 	}
 
+	bool AddToAtlas()
+	{
+		if( g_pImageAtlas == nullptr )
+		{
+			/* Paletted images each have their own palette, so pages are RGBA. */
+			RagePixelFormat pf = RagePixelFormat_RGB5A1;
+			if( !DISPLAY->SupportsTextureFormat(pf) )
+				pf = RagePixelFormat_RGBA4;
+			const int iPageSize = std::min( IMAGE_ATLAS_PAGE_SIZE, DISPLAY->GetMaxTextureSize() );
+			g_pImageAtlas = new RageTextureAtlas( "ImageCache", iPageSize, pf );
+		}
+
+		m_bInAtlas = g_pImageAtlas->Add( m_pImage, m_AtlasSlot );
+		if( !m_bInAtlas && g_pImageAtlas->GetNumPages() == 0 )
+			RageUtil::SafeDelete( g_pImageAtlas );
+		return m_bInAtlas;
+	}
+
 	void Destroy()
 	{
+		if( m_bInAtlas )
+		{
+			g_pImageAtlas->Remove( m_AtlasSlot );
+			if( g_pImageAtlas->GetNumPages() == 0 )
+				RageUtil::SafeDelete( g_pImageAtlas );
+			m_bInAtlas = false;
+			m_AtlasRect = RectF( 0, 0, 1, 1 );
+		}
+
 		if( m_uTexHandle )
 			DISPLAY->DeleteTexture( m_uTexHandle );
 		m_uTexHandle = 0;
@@ -266,6 +311,16 @@ struct ImageTexture: public RageTexture
 	void Invalidate()
 	{
 		m_uTexHandle = 0; /* don't Destroy() */
+		if( m_bInAtlas )
+			g_pImageAtlas->Invalidate();
+	}
+
+	void RemoveFromAtlas()
+	{
+		if( !m_bInAtlas )
+			return;
+		m_bNoAtlas = true;
+		Reload();
 	}
 };
 
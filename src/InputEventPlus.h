@@ -13,7 +13,7 @@ public:
 		type(IET_FIRST_PRESS),
 		MenuI(GameButton_Invalid),
 		pn(PLAYER_INVALID),
-		mp(MultiPlayer_Invalid), InputList() { }
+		mp(MultiPlayer_Invalid), InputList(), bTapped(false) { }
 	DeviceInput DeviceI;
 	GameInput GameI;
 	InputEventType type;
@@ -21,6 +21,8 @@ public:
 	PlayerNumber pn;
 	MultiPlayer mp;
 	DeviceInputList InputList;
+	// An InputEventTap has already handled this.
+	bool bTapped;
 };
 
 struct AlternateMapping
@@ -4,7 +4,7 @@
 #include "RageLog.h"
 #include "RageInput.h"
 #include "RageUtil.h"
-#include "RageThreads.h"
+#include "RageUtil_SPSCQueue.h"
 #include "Preference.h"
 #include "GameInput.h"
 #include "InputMapper.h"
@@ -12,7 +12,10 @@
 #include "PrefsManager.h"
 #include "ScreenDimensions.h"
 
-#include <set>
+#include <algorithm>
+#include <atomic>
+#include <map>
+#include <mutex>
 #include <vector>
 
 
@@ -26,75 +29,158 @@ XToString(InputEventType);
 XToLocalizedString(InputEventType);
 LuaXType(InputEventType);
 
+/* A button's actual and reported state are each packed into a word, so a
+ * driver thread and the main thread can update them without a lock: bit 0 is
+ * whether the button is held, bits 1-7 count changes, and the rest is a time
+ * in microseconds. */
+static uint64_t PackState( bool bHeld, uint64_t iSeq, const RageTimer &tm )
+{
+	const uint64_t iUs = tm.m_secs * 1000000 + tm.m_us;
+	return (iUs << 8) | ((iSeq & 0x7F) << 1) | (bHeld? 1:0);
+}
+static bool StateHeld( uint64_t iState ) { return (iState & 1) != 0; }
+static uint64_t StateSeq( uint64_t iState ) { return (iState >> 1) & 0x7F; }
+static RageTimer StateTime( uint64_t iState )
+{
+	const uint64_t iUs = iState >> 8;
+	return RageTimer( iUs / 1000000, iUs % 1000000 );
+}
+
 struct ButtonState
 {
 	ButtonState();
-	bool m_BeingHeld; // actual current state
-	bool m_bLastReportedHeld; // last state reported by Update()
-	RString m_sComment;
-	float m_fSecsHeld;
-	DeviceInput m_DeviceInput;
 
-	// Timestamp of m_BeingHeld changing.
-	RageTimer m_BeingHeldTime;
+	/* Written by the thread reporting the button: */
+	std::atomic<uint64_t> m_iBeingHeld;	// actual current state, and when it changed
+	std::atomic<float> m_fLevel;
 
-	// The time that we actually reported the last event (used for debouncing).
-	RageTimer m_LastReportTime;
+	/* The last state reported, and when it was reported (used for debouncing).
+	 * A change is only reported by swapping in a new value, so if a driver
+	 * thread and the main thread both try, only one of them reports it. */
+	std::atomic<uint64_t> m_iLastReport;
 
-	// The timestamp of the last reported change. Unlike m_BeingHeldTime, this
+	// Whether the main thread has been asked to watch this button.
+	std::atomic<bool> m_bListed;
+
+	/* Only touched by the main thread: */
+	uint64_t m_iLastReportSeen;	// the m_iLastReport of the last event queued
+	bool m_bActive;	// in g_viActiveButtons
+	bool m_bLastReportedHeld; // last state reported by Update()
+	bool m_bDisableRepeat;
+	float m_fSecsHeld;
+
+	// The timestamp of the last reported change. Unlike m_iBeingHeld, this
 	// value is debounced along with the input state. (This is the same as
 	// m_fSecsHeld, except this isn't affected by Update scaling.)
 	RageTimer m_LastInputTime;
 };
 
-struct DeviceButtonPair
+/* A change reported on a driver thread, or a button for the main thread to
+ * start watching. */
+struct QueuedInput
 {
-	InputDevice device;
-	DeviceButton button;
-	DeviceButtonPair( InputDevice d, DeviceButton b ): device(d), button(b){ }
+	DeviceInput di;
+	InputEventType type;	// InputEventType_Invalid if nothing was reported
+	uint64_t iReport;	// the m_iLastReport that reported this
+	bool bTapped;
 };
 
-inline bool operator<(DeviceButtonPair const &lhs, DeviceButtonPair const &rhs)
+/* Each thread that reports input gets its own queue, so each queue has a
+ * single producer, and only the main thread consumes them. */
+struct ThreadInputQueue
 {
-	if (lhs.device != rhs.device)
-	{
-		return lhs.device < rhs.device;
-	}
-	return lhs.button < rhs.button;
-}
-inline bool operator>(DeviceButtonPair const &lhs, DeviceButtonPair const &rhs)
-{
-	return operator<(rhs, lhs);
-}
-inline bool operator<=(DeviceButtonPair const &lhs, DeviceButtonPair const &rhs)
-{
-	return !operator<(rhs, lhs);
-}
-inline bool operator>=(DeviceButtonPair const &lhs, DeviceButtonPair const &rhs)
-{
-	return !operator<(lhs, rhs);
-}
+	ThreadInputQueue(): m_Events( 1024 ), m_bFinished( false ) { }
+	SPSCQueue<QueuedInput> m_Events;
+	bool m_bFinished;	// protected by g_QueuesLock
+};
 
 namespace
 {
-	/* Maintain a set of all interesting buttons: buttons which are being held
-	 * down, or which were held down and need a RELEASE event. We use this to
-	 * optimize InputFilter::Update, so we don't have to process every button
-	 * we know about when most of them aren't in use. This set is protected
-	 * by queuemutex. */
-	typedef std::map<DeviceButtonPair, ButtonState> ButtonStateMap;
-	ButtonStateMap g_ButtonStates;
-	ButtonState &GetButtonState( const DeviceInput &di )
+	/* Every button of every device, indexed by GetButtonIndex.  Only the
+	 * buttons in g_viActiveButtons are looked at each update: buttons which
+	 * are being held down, or which were held down and need a RELEASE event.
+	 * g_viActiveButtons is kept sorted, which is DeviceInput order. */
+	ButtonState *g_pButtonStates = nullptr;
+	std::vector<int> g_viActiveButtons;
+
+	int GetButtonIndex( const DeviceInput &di ) { return di.device * NUM_DeviceButton + di.button; }
+	bool IsValidButton( const DeviceInput &di ) { return di.device < NUM_InputDevice && di.button < NUM_DeviceButton; }
+	ButtonState &GetButtonState( const DeviceInput &di ) { return g_pButtonStates[GetButtonIndex(di)]; }
+
+	DeviceInputList g_CurrentState;
+
+	std::mutex g_CommentsLock;
+	std::map<DeviceInput, RString> g_ButtonComments;
+
+	/* Serializes calls to the InputEventTap, which may come from any thread
+	 * reporting input. */
+	std::mutex g_TapLock;
+
+	/* Queues are never freed; one whose thread has exited is reused by the
+	 * next thread to report input. */
+	const int MAX_INPUT_QUEUES = 16;
+	std::mutex g_QueuesLock;
+	ThreadInputQueue *g_apQueues[MAX_INPUT_QUEUES];
+	std::atomic<int> g_iNumQueues( 0 );
+
+	/* Inputs dropped because their thread's queue was full.  Update catches
+	 * up on their buttons by looking at every button. */
+	std::atomic<unsigned> g_iOverflows( 0 );
+	unsigned g_iOverflowsSeen = 0;
+
+	struct QueueSlot
 	{
-		DeviceButtonPair db(di.device, di.button);
-		ButtonState &bs = g_ButtonStates[db];
-		bs.m_DeviceInput.button = di.button;
-		bs.m_DeviceInput.device = di.device;
-		return bs;
+		ThreadInputQueue *p = nullptr;
+		~QueueSlot()
+		{
+			if( p == nullptr )
+				return;
+			std::lock_guard<std::mutex> lock( g_QueuesLock );
+			p->m_bFinished = true;
+		}
+	};
+	thread_local QueueSlot t_Queue;
+
+	ThreadInputQueue *GetInputQueue()
+	{
+		if( t_Queue.p != nullptr )
+			return t_Queue.p;
+
+		std::lock_guard<std::mutex> lock( g_QueuesLock );
+		const int iNumQueues = g_iNumQueues.load( std::memory_order_relaxed );
+		for( int i = 0; i < iNumQueues; ++i )
+		{
+			if( g_apQueues[i]->m_bFinished )
+			{
+				g_apQueues[i]->m_bFinished = false;
+				t_Queue.p = g_apQueues[i];
+				return t_Queue.p;
+			}
+		}
+		if( iNumQueues == MAX_INPUT_QUEUES )
+			return nullptr;
+
+		g_apQueues[iNumQueues] = new ThreadInputQueue;
+		g_iNumQueues.store( iNumQueues+1, std::memory_order_release );
+		t_Queue.p = g_apQueues[iNumQueues];
+		return t_Queue.p;
 	}
 
-	DeviceInputList g_CurrentState;
-	std::set<DeviceInput> g_DisableRepeat;
+	void QueueInput( ThreadInputQueue *pQueue, const QueuedInput &qi )
+	{
+		if( pQueue == nullptr || !pQueue->m_Events.push(qi) )
+			g_iOverflows.fetch_add( 1, std::memory_order_relaxed );
+	}
+
+	void ActivateButton( int iIndex )
+	{
+		ButtonState &bs = g_pButtonStates[iIndex];
+		bs.m_bListed.store( true );
+		if( bs.m_bActive )
+			return;
+		bs.m_bActive = true;
+		g_viActiveButtons.insert( std::lower_bound(g_viActiveButtons.begin(), g_viActiveButtons.end(), iIndex), iIndex );
+	}
 }
 
 /* Some input devices require debouncing. Do this on both press and release.
@@ -127,7 +213,8 @@ static float g_fTimeBeforeRepeats, g_fTimeBetweenRepeats;
 
 InputFilter::InputFilter()
 {
-	queuemutex = new RageMutex("InputFilter");
+	g_pButtonStates = new ButtonState[NUM_InputDevice * NUM_DeviceButton];
+	m_pEventTap = nullptr;
 
 	Reset();
 	ResetRepeatRate();
@@ -148,8 +235,8 @@ InputFilter::InputFilter()
 
 InputFilter::~InputFilter()
 {
-	delete queuemutex;
-	g_ButtonStates.clear();
+	RageUtil::SafeDeleteArray( g_pButtonStates );
+	g_viActiveButtons.clear();
 	// Unregister with Lua.
 	LUA->UnsetGlobal( "INPUTFILTER" );
 }
@@ -177,18 +264,23 @@ void InputFilter::ResetRepeatRate()
 }
 
 ButtonState::ButtonState():
-	m_BeingHeldTime(RageZeroTimer),
-	m_LastReportTime(RageZeroTimer)
-{
-	m_BeingHeld = false;
+	m_iBeingHeld(0),
+	m_fLevel(0),
+	m_iLastReport(0),
+	m_bListed(false),
+	m_iLastReportSeen(0),
+	m_LastInputTime(RageZeroTimer)
+{
+	m_bActive = false;
 	m_bLastReportedHeld = false;
+	m_bDisableRepeat = false;
 	m_fSecsHeld = 0;
 }
 
+/* This may be called from any thread.  Changes are reported on the calling
+ * thread, and queued for Update to pass on. */
 void InputFilter::ButtonPressed( const DeviceInput &di )
 {
-	LockMut(*queuemutex);
-
 	if( di.ts.IsZero() )
 		LOG->Warn( "InputFilter::ButtonPressed: zero timestamp is invalid" );
 
@@ -205,89 +297,115 @@ void InputFilter::ButtonPressed( const DeviceInput &di )
 	}
 
 	ButtonState &bs = GetButtonState( di );
+	ThreadInputQueue *pQueue = GetInputQueue();
 
 	// Flush any delayed input, like Update() (in case Update() isn't being called).
 	RageTimer now;
-	CheckButtonChange( bs, di, now );
-
-	bs.m_DeviceInput = di;
+	bool bQueued = QueueButtonChange( pQueue, bs, di, now );
 
-	bool Down = di.bDown;
-	if( bs.m_BeingHeld != Down )
-	{
-		bs.m_BeingHeld = Down;
-		bs.m_BeingHeldTime = di.ts;
-	}
+	bs.m_fLevel.store( di.level );
+	if( StateHeld(bs.m_iBeingHeld.load()) != di.bDown )
+		bs.m_iBeingHeld.store( PackState(di.bDown, 0, di.ts) );
 
 	// Try to report presses immediately.
-	MakeButtonStateList( g_CurrentState );
-	CheckButtonChange( bs, di, now );
+	bQueued |= QueueButtonChange( pQueue, bs, di, now );
+
+	/* If the change couldn't be reported yet, or the button isn't held but
+	 * has a level, have Update watch it. */
+	if( !bs.m_bListed.exchange(true) && !bQueued )
+		QueueInput( pQueue, QueuedInput{ di, InputEventType_Invalid, 0, false } );
 }
 
 void InputFilter::SetButtonComment( const DeviceInput &di, const RString &sComment )
 {
-	LockMut(*queuemutex);
-	ButtonState &bs = GetButtonState( di );
-	bs.m_sComment = sComment;
+	std::lock_guard<std::mutex> lock( g_CommentsLock );
+	g_ButtonComments[di] = sComment;
 }
 
 /** @brief Release all buttons on the given device. */
 void InputFilter::ResetDevice( InputDevice device )
 {
-	LockMut(*queuemutex);
 	RageTimer now;
 
-	const ButtonStateMap ButtonStates( g_ButtonStates );
-	for (std::pair<DeviceButtonPair const, ButtonState> const &b : ButtonStates)
+	for( int b = 0; b < NUM_DeviceButton; ++b )
 	{
-		const DeviceButtonPair &db = b.first;
-		if( db.device == device )
-			ButtonPressed( DeviceInput(device, db.button, 0, now) );
+		const DeviceInput di( device, DeviceButton(b), 0, now );
+		const ButtonState &bs = GetButtonState( di );
+		if( StateHeld(bs.m_iBeingHeld.load()) || bs.m_fLevel.load() != 0.0f )
+			ButtonPressed( di );
 	}
 }
 
-/** @brief Check for reportable presses. */
-void InputFilter::CheckButtonChange( ButtonState &bs, DeviceInput di, const RageTimer &now )
+/** @brief Check for reportable presses.
+ *
+ * iReport is the m_iLastReport expected.  Return true if a change was
+ * reported, filling in di and iReport.  If another thread reports first,
+ * retry against its report if bRetry is set, or else give up. */
+bool InputFilter::CheckButtonChange( ButtonState &bs, DeviceInput &di, const RageTimer &now, uint64_t &iReport, bool bRetry )
 {
-	if( bs.m_BeingHeld == bs.m_bLastReportedHeld )
-		return;
+	for(;;)
+	{
+		const uint64_t iBeingHeld = bs.m_iBeingHeld.load();
+		const bool bHeld = StateHeld( iBeingHeld );
+		if( bHeld == StateHeld(iReport) )
+			return false;
 
-	GameInput gi;
+		GameInput gi;
 
-	/* Possibly apply debounce,
-	 * If the input was coin, possibly apply distinct coin debounce in the else below. */
-	if (! INPUTMAPPER->DeviceToGame(di, gi) || gi.button != GAME_BUTTON_COIN )
-	{
-		/* If the last IET_FIRST_PRESS or IET_RELEASE event was sent too recently,
-		 * wait a while before sending it. */
-		if( now - bs.m_LastReportTime < g_fInputDebounceTime )
+		/* Possibly apply debounce,
+		 * If the input was coin, possibly apply distinct coin debounce in the else below. */
+		if (! INPUTMAPPER->DeviceToGame(di, gi) || gi.button != GAME_BUTTON_COIN )
 		{
-			return;
+			/* If the last IET_FIRST_PRESS or IET_RELEASE event was sent too recently,
+			 * wait a while before sending it. */
+			if( now - StateTime(iReport) < g_fInputDebounceTime )
+			{
+				return false;
+			}
+		} else {
+			if( now - StateTime(iReport) < PREFSMAN->m_fDebounceCoinInputTime )
+			{
+				return false;
+			}
 		}
-	} else {
-		if( now - bs.m_LastReportTime < PREFSMAN->m_fDebounceCoinInputTime )
+
+		const uint64_t iNewReport = PackState( bHeld, StateSeq(iReport)+1, now );
+		if( bs.m_iLastReport.compare_exchange_strong(iReport, iNewReport) )
 		{
-			return;
+			iReport = iNewReport;
+			di.ts = StateTime( iBeingHeld );
+			di.level = bHeld? bs.m_fLevel.load():0;
+			di.bDown = bHeld;
+			return true;
 		}
+
+		if( !bRetry )
+			return false;
 	}
+}
 
-	bs.m_LastReportTime = now;
-	bs.m_bLastReportedHeld = bs.m_BeingHeld;
-	bs.m_fSecsHeld = 0;
-	bs.m_LastInputTime = bs.m_BeingHeldTime;
+/** @brief Report a change on the thread that saw it, and queue it for Update. */
+bool InputFilter::QueueButtonChange( ThreadInputQueue *pQueue, ButtonState &bs, const DeviceInput &di, const RageTimer &now )
+{
+	/* Only report a change if there's room to queue it.  Otherwise, leave it
+	 * for Update to report. */
+	if( pQueue == nullptr || pQueue->m_Events.full() )
+		return false;
 
-	di.ts = bs.m_BeingHeldTime;
-	if( !bs.m_bLastReportedHeld )
-		di.level = 0;
+	QueuedInput qi = { di, InputEventType_Invalid, bs.m_iLastReport.load(), false };
+	if( !CheckButtonChange(bs, qi.di, now, qi.iReport, true) )
+		return false;
 
-	MakeButtonStateList( g_CurrentState );
-	ReportButtonChange( di, bs.m_bLastReportedHeld? IET_FIRST_PRESS:IET_RELEASE );
+	InputEvent ie;
+	ie.di = qi.di;
+	ie.type = qi.type = qi.di.bDown? IET_FIRST_PRESS:IET_RELEASE;
+	qi.bTapped = TapButtonChange( ie );
 
-	if( !bs.m_bLastReportedHeld )
-		g_DisableRepeat.erase( di );
+	pQueue->m_Events.push( qi );
+	return true;
 }
 
-void InputFilter::ReportButtonChange( const DeviceInput &di, InputEventType t )
+InputEvent &InputFilter::ReportButtonChange( const DeviceInput &di, InputEventType t )
 {
 	queue.push_back( InputEvent() );
 	InputEvent &ie = queue.back();
@@ -295,21 +413,43 @@ void InputFilter::ReportButtonChange( const DeviceInput &di, InputEventType t )
 	ie.di = di;
 
 	/* Include a list of all buttons that were pressed at the time of this event.
-	 * We can create this efficiently using g_ButtonStates. Use a vector and not
+	 * We can create this efficiently using g_viActiveButtons. Use a vector and not
 	 * a map, for efficiency; most code will not use this information. Iterating
-	 * over g_ButtonStates will be in DeviceInput order, so users can binary
+	 * over g_viActiveButtons will be in DeviceInput order, so users can binary
 	 * search this list (eg. std::lower_bound). */
 	ie.m_ButtonState = g_CurrentState;
+	return ie;
+}
+
+bool InputFilter::TapButtonChange( const InputEvent &ie )
+{
+	if( m_pEventTap.load(std::memory_order_acquire) == nullptr )
+		return false;
+
+	std::lock_guard<std::mutex> lock( g_TapLock );
+	InputEventTap *pTap = m_pEventTap.load( std::memory_order_relaxed );
+	return pTap != nullptr && pTap->TapInputEvent( ie );
+}
+
+/* Note a change reported by a driver thread, or on this thread by Update. */
+static void SetReported( ButtonState &bs, const DeviceInput &di, uint64_t iReport )
+{
+	bs.m_iLastReportSeen = iReport;
+	bs.m_bLastReportedHeld = di.bDown;
+	bs.m_fSecsHeld = 0;
+	bs.m_LastInputTime = di.ts;
+	if( !bs.m_bLastReportedHeld )
+		bs.m_bDisableRepeat = false;
 }
 
 void InputFilter::MakeButtonStateList( std::vector<DeviceInput> &aInputOut ) const
 {
 	aInputOut.clear();
-	aInputOut.reserve( g_ButtonStates.size() );
-	for( ButtonStateMap::const_iterator it = g_ButtonStates.begin(); it != g_ButtonStates.end(); ++it )
+	aInputOut.reserve( g_viActiveButtons.size() );
+	for( int iIndex : g_viActiveButtons )
 	{
-		const ButtonState &bs = it->second;
-		aInputOut.push_back( bs.m_DeviceInput );
+		const ButtonState &bs = g_pButtonStates[iIndex];
+		aInputOut.push_back( DeviceInput(InputDevice(iIndex / NUM_DeviceButton), DeviceButton(iIndex % NUM_DeviceButton), bs.m_fLevel.load(std::memory_order_relaxed)) );
 		aInputOut.back().ts = bs.m_LastInputTime;
 		aInputOut.back().bDown = bs.m_bLastReportedHeld;
 	}
@@ -321,38 +461,81 @@ void InputFilter::Update( float fDeltaTime )
 
 	INPUTMAN->Update();
 
-	/* Make sure that nothing gets inserted while we do this, to prevent things
-	 * like "key pressed, key release, key repeat". */
-	LockMut(*queuemutex);
+	/* Pass on the changes reported by each thread, in the order each thread
+	 * reported them. */
+	const int iNumQueues = g_iNumQueues.load( std::memory_order_acquire );
+	for( int q = 0; q < iNumQueues; ++q )
+	{
+		QueuedInput qi;
+		while( g_apQueues[q]->m_Events.pop(qi) )
+		{
+			const int iIndex = GetButtonIndex( qi.di );
+			ActivateButton( iIndex );
+			if( qi.type == InputEventType_Invalid )
+				continue;
+
+			SetReported( g_pButtonStates[iIndex], qi.di, qi.iReport );
+			MakeButtonStateList( g_CurrentState );
+			ReportButtonChange( qi.di, qi.type ).m_bTapped = qi.bTapped;
+		}
+	}
 
-	DeviceInput di( InputDevice_Invalid, DeviceButton_Invalid, 1.0f, now );
+	/* If anything was dropped, we may not know about some buttons; look at
+	 * all of them. */
+	const unsigned iOverflows = g_iOverflows.load( std::memory_order_relaxed );
+	if( iOverflows != g_iOverflowsSeen )
+	{
+		LOG->Warn( "InputFilter: %u inputs overflowed their queue", iOverflows - g_iOverflowsSeen );
+		g_iOverflowsSeen = iOverflows;
+		for( int i = 0; i < NUM_InputDevice * NUM_DeviceButton; ++i )
+		{
+			const ButtonState &bs = g_pButtonStates[i];
+			if( StateHeld(bs.m_iBeingHeld.load()) || bs.m_iLastReport.load() != bs.m_iLastReportSeen || bs.m_fLevel.load() != 0.0f )
+				ActivateButton( i );
+		}
+	}
 
 	MakeButtonStateList( g_CurrentState );
 
-	std::vector<ButtonStateMap::iterator> ButtonsToErase;
+	std::vector<int> ButtonsToErase;
 
-	for( std::map<DeviceButtonPair, ButtonState>::iterator b = g_ButtonStates.begin(); b != g_ButtonStates.end(); ++b )
+	for( int iIndex : g_viActiveButtons )
 	{
-		di.device = b->first.device;
-		di.button = b->first.button;
-		ButtonState &bs = b->second;
-
-		// Generate IET_FIRST_PRESS and IET_RELEASE events that were delayed.
-		CheckButtonChange( bs, di, now );
+		DeviceInput di( InputDevice(iIndex / NUM_DeviceButton), DeviceButton(iIndex % NUM_DeviceButton), 1.0f, now );
+		ButtonState &bs = g_pButtonStates[iIndex];
+
+		/* Generate IET_FIRST_PRESS and IET_RELEASE events that were delayed.
+		 * If a driver thread has reported a change we haven't seen yet, it's
+		 * still in its queue; leave it until next time. */
+		uint64_t iReport = bs.m_iLastReportSeen;
+		if( CheckButtonChange(bs, di, now, iReport, false) )
+		{
+			SetReported( bs, di, iReport );
+			MakeButtonStateList( g_CurrentState );
+			InputEvent &ie = ReportButtonChange( di, di.bDown? IET_FIRST_PRESS:IET_RELEASE );
+			ie.m_bTapped = TapButtonChange( ie );
+		}
 
 		// Generate IET_REPEAT events.
 		if( !bs.m_bLastReportedHeld )
 		{
 			// If the key isn't pressed, and hasn't been pressed for a while
-			// (so debouncing isn't interested in it), purge the entry.
-			if( now - bs.m_LastReportTime > g_fInputDebounceTime &&
-				 bs.m_DeviceInput.level == 0.0f )
-				ButtonsToErase.push_back( b );
+			// (so debouncing isn't interested in it), stop watching it.  Do
+			// that before checking, so a change made meanwhile asks again.
+			bs.m_bListed.store( false );
+			const uint64_t iLastReport = bs.m_iLastReport.load();
+			if( iLastReport == bs.m_iLastReportSeen &&
+				!StateHeld(bs.m_iBeingHeld.load()) &&
+				now - StateTime(iLastReport) > g_fInputDebounceTime &&
+				bs.m_fLevel.load() == 0.0f )
+				ButtonsToErase.push_back( iIndex );
+			else
+				bs.m_bListed.store( true );
 			continue;
 		}
 
 		// If repeats are disabled for this button, skip.
-		if( g_DisableRepeat.find(di) != g_DisableRepeat.end() )
+		if( bs.m_bDisableRepeat )
 			continue;
 
 		const float fOldHoldTime = bs.m_fSecsHeld;
@@ -379,13 +562,22 @@ void InputFilter::Update( float fDeltaTime )
 		/* Set the timestamp to the exact time of the repeat. This way, as long
 		 * as tab/` aren't being used, the timestamp will always increase steadily
 		 * during repeats. */
+		di.level = bs.m_fLevel.load( std::memory_order_relaxed );
+		di.bDown = true;
 		di.ts = bs.m_LastInputTime + fRepeatTime;
 
 		ReportButtonChange( di, IET_REPEAT );
 	}
 
-	for (ButtonStateMap::iterator &it : ButtonsToErase)
-		g_ButtonStates.erase( it );
+	if( !ButtonsToErase.empty() )
+	{
+		for( int iIndex : ButtonsToErase )
+		{
+			g_pButtonStates[iIndex].m_bActive = false;
+			g_viActiveButtons.erase( std::lower_bound(g_viActiveButtons.begin(), g_viActiveButtons.end(), iIndex) );
+		}
+		MakeButtonStateList( g_CurrentState );
+	}
 }
 
 template<typename T, typename IT>
@@ -400,7 +592,6 @@ const T *FindItemBinarySearch( IT begin, IT end, const T &i )
 
 bool InputFilter::IsBeingPressed( const DeviceInput &di, const DeviceInputList *pButtonState ) const
 {
-	LockMut(*queuemutex);
 	if( pButtonState == nullptr )
 		pButtonState = &g_CurrentState;
 	const DeviceInput *pDI = FindItemBinarySearch( pButtonState->begin(), pButtonState->end(), di );
@@ -409,7 +600,6 @@ bool InputFilter::IsBeingPressed( const DeviceInput &di, const DeviceInputList *
 
 float InputFilter::GetSecsHeld( const DeviceInput &di, const DeviceInputList *pButtonState ) const
 {
-	LockMut(*queuemutex);
 	if( pButtonState == nullptr )
 		pButtonState = &g_CurrentState;
 	const DeviceInput *pDI = FindItemBinarySearch( pButtonState->begin(), pButtonState->end(), di );
@@ -420,7 +610,6 @@ float InputFilter::GetSecsHeld( const DeviceInput &di, const DeviceInputList *pB
 
 float InputFilter::GetLevel( const DeviceInput &di, const DeviceInputList *pButtonState ) const
 {
-	LockMut(*queuemutex);
 	if( pButtonState == nullptr )
 		pButtonState = &g_CurrentState;
 	const DeviceInput *pDI = FindItemBinarySearch( pButtonState->begin(), pButtonState->end(), di );
@@ -431,39 +620,51 @@ float InputFilter::GetLevel( const DeviceInput &di, const DeviceInputList *pButt
 
 RString InputFilter::GetButtonComment( const DeviceInput &di ) const
 {
-	LockMut(*queuemutex);
-	return GetButtonState( di ).m_sComment;
+	std::lock_guard<std::mutex> lock( g_CommentsLock );
+	std::map<DeviceInput, RString>::const_iterator it = g_ButtonComments.find( di );
+	return it == g_ButtonComments.end()? RString():it->second;
 }
 
 void InputFilter::ResetKeyRepeat( const DeviceInput &di )
 {
-	LockMut(*queuemutex);
-	GetButtonState( di ).m_fSecsHeld = 0;
+	if( IsValidButton(di) )
+		GetButtonState( di ).m_fSecsHeld = 0;
 }
 
 /** @brief Stop repeating the specified key until released. */
 void InputFilter::RepeatStopKey( const DeviceInput &di )
 {
-	LockMut(*queuemutex);
+	if( !IsValidButton(di) )
+		return;
 
 	// If the button is up, do nothing.
 	ButtonState &bs = GetButtonState( di );
 	if( !bs.m_bLastReportedHeld )
 		return;
 
-	g_DisableRepeat.insert( di );
+	bs.m_bDisableRepeat = true;
 }
 
 void InputFilter::GetInputEvents( std::vector<InputEvent> &array )
 {
 	array.clear();
-	LockMut(*queuemutex);
 	array.swap( queue );
 }
 
+void InputFilter::SetEventTap( InputEventTap *pTap )
+{
+	/* Once this returns, the old tap isn't being called. */
+	std::lock_guard<std::mutex> lock( g_TapLock );
+	m_pEventTap.store( pTap, std::memory_order_release );
+}
+
+unsigned InputFilter::GetQueueOverflows() const
+{
+	return g_iOverflows.load( std::memory_order_relaxed );
+}
+
 void InputFilter::GetPressedButtons( std::vector<DeviceInput> &array ) const
 {
-	LockMut(*queuemutex);
 	array = g_CurrentState;
 }
 
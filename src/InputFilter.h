@@ -5,6 +5,8 @@
 
 #include "RageInputDevice.h"
 
+#include <atomic>
+#include <cstdint>
 #include <vector>
 
 
@@ -31,13 +33,26 @@ LuaDeclareType(InputEventType);
 
 struct InputEvent
 {
-	InputEvent(): type(IET_FIRST_PRESS) {}
+	InputEvent(): type(IET_FIRST_PRESS), m_bTapped(false) {}
 
 	DeviceInput di;
 	InputEventType type;
 
 	// A list of all buttons that were pressed at the time of this event:
 	DeviceInputList m_ButtonState;
+
+	// An InputEventTap took this event, and has handled it.
+	bool m_bTapped;
+};
+
+/* Sees each press and release as soon as it's reported, on the thread that
+ * reported it.  Calls are serialized, so it's only called from one thread at a
+ * time.  Events it takes are still queued, but with m_bTapped set. */
+class InputEventTap
+{
+public:
+	virtual ~InputEventTap() { }
+	virtual bool TapInputEvent( const InputEvent &ie ) = 0;
 };
 
 struct MouseCoordinates
@@ -47,11 +62,12 @@ struct MouseCoordinates
 	float fZ;
 };
 
-class RageMutex;
 struct ButtonState;
+struct ThreadInputQueue;
 class InputFilter
 {
 public:
+	/* These may be called from any thread; the rest is for the main thread. */
 	void ButtonPressed( const DeviceInput &di );
 	void SetButtonComment( const DeviceInput &di, const RString &sComment = "" );
 	void ResetDevice( InputDevice dev );
@@ -74,6 +90,8 @@ public:
 	RString GetButtonComment( const DeviceInput &di ) const;
 
 	void GetInputEvents( std::vector<InputEvent> &aEventOut );
+	void SetEventTap( InputEventTap *pTap );
+	unsigned GetQueueOverflows() const;
 	void GetPressedButtons( std::vector<DeviceInput> &array ) const;
 
 	// cursor
@@ -87,12 +105,14 @@ public:
 	void PushSelf( lua_State *L );
 
 private:
-	void CheckButtonChange( ButtonState &bs, DeviceInput di, const RageTimer &now );
-	void ReportButtonChange( const DeviceInput &di, InputEventType t );
+	bool CheckButtonChange( ButtonState &bs, DeviceInput &di, const RageTimer &now, uint64_t &iReport, bool bRetry );
+	bool QueueButtonChange( ThreadInputQueue *pQueue, ButtonState &bs, const DeviceInput &di, const RageTimer &now );
+	InputEvent &ReportButtonChange( const DeviceInput &di, InputEventType t );
+	bool TapButtonChange( const InputEvent &ie );
 	void MakeButtonStateList( std::vector<DeviceInput> &aInputOut ) const;
 
 	std::vector<InputEvent> queue;
-	RageMutex *queuemutex;
+	std::atomic<InputEventTap *> m_pEventTap;
 	MouseCoordinates m_MouseCoords;
 
 	InputFilter(const InputFilter& rhs);
@@ -0,0 +1,44 @@
+#include "global.h"
+#include "JudgmentIndex.h"
+#include "TimingData.h"
+
+#include <iterator>
+
+void JudgmentIndex::Load( NoteData &nd, const TimingData &timing )
+{
+	m_pTiming = &timing;
+	m_vvNotes.assign( nd.GetNumTracks(), std::vector<Note>() );
+	m_viCursor.assign( nd.GetNumTracks(), 0 );
+
+	for( int t=0; t<nd.GetNumTracks(); t++ )
+	{
+		std::vector<Note> &vNotes = m_vvNotes[t];
+		vNotes.reserve( std::distance(nd.begin(t), nd.end(t)) );
+		for( NoteData::iterator it = nd.begin(t); it != nd.end(t); ++it )
+		{
+			TapNote &tn = it->second;
+			// unsure if autoKeysounds should be excluded. -Wolfman2000
+			if( tn.type == TapNoteType_Empty || tn.type == TapNoteType_AutoKeysound )
+				continue;
+			if( !timing.IsJudgableAtRow(it->first) )
+				continue;
+
+			Note note;
+			note.iRow = it->first;
+			note.pTN = &tn;
+			vNotes.push_back( note );
+		}
+	}
+}
+
+void JudgmentIndex::Unload()
+{
+	m_pTiming = nullptr;
+	m_vvNotes.clear();
+	m_viCursor.clear();
+}
+
+float JudgmentIndex::GetSeconds( const Note &note ) const
+{
+	return m_pTiming->GetElapsedTimeFromBeat( NoteRowToBeat(note.iRow) );
+}
@@ -0,0 +1,111 @@
+/* JudgmentIndex - The notes of each column a step can land on, in song order. */
+
+#ifndef JUDGMENT_INDEX_H
+#define JUDGMENT_INDEX_H
+
+#include "GameConstantsAndTypes.h"
+#include "NoteData.h"
+
+#include <bitset>
+#include <vector>
+
+class TimingData;
+
+/* Everything the judgment of a human's step depends on, besides the note. */
+struct StepJudgeParams
+{
+	float fWindowSeconds[NUM_TimingWindow];
+	std::bitset<5> twDisabledWindows;
+	bool bRequireStepOnMines;
+	bool bRequireStepOnHoldHeads;
+};
+
+/* Finding the note a step lands on by searching NoteData's maps costs a few
+ * tree walks per step.  This keeps each column's judgable notes in a sorted
+ * vector, and a cursor per column that follows the steps, so finding the
+ * closest note is usually a look at the notes next to the cursor.
+ *
+ * The index holds pointers into the NoteData it was loaded from, so it must be
+ * loaded again whenever notes are added or removed.  Times aren't kept: sync
+ * changes move every note during a song, so they're read from the TimingData
+ * when asked for. */
+class JudgmentIndex
+{
+public:
+	struct Note
+	{
+		int iRow;
+		TapNote *pTN;
+	};
+
+	JudgmentIndex(): m_pTiming( nullptr ) { }
+
+	/* Index every note in nd a step can be judged against: anything but empty
+	 * notes and autoplayed keysounds, outside of warps and fakes. */
+	void Load( NoteData &nd, const TimingData &timing );
+	void Unload();
+
+	/* The time of note, from the timing the index was loaded with, as it is
+	 * now. */
+	float GetSeconds( const Note &note ) const;
+
+	int GetNumTracks() const { return (int) m_vvNotes.size(); }
+	const std::vector<Note> &GetNotes( int iTrack ) const { return m_vvNotes[iTrack]; }
+
+	/* Return the note nearest iNoteRow in iTrack that isn't bTaken(note), no
+	 * more than iMaxRowsAhead rows after it or iMaxRowsBehind rows before it,
+	 * or nullptr.  A note the same distance either side is taken from ahead.
+	 * This finds the same note searching NoteData did. */
+	template<typename IsTaken>
+	const Note *GetClosestNote( int iTrack, int iNoteRow, int iMaxRowsAhead, int iMaxRowsBehind, IsTaken bTaken ) const;
+
+private:
+	std::vector<std::vector<Note>> m_vvNotes;
+	const TimingData *m_pTiming;
+
+	/* Each track's first note at or after the last row searched for. */
+	mutable std::vector<unsigned> m_viCursor;
+};
+
+template<typename IsTaken>
+const JudgmentIndex::Note *JudgmentIndex::GetClosestNote( int iTrack, int iNoteRow, int iMaxRowsAhead, int iMaxRowsBehind, IsTaken bTaken ) const
+{
+	if( iTrack < 0 || iTrack >= GetNumTracks() )
+		return nullptr;
+
+	/* Steps arrive in song order, so the cursor rarely moves more than a note. */
+	const std::vector<Note> &vNotes = m_vvNotes[iTrack];
+	unsigned &iCursor = m_viCursor[iTrack];
+	while( iCursor < vNotes.size() && vNotes[iCursor].iRow < iNoteRow )
+		++iCursor;
+	while( iCursor > 0 && vNotes[iCursor-1].iRow >= iNoteRow )
+		--iCursor;
+
+	const Note *pNext = nullptr;
+	for( unsigned i = iCursor; i < vNotes.size() && vNotes[i].iRow < iNoteRow+iMaxRowsAhead; ++i )
+	{
+		if( !bTaken(vNotes[i]) )
+		{
+			pNext = &vNotes[i];
+			break;
+		}
+	}
+
+	const Note *pPrev = nullptr;
+	for( unsigned i = iCursor; i > 0 && vNotes[i-1].iRow >= iNoteRow-iMaxRowsBehind; --i )
+	{
+		if( !bTaken(vNotes[i-1]) )
+		{
+			pPrev = &vNotes[i-1];
+			break;
+		}
+	}
+
+	if( pNext == nullptr )
+		return pPrev;
+	if( pPrev == nullptr )
+		return pNext;
+	return (pNext->iRow - iNoteRow > iNoteRow - pPrev->iRow)? pPrev:pNext;
+}
+
+#endif
@@ -0,0 +1,343 @@
+#include "global.h"
+#include "JudgmentThread.h"
+#include "PrefsManager.h"
+#include "RageLog.h"
+#include "RageUtil.h"
+
+#include <algorithm>
+#include <cmath>
+
+/* How far from a step to look for the note it was meant for.  This matches
+ * StepSearchDistance in Player. */
+static const float STEP_SEARCH_SECONDS = 1.0f;
+
+/* Room for a few seconds of frantic stepping, if the main thread stalls. */
+static const unsigned PENDING_STEPS = 256;
+static const unsigned RESULT_STEPS = 1024;
+
+TapNoteScore JudgeHumanStep( const StepJudgeParams &params, TapNoteType type, bool bHidden, float fNoteOffset, bool bHeld, bool bRelease )
+{
+	const float fSecondsFromExact = std::abs( fNoteOffset );
+	const float *fWindow = params.fWindowSeconds;
+	const std::bitset<5> &disabledWindows = params.twDisabledWindows;
+
+	switch( type )
+	{
+	case TapNoteType_Mine:
+		// Stepped too close to mine?
+		if(!bRelease &&
+			(!params.bRequireStepOnMines || params.bRequireStepOnMines == !bHeld ) &&
+			fSecondsFromExact <= fWindow[TW_Mine])
+			return TNS_HitMine;
+		return TNS_None;
+	case TapNoteType_Attack:
+		if( !bRelease && fSecondsFromExact <= fWindow[TW_Attack] && !bHidden )
+			return AllowW1() ? TNS_W1 : TNS_W2; // sentinel
+		return TNS_None;
+	case TapNoteType_HoldHead:
+		// oh wow, this was causing the trigger before the hold heads
+		// bug. (It was fNoteOffset > 0.f before) -DaisuMaster
+		if( !params.bRequireStepOnHoldHeads && ( fNoteOffset <= fWindow[TW_W5] && fWindow[TW_W5] != 0 ) )
+		{
+			// Set it to the first non-disabled window.
+			if (!disabledWindows[TW_W1])
+				return TNS_W1;
+			else if (!disabledWindows[TW_W2])
+				return TNS_W2;
+			else if (!disabledWindows[TW_W3])
+				return TNS_W3;
+			else if (!disabledWindows[TW_W4])
+				return TNS_W4;
+			else if (!disabledWindows[TW_W5])
+				return TNS_W5;
+			return TNS_None;
+		}
+		[[fallthrough]];
+	default:
+		if( (type == TapNoteType_Lift) == bRelease )
+		{
+			if(	fSecondsFromExact <= fWindow[TW_W1] && !disabledWindows[TW_W1] )	return TNS_W1;
+			else if( fSecondsFromExact <= fWindow[TW_W2] && !disabledWindows[TW_W2] )	return TNS_W2;
+			else if( fSecondsFromExact <= fWindow[TW_W3] && !disabledWindows[TW_W3] )	return TNS_W3;
+			else if( fSecondsFromExact <= fWindow[TW_W4] && !disabledWindows[TW_W4] )	return TNS_W4;
+			else if( fSecondsFromExact <= fWindow[TW_W5] && !disabledWindows[TW_W5] )	return TNS_W5;
+		}
+		return TNS_None;
+	}
+}
+
+JudgmentSnapshot::JudgmentSnapshot( const std::vector<std::vector<Note>> &vvNotes, const TimingData &timing, float fGlobalOffsetSeconds,
+	const StepJudgeParams &params, int iGeneration ):
+	m_Timing(timing), m_fGlobalOffsetSeconds(fGlobalOffsetSeconds), m_Params(params), m_iGeneration(iGeneration)
+{
+	m_Timing.PrepareLookup();
+
+	for( const std::vector<Note> &vNotes : vvNotes )
+	{
+		m_viColumnStart.push_back( m_vNotes.size() );
+		m_vNotes.insert( m_vNotes.end(), vNotes.begin(), vNotes.end() );
+	}
+	m_viColumnStart.push_back( m_vNotes.size() );
+
+	m_pClaimed.reset( new std::atomic<bool>[m_vNotes.size()] );
+	for( unsigned i = 0; i < m_vNotes.size(); ++i )
+		m_pClaimed[i].store( m_vNotes[i].bJudged, std::memory_order_relaxed );
+}
+
+int JudgmentSnapshot::FindNote( int iCol, int iRow ) const
+{
+	if( iCol < 0 || iCol+1 >= (int) m_viColumnStart.size() )
+		return -1;
+
+	const auto begin = m_vNotes.begin() + m_viColumnStart[iCol];
+	const auto end = m_vNotes.begin() + m_viColumnStart[iCol+1];
+	const auto it = std::lower_bound( begin, end, iRow, []( const Note &n, int r ) { return n.iRow < r; } );
+	if( it == end || it->iRow != iRow )
+		return -1;
+	return it - m_vNotes.begin();
+}
+
+/* TimingData::GetBeatFromElapsedTime, without reading the offset and rate
+ * from the main thread's globals. */
+int JudgmentSnapshot::GetRowAtTime( float fMusicSeconds, float fMusicRate ) const
+{
+	TimingData::GetBeatArgs args;
+	args.elapsed_time = fMusicSeconds + fMusicRate * m_fGlobalOffsetSeconds;
+	m_Timing.GetBeatAndBPSFromElapsedTimeNoOffset( args );
+	return BeatToNoteRow( args.beat );
+}
+
+bool JudgmentSnapshot::Claim( int iNote )
+{
+	bool bExpected = false;
+	return m_pClaimed[iNote].compare_exchange_strong( bExpected, true, std::memory_order_acq_rel );
+}
+
+void JudgmentSnapshot::Judge( int iCol, float fMusicSeconds, float fMusicRate, bool bRelease, ThreadedStep &out )
+{
+	out.iRow = -1;
+	out.fNoteOffset = 0;
+	out.tns = TNS_None;
+	out.iGeneration = m_iGeneration;
+
+	if( iCol < 0 || iCol+1 >= (int) m_viColumnStart.size() )
+		return;
+
+	const int iBegin = m_viColumnStart[iCol];
+	const int iEnd = m_viColumnStart[iCol+1];
+
+	/* Search as far either side as Player::Step does, measured from the step
+	 * rather than from the last update. */
+	const int iStepRow = GetRowAtTime( fMusicSeconds, fMusicRate );
+	const int iSearchRows = std::max(
+		GetRowAtTime( fMusicSeconds + STEP_SEARCH_SECONDS, fMusicRate ) - iStepRow,
+		iStepRow - GetRowAtTime( fMusicSeconds - STEP_SEARCH_SECONDS, fMusicRate )
+	) + ROWS_PER_BEAT;
+
+	const int iFirstAfter = std::lower_bound( m_vNotes.begin() + iBegin, m_vNotes.begin() + iEnd, iStepRow,
+		[]( const Note &n, int r ) { return n.iRow < r; } ) - m_vNotes.begin();
+
+	/* If another thread claims the note we pick while we're scoring it, look
+	 * again. */
+	for(;;)
+	{
+		int iNext = iFirstAfter;
+		while( iNext < iEnd && IsClaimed(iNext) )
+			++iNext;
+		if( iNext < iEnd && m_vNotes[iNext].iRow >= iStepRow + iSearchRows )
+			iNext = iEnd;
+
+		int iPrev = iFirstAfter - 1;
+		while( iPrev >= iBegin && IsClaimed(iPrev) )
+			--iPrev;
+		if( iPrev >= iBegin && m_vNotes[iPrev].iRow < iStepRow - iSearchRows )
+			iPrev = iBegin - 1;
+
+		int iNote;
+		if( iNext == iEnd && iPrev < iBegin )
+			return;
+		else if( iNext == iEnd )
+			iNote = iPrev;
+		else if( iPrev < iBegin )
+			iNote = iNext;
+		else if( m_vNotes[iNext].iRow - iStepRow > iStepRow - m_vNotes[iPrev].iRow )
+			iNote = iPrev;
+		else
+			iNote = iNext;
+
+		const Note &note = m_vNotes[iNote];
+		const float fNoteOffset = (note.fSeconds - fMusicSeconds) / fMusicRate;
+		const TapNoteScore tns = JudgeHumanStep( m_Params, note.type, false, fNoteOffset, false, bRelease );
+		if( tns != TNS_None && !Claim(iNote) )
+			continue;
+
+		out.iRow = note.iRow;
+		out.fNoteOffset = fNoteOffset;
+		out.tns = tns;
+		return;
+	}
+}
+
+JudgmentThread::Slot::Slot():
+	m_iSeq(0), m_fMusicSeconds(0), m_iBeatUpdateUs(0), m_fMusicRate(1), m_bLive(false),
+	m_Results(RESULT_STEPS)
+{
+}
+
+JudgmentThread::JudgmentThread():
+	m_Pending(PENDING_STEPS), m_bHaveHeld(false), m_bShutdown(false)
+{
+	m_Thread.SetName( "Judgment thread" );
+}
+
+JudgmentThread::~JudgmentThread()
+{
+	Stop();
+}
+
+void JudgmentThread::Start( const std::vector<StepButton> &vButtons )
+{
+	Stop();
+
+	PendingStep ps;
+	while( m_Pending.pop(ps) )
+		;
+	m_bHaveHeld = false;
+
+	m_vButtons = vButtons;
+	std::sort( m_vButtons.begin(), m_vButtons.end(),
+		[]( const StepButton &a, const StepButton &b ) { return a.di < b.di; } );
+
+	m_bShutdown = false;
+	m_Thread.Create( StartThread, this );
+	if( INPUTFILTER != nullptr )
+		INPUTFILTER->SetEventTap( this );
+}
+
+void JudgmentThread::Stop()
+{
+	if( !m_Thread.IsCreated() )
+		return;
+
+	/* Once this returns, no more steps are coming in. */
+	if( INPUTFILTER != nullptr )
+		INPUTFILTER->SetEventTap( nullptr );
+
+	m_bShutdown = true;
+	m_Thread.Wait();
+}
+
+void JudgmentThread::SetSnapshot( PlayerNumber pn, const std::shared_ptr<JudgmentSnapshot> &pSnapshot )
+{
+	std::atomic_store( &m_Slots[pn].m_pSnapshot, pSnapshot );
+}
+
+void JudgmentThread::SetPosition( PlayerNumber pn, float fMusicSeconds, const RageTimer &tmLastBeatUpdate, float fMusicRate, bool bLive )
+{
+	Slot &slot = m_Slots[pn];
+	const unsigned iSeq = slot.m_iSeq.load( std::memory_order_relaxed );
+	slot.m_iSeq.store( iSeq+1, std::memory_order_relaxed );
+	std::atomic_thread_fence( std::memory_order_release );
+	slot.m_fMusicSeconds.store( fMusicSeconds, std::memory_order_relaxed );
+	slot.m_iBeatUpdateUs.store( int64_t(tmLastBeatUpdate.m_secs) * 1000000 + int64_t(tmLastBeatUpdate.m_us), std::memory_order_relaxed );
+	slot.m_fMusicRate.store( fMusicRate, std::memory_order_relaxed );
+	slot.m_iSeq.store( iSeq+2, std::memory_order_release );
+
+	slot.m_bLive.store( bLive, std::memory_order_release );
+}
+
+bool JudgmentThread::GetJudgedStep( PlayerNumber pn, ThreadedStep &out )
+{
+	return m_Slots[pn].m_Results.pop( out );
+}
+
+bool JudgmentThread::TapInputEvent( const InputEvent &ie )
+{
+	if( ie.type != IET_FIRST_PRESS && ie.type != IET_RELEASE )
+		return false;
+
+	const auto it = std::lower_bound( m_vButtons.begin(), m_vButtons.end(), ie.di,
+		[]( const StepButton &b, const DeviceInput &di ) { return b.di < di; } );
+	if( it == m_vButtons.end() || it->di != ie.di )
+		return false;
+	if( !m_Slots[it->pn].m_bLive.load(std::memory_order_acquire) )
+		return false;
+
+	PendingStep ps;
+	ps.pn = it->pn;
+	ps.iCol = it->iCol;
+	ps.bRelease = ie.type == IET_RELEASE;
+	ps.tm = ie.di.ts;
+
+	/* If we're full, let the main thread judge it the old way. */
+	return m_Pending.push( ps );
+}
+
+void JudgmentThread::ThreadMain()
+{
+	while( !m_bShutdown )
+	{
+		JudgePendingSteps();
+		usleep( 1000 );
+	}
+}
+
+void JudgmentThread::JudgePendingSteps()
+{
+	for(;;)
+	{
+		if( !m_bHaveHeld && !m_Pending.pop(m_Held) )
+			return;
+		m_bHaveHeld = true;
+
+		/* If the main thread hasn't kept up, wait for it, so steps stay in
+		 * order. */
+		Slot &slot = m_Slots[m_Held.pn];
+		if( slot.m_Results.full() )
+			return;
+
+		ThreadedStep step;
+		JudgeStep( m_Held, step );
+		slot.m_Results.push( step );
+		m_bHaveHeld = false;
+	}
+}
+
+void JudgmentThread::JudgeStep( const PendingStep &ps, ThreadedStep &out )
+{
+	out.iCol = ps.iCol;
+	out.bRelease = ps.bRelease;
+	out.tm = ps.tm;
+	out.iRow = -1;
+	out.fNoteOffset = 0;
+	out.tns = TNS_None;
+	out.iGeneration = -1;
+	out.fLatency = ps.tm.Ago();
+
+	Slot &slot = m_Slots[ps.pn];
+	std::shared_ptr<JudgmentSnapshot> pSnapshot = std::atomic_load( &slot.m_pSnapshot );
+	if( pSnapshot == nullptr )
+		return;
+
+	float fMusicSeconds, fMusicRate;
+	int64_t iBeatUpdateUs;
+	for(;;)
+	{
+		const unsigned iSeq = slot.m_iSeq.load( std::memory_order_acquire );
+		if( iSeq & 1 )
+			continue;
+		fMusicSeconds = slot.m_fMusicSeconds.load( std::memory_order_relaxed );
+		iBeatUpdateUs = slot.m_iBeatUpdateUs.load( std::memory_order_relaxed );
+		fMusicRate = slot.m_fMusicRate.load( std::memory_order_relaxed );
+		std::atomic_thread_fence( std::memory_order_acquire );
+		if( slot.m_iSeq.load(std::memory_order_relaxed) == iSeq )
+			break;
+	}
+
+	/* The same arithmetic as Player::Step: the music time as of the last beat
+	 * update, plus the time from then to the step. */
+	const RageTimer tmBeatUpdate( iBeatUpdateUs / 1000000, iBeatUpdateUs % 1000000 );
+	fMusicSeconds += (ps.tm - tmBeatUpdate) * fMusicRate;
+
+	pSnapshot->Judge( ps.iCol, fMusicSeconds, fMusicRate, ps.bRelease, out );
+}
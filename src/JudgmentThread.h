@@ -0,0 +1,161 @@
+/* JudgmentThread - Judge gameplay steps as they arrive, off the main thread. */
+
+#ifndef JUDGMENT_THREAD_H
+#define JUDGMENT_THREAD_H
+
+#include "GameConstantsAndTypes.h"
+#include "InputFilter.h"
+#include "JudgmentIndex.h"
+#include "NoteTypes.h"
+#include "PlayerNumber.h"
+#include "RageThreads.h"
+#include "RageTimer.h"
+#include "RageUtil_SPSCQueue.h"
+#include "TimingData.h"
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+/* Score a step fNoteOffset seconds before a note of the given type, or
+ * TNS_None if it's too far away.  Player::Step and JudgmentThread both use
+ * this, so they can't disagree. */
+TapNoteScore JudgeHumanStep( const StepJudgeParams &params, TapNoteType type, bool bHidden, float fNoteOffset, bool bHeld, bool bRelease );
+
+/* A step judged by JudgmentThread, for Player::Step to score. */
+struct ThreadedStep
+{
+	int iCol;
+	bool bRelease;
+	RageTimer tm;
+	int iRow;		// the note stepped on, or -1
+	float fNoteOffset;
+	TapNoteScore tns;
+	int iGeneration;	// of the snapshot it was judged against, or -1 if none
+	float fLatency;		// seconds from the step to its judgment
+};
+
+/* The notes of a NoteData that a step can land on, with their times.  Nothing
+ * changes once it's made except which notes are claimed: a note is claimed by
+ * whichever thread judges it first, and the other leaves it alone. */
+class JudgmentSnapshot
+{
+public:
+	struct Note
+	{
+		int iRow;
+		float fSeconds;
+		TapNoteType type;
+		bool bJudged;
+	};
+
+	/* vvNotes holds each column's notes, in row order.  Steps are placed on
+	 * rows with a copy of timing, fGlobalOffsetSeconds ahead. */
+	JudgmentSnapshot( const std::vector<std::vector<Note>> &vvNotes, const TimingData &timing, float fGlobalOffsetSeconds,
+		const StepJudgeParams &params, int iGeneration );
+
+	int GetGeneration() const { return m_iGeneration; }
+	/* The song offset the note times were taken with. */
+	float GetBeat0OffsetSeconds() const { return m_Timing.m_fBeat0OffsetInSeconds; }
+
+	/* Return the index of the note at iRow in iCol, or -1. */
+	int FindNote( int iCol, int iRow ) const;
+	bool IsClaimed( int iNote ) const { return m_pClaimed[iNote].load( std::memory_order_acquire ); }
+	/* Return false if the note was already claimed. */
+	bool Claim( int iNote );
+
+	/* Judge a step in iCol at fMusicSeconds against the nearest unclaimed
+	 * note by row, as Player::Step picks it, claiming the note if the step
+	 * scores.  Given the same steps in the same order, the results are the
+	 * same. */
+	void Judge( int iCol, float fMusicSeconds, float fMusicRate, bool bRelease, ThreadedStep &out );
+
+private:
+	int GetRowAtTime( float fMusicSeconds, float fMusicRate ) const;
+
+	std::vector<Note> m_vNotes;
+	std::vector<int> m_viColumnStart;	// m_vNotes index of each column's first note, and the end
+	std::unique_ptr<std::atomic<bool>[]> m_pClaimed;
+	TimingData m_Timing;
+	float m_fGlobalOffsetSeconds;
+	StepJudgeParams m_Params;
+	int m_iGeneration;
+};
+
+/* Takes gameplay presses and releases from INPUTFILTER as they're reported,
+ * and judges them at 1kHz against each player's JudgmentSnapshot, so judgments
+ * don't wait for the next frame.  The main thread publishes each player's
+ * music position every update, and scores the judged steps. */
+class JudgmentThread: public InputEventTap
+{
+public:
+	struct StepButton
+	{
+		DeviceInput di;
+		PlayerNumber pn;
+		int iCol;
+	};
+
+	JudgmentThread();
+	~JudgmentThread();
+
+	/* Take presses and releases of vButtons.  A player's steps are only taken
+	 * while SetPosition says they're live. */
+	void Start( const std::vector<StepButton> &vButtons );
+	void Stop();
+
+	/* Main thread: */
+	void SetSnapshot( PlayerNumber pn, const std::shared_ptr<JudgmentSnapshot> &pSnapshot );
+	void SetPosition( PlayerNumber pn, float fMusicSeconds, const RageTimer &tmLastBeatUpdate, float fMusicRate, bool bLive );
+	bool GetJudgedStep( PlayerNumber pn, ThreadedStep &out );
+
+	/* InputEventTap; InputFilter serializes calls, so there is only ever one
+	 * producer at a time. */
+	bool TapInputEvent( const InputEvent &ie );
+
+private:
+	struct PendingStep
+	{
+		PlayerNumber pn;
+		int iCol;
+		bool bRelease;
+		RageTimer tm;
+	};
+
+	struct Slot
+	{
+		Slot();
+
+		/* Only accessed with std::atomic_load and std::atomic_store. */
+		std::shared_ptr<JudgmentSnapshot> m_pSnapshot;
+
+		/* The music position, as of m_iBeatUpdateUs.  A seqlock: m_iSeq is odd
+		 * while the main thread is writing. */
+		std::atomic<unsigned> m_iSeq;
+		std::atomic<float> m_fMusicSeconds;
+		std::atomic<int64_t> m_iBeatUpdateUs;
+		std::atomic<float> m_fMusicRate;
+		std::atomic<bool> m_bLive;
+
+		SPSCQueue<ThreadedStep> m_Results;
+	};
+
+	static int StartThread( void *p ) { ((JudgmentThread *) p)->ThreadMain(); return 0; }
+	void ThreadMain();
+	void JudgePendingSteps();
+	void JudgeStep( const PendingStep &ps, ThreadedStep &out );
+
+	std::vector<StepButton> m_vButtons;	// sorted by DeviceInput
+	Slot m_Slots[NUM_PLAYERS];
+	SPSCQueue<PendingStep> m_Pending;
+
+	/* A step popped from m_Pending that its player's results had no room for. */
+	PendingStep m_Held;
+	bool m_bHaveHeld;
+
+	RageThread m_Thread;
+	std::atomic<bool> m_bShutdown;
+};
+
+#endif
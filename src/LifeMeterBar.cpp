@@ -272,7 +272,7 @@ void LifeMeterBar::AfterLifeChanged()
 	Message msg( "LifeChanged" );
 	msg.SetParam( "Player", m_pPlayerState->m_PlayerNumber );
 	msg.SetParam( "LifeMeter", LuaReference::CreateFromPush(*this) );
-	MESSAGEMAN->Broadcast( msg );
+	MESSAGEMAN->BroadcastDeferred( msg, this );
 }
 
 bool LifeMeterBar::IsHot() const
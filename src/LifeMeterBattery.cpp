@@ -205,7 +205,7 @@ void LifeMeterBattery::BroadcastLifeChanged(bool lost_life)
 	msg.SetParam("LifeMeter", LuaReference::CreateFromPush(*this));
 	msg.SetParam("LivesLeft", GetLivesLeft());
 	msg.SetParam("LostLife", lost_life);
-	MESSAGEMAN->Broadcast(msg);
+	MESSAGEMAN->BroadcastDeferred(msg);
 }
 
 void LifeMeterBattery::HandleTapScoreNone()
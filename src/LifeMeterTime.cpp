@@ -208,7 +208,7 @@ void LifeMeterTime::SendLifeChangedMessage( float fOldLife, TapNoteScore tns, Ho
 	msg.SetParam( "OldLife", fOldLife );
 	msg.SetParam( "Difference", fOldLife - m_fLifeTotalLostSeconds );
 	msg.SetParam( "LifeMeter", LuaReference::CreateFromPush(*this) );
-	MESSAGEMAN->Broadcast( msg );
+	MESSAGEMAN->BroadcastDeferred( msg );
 }
 
 bool LifeMeterTime::IsInDanger() const
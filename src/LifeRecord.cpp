@@ -0,0 +1,214 @@
+#include "global.h"
+#include "LifeRecord.h"
+#include "RageUtil.h"
+
+#include <algorithm>
+
+/* Narrower than a frame, so a song's records each get their own bucket. */
+static const float INITIAL_BUCKET_SECONDS = 1/256.0f;
+/* How far back to move a record that another shares the time of; 2^-8. */
+static const float SAME_TIME_STEP = 0.00390625f;
+
+LifeRecord::LifeRecord()
+{
+	m_bKeepSamples = false;
+	Clear();
+}
+
+void LifeRecord::Clear()
+{
+	m_vBuckets.clear();
+	m_fBucketSeconds = INITIAL_BUCKET_SECONDS;
+	m_vSamples.clear();
+}
+
+void LifeRecord::Add( float fSecond, float fLife )
+{
+	if( !m_vBuckets.empty() )
+		fSecond = std::max( fSecond, m_vBuckets.back().fSecond );
+	if( m_bKeepSamples )
+		m_vSamples.push_back( std::make_pair(fSecond, fLife) );
+
+	if( !m_vBuckets.empty() )
+	{
+		Bucket &last = m_vBuckets.back();
+		const Bucket *pBefore = m_vBuckets.size() >= 2? &m_vBuckets[m_vBuckets.size()-2]:nullptr;
+
+		/* A tap and a hold can both set the life on the same frame.  Move the
+		 * first record back a bit, or the line slopes down to the second from
+		 * the record before instead of dropping at the miss. */
+		if( fSecond == last.fSecond && fLife != last.fLast &&
+			(pBefore == nullptr || pBefore->fSecond < fSecond - SAME_TIME_STEP) )
+		{
+			last.fSecond = fSecond - SAME_TIME_STEP;
+		}
+		/* Of three records in a row with the same life, the middle one adds
+		 * nothing to the line; extend the flat bucket instead. */
+		else if( pBefore != nullptr && pBefore->fLast == fLife && last.fMin == fLife && last.fMax == fLife )
+		{
+			last.fSecond = fSecond;
+			return;
+		}
+	}
+
+	Bucket b;
+	b.fSecond = fSecond;
+	b.fLast = b.fMin = b.fMax = fLife;
+	AddBucket( b );
+}
+
+void LifeRecord::Append( const LifeRecord &other, float fOffsetSeconds )
+{
+	for( const Bucket &ob : other.m_vBuckets )
+	{
+		Bucket b = ob;
+		b.fSecond += fOffsetSeconds;
+		if( !m_vBuckets.empty() )
+			b.fSecond = std::max( b.fSecond, m_vBuckets.back().fSecond );
+		AddBucket( b );
+	}
+
+	if( m_bKeepSamples )
+	{
+		for( const std::pair<float,float> &s : other.m_vSamples )
+			m_vSamples.push_back( std::make_pair(s.first + fOffsetSeconds, s.second) );
+	}
+}
+
+void LifeRecord::AddBucket( const Bucket &b )
+{
+	if( !m_vBuckets.empty() && GetBucketIndex(b.fSecond) == GetBucketIndex(m_vBuckets.back().fSecond) )
+	{
+		Merge( m_vBuckets.back(), b );
+		return;
+	}
+
+	if( m_vBuckets.size() >= MAX_BUCKETS )
+	{
+		Downsample();
+		if( GetBucketIndex(b.fSecond) == GetBucketIndex(m_vBuckets.back().fSecond) )
+		{
+			Merge( m_vBuckets.back(), b );
+			return;
+		}
+	}
+
+	m_vBuckets.push_back( b );
+}
+
+/* Double the bucket width until there's room for another. */
+void LifeRecord::Downsample()
+{
+	do
+	{
+		m_fBucketSeconds *= 2;
+		unsigned iOut = 0;
+		for( unsigned i = 1; i < m_vBuckets.size(); ++i )
+		{
+			if( GetBucketIndex(m_vBuckets[i].fSecond) == GetBucketIndex(m_vBuckets[iOut].fSecond) )
+				Merge( m_vBuckets[iOut], m_vBuckets[i] );
+			else
+				m_vBuckets[++iOut] = m_vBuckets[i];
+		}
+		m_vBuckets.resize( iOut+1 );
+	} while( m_vBuckets.size() >= MAX_BUCKETS );
+}
+
+void LifeRecord::Merge( Bucket &into, const Bucket &from )
+{
+	into.fSecond = from.fSecond;
+	into.fLast = from.fLast;
+	into.fMin = std::min( into.fMin, from.fMin );
+	into.fMax = std::max( into.fMax, from.fMax );
+}
+
+float LifeRecord::GetAt( float fSecond ) const
+{
+	if( m_vBuckets.empty() )
+		return 0;
+
+	// Find the last bucket at or before fSecond, or the first.
+	std::vector<Bucket>::const_iterator it = std::upper_bound( m_vBuckets.begin(), m_vBuckets.end(), fSecond,
+		[]( float f, const Bucket &b ) { return f < b.fSecond; } );
+	if( it != m_vBuckets.begin() )
+		--it;
+	return it->fLast;
+}
+
+float LifeRecord::GetLerpAt( float fSecond ) const
+{
+	if( m_vBuckets.empty() )
+		return 0;
+
+	// Find the first bucket after fSecond.
+	std::vector<Bucket>::const_iterator later = std::upper_bound( m_vBuckets.begin(), m_vBuckets.end(), fSecond,
+		[]( float f, const Bucket &b ) { return f < b.fSecond; } );
+
+	// Find the last bucket at or before fSecond.
+	std::vector<Bucket>::const_iterator earlier = later;
+	if( earlier != m_vBuckets.begin() )
+		--earlier;
+
+	if( later == m_vBuckets.end() )
+		return earlier->fLast;
+
+	if( earlier->fSecond == later->fSecond ) // Don't divide by zero in SCALE.
+		return earlier->fLast;
+
+	// earlier <= fSecond <= later
+	return SCALE( fSecond, earlier->fSecond, later->fSecond, earlier->fLast, later->fLast );
+}
+
+void LifeRecord::GetLerpSamples( float *fLifeOut, int iNumSamples, float fEndSecond, float fDivisions ) const
+{
+	unsigned iLater = 0;
+	float fLastSecond = 0;
+	for( int i = 0; i < iNumSamples; ++i )
+	{
+		const float fSecond = fDivisions > 0? SCALE( i, 0, fDivisions, 0.0f, fEndSecond ):0.0f;
+		if( fSecond < fLastSecond )
+			iLater = 0;
+		fLastSecond = fSecond;
+
+		if( m_vBuckets.empty() )
+		{
+			fLifeOut[i] = 0;
+			continue;
+		}
+
+		// As GetLerpAt, walking forward from the last sample's buckets.
+		while( iLater < m_vBuckets.size() && m_vBuckets[iLater].fSecond <= fSecond )
+			++iLater;
+		const Bucket &earlier = m_vBuckets[iLater > 0? iLater-1:0];
+		if( iLater == m_vBuckets.size() )
+			fLifeOut[i] = earlier.fLast;
+		else if( earlier.fSecond == m_vBuckets[iLater].fSecond )
+			fLifeOut[i] = earlier.fLast;
+		else
+			fLifeOut[i] = SCALE( fSecond, earlier.fSecond, m_vBuckets[iLater].fSecond, earlier.fLast, m_vBuckets[iLater].fLast );
+	}
+}
+
+void LifeRecord::GetRangeSamples( float *fMinOut, float *fMaxOut, int iNumSamples, float fEndSecond ) const
+{
+	unsigned iBucket = 0;
+	float fLife = m_vBuckets.empty()? 0:m_vBuckets[0].fLast;
+	for( int i = 0; i < iNumSamples; ++i )
+	{
+		const float fFrom = SCALE( i, 0, (float)iNumSamples, 0.0f, fEndSecond );
+		const float fTo = SCALE( i+1, 0, (float)iNumSamples, 0.0f, fEndSecond );
+
+		// Start with the life carried into the span.
+		while( iBucket < m_vBuckets.size() && m_vBuckets[iBucket].fSecond < fFrom )
+			fLife = m_vBuckets[iBucket++].fLast;
+		fMinOut[i] = fMaxOut[i] = fLife;
+
+		while( iBucket < m_vBuckets.size() && m_vBuckets[iBucket].fSecond < fTo )
+		{
+			const Bucket &b = m_vBuckets[iBucket++];
+			fMinOut[i] = std::min( fMinOut[i], b.fMin );
+			fMaxOut[i] = std::max( fMaxOut[i], b.fMax );
+			fLife = b.fLast;
+		}
+	}
+}
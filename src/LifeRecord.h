@@ -0,0 +1,74 @@
+/* LifeRecord - A player's life over a stage, in a bounded amount of memory. */
+
+#ifndef LIFE_RECORD_H
+#define LIFE_RECORD_H
+
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+/* Life is recorded into buckets of time, each holding the lowest, highest and
+ * last life recorded in it, and the time of that last record.  Buckets start
+ * out narrower than a frame, so a song's record is exact.  When the record
+ * fills up, the buckets are doubled in width and neighbours merged, so a record
+ * of any length takes at most MAX_BUCKETS buckets, and adding to it takes
+ * constant time on average.
+ *
+ * The record reads as a line through the last life of each bucket, as the map
+ * of every change it replaces did.  Keeping every sample as well, for
+ * replays, is optional, and unbounded. */
+class LifeRecord
+{
+public:
+	static const unsigned MAX_BUCKETS = 4096;
+
+	LifeRecord();
+	void Clear();
+
+	/* Record fLife at fSecond.  Records come in time order; an earlier one is
+	 * taken to be at the time of the last. */
+	void Add( float fSecond, float fLife );
+	/* Add all of other's record, fOffsetSeconds later. */
+	void Append( const LifeRecord &other, float fOffsetSeconds );
+
+	bool IsEmpty() const { return m_vBuckets.empty(); }
+	/* The last life recorded, or 0 if none has been. */
+	float GetLast() const { return m_vBuckets.empty()? 0:m_vBuckets.back().fLast; }
+	float GetAt( float fSecond ) const;
+	float GetLerpAt( float fSecond ) const;
+
+	/* Fill fLifeOut with iNumSamples samples of the line, sample i taken at
+	 * i/fDivisions of fEndSecond.  This walks the record once. */
+	void GetLerpSamples( float *fLifeOut, int iNumSamples, float fEndSecond, float fDivisions ) const;
+	/* Fill fMinOut and fMaxOut with the lowest and highest life in each of
+	 * iNumSamples equal spans from 0 to fEndSecond. */
+	void GetRangeSamples( float *fMinOut, float *fMaxOut, int iNumSamples, float fEndSecond ) const;
+
+	/* Keep every record exactly as added, too, such as to compare replays. */
+	void SetKeepSamples( bool b ) { m_bKeepSamples = b; }
+	const std::vector<std::pair<float,float>> &GetSamples() const { return m_vSamples; }	// second, life
+
+	unsigned GetNumBuckets() const { return (unsigned) m_vBuckets.size(); }
+	float GetBucketSeconds() const { return m_fBucketSeconds; }
+
+private:
+	struct Bucket
+	{
+		float fSecond;	// of the last record
+		float fLast;
+		float fMin;
+		float fMax;
+	};
+
+	int64_t GetBucketIndex( float fSecond ) const { return (int64_t) (fSecond / m_fBucketSeconds); }
+	void AddBucket( const Bucket &b );
+	void Downsample();
+	static void Merge( Bucket &into, const Bucket &from );
+
+	std::vector<Bucket> m_vBuckets;
+	float m_fBucketSeconds;
+	bool m_bKeepSamples;
+	std::vector<std::pair<float,float>> m_vSamples;
+};
+
+#endif
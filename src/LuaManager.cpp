@@ -4,13 +4,18 @@
 #include "RageUtil.h"
 #include "RageLog.h"
 #include "RageFile.h"
+#include "RageFileManager.h"
 #include "RageThreads.h"
+#include "RageTimer.h"
 #include "arch/Dialog/Dialog.h"
 #include "XmlFile.h"
 #include "Command.h"
 #include "RageLog.h"
 #include "RageTypes.h"
 #include "MessageManager.h"
+#include "RageProfiler.h"
+#include "Preference.h"
+#include "SpecialFiles.h"
 #include "ver.h"
 
 #include <cassert>
@@ -18,21 +23,48 @@
 #include <csetjmp>
 #include <cstddef>
 #include <cstdint>
+#include <cstring>
+#include <algorithm>
 #include <map>
 #include <sstream> // conversion for lua functions.
+#include <utility>
 #include <vector>
 
 LuaManager *LUA = nullptr;
+
+/* Lock statistics for one LuaManager::Get call site.  Only kept while the
+ * frame profiler is enabled. */
+struct LuaSiteStats
+{
+	const char *szSite;
+	int iGets;
+	int iLocks;
+	int iContended;
+	float fWaitSeconds;
+};
+
 struct Impl
 {
 	Impl(): g_pLock("Lua") {}
 	std::vector<lua_State *> g_FreeStateList;
-	std::map<lua_State *, bool> g_ActiveStates;
+
+	/* Acquired states, and whether releasing each one unlocks.  States are
+	 * nearly always released in reverse order, so search from the back. */
+	std::vector<std::pair<lua_State *, bool>> g_ActiveStates;
 
 	RageMutex g_pLock;
+
+	std::vector<LuaSiteStats> g_vSiteStats;
+	RageTimer g_SiteStatsTimer;
+	RString g_sLockStats;
 };
 static Impl *pImpl = nullptr;
 
+/* Whether this thread holds g_pLock.  RageMutex::IsLockedByThisThread has to
+ * look up the thread ID, which is a system call on some platforms, and Get()
+ * is called far too often for that. */
+static thread_local bool t_bHoldsLua = false;
+
 #if defined(_MSC_VER)
 	/* "interaction between '_setjmp' and C++ object destruction is non-portable"
 	 * We don't care; we'll throw a fatal exception immediately anyway. */
@@ -281,15 +313,46 @@ LuaManager::~LuaManager()
 	RageUtil::SafeDelete( pImpl );
 }
 
-Lua *LuaManager::Get()
+Lua *LuaManager::Get( const char *szSite )
 {
-	bool bLocked = false;
-	if( !pImpl->g_pLock.IsLockedByThisThread() )
+	/* If this thread already holds Lua, this is a nested Get, and the mutex
+	 * doesn't need to be touched.  Otherwise, try the lock before blocking on
+	 * it, so we can tell when another thread had it. */
+	bool bLocked = false, bContended = false;
+	float fWaitSeconds = 0;
+	if( !t_bHoldsLua )
 	{
-		pImpl->g_pLock.Lock();
+		if( !pImpl->g_pLock.TryLock() )
+		{
+			RageTimer tm;
+			pImpl->g_pLock.Lock();
+			fWaitSeconds = tm.Ago();
+			bContended = true;
+		}
+		t_bHoldsLua = true;
 		bLocked = true;
 	}
 
+	if( RageProfiler::IsEnabled() )
+	{
+		if( szSite == nullptr )
+			szSite = "(other)";
+		std::vector<LuaSiteStats> &vStats = pImpl->g_vSiteStats;
+		auto it = std::find_if( vStats.begin(), vStats.end(),
+			[szSite]( const LuaSiteStats &s ) { return s.szSite == szSite || !strcmp(s.szSite, szSite); } );
+		if( it == vStats.end() )
+		{
+			vStats.push_back( LuaSiteStats{ szSite, 0, 0, 0, 0 } );
+			it = vStats.end() - 1;
+		}
+		++it->iGets;
+		if( bLocked )
+			++it->iLocks;
+		if( bContended )
+			++it->iContended;
+		it->fWaitSeconds += fWaitSeconds;
+	}
+
 	ASSERT( lua_gettop(m_pLuaMain) == 1 );
 
 	lua_State *pRet;
@@ -307,7 +370,7 @@ Lua *LuaManager::Get()
 		pImpl->g_FreeStateList.pop_back();
 	}
 
-	pImpl->g_ActiveStates[pRet] = bLocked;
+	pImpl->g_ActiveStates.push_back( std::make_pair(pRet, bLocked) );
 	return pRet;
 }
 
@@ -316,15 +379,66 @@ void LuaManager::Release( Lua *&p )
 	pImpl->g_FreeStateList.push_back( p );
 
 	ASSERT( lua_gettop(p) == 0 );
-	ASSERT( pImpl->g_ActiveStates.find(p) != pImpl->g_ActiveStates.end() );
-	bool bDoUnlock = pImpl->g_ActiveStates[p];
-	pImpl->g_ActiveStates.erase( p );
+	std::vector<std::pair<lua_State *, bool>> &vActive = pImpl->g_ActiveStates;
+	auto it = vActive.end();
+	while( it != vActive.begin() && (it-1)->first != p )
+		--it;
+	ASSERT( it != vActive.begin() );
+	--it;
+	bool bDoUnlock = it->second;
+	vActive.erase( it );
 
 	if( bDoUnlock )
+	{
+		t_bHoldsLua = false;
 		pImpl->g_pLock.Unlock();
+	}
 	p = nullptr;
 }
 
+RString LuaManager::GetLockStats()
+{
+	if( !RageProfiler::IsEnabled() )
+	{
+		pImpl->g_sLockStats = RString();
+		return RString();
+	}
+
+	Lua *L = Get( "LuaManager::GetLockStats" );
+	const float fSeconds = pImpl->g_SiteStatsTimer.Ago();
+	if( fSeconds >= 1.0f )
+	{
+		pImpl->g_SiteStatsTimer.Touch();
+
+		std::vector<LuaSiteStats> &vStats = pImpl->g_vSiteStats;
+		std::sort( vStats.begin(), vStats.end(),
+			[]( const LuaSiteStats &a, const LuaSiteStats &b ) { return a.iGets > b.iGets; } );
+
+		LuaSiteStats total = { nullptr, 0, 0, 0, 0 };
+		for( const LuaSiteStats &s : vStats )
+		{
+			total.iGets += s.iGets;
+			total.iLocks += s.iLocks;
+			total.iContended += s.iContended;
+			total.fWaitSeconds += s.fWaitSeconds;
+		}
+
+		pImpl->g_sLockStats = ssprintf( "Lua %.0f gets/s, %.0f locks/s, %.0f contended/s (%.2fms/s waiting)",
+			total.iGets / fSeconds, total.iLocks / fSeconds, total.iContended / fSeconds,
+			total.fWaitSeconds * 1000 / fSeconds );
+		for( unsigned i = 0; i < vStats.size() && i < 4; ++i )
+		{
+			const LuaSiteStats &s = vStats[i];
+			pImpl->g_sLockStats += ssprintf( "\n  %s %.0f/s, %.0f contended/s",
+				s.szSite, s.iGets / fSeconds, s.iContended / fSeconds );
+		}
+
+		vStats.clear();
+	}
+	Release( L );
+	return pImpl->g_sLockStats;
+}
+
 /*
  * Low-level access to Lua is always serialized through pImpl->g_pLock; we never run the Lua
  * core simultaneously from multiple threads.  However, when a thread has an acquired
@@ -353,14 +467,16 @@ void LuaManager::Release( Lua *&p )
  */
 void LuaManager::YieldLua()
 {
-	ASSERT( pImpl->g_pLock.IsLockedByThisThread() );
+	ASSERT( t_bHoldsLua );
 
+	t_bHoldsLua = false;
 	pImpl->g_pLock.Unlock();
 }
 
 void LuaManager::UnyieldLua()
 {
 	pImpl->g_pLock.Lock();
+	t_bHoldsLua = true;
 }
 
 void LuaManager::RegisterTypes()
@@ -761,14 +877,10 @@ XNode *LuaHelpers::GetLuaInformation()
 
 bool LuaHelpers::RunScriptFile( const RString &sFile )
 {
-	RString sScript;
-	if( !GetFileContents(sFile, sScript) )
-		return false;
-
 	Lua *L = LUA->Get();
 
 	RString sError;
-	if( !LuaHelpers::RunScript( L, sScript, "@" + sFile, sError, 0 ) )
+	if( !LuaHelpers::LoadScriptFile(L, sFile, sError) || !LuaHelpers::RunScriptOnStack(L, sError, 0) )
 	{
 		LUA->Release( L );
 		sError = ssprintf( "Lua runtime error: %s", sError.c_str() );
@@ -783,6 +895,8 @@ bool LuaHelpers::RunScriptFile( const RString &sFile )
 
 bool LuaHelpers::LoadScript( Lua *L, const RString &sScript, const RString &sName, RString &sError )
 {
+	PROFILE_SCOPE( "Lua compile" );
+
 	// load string
 	int ret = luaL_loadbuffer( L, sScript.data(), sScript.size(), sName.c_str() );
 	if( ret )
@@ -794,6 +908,225 @@ bool LuaHelpers::LoadScript( Lua *L, const RString &sScript, const RString &sNam
 	return true;
 }
 
+/* Script files are compiled once, and the bytecode is kept until the theme is
+ * reloaded.  With LuaBytecodeDiskCache, the bytecode is also written to
+ * LUA_CACHE_DIR, so the next boot doesn't compile either.  Either copy is only
+ * used if the file's hash (size and date) still matches. */
+#define LUA_CACHE_DIR (SpecialFiles::CACHE_DIR + "Lua/")
+static const int LUA_CACHE_VERSION = 1;
+static Preference<bool> g_bLuaBytecodeDiskCache( "LuaBytecodeDiskCache", false );
+
+struct LuaCacheHeader
+{
+	int iVersion;
+	unsigned iFileHash;
+	float fCompileSeconds;
+};
+
+namespace
+{
+	struct CompiledScript
+	{
+		unsigned iFileHash;
+		float fCompileSeconds;
+		RString sBytecode;
+	};
+
+	RageMutex g_CompiledScriptsLock( "LuaCompiledScripts" );
+	std::map<RString, CompiledScript> g_mapCompiledScripts;
+	std::set<RString> *g_pScriptFileRecord = nullptr;
+	int g_iScriptCacheHits = 0, g_iScriptCacheDiskHits = 0, g_iScriptCacheMisses = 0;
+	float g_fCompileSeconds = 0, g_fCompileSecondsSaved = 0;
+
+	int DumpToString( lua_State *L, const void *p, size_t sz, void *pData )
+	{
+		static_cast<RString *>(pData)->append( static_cast<const char *>(p), sz );
+		return 0;
+	}
+
+	RString GetLuaCachePath( const RString &sFile )
+	{
+		return LUA_CACHE_DIR + ssprintf( "%08x", GetHashForString(sFile) );
+	}
+
+	bool LoadFromDiskCache( const RString &sFile, unsigned iFileHash, CompiledScript &out )
+	{
+		RageFile f;
+		if( !f.Open(GetLuaCachePath(sFile)) )
+			return false;
+
+		LuaCacheHeader h;
+		if( f.Read(&h, sizeof(h)) != sizeof(h) )
+			return false;
+		if( h.iVersion != LUA_CACHE_VERSION || h.iFileHash != iFileHash )
+			return false;
+
+		const int iSize = f.GetFileSize() - sizeof(h);
+		if( iSize <= 0 || f.Read(out.sBytecode, iSize) != iSize )
+			return false;
+		out.iFileHash = iFileHash;
+		out.fCompileSeconds = h.fCompileSeconds;
+		return true;
+	}
+
+	void SaveToDiskCache( const RString &sFile, const CompiledScript &script )
+	{
+		const RString sCachePath = GetLuaCachePath( sFile );
+		RageFile f;
+		if( !f.Open(sCachePath, RageFile::WRITE) )
+		{
+			LOG->Trace( "Couldn't write Lua cache file \"%s\": %s", sCachePath.c_str(), f.GetError().c_str() );
+			return;
+		}
+
+		LuaCacheHeader h;
+		h.iVersion = LUA_CACHE_VERSION;
+		h.iFileHash = script.iFileHash;
+		h.fCompileSeconds = script.fCompileSeconds;
+		if( f.Write(&h, sizeof(h)) == -1 || f.Write(script.sBytecode) == -1 || f.Flush() == -1 )
+		{
+			f.Close();
+			FILEMAN->Remove( sCachePath );
+		}
+	}
+}
+
+bool LuaHelpers::LoadScriptFile( Lua *L, const RString &sFile, RString &sError )
+{
+	const RString sName = "@" + sFile;
+	const unsigned iFileHash = GetHashForFile( sFile );
+
+	{
+		LockMut( g_CompiledScriptsLock );
+		if( g_pScriptFileRecord != nullptr )
+			g_pScriptFileRecord->insert( sFile );
+
+		RageTimer tm;
+		auto it = g_mapCompiledScripts.find( sFile );
+		bool bFromDisk = false;
+		if( it == g_mapCompiledScripts.end() || it->second.iFileHash != iFileHash )
+		{
+			CompiledScript script;
+			if( g_bLuaBytecodeDiskCache && LoadFromDiskCache(sFile, iFileHash, script) )
+			{
+				it = g_mapCompiledScripts.insert_or_assign( sFile, script ).first;
+				bFromDisk = true;
+			}
+			else
+			{
+				it = g_mapCompiledScripts.end();
+			}
+		}
+
+		if( it != g_mapCompiledScripts.end() )
+		{
+			const RString &sBytecode = it->second.sBytecode;
+			if( luaL_loadbuffer(L, sBytecode.data(), sBytecode.size(), sName.c_str()) == 0 )
+			{
+				++g_iScriptCacheHits;
+				if( bFromDisk )
+					++g_iScriptCacheDiskHits;
+				g_fCompileSecondsSaved += it->second.fCompileSeconds - tm.Ago();
+				return true;
+			}
+
+			/* The bytecode is bad, or from a build with a different number
+			 * format.  Compile the source and replace it. */
+			lua_pop( L, 1 );
+			g_mapCompiledScripts.erase( it );
+		}
+	}
+
+	RString sScript;
+	if( !GetFileContents(sFile, sScript) )
+	{
+		sError = ssprintf( "Couldn't read \"%s\"", sFile.c_str() );
+		return false;
+	}
+
+	RageTimer tm;
+	if( !LoadScript(L, sScript, sName, sError) )
+		return false;
+
+	CompiledScript script;
+	script.iFileHash = iFileHash;
+	script.fCompileSeconds = tm.Ago();
+	lua_dump( L, DumpToString, &script.sBytecode );
+
+	LockMut( g_CompiledScriptsLock );
+	++g_iScriptCacheMisses;
+	g_fCompileSeconds += script.fCompileSeconds;
+	if( g_bLuaBytecodeDiskCache )
+		SaveToDiskCache( sFile, script );
+	g_mapCompiledScripts[sFile] = std::move( script );
+	return true;
+}
+
+void LuaHelpers::PrecompileScriptFile( const RString &sFile )
+{
+	const unsigned iFileHash = GetHashForFile( sFile );
+	{
+		LockMut( g_CompiledScriptsLock );
+		auto it = g_mapCompiledScripts.find( sFile );
+		if( it != g_mapCompiledScripts.end() && it->second.iFileHash == iFileHash )
+			return;
+	}
+
+	RString sScript;
+	if( !GetFileContents(sFile, sScript) )
+		return;
+
+	/* Compiling only needs a bare state, not the one with our bindings. */
+	lua_State *L = lua_open();
+	RageTimer tm;
+	RString sError;
+	if( !LoadScript(L, sScript, "@" + sFile, sError) )
+	{
+		/* Leave it to LoadScriptFile to report. */
+		lua_close( L );
+		return;
+	}
+
+	CompiledScript script;
+	script.iFileHash = iFileHash;
+	script.fCompileSeconds = tm.Ago();
+	lua_dump( L, DumpToString, &script.sBytecode );
+	lua_close( L );
+
+	LockMut( g_CompiledScriptsLock );
+	g_fCompileSeconds += script.fCompileSeconds;
+	g_mapCompiledScripts[sFile] = std::move( script );
+}
+
+void LuaHelpers::SetScriptFileRecord( std::set<RString> *pRecord )
+{
+	LockMut( g_CompiledScriptsLock );
+	g_pScriptFileRecord = pRecord;
+}
+
+std::set<RString> *LuaHelpers::GetScriptFileRecord()
+{
+	LockMut( g_CompiledScriptsLock );
+	return g_pScriptFileRecord;
+}
+
+void LuaHelpers::ClearScriptFileCache()
+{
+	LockMut( g_CompiledScriptsLock );
+	g_mapCompiledScripts.clear();
+}
+
+void LuaHelpers::LogScriptFileCacheStats()
+{
+	LockMut( g_CompiledScriptsLock );
+	if( g_iScriptCacheHits + g_iScriptCacheMisses == 0 )
+		return;
+
+	LOG->Trace( "Lua script cache: %i hits (%i from disk), %i misses; compiled for %.0fms, saved %.0fms.",
+		g_iScriptCacheHits, g_iScriptCacheDiskHits, g_iScriptCacheMisses,
+		g_fCompileSeconds * 1000, g_fCompileSecondsSaved * 1000 );
+}
+
 void LuaHelpers::ScriptErrorMessage(RString const& Error)
 {
 	Message msg("ScriptError");
@@ -832,6 +1165,8 @@ void LuaHelpers::ReportScriptErrorFmt(const char *fmt, ...)
 
 bool LuaHelpers::RunScriptOnStack( Lua *L, RString &Error, int Args, int ReturnValues, bool ReportError )
 {
+	PROFILE_SCOPE( "Lua" );
+
 	lua_pushcfunction( L, GetLuaStack );
 
 	// move the error function above the function and params
@@ -895,7 +1230,7 @@ bool LuaHelpers::RunExpression( Lua *L, const RString &sExpression, const RStrin
 	return true;
 }
 
-void LuaHelpers::ParseCommandList( Lua *L, const RString &sCommands, const RString &sName, bool bLegacy )
+RString LuaHelpers::CommandListToScript( const RString &sCommands, bool bLegacy )
 {
 	RString sLuaFunction;
 	if( sCommands.size() > 0 && sCommands[0] == '\033' )
@@ -976,6 +1311,13 @@ void LuaHelpers::ParseCommandList( Lua *L, const RString &sCommands, const RStri
 		sLuaFunction = s.str();
 	}
 
+	return sLuaFunction;
+}
+
+void LuaHelpers::ParseCommandList( Lua *L, const RString &sCommands, const RString &sName, bool bLegacy )
+{
+	RString sLuaFunction = CommandListToScript( sCommands, bLegacy );
+
 	RString sError;
 	if( !LuaHelpers::RunScript(L, sLuaFunction, sName, sError, 0, 1) )
 		LOG->Warn( "Compiling \"%s\": %s", sLuaFunction.c_str(), sError.c_str() );
@@ -1109,6 +1451,21 @@ namespace
 		}
 	}
 
+	/* LoadFile(path) compiles a script file through the bytecode cache, and
+	 * returns the chunk, or nil and an error. */
+	static int LoadFile( lua_State *L )
+	{
+		RString sPath = SArg(1);
+		RString sError;
+		if( !LuaHelpers::LoadScriptFile(L, sPath, sError) )
+		{
+			lua_pushnil( L );
+			LuaHelpers::Push( L, sError );
+			return 2;
+		}
+		return 1;
+	}
+
 	/* RunWithThreadVariables(func, { a = "x", b = "y" }, arg1, arg2, arg3 ... }
 	 * calls func(arg1, arg2, arg3) with two LuaThreadVariable set, and returns
 	 * the return values of func(). */
@@ -1169,6 +1526,7 @@ namespace
 		LIST_METHOD( Flush ),
 		LIST_METHOD( CheckType ),
 		LIST_METHOD( ReadFile ),
+		LIST_METHOD( LoadFile ),
 		LIST_METHOD( RunWithThreadVariables ),
 		LIST_METHOD( GetThreadVariable ),
 		LIST_METHOD( ReportScriptError ),
@@ -22,6 +22,7 @@ extern "C"
 // For Dialog::Result
 #include "arch/Dialog/Dialog.h"
 
+#include <set>
 #include <vector>
 
 
@@ -34,7 +35,9 @@ public:
 	LuaManager();
 	~LuaManager();
 
-	Lua *Get();
+	/* szSite names the caller in GetLockStats, and must be a string literal;
+	 * callers that aren't named are counted together. */
+	Lua *Get( const char *szSite = nullptr );
 	void Release( Lua *&p );
 
 	/* Explicitly lock and unlock Lua access. This is done automatically by
@@ -50,6 +53,11 @@ public:
 	void SetGlobal( const RString &sName, const RString &val );
 	void UnsetGlobal( const RString &sName );
 
+	/* Gets, mutex locks and contended locks per second, in total and for the
+	 * busiest call sites, for the stats overlay.  Only counted while the frame
+	 * profiler is enabled. */
+	RString GetLockStats();
+
 private:
 	lua_State *m_pLuaMain;
 	// Swallow up warnings. If they must be used, define them.
@@ -59,6 +67,24 @@ private:
 
 extern LuaManager *LUA;
 
+/* Acquire Lua for the rest of the scope:
+ *
+ * LuaHandle L( "Actor::SetParent" );
+ * lua_pushnil( L );
+ */
+class LuaHandle
+{
+public:
+	explicit LuaHandle( const char *szSite ): m_pL( LUA->Get(szSite) ) { }
+	~LuaHandle() { LUA->Release( m_pL ); }
+	operator Lua *() const { return m_pL; }
+
+private:
+	Lua *m_pL;
+	LuaHandle( const LuaHandle &rhs ) = delete;
+	LuaHandle &operator=( const LuaHandle &rhs ) = delete;
+};
+
 
 /** @brief Utilities for working with Lua. */
 namespace LuaHelpers
@@ -68,6 +94,23 @@ namespace LuaHelpers
 	 * and the stack is unchanged. */
 	bool LoadScript( Lua *L, const RString &sScript, const RString &sName, RString &sError );
 
+	/* Like LoadScript, for the contents of sFile.  The compiled chunk is
+	 * cached, keyed on the path and the file's size and date. */
+	bool LoadScriptFile( Lua *L, const RString &sFile, RString &sError );
+
+	/* Compile sFile into the cache, if it isn't there already, without
+	 * touching the main Lua state.  Safe to call from any thread. */
+	void PrecompileScriptFile( const RString &sFile );
+
+	/* While set, every file passed to LoadScriptFile is added to pRecord. */
+	void SetScriptFileRecord( std::set<RString> *pRecord );
+	std::set<RString> *GetScriptFileRecord();
+
+	/* Forget cached chunks, so edited scripts are recompiled (the file hash
+	 * doesn't notice edits within a second).  Called when the theme reloads. */
+	void ClearScriptFileCache();
+	void LogScriptFileCacheStats();
+
 	/* Report the error three ways:  Broadcast message, Warn, and Dialog. */
 	/* If UseAbort is true, reports the error through Dialog::AbortRetryIgnore
 		 and returns the result. */
@@ -113,7 +156,10 @@ namespace LuaHelpers
 	// Read the table at the top of the stack back into a vector.
 	void ReadArrayFromTableB( Lua *L, std::vector<bool> &aOut );
 
+	/* Compile and run a command list, leaving the resulting function on the
+	 * stack.  CommandListToScript returns the Lua source it's compiled from. */
 	void ParseCommandList( lua_State *L, const RString &sCommands, const RString &sName, bool bLegacy );
+	RString CommandListToScript( const RString &sCommands, bool bLegacy );
 
 	XNode *GetLuaInformation();
 
@@ -22,7 +22,7 @@ LuaReference::LuaReference( const LuaReference &cpy )
 	else
 	{
 		/* Make a new reference. */
-		Lua *L = LUA->Get();
+		Lua *L = LUA->Get( "LuaReference::LuaReference" );
 		lua_rawgeti( L, LUA_REGISTRYINDEX, cpy.m_iReference );
 		m_iReference = luaL_ref( L, LUA_REGISTRYINDEX );
 		LUA->Release( L );
@@ -43,7 +43,7 @@ LuaReference &LuaReference::operator=( const LuaReference &cpy )
 	else
 	{
 		/* Make a new reference. */
-		Lua *L = LUA->Get();
+		Lua *L = LUA->Get( "LuaReference::operator=" );
 		lua_rawgeti( L, LUA_REGISTRYINDEX, cpy.m_iReference );
 		m_iReference = luaL_ref( L, LUA_REGISTRYINDEX );
 		LUA->Release( L );
@@ -68,7 +68,7 @@ void LuaReference::SetFromNil()
 void LuaReference::DeepCopy()
 {
 	/* Call DeepCopy(t, u), where t is our referenced object and u is the new table. */
-	Lua *L = LUA->Get();
+	Lua *L = LUA->Get( "LuaReference::DeepCopy" );
 
 	/* Arg 1 (t): */
 	this->PushSelf( L );
@@ -101,7 +101,7 @@ bool LuaReference::IsNil() const
 
 int LuaReference::GetLuaType() const
 {
-	Lua *L = LUA->Get();
+	Lua *L = LUA->Get( "LuaReference::GetLuaType" );
 	this->PushSelf( L );
 	int iRet = lua_type( L, -1 );
 	lua_pop( L, 1 );
@@ -115,7 +115,7 @@ void LuaReference::Unregister()
 	if( LUA == nullptr || m_iReference == LUA_NOREF )
 		return; // nothing to do
 
-	Lua *L = LUA->Get();
+	Lua *L = LUA->Get( "LuaReference::Unregister" );
 	luaL_unref( L, LUA_REGISTRYINDEX, m_iReference );
 	LUA->Release( L );
 	m_iReference = LUA_NOREF;
@@ -123,7 +123,7 @@ void LuaReference::Unregister()
 
 bool LuaReference::SetFromExpression( const RString &sExpression )
 {
-	Lua *L = LUA->Get();
+	Lua *L = LUA->Get( "LuaReference::SetFromExpression" );
 
 	bool bSuccess = LuaHelpers::RunExpression( L, sExpression );
 	this->SetFromStack( L );
@@ -135,7 +135,7 @@ bool LuaReference::SetFromExpression( const RString &sExpression )
 RString LuaReference::Serialize() const
 {
 	/* Call Serialize(t), where t is our referenced object. */
-	Lua *L = LUA->Get();
+	Lua *L = LUA->Get( "LuaReference::Serialize" );
 	lua_getglobal( L, "Serialize" );
 
 	ASSERT_M( !lua_isnil(L, -1), "Serialize() missing" );
@@ -179,7 +179,7 @@ namespace LuaHelpers
 
 LuaTable::LuaTable()
 {
-	Lua *L = LUA->Get();
+	Lua *L = LUA->Get( "LuaTable::LuaTable" );
 	lua_newtable( L );
 	this->SetFromStack(L);
 	LUA->Release( L );
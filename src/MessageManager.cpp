@@ -4,10 +4,15 @@
 #include "RageThreads.h"
 #include "EnumHelper.h"
 #include "LuaManager.h"
+#include "Preference.h"
 #include "RageLog.h"
+#include "RageProfiler.h"
+#include "RageTimer.h"
 
-#include <set>
-#include <map>
+#include <algorithm>
+#include <deque>
+#include <unordered_map>
+#include <vector>
 
 MessageManager*	MESSAGEMAN = nullptr;	// global and accessible from anywhere in our program
 
@@ -92,28 +97,111 @@ XToString( MessageID );
 
 static RageMutex g_Mutex( "MessageManager" );
 
-typedef std::set<IMessageSubscriber*> SubscribersSet;
-static std::map<RString,SubscribersSet> g_MessageToSubscribers;
+static Preference<bool> g_bDeferGameplayMessages( "DeferGameplayMessages", false );
+
+namespace
+{
+	struct MessageEntry
+	{
+		RString sName;
+		/* Removals during a broadcast leave a null, which is compacted away
+		 * once the last broadcast of this message returns. */
+		std::vector<IMessageSubscriber*> vSubscribers;
+		int iBroadcastDepth = 0;
+		bool bHasNulls = false;
+	};
+
+	/* Indexed by message ID.  This is a deque so entries (and their names) never
+	 * move as new names are added. */
+	std::deque<MessageEntry> g_Messages;
+	std::unordered_map<std::string, int> g_MessageNameToID;
+
+	// These are called with g_Mutex held.
+	MessageEntry &GetEntryLocked( int iID )
+	{
+		if( g_Messages.empty() )
+		{
+			FOREACH_ENUM( MessageID, m )
+			{
+				g_Messages.emplace_back();
+				g_Messages.back().sName = MessageIDToString( m );
+				g_MessageNameToID[g_Messages.back().sName] = m;
+			}
+		}
+		return g_Messages[iID];
+	}
+
+	int InternLocked( const RString &sName )
+	{
+		GetEntryLocked( 0 );
+		auto it = g_MessageNameToID.find( sName );
+		if( it != g_MessageNameToID.end() )
+			return it->second;
+
+		const int iID = g_Messages.size();
+		g_Messages.emplace_back();
+		g_Messages.back().sName = sName;
+		g_MessageNameToID[sName] = iID;
+		return iID;
+	}
+}
+
+namespace
+{
+	struct DeferredMessage
+	{
+		const RString *psName;
+		const void *pCoalesce;
+		LuaReference Params;
+	};
+
+	/* Messages are queued in g_vDeferred, which is swapped into g_vDispatching
+	 * for dispatch, so messages queued by handlers wait for the next frame.
+	 * Both keep their capacity, so queueing doesn't allocate once warmed up. */
+	std::vector<DeferredMessage> g_vDeferred;
+	std::vector<DeferredMessage> g_vDispatching;
+	bool g_bDispatching = false;
+
+	// Only touched by DispatchDeferred.
+	RageTimer g_DeferredStatsTimer;
+	int g_iDeferredFrames = 0, g_iDeferredTotal = 0, g_iDeferredMax = 0, g_iDeferredCoalesced = 0;
+	float g_fDeferredSeconds = 0;
+	RString g_sDeferredStats;
+	int g_iCoalesced = 0;	// guarded by g_Mutex
+}
+
+int InternMessageName( const RString &sName )
+{
+	LockMut( g_Mutex );
+	return InternLocked( sName );
+}
 
 Message::Message( const RString &s )
 {
-	m_sName = s;
-	m_pParams = new LuaTable;
+	LockMut( g_Mutex );
+	m_iID = InternLocked( s );
+	m_psName = &GetEntryLocked( m_iID ).sName;
+	m_pParams = nullptr;
 	m_bBroadcast = false;
 }
 
 Message::Message(const MessageID id)
 {
-	m_sName= MessageIDToString(id);
-	m_pParams = new LuaTable;
+	m_iID = id;
+	m_psName = &MessageIDToString(id);
+	m_pParams = nullptr;
 	m_bBroadcast = false;
 }
 
 Message::Message( const RString &s, const LuaReference &params )
 {
-	m_sName = s;
+	{
+		LockMut( g_Mutex );
+		m_iID = InternLocked( s );
+		m_psName = &GetEntryLocked( m_iID ).sName;
+	}
 	m_bBroadcast = false;
-	Lua *L = LUA->Get();
+	Lua *L = LUA->Get( "Message::Message" );
 	m_pParams = new LuaTable; // XXX: creates an extra table
 	params.PushSelf( L );
 	m_pParams->SetFromStack( L );
@@ -126,32 +214,46 @@ Message::~Message()
 	delete m_pParams;
 }
 
+void Message::SetName( const RString &sName )
+{
+	LockMut( g_Mutex );
+	m_iID = InternLocked( sName );
+	m_psName = &GetEntryLocked( m_iID ).sName;
+}
+
+LuaTable &Message::GetParams() const
+{
+	if( m_pParams == nullptr )
+		m_pParams = new LuaTable;
+	return *m_pParams;
+}
+
 void Message::PushParamTable( lua_State *L )
 {
-	m_pParams->PushSelf( L );
+	GetParams().PushSelf( L );
 }
 
 void Message::SetParamTable( const LuaReference &params )
 {
-	Lua *L = LUA->Get();
+	Lua *L = LUA->Get( "Message::SetParamTable" );
 	params.PushSelf( L );
-	m_pParams->SetFromStack( L );
+	GetParams().SetFromStack( L );
 	LUA->Release( L );
 }
 
 const LuaReference &Message::GetParamTable() const
 {
-	return *m_pParams;
+	return GetParams();
 }
 
 void Message::GetParamFromStack( lua_State *L, const RString &sName ) const
 {
-	m_pParams->Get( L, sName );
+	GetParams().Get( L, sName );
 }
 
 void Message::SetParamFromStack( lua_State *L, const RString &sName )
 {
-	m_pParams->Set( L, sName );
+	GetParams().Set( L, sName );
 }
 
 MessageManager::MessageManager()
@@ -169,40 +271,45 @@ MessageManager::MessageManager()
 
 MessageManager::~MessageManager()
 {
+	g_vDeferred.clear();
+	g_vDispatching.clear();
+
 	// Unregister with Lua.
 	LUA->UnsetGlobal( "MESSAGEMAN" );
 }
 
-void MessageManager::Subscribe( IMessageSubscriber* pSubscriber, const RString& sMessage )
+void MessageManager::Subscribe( IMessageSubscriber* pSubscriber, int iMessageID )
 {
 	LockMut(g_Mutex);
 
-	SubscribersSet& subs = g_MessageToSubscribers[sMessage];
+	MessageEntry &entry = GetEntryLocked( iMessageID );
+	std::vector<IMessageSubscriber*> &subs = entry.vSubscribers;
 #ifdef DEBUG
-	SubscribersSet::iterator iter = subs.find(pSubscriber);
-	ASSERT_M( iter == subs.end(), ssprintf("already subscribed to '%s'",sMessage.c_str()) );
+	ASSERT_M( std::find(subs.begin(), subs.end(), pSubscriber) == subs.end(),
+		ssprintf("already subscribed to '%s'",entry.sName.c_str()) );
 #endif
-	subs.insert( pSubscriber );
+	subs.push_back( pSubscriber );
 }
 
-void MessageManager::Subscribe( IMessageSubscriber* pSubscriber, MessageID m )
-{
-	Subscribe( pSubscriber, MessageIDToString(m) );
-}
-
-void MessageManager::Unsubscribe( IMessageSubscriber* pSubscriber, const RString& sMessage )
+void MessageManager::Unsubscribe( IMessageSubscriber* pSubscriber, int iMessageID )
 {
 	LockMut(g_Mutex);
 
-	SubscribersSet& subs = g_MessageToSubscribers[sMessage];
-	SubscribersSet::iterator iter = subs.find(pSubscriber);
-	ASSERT( iter != subs.end() );
-	subs.erase( iter );
-}
+	MessageEntry &entry = GetEntryLocked( iMessageID );
+	std::vector<IMessageSubscriber*> &subs = entry.vSubscribers;
 
-void MessageManager::Unsubscribe( IMessageSubscriber* pSubscriber, MessageID m )
-{
-	Unsubscribe( pSubscriber, MessageIDToString(m) );
+	// Subscribers tend to go away in the reverse of the order they came in.
+	auto iter = std::find( subs.rbegin(), subs.rend(), pSubscriber );
+	ASSERT( iter != subs.rend() );
+	if( entry.iBroadcastDepth > 0 )
+	{
+		*iter = nullptr;
+		entry.bHasNulls = true;
+	}
+	else
+	{
+		subs.erase( std::next(iter).base() );
+	}
 }
 
 void MessageManager::Broadcast( Message &msg ) const
@@ -215,14 +322,114 @@ void MessageManager::Broadcast( Message &msg ) const
 
 	LockMut(g_Mutex);
 
-	std::map<RString, SubscribersSet>::const_iterator iter = g_MessageToSubscribers.find( msg.GetName() );
-	if( iter == g_MessageToSubscribers.end() )
+	MessageEntry &entry = GetEntryLocked( msg.GetID() );
+	const size_t iNumSubscribers = entry.vSubscribers.size();
+	if( iNumSubscribers == 0 )
+		return;
+
+	/* Index rather than iterate: handlers may subscribe things, which can
+	 * reallocate the vector. */
+	++entry.iBroadcastDepth;
+	for( size_t i = 0; i < iNumSubscribers; ++i )
+	{
+		IMessageSubscriber *pSubscriber = entry.vSubscribers[i];
+		if( pSubscriber != nullptr )
+			pSubscriber->HandleMessage( msg );
+	}
+	--entry.iBroadcastDepth;
+
+	if( entry.iBroadcastDepth == 0 && entry.bHasNulls )
+	{
+		std::vector<IMessageSubscriber*> &subs = entry.vSubscribers;
+		subs.erase( std::remove(subs.begin(), subs.end(), nullptr), subs.end() );
+		entry.bHasNulls = false;
+	}
+}
+
+void MessageManager::BroadcastDeferred( Message &msg, const void *pCoalesce )
+{
+	if( !g_bDeferGameplayMessages )
+	{
+		Broadcast( msg );
 		return;
+	}
+
+	// Take the reference to the params outside of g_Mutex; it needs the Lua lock.
+	DeferredMessage d;
+	d.psName = &msg.GetName();
+	d.pCoalesce = pCoalesce;
+	d.Params = msg.GetParamTable();
+
+	LockMut( g_Mutex );
+	if( pCoalesce != nullptr )
+	{
+		auto it = std::find_if( g_vDeferred.begin(), g_vDeferred.end(),
+			[&]( const DeferredMessage &q ) { return q.pCoalesce == pCoalesce && q.psName == d.psName; } );
+		if( it != g_vDeferred.end() )
+		{
+			g_vDeferred.erase( it );
+			++g_iCoalesced;
+		}
+	}
+	g_vDeferred.push_back( d );
+}
+
+void MessageManager::DispatchDeferred()
+{
+	int iCoalesced;
+	{
+		LockMut( g_Mutex );
+		if( g_bDispatching )
+			return;
+		g_bDispatching = true;
+		g_vDispatching.swap( g_vDeferred );
+		iCoalesced = g_iCoalesced;
+		g_iCoalesced = 0;
+	}
 
-	for (IMessageSubscriber *subscriber : iter->second)
+	const int iDepth = g_vDispatching.size();
+	if( iDepth != 0 )
 	{
-		subscriber->HandleMessage( msg );
+		PROFILE_SCOPE( "Deferred messages" );
+		RageTimer timer;
+		for( const DeferredMessage &d : g_vDispatching )
+		{
+			Message msg( *d.psName, d.Params );
+			Broadcast( msg );
+		}
+		g_fDeferredSeconds += timer.Ago();
+		g_vDispatching.clear();
 	}
+
+	{
+		LockMut( g_Mutex );
+		g_bDispatching = false;
+	}
+
+	if( !g_bDeferGameplayMessages && g_sDeferredStats.empty() )
+		return;
+
+	++g_iDeferredFrames;
+	g_iDeferredTotal += iDepth;
+	g_iDeferredMax = std::max( g_iDeferredMax, iDepth );
+	g_iDeferredCoalesced += iCoalesced;
+	if( g_DeferredStatsTimer.Ago() < 1.0f )
+		return;
+	g_DeferredStatsTimer.Touch();
+
+	if( !g_bDeferGameplayMessages )
+		g_sDeferredStats = RString();
+	else
+		g_sDeferredStats = ssprintf( "Deferred messages: %.1f/frame (max %i, %i coalesced), %.2fms/frame",
+			float(g_iDeferredTotal) / g_iDeferredFrames, g_iDeferredMax, g_iDeferredCoalesced,
+			g_fDeferredSeconds * 1000 / g_iDeferredFrames );
+	g_iDeferredFrames = g_iDeferredTotal = g_iDeferredMax = g_iDeferredCoalesced = 0;
+	g_fDeferredSeconds = 0;
+}
+
+RString MessageManager::GetDeferredStats() const
+{
+	return g_sDeferredStats;
 }
 
 void MessageManager::Broadcast( const RString& sMessage ) const
@@ -234,14 +441,17 @@ void MessageManager::Broadcast( const RString& sMessage ) const
 
 void MessageManager::Broadcast( MessageID m ) const
 {
-	Broadcast( MessageIDToString(m) );
+	Message msg( m );
+	Broadcast( msg );
 }
 
-bool MessageManager::IsSubscribedToMessage( IMessageSubscriber* pSubscriber, const RString &sMessage ) const
+bool MessageManager::IsSubscribedToMessage( IMessageSubscriber* pSubscriber, int iMessageID ) const
 {
-	SubscribersSet& subs = g_MessageToSubscribers[sMessage];
-	return subs.find( pSubscriber ) != subs.end();
-}	
+	LockMut(g_Mutex);
+
+	const std::vector<IMessageSubscriber*> &subs = GetEntryLocked( iMessageID ).vSubscribers;
+	return std::find( subs.begin(), subs.end(), pSubscriber ) != subs.end();
+}
 
 void IMessageSubscriber::ClearMessages( const RString sMessage )
 {
@@ -250,8 +460,11 @@ void IMessageSubscriber::ClearMessages( const RString sMessage )
 MessageSubscriber::MessageSubscriber( const MessageSubscriber &cpy ):
 	IMessageSubscriber(cpy)
 {
-	for (RString const &msg : cpy.m_vsSubscribedTo)
-		this->SubscribeToMessage( msg );
+	for (int iMessageID : cpy.m_viSubscribedTo)
+	{
+		MESSAGEMAN->Subscribe( this, iMessageID );
+		m_viSubscribedTo.push_back( iMessageID );
+	}
 }
 
 MessageSubscriber &MessageSubscriber::operator=(const MessageSubscriber &cpy)
@@ -261,29 +474,33 @@ MessageSubscriber &MessageSubscriber::operator=(const MessageSubscriber &cpy)
 
 	UnsubscribeAll();
 
-	for (RString const &msg : cpy.m_vsSubscribedTo)
-		this->SubscribeToMessage( msg );
+	for (int iMessageID : cpy.m_viSubscribedTo)
+	{
+		MESSAGEMAN->Subscribe( this, iMessageID );
+		m_viSubscribedTo.push_back( iMessageID );
+	}
 
 	return *this;
 }
 
 void MessageSubscriber::SubscribeToMessage( const RString &sMessageName )
 {
-	MESSAGEMAN->Subscribe( this, sMessageName );
-	m_vsSubscribedTo.push_back( sMessageName );
+	const int iMessageID = InternMessageName( sMessageName );
+	MESSAGEMAN->Subscribe( this, iMessageID );
+	m_viSubscribedTo.push_back( iMessageID );
 }
 
 void MessageSubscriber::SubscribeToMessage( MessageID message )
 {
 	MESSAGEMAN->Subscribe( this, message );
-	m_vsSubscribedTo.push_back( MessageIDToString(message) );
+	m_viSubscribedTo.push_back( message );
 }
 
 void MessageSubscriber::UnsubscribeAll()
 {
-	for (RString const &s : m_vsSubscribedTo)
-		MESSAGEMAN->Unsubscribe( this, s );
-	m_vsSubscribedTo.clear();
+	for (int iMessageID : m_viSubscribedTo)
+		MESSAGEMAN->Unsubscribe( this, iMessageID );
+	m_viSubscribedTo.clear();
 }
 
 
@@ -92,6 +92,12 @@ enum MessageID
 };
 const RString& MessageIDToString( MessageID m );
 
+/* Message names are interned: each name is given an integer ID the first
+ * time it's seen, so subscribing and broadcasting never look up names.  The
+ * ID of each MessageID's name is the MessageID itself; other names are
+ * numbered after NUM_MessageID.  IDs are never freed. */
+int InternMessageName( const RString &sName );
+
 struct Message
 {
 	explicit Message( const RString &s );
@@ -99,8 +105,9 @@ struct Message
 	Message( const RString &s, const LuaReference &params );
 	~Message();
 
-	void SetName( const RString &sName ) { m_sName = sName; }
-	RString GetName() const { return m_sName; }
+	void SetName( const RString &sName );
+	const RString &GetName() const { return *m_psName; }
+	int GetID() const { return m_iID; }
 
 	bool IsBroadcast() const { return m_bBroadcast; }
 	void SetBroadcast( bool b ) { m_bBroadcast = b; }
@@ -140,12 +147,16 @@ struct Message
 		LUA->Release( L );
 	}
 
-	bool operator==( const RString &s ) const { return m_sName == s; }
-	bool operator==( MessageID id ) const { return MessageIDToString(id) == m_sName; }
+	bool operator==( const RString &s ) const { return *m_psName == s; }
+	bool operator==( MessageID id ) const { return m_iID == id; }
 
 private:
-	RString m_sName;
-	LuaTable *m_pParams;
+	LuaTable &GetParams() const;
+
+	int m_iID;
+	const RString *m_psName;	// owned by the intern table
+	/* Created on first use, so messages without parameters don't allocate. */
+	mutable LuaTable *m_pParams;
 	bool m_bBroadcast;
 
 	Message &operator=( const Message &rhs ); // don't use
@@ -171,7 +182,7 @@ private:
 class MessageSubscriber : public IMessageSubscriber
 {
 public:
-	MessageSubscriber(): m_vsSubscribedTo() {}
+	MessageSubscriber(): m_viSubscribedTo() {}
 	MessageSubscriber( const MessageSubscriber &cpy );
 	MessageSubscriber &operator=(const MessageSubscriber &cpy);
 
@@ -184,7 +195,7 @@ public:
 	void UnsubscribeAll();
 
 private:
-	std::vector<RString> m_vsSubscribedTo;
+	std::vector<int> m_viSubscribedTo;
 };
 
 /** @brief Deliver messages to any part of the program as needed. */
@@ -194,15 +205,37 @@ public:
 	MessageManager();
 	~MessageManager();
 
-	void Subscribe( IMessageSubscriber* pSubscriber, const RString& sMessage );
-	void Subscribe( IMessageSubscriber* pSubscriber, MessageID m );
-	void Unsubscribe( IMessageSubscriber* pSubscriber, const RString& sMessage );
-	void Unsubscribe( IMessageSubscriber* pSubscriber, MessageID m );
+	/* Subscribers are kept in a vector per message ID.  Subscribing or
+	 * unsubscribing from within HandleMessage is safe: a subscriber added
+	 * during a broadcast of the same message doesn't receive it, and one
+	 * removed during it won't receive it if it hasn't already. */
+	void Subscribe( IMessageSubscriber* pSubscriber, const RString& sMessage ) { Subscribe( pSubscriber, InternMessageName(sMessage) ); }
+	void Subscribe( IMessageSubscriber* pSubscriber, MessageID m ) { Subscribe( pSubscriber, int(m) ); }
+	void Subscribe( IMessageSubscriber* pSubscriber, int iMessageID );
+	void Unsubscribe( IMessageSubscriber* pSubscriber, const RString& sMessage ) { Unsubscribe( pSubscriber, InternMessageName(sMessage) ); }
+	void Unsubscribe( IMessageSubscriber* pSubscriber, MessageID m ) { Unsubscribe( pSubscriber, int(m) ); }
+	void Unsubscribe( IMessageSubscriber* pSubscriber, int iMessageID );
 	void Broadcast( Message &msg ) const;
 	void Broadcast( const RString& sMessage ) const;
 	void Broadcast( MessageID m ) const;
-	bool IsSubscribedToMessage( IMessageSubscriber* pSubscriber, const RString &sMessage ) const;
-	inline bool IsSubscribedToMessage( IMessageSubscriber* pSubscriber, MessageID message ) const { return IsSubscribedToMessage( pSubscriber, MessageIDToString(message) ); }
+	bool IsSubscribedToMessage( IMessageSubscriber* pSubscriber, const RString &sMessage ) const { return IsSubscribedToMessage( pSubscriber, InternMessageName(sMessage) ); }
+	bool IsSubscribedToMessage( IMessageSubscriber* pSubscriber, MessageID message ) const { return IsSubscribedToMessage( pSubscriber, int(message) ); }
+	bool IsSubscribedToMessage( IMessageSubscriber* pSubscriber, int iMessageID ) const;
+
+	/* Broadcast a gameplay message.  If the DeferGameplayMessages preference
+	 * is set, it's queued with its params instead, and broadcast from
+	 * DispatchDeferred, which the game loop calls once a frame after input is
+	 * handled; that keeps slow Lua handlers out of the judging path.
+	 *
+	 * For messages that only carry the latest state (like the life bar's
+	 * LifeChanged), pass the sender as pCoalesce: a queued message with the
+	 * same name from the same sender is dropped in favor of the new one. */
+	void BroadcastDeferred( Message &msg, const void *pCoalesce = nullptr );
+	void DispatchDeferred();
+
+	/* Queue depth and dispatch time per frame over the last second, for the
+	 * stats display.  Empty if nothing has been deferred. */
+	RString GetDeferredStats() const;
 
 	void SetLogging(bool set) { m_Logging= set; }
 	bool m_Logging;
@@ -223,7 +256,7 @@ private:
 public:
 	explicit BroadcastOnChange( MessageID m ) { mSendWhenChanged = m; }
 	const T Get() const { return val; }
-	void Set( T t ) { val = t; MESSAGEMAN->Broadcast( MessageIDToString(mSendWhenChanged) ); }
+	void Set( T t ) { val = t; MESSAGEMAN->Broadcast( mSendWhenChanged ); }
 	operator T () const { return val; }
 	bool operator == ( const T &other ) const { return val == other; }
 	bool operator != ( const T &other ) const { return val != other; }
@@ -263,7 +296,7 @@ private:
 public:
 	explicit BroadcastOnChangePtr( MessageID m ) { mSendWhenChanged = m; val = nullptr; }
 	T* Get() const { return val; }
-	void Set( T* t ) { val = t; if(MESSAGEMAN) MESSAGEMAN->Broadcast( MessageIDToString(mSendWhenChanged) ); }
+	void Set( T* t ) { val = t; if(MESSAGEMAN) MESSAGEMAN->Broadcast( mSendWhenChanged ); }
 	/* This is only intended to be used for setting temporary values; always
 	 * restore the original value when finished, so listeners don't get confused
 	 * due to missing a message. */
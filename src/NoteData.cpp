@@ -12,6 +12,7 @@
 #include "GameState.h" // blame radar calculations.
 #include "RageUtil_AutoPtr.h"
 
+#include <algorithm>
 #include <cstddef>
 #include <vector>
 
@@ -21,6 +22,7 @@ REGISTER_CLASS_TRAITS( NoteData, new NoteData(*pCopy) )
 void NoteData::Init()
 {
 	m_TapNotes = std::vector<TrackMap>();	// ensure that the memory is freed
+	InvalidateCounts();
 }
 
 void NoteData::SetNumTracks( int iNewNumTracks )
@@ -28,6 +30,7 @@ void NoteData::SetNumTracks( int iNewNumTracks )
 	ASSERT( iNewNumTracks > 0 );
 
 	m_TapNotes.resize( iNewNumTracks );
+	InvalidateCounts();
 }
 
 bool NoteData::IsComposite() const
@@ -44,6 +47,8 @@ bool NoteData::IsComposite() const
 // Clear (rowBegin,rowEnd).
 void NoteData::ClearRangeForTrack( int rowBegin, int rowEnd, int iTrack )
 {
+	InvalidateCounts();
+
 	// Optimization: if the range encloses everything, just clear the whole maps.
 	if( rowBegin == 0 && rowEnd == MAX_NOTE_ROW )
 	{
@@ -123,6 +128,7 @@ void NoteData::ClearAll()
 {
 	for( int t=0; t<GetNumTracks(); t++ )
 		m_TapNotes[t].clear();
+	InvalidateCounts();
 }
 
 /* Copy [rowFromBegin,rowFromEnd) from pFrom to this. (Note that this does
@@ -494,8 +500,173 @@ bool NoteData::IsFake(const TapNote &tn, const int row) const
 			|| !GAMESTATE->GetProcessedTimingData()->IsJudgableAtRow(row));
 }
 
+void NoteData::SetCacheCounts( bool b )
+{
+	m_Counts.m_bEnabled = b;
+	if( !b )
+	{
+		InvalidateCounts();
+		std::vector<NoteCounts>().swap( m_Counts.m_vTotals );
+	}
+}
+
+/* Walk every track at once, counting each row the way the queries below do,
+ * bar the timing. */
+void NoteData::BuildCounts() const
+{
+	std::vector<NoteCounts> &vTotals = m_Counts.m_vTotals;
+	vTotals.clear();
+
+	NoteCounts totals = NoteCounts();
+	totals.iRow = -1;
+	vTotals.push_back( totals );
+
+	const int iNumTracks = GetNumTracks();
+	const bool bComposite = IsComposite();
+	std::vector<TrackMap::const_iterator> vIters( iNumTracks );
+	for( int t = 0; t < iNumTracks; ++t )
+		vIters[t] = m_TapNotes[t].begin();
+	// The row each track's last hold ends on, or -1 if its last note wasn't one.
+	std::vector<int> viHoldEnd( iNumTracks, -1 );
+
+	for( ;; )
+	{
+		int iRow = MAX_NOTE_ROW;
+		for( int t = 0; t < iNumTracks; ++t )
+			if( vIters[t] != m_TapNotes[t].end() )
+				iRow = std::min( iRow, vIters[t]->first );
+		if( iRow == MAX_NOTE_ROW )
+			break;
+
+		totals.iRow = iRow;
+		int iTaps[2] = { 0, 0 };	// IsTap, by player
+		int iSimultaneousTaps = 0;	// as GetNumRowsWithSimultaneousTaps
+		int iHeld = 0;			// as RowNeedsAtLeastSimultaneousPresses
+		bool bTap = false, bTapOrHoldHead = false;
+		for( int t = 0; t < iNumTracks; ++t )
+		{
+			if( viHoldEnd[t] >= iRow )
+				++iHeld;
+			if( vIters[t] == m_TapNotes[t].end() || vIters[t]->first != iRow )
+				continue;
+
+			const TapNote &tn = vIters[t]->second;
+			++vIters[t];
+			const int p = (bComposite? tn.pn == PLAYER_1 : t < iNumTracks/2)? 0:1;
+			++totals.iPlayer[PlayerCount_Note][p];
+			switch( tn.type )
+			{
+			case TapNoteType_Tap:
+			case TapNoteType_HoldHead:
+			case TapNoteType_HoldTail:
+			case TapNoteType_Attack:
+				++totals.iPlayer[PlayerCount_Tap][p];
+				++iTaps[p];
+				++iSimultaneousTaps;
+				bTap |= tn.type == TapNoteType_Tap;
+				bTapOrHoldHead |= tn.type == TapNoteType_Tap || tn.type == TapNoteType_HoldHead;
+				if( tn.type == TapNoteType_HoldHead && tn.subType == TapNoteSubType_Hold )
+					++totals.iPlayer[PlayerCount_Hold][p];
+				else if( tn.type == TapNoteType_HoldHead && tn.subType == TapNoteSubType_Roll )
+					++totals.iPlayer[PlayerCount_Roll][p];
+				break;
+			case TapNoteType_Lift:
+				++totals.iPlayer[PlayerCount_Lift][p];
+				++iSimultaneousTaps;
+				bTap = bTapOrHoldHead = true;
+				break;
+			case TapNoteType_Mine:
+				++totals.iPlayer[PlayerCount_Mine][p];
+				break;
+			case TapNoteType_Fake:
+				++totals.iPlayer[PlayerCount_Fake][p];
+				break;
+			default:
+				break;
+			}
+
+			// What IsHoldNoteAtRow finds on the rows after this one.
+			if( tn.type == TapNoteType_HoldHead )
+				viHoldEnd[t] = iRow + tn.iDuration;
+			else if( tn.type != TapNoteType_Empty && tn.type != TapNoteType_AutoKeysound )
+				viHoldEnd[t] = -1;
+		}
+
+		for( int p = 0; p < 2; ++p )
+		{
+			totals.iPlayer[PlayerCount_JumpRow][p] += iTaps[p] >= 2;
+			totals.iPlayer[PlayerCount_HandRow][p] += iTaps[p] >= 3;
+			totals.iPlayer[PlayerCount_QuadRow][p] += iTaps[p] >= 4;
+		}
+		// Presses are the taps that aren't lifts; holds only count with one.
+		const int iPresses = iTaps[0] + iTaps[1];
+		totals.iRows[RowCount_Tap] += bTap;
+		totals.iRows[RowCount_TapOrHoldHead] += bTapOrHoldHead;
+		totals.iRows[RowCount_Jump] += iSimultaneousTaps >= 2;
+		totals.iRows[RowCount_Hand] += iPresses > 0 && iPresses + iHeld >= 3;
+		totals.iRows[RowCount_Quad] += iPresses > 0 && iPresses + iHeld >= 4;
+		vTotals.push_back( totals );
+	}
+
+	m_Counts.m_bValid = true;
+}
+
+bool NoteData::GetCachedCounts( int iStartRow, int iEndRow, NoteCounts &out ) const
+{
+	if( !m_Counts.m_bEnabled )
+		return false;
+	if( !m_Counts.m_bValid )
+		BuildCounts();
+
+	out = NoteCounts();
+	if( iStartRow >= iEndRow )
+		return true;
+
+	/* The totals of the rows before the range are those of the entry before
+	 * its first row. */
+	const std::vector<NoteCounts> &vTotals = m_Counts.m_vTotals;
+	auto RowLess = []( const NoteCounts &c, int iRow ) { return c.iRow < iRow; };
+	const size_t iBegin = std::lower_bound( vTotals.begin()+1, vTotals.end(), iStartRow, RowLess ) - vTotals.begin();
+	const size_t iEnd = std::lower_bound( vTotals.begin()+iBegin, vTotals.end(), iEndRow, RowLess ) - vTotals.begin();
+
+	const TimingData *pTiming = GAMESTATE->GetProcessedTimingData();
+	if( !pTiming->HasWarps() && !pTiming->HasFakes() )
+	{
+		// Every row can be judged.
+		const NoteCounts &before = vTotals[iBegin-1], &last = vTotals[iEnd-1];
+		for( int c = 0; c < NUM_PlayerCount; ++c )
+			for( int p = 0; p < 2; ++p )
+				out.iPlayer[c][p] = last.iPlayer[c][p] - before.iPlayer[c][p];
+		for( int c = 0; c < NUM_RowCount; ++c )
+			out.iRows[c] = last.iRows[c] - before.iRows[c];
+		return true;
+	}
+
+	// Add up the rows that can be judged; the notes of the rest are fakes.
+	for( size_t i = iBegin; i < iEnd; ++i )
+	{
+		const NoteCounts &row = vTotals[i], &before = vTotals[i-1];
+		if( !pTiming->IsJudgableAtRow(row.iRow) )
+		{
+			for( int p = 0; p < 2; ++p )
+				out.iPlayer[PlayerCount_Fake][p] += row.iPlayer[PlayerCount_Note][p] - before.iPlayer[PlayerCount_Note][p];
+			continue;
+		}
+		for( int c = 0; c < NUM_PlayerCount; ++c )
+			for( int p = 0; p < 2; ++p )
+				out.iPlayer[c][p] += row.iPlayer[c][p] - before.iPlayer[c][p];
+		for( int c = 0; c < NUM_RowCount; ++c )
+			out.iRows[c] += row.iRows[c] - before.iRows[c];
+	}
+	return true;
+}
+
 int NoteData::GetNumTapNotes( int iStartIndex, int iEndIndex ) const
 {
+	NoteCounts counts;
+	if( GetCachedCounts(iStartIndex, iEndIndex, counts) )
+		return counts.Total( PlayerCount_Tap );
+
 	int iNumNotes = 0;
 	for( int t=0; t<GetNumTracks(); t++ )
 	{
@@ -537,6 +708,10 @@ int NoteData::GetNumTapNotesInRow( int iRow ) const
 
 int NoteData::GetNumRowsWithTap( int iStartIndex, int iEndIndex ) const
 {
+	NoteCounts counts;
+	if( GetCachedCounts(iStartIndex, iEndIndex, counts) )
+		return counts.iRows[RowCount_Tap];
+
 	int iNumNotes = 0;
 	FOREACH_NONEMPTY_ROW_ALL_TRACKS_RANGE( *this, r, iStartIndex, iEndIndex )
 		if( IsThereATapAtRow(r) && GAMESTATE->GetProcessedTimingData()->IsJudgableAtRow(r) )
@@ -558,6 +733,10 @@ int NoteData::GetNumMinesInRow(int iRow) const
 
 int NoteData::GetNumMines( int iStartIndex, int iEndIndex ) const
 {
+	NoteCounts counts;
+	if( GetCachedCounts(iStartIndex, iEndIndex, counts) )
+		return counts.Total( PlayerCount_Mine );
+
 	int iNumMines = 0;
 
 	for( int t=0; t<GetNumTracks(); t++ )
@@ -572,6 +751,10 @@ int NoteData::GetNumMines( int iStartIndex, int iEndIndex ) const
 
 int NoteData::GetNumRowsWithTapOrHoldHead( int iStartIndex, int iEndIndex ) const
 {
+	NoteCounts counts;
+	if( GetCachedCounts(iStartIndex, iEndIndex, counts) )
+		return counts.iRows[RowCount_TapOrHoldHead];
+
 	int iNumNotes = 0;
 	FOREACH_NONEMPTY_ROW_ALL_TRACKS_RANGE( *this, r, iStartIndex, iEndIndex )
 		if( IsThereATapOrHoldHeadAtRow(r) && GAMESTATE->GetProcessedTimingData()->IsJudgableAtRow(r) )
@@ -623,6 +806,10 @@ int NoteData::GetNumRowsWithSimultaneousPresses( int iMinSimultaneousPresses, in
 	 * etc.  Only count rows that have at least one tap note (hold heads count).
 	 * Otherwise, every row of hold notes counts, so three simultaneous hold
 	 * notes will count as hundreds of "hands". */
+	NoteCounts counts;
+	if( (iMinSimultaneousPresses == 3 || iMinSimultaneousPresses == 4) && GetCachedCounts(iStartIndex, iEndIndex, counts) )
+		return counts.iRows[iMinSimultaneousPresses == 3? RowCount_Hand:RowCount_Quad];
+
 	int iNum = 0;
 	FOREACH_NONEMPTY_ROW_ALL_TRACKS_RANGE( *this, r, iStartIndex, iEndIndex )
 	{
@@ -638,6 +825,10 @@ int NoteData::GetNumRowsWithSimultaneousPresses( int iMinSimultaneousPresses, in
 
 int NoteData::GetNumRowsWithSimultaneousTaps( int iMinTaps, int iStartIndex, int iEndIndex ) const
 {
+	NoteCounts counts;
+	if( iMinTaps == 2 && GetCachedCounts(iStartIndex, iEndIndex, counts) )
+		return counts.iRows[RowCount_Jump];
+
 	int iNum = 0;
 	FOREACH_NONEMPTY_ROW_ALL_TRACKS_RANGE( *this, r, iStartIndex, iEndIndex )
 	{
@@ -662,6 +853,10 @@ int NoteData::GetNumRowsWithSimultaneousTaps( int iMinTaps, int iStartIndex, int
 
 int NoteData::GetNumHoldNotes( int iStartIndex, int iEndIndex ) const
 {
+	NoteCounts counts;
+	if( GetCachedCounts(iStartIndex, iEndIndex, counts) )
+		return counts.Total( PlayerCount_Hold );
+
 	int iNumHolds = 0;
 	for( int t=0; t<GetNumTracks(); ++t )
 	{
@@ -682,6 +877,10 @@ int NoteData::GetNumHoldNotes( int iStartIndex, int iEndIndex ) const
 
 int NoteData::GetNumRolls( int iStartIndex, int iEndIndex ) const
 {
+	NoteCounts counts;
+	if( GetCachedCounts(iStartIndex, iEndIndex, counts) )
+		return counts.Total( PlayerCount_Roll );
+
 	int iNumRolls = 0;
 	for( int t=0; t<GetNumTracks(); ++t )
 	{
@@ -702,6 +901,10 @@ int NoteData::GetNumRolls( int iStartIndex, int iEndIndex ) const
 
 int NoteData::GetNumLifts( int iStartIndex, int iEndIndex ) const
 {
+	NoteCounts counts;
+	if( GetCachedCounts(iStartIndex, iEndIndex, counts) )
+		return counts.Total( PlayerCount_Lift );
+
 	int iNumLifts = 0;
 
 	for( int t=0; t<GetNumTracks(); t++ )
@@ -716,6 +919,10 @@ int NoteData::GetNumLifts( int iStartIndex, int iEndIndex ) const
 
 int NoteData::GetNumFakes( int iStartIndex, int iEndIndex ) const
 {
+	NoteCounts counts;
+	if( GetCachedCounts(iStartIndex, iEndIndex, counts) )
+		return counts.Total( PlayerCount_Fake );
+
 	int iNumFakes = 0;
 
 	for( int t=0; t<GetNumTracks(); t++ )
@@ -739,6 +946,10 @@ bool NoteData::IsPlayer1(const int track, const TapNote &tn) const
 
 std::pair<int, int> NoteData::GetNumTapNotesTwoPlayer( int iStartIndex, int iEndIndex ) const
 {
+	NoteCounts counts;
+	if( GetCachedCounts(iStartIndex, iEndIndex, counts) )
+		return counts.ByPlayer( PlayerCount_Tap );
+
 	std::pair<int, int> num(0, 0);
 	for( int t=0; t<GetNumTracks(); t++ )
 	{
@@ -761,6 +972,10 @@ std::pair<int, int> NoteData::GetNumRowsWithSimultaneousTapsTwoPlayer(int minTap
 																 int startRow,
 																 int endRow) const
 {
+	NoteCounts counts;
+	if( minTaps >= 2 && minTaps <= 4 && GetCachedCounts(startRow, endRow, counts) )
+		return counts.ByPlayer( PlayerCount(PlayerCount_JumpRow + minTaps-2) );
+
 	std::pair<int, int> num(0, 0);
 	FOREACH_NONEMPTY_ROW_ALL_TRACKS_RANGE( *this, r, startRow, endRow )
 	{
@@ -801,6 +1016,10 @@ std::pair<int, int> NoteData::GetNumQuadsTwoPlayer( int iStartIndex, int iEndInd
 
 std::pair<int, int> NoteData::GetNumHoldNotesTwoPlayer( int iStartIndex, int iEndIndex ) const
 {
+	NoteCounts counts;
+	if( GetCachedCounts(iStartIndex, iEndIndex, counts) )
+		return counts.ByPlayer( PlayerCount_Hold );
+
 	std::pair<int, int> num(0, 0);
 	for( int t=0; t<GetNumTracks(); ++t )
 	{
@@ -824,6 +1043,10 @@ std::pair<int, int> NoteData::GetNumHoldNotesTwoPlayer( int iStartIndex, int iEn
 
 std::pair<int, int> NoteData::GetNumMinesTwoPlayer( int iStartIndex, int iEndIndex ) const
 {
+	NoteCounts counts;
+	if( GetCachedCounts(iStartIndex, iEndIndex, counts) )
+		return counts.ByPlayer( PlayerCount_Mine );
+
 	std::pair<int, int> num(0, 0);
 	for( int t=0; t<GetNumTracks(); t++ )
 	{
@@ -844,6 +1067,10 @@ std::pair<int, int> NoteData::GetNumMinesTwoPlayer( int iStartIndex, int iEndInd
 
 std::pair<int, int> NoteData::GetNumRollsTwoPlayer( int iStartIndex, int iEndIndex ) const
 {
+	NoteCounts counts;
+	if( GetCachedCounts(iStartIndex, iEndIndex, counts) )
+		return counts.ByPlayer( PlayerCount_Roll );
+
 	std::pair<int, int> num(0, 0);
 	for( int t=0; t<GetNumTracks(); ++t )
 	{
@@ -867,6 +1094,10 @@ std::pair<int, int> NoteData::GetNumRollsTwoPlayer( int iStartIndex, int iEndInd
 
 std::pair<int, int> NoteData::GetNumLiftsTwoPlayer( int iStartIndex, int iEndIndex ) const
 {
+	NoteCounts counts;
+	if( GetCachedCounts(iStartIndex, iEndIndex, counts) )
+		return counts.ByPlayer( PlayerCount_Lift );
+
 	std::pair<int, int> num(0, 0);
 	for( int t=0; t<GetNumTracks(); t++ )
 	{
@@ -887,6 +1118,10 @@ std::pair<int, int> NoteData::GetNumLiftsTwoPlayer( int iStartIndex, int iEndInd
 
 std::pair<int, int> NoteData::GetNumFakesTwoPlayer( int iStartIndex, int iEndIndex ) const
 {
+	NoteCounts counts;
+	if( GetCachedCounts(iStartIndex, iEndIndex, counts) )
+		return counts.ByPlayer( PlayerCount_Fake );
+
 	std::pair<int, int> num(0, 0);
 	for( int t=0; t<GetNumTracks(); t++ )
 	{
@@ -951,6 +1186,7 @@ void NoteData::MoveTapNoteTrack( int dest, int src )
 	if(dest == src) return;
 	m_TapNotes[dest] = m_TapNotes[src];
 	m_TapNotes[src].clear();
+	InvalidateCounts();
 }
 
 void NoteData::SetTapNote( int track, int row, const TapNote& t )
@@ -960,6 +1196,8 @@ void NoteData::SetTapNote( int track, int row, const TapNote& t )
 	if( row < 0 )
 		return;
 
+	InvalidateCounts();
+
 	// There's no point in inserting empty notes into the map.
 	// Any blank space in the map is defined to be empty.
 	// If we're trying to insert an empty at a spot where another note
@@ -1249,6 +1487,7 @@ void NoteData::RemoveATIFromList(all_tracks_const_iterator* iter) const
 
 void NoteData::RevalidateATIs(std::vector<int> const& added_or_removed_tracks, bool added)
 {
+	InvalidateCounts();
 	for(std::set<all_tracks_iterator*>::iterator cur= m_atis.begin();
 			cur != m_atis.end(); ++cur)
 	{
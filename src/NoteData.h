@@ -36,7 +36,7 @@ public:
 	typedef std::map<int,TapNote>::reverse_iterator reverse_iterator;
 	typedef std::map<int,TapNote>::const_reverse_iterator const_reverse_iterator;
 
-	NoteData(): m_TapNotes() {}
+	NoteData(): m_TapNotes(), m_Counts() {}
 
 	iterator begin( int iTrack )					{ return m_TapNotes[iTrack].begin(); }
 	const_iterator begin( int iTrack ) const			{ return m_TapNotes[iTrack].begin(); }
@@ -55,6 +55,8 @@ public:
 		m_TapNotes.swap(nd.m_TapNotes);
 		m_atis.swap(nd.m_atis);
 		m_const_atis.swap(nd.m_const_atis);
+		InvalidateCounts();
+		nd.InvalidateCounts();
 	}
 
 
@@ -151,6 +153,62 @@ private:
 														   int startRow = 0,
 														   int endRow = MAX_NOTE_ROW) const;
 
+	/* What the count queries count, up to and including a row.  Whether a row
+	 * can be judged is left out, since that's up to the timing at the time of
+	 * the query. */
+	enum PlayerCount
+	{
+		PlayerCount_Tap,	// IsTap
+		PlayerCount_Mine,
+		PlayerCount_Lift,
+		PlayerCount_Fake,
+		PlayerCount_Hold,
+		PlayerCount_Roll,
+		PlayerCount_Note,	// anything; all of them are fakes in a row that can't be judged
+		PlayerCount_JumpRow,	// rows with at least two of the player's taps
+		PlayerCount_HandRow,
+		PlayerCount_QuadRow,
+		NUM_PlayerCount
+	};
+	enum RowCount
+	{
+		RowCount_Tap,		// IsThereATapAtRow
+		RowCount_TapOrHoldHead,
+		RowCount_Jump,		// GetNumRowsWithSimultaneousTaps(2)
+		RowCount_Hand,		// RowNeedsAtLeastSimultaneousPresses(3)
+		RowCount_Quad,
+		NUM_RowCount
+	};
+	struct NoteCounts
+	{
+		int iRow;
+		int iPlayer[NUM_PlayerCount][2];	// by IsPlayer1, player 1 first
+		int iRows[NUM_RowCount];
+
+		int Total( PlayerCount c ) const { return iPlayer[c][0] + iPlayer[c][1]; }
+		std::pair<int,int> ByPlayer( PlayerCount c ) const { return std::make_pair( iPlayer[c][0], iPlayer[c][1] ); }
+	};
+
+	/* The running totals of each non-empty row, after one of all zeroes.
+	 * Copies start out without them, to build their own if they're asked. */
+	struct CountCache
+	{
+		CountCache(): m_bEnabled(false), m_bValid(false) {}
+		CountCache( const CountCache & ): m_bEnabled(false), m_bValid(false) {}
+		CountCache &operator=( const CountCache & ) { m_bValid = false; return *this; }
+
+		bool m_bEnabled;
+		bool m_bValid;
+		std::vector<NoteCounts> m_vTotals;
+	};
+	mutable CountCache m_Counts;
+
+	void InvalidateCounts() { m_Counts.m_bValid = false; }
+	void BuildCounts() const;
+	/* If counts are cached, total those of the rows in [iStartRow,iEndRow)
+	 * the processed timing can judge and return true. */
+	bool GetCachedCounts( int iStartRow, int iEndRow, NoteCounts &out ) const;
+
 	// These exist so that they can be revalidated when something that transforms
 	// the NoteData occurs. -Kyz
 	mutable std::set<all_tracks_iterator*> m_atis;
@@ -192,7 +250,7 @@ public:
 
 	inline iterator FindTapNote( unsigned iTrack, int iRow )	{ return m_TapNotes[iTrack].find( iRow ); }
 	inline const_iterator FindTapNote( unsigned iTrack, int iRow ) const { return m_TapNotes[iTrack].find( iRow ); }
-	void RemoveTapNote( unsigned iTrack, iterator it )		{ m_TapNotes[iTrack].erase( it ); }
+	void RemoveTapNote( unsigned iTrack, iterator it )		{ m_TapNotes[iTrack].erase( it ); InvalidateCounts(); }
 
 	/**
 	 * @brief Return an iterator range for [rowBegin,rowEnd).
@@ -235,6 +293,8 @@ public:
 	}
 
 	// Call this after using any transform that changes the NoteData.
+	// It also drops the cached counts, which changing notes through an
+	// iterator doesn't.
 	void RevalidateATIs(std::vector<int> const& added_or_removed_tracks, bool added);
 	void TransferATIs(NoteData& to);
 
@@ -300,6 +360,11 @@ public:
 	bool IsHoldNoteAtRow( int iTrack, int iRow, int *pHeadRow = nullptr ) const;
 	bool IsHoldHeadOrBodyAtRow( int iTrack, int iRow, int *pHeadRow ) const;
 
+	/* Answer the count queries below from running totals, kept until the
+	 * notes change, so each is a search instead of a walk over the range.  For
+	 * NoteData that's counted over and over, like the editor's. */
+	void SetCacheCounts( bool b );
+
 	// statistics
 	bool IsEmpty() const;
 	bool IsTrackEmpty( int iTrack ) const { return m_TapNotes[iTrack].empty(); }
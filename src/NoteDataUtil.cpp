@@ -983,16 +983,6 @@ void NoteDataUtil::AutogenKickbox(const NoteData& in, NoteData& out, const Timin
 	out.RevalidateATIs(std::vector<int>(), false);
 }
 
-struct recent_note
-{
-	int row;
-	int track;
-	recent_note()
-		:row(0), track(0) {}
-	recent_note(int r, int t)
-		:row(r), track(t) {}
-};
-
 // CalculateRadarValues has to delay some stuff until a row ends, but can
 // only detect a row ending when it hits the next note.  There isn't a note
 // after the last row, so it also has to do the delayed stuff after exiting
@@ -1034,11 +1024,13 @@ void NoteDataUtil::CalculateRadarValues( const NoteData &in, float fSongSeconds,
 	// the same way.
 	out.Zero();
 	int curr_row= -1;
-	// recent_notes is used to calculate the voltage.  Each element is the row
-	// and track number of a tap note.  When the pair at the beginning is too
-	// old, it's deleted.  This provides a way to have a rolling window
-	// that scans for the peak step density. -Kyz
-	std::vector<recent_note> recent_notes;
+	// recent_rows is used to calculate the voltage.  Each element is the row
+	// of a tap note.  When the row at first_recent_row is too old, it's
+	// passed over.  This provides a way to have a rolling window that scans
+	// for the peak step density without erasing from the front of the vector
+	// for every note that leaves the window.
+	std::vector<int> recent_rows;
+	size_t first_recent_row= 0;
 	NoteData::all_tracks_const_iterator curr_note=
 		in.GetTapNoteRangeAllTracks(0, MAX_NOTE_ROW);
 	TimingData* timing= GAMESTATE->GetProcessedTimingData();
@@ -1068,19 +1060,12 @@ void NoteDataUtil::CalculateRadarValues( const NoteData &in, float fSongSeconds,
 					--n;
 				}
 			}
-			for(size_t n= 0; n < recent_notes.size(); ++n)
+			// recent_rows is kept sorted, so reaching the first note that
+			// isn't old enough to remove means we're finished. -Kyz
+			while(first_recent_row < recent_rows.size() &&
+				recent_rows[first_recent_row] < curr_row - voltage_window)
 			{
-				if(recent_notes[n].row < curr_row - voltage_window)
-				{
-					recent_notes.erase(recent_notes.begin() + n);
-					--n;
-				}
-				else
-				{
-					// recent_notes is kept sorted, so reaching the first note that
-					// isn't old enough to remove means we're finished. -Kyz
-					break;
-				}
+				++first_recent_row;
 			}
 			// GetChaosRadarValue did not care about whether a row is judgable.
 			// So chaos is checked here. -Kyz
@@ -1104,9 +1089,9 @@ void NoteDataUtil::CalculateRadarValues( const NoteData &in, float fSongSeconds,
 					++out[RadarCategory_Notes];
 					++state.num_notes_on_curr_row;
 					++total_taps;
-					recent_notes.push_back(
-						recent_note(curr_row, curr_note.Track()));
-					max_notes_in_voltage_window= std::max(recent_notes.size(),
+					recent_rows.push_back(curr_row);
+					max_notes_in_voltage_window= std::max(
+						recent_rows.size() - first_recent_row,
 						max_notes_in_voltage_window);
 					// If there is one hold active, and one tap on this row, it does
 					// not count as a jump.  Hands do need to count the number of
@@ -1621,9 +1621,9 @@ void NoteColumnRenderer::UpdatePercentThroughTween(float between)
 		between);
 }
 
-void NoteColumnRenderer::BeginTweening(float time, ITween* interp)
+void NoteColumnRenderer::BeginTweening(float time, ITweenPtr interp)
 {
-	Actor::BeginTweening(time, interp);
+	Actor::BeginTweening(time, std::move(interp));
 	if(!NCR_Tweens.empty())
 	{
 		NCR_Tweens.push_back(NCR_Tweens.back());
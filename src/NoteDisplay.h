@@ -327,7 +327,7 @@ struct NoteColumnRenderer : public Actor
 	virtual void SetCurrentTweenStart() override;
 	virtual void EraseHeadTween() override;
 	virtual void UpdatePercentThroughTween(float between) override;
-	virtual void BeginTweening(float time, ITween* interp) override;
+	virtual void BeginTweening(float time, ITweenPtr interp) override;
 	virtual void StopTweening() override;
 	virtual void FinishTweening() override;
 
@@ -18,6 +18,8 @@
 #include "Course.h"
 #include "NoteData.h"
 #include "RageDisplay.h"
+#include "RageProfiler.h"
+#include "GameplayTelemetry.h"
 
 #include <cfloat>
 #include <cmath>
@@ -773,6 +775,8 @@ void NoteField::CalcPixelsBeforeAndAfterTargets()
 
 void NoteField::DrawPrimitives()
 {
+	PROFILE_SCOPE( "NoteField::DrawPrimitives" );
+	GameplayTelemetryScope telemetry( GameplayTelemetry::TIMER_NOTEFIELD_DRAW );
 	//LOG->Trace( "NoteField::DrawPrimitives()" );
 
 	// This should be filled in on the first update.
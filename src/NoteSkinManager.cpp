@@ -174,19 +174,22 @@ bool NoteSkinManager::LoadNoteSkinDataRecursive( const RString &sNoteSkinName_,
 	for( std::vector<RString>::reverse_iterator dir = data_out.vsDirSearchOrder.rbegin(); dir != data_out.vsDirSearchOrder.rend(); ++dir )
 	{
 		RString sFile = *dir + "NoteSkin.lua";
-		RString sScript;
 		if( !FILEMAN->IsAFile(sFile) )
 			continue;
 
-		if( !GetFileContents(sFile, sScript) )
-			continue;
-
 		LOG->Trace( "Load script \"%s\"", sFile.c_str() );
 
 		Lua *L = LUA->Get();
 		RString Error= "Error running " + sFile + ": ";
+		RString sLoadError;
+		if( !LuaHelpers::LoadScriptFile(L, sFile, sLoadError) )
+		{
+			LuaHelpers::ReportScriptError( Error + sLoadError );
+			LUA->Release( L );
+			continue;
+		}
 		refScript.PushSelf( L );
-		if( !LuaHelpers::RunScript(L, sScript, "@" + sFile, Error, 1, 1, true) )
+		if( !LuaHelpers::RunScriptOnStack(L, Error, 1, 1, true) )
 		{
 			lua_pop( L, 1 );
 		}
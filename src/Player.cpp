@@ -39,7 +39,11 @@
 #include "GameCommand.h"
 #include "LocalizedString.h"
 #include "AdjustSync.h"
+#include "GamePreferences.h"
+#include "JudgmentThread.h"
+#include "GameplayTelemetry.h"
 
+#include <algorithm>
 #include <cmath>
 #include <cstddef>
 #include <vector>
@@ -88,6 +92,15 @@ public:
 		}
 		return ret;
 	}
+	// Returns true if the row has been judged, without judging it.
+	bool IsRowJudged( int iRow ) const
+	{
+		if( iRow < m_iStart )
+			return true;
+		if( iRow >= m_iStart+int(m_vRows.size()) )
+			return false;
+		return m_vRows[(iRow - m_iStart + m_iOffset) % m_vRows.size()];
+	}
 	void Reset( int iStart )
 	{
 		m_iStart = iStart;
@@ -235,6 +248,17 @@ float Player::GetWindowSeconds( TimingWindow tw )
 	return fSecs;
 }
 
+static StepJudgeParams MakeStepJudgeParams( const PlayerState *pPlayerState )
+{
+	StepJudgeParams params;
+	FOREACH_ENUM( TimingWindow, tw )
+		params.fWindowSeconds[tw] = Player::GetWindowSeconds( tw );
+	params.twDisabledWindows = pPlayerState->m_PlayerOptions.GetCurrent().m_twDisabledWindows;
+	params.bRequireStepOnMines = REQUIRE_STEP_ON_MINES;
+	params.bRequireStepOnHoldHeads = REQUIRE_STEP_ON_HOLD_HEADS;
+	return params;
+}
+
 Player::Player( NoteData &nd, bool bVisibleParts ) : m_NoteData(nd)
 {
 	m_drawing_notefield_board= false;
@@ -254,14 +278,14 @@ Player::Player( NoteData &nd, bool bVisibleParts ) : m_NoteData(nd)
 	m_pSecondaryScoreKeeper = nullptr;
 	m_pInventory = nullptr;
 	m_pIterNeedsTapJudging = nullptr;
-	m_pIterNeedsHoldJudging = nullptr;
 	m_pIterUncrossedRows = nullptr;
-	m_pIterUnjudgedRows = nullptr;
-	m_pIterUnjudgedMineRows = nullptr;
 
 	m_bPaused = false;
 	m_bDelay = false;
 
+	m_pJudgmentThread = nullptr;
+	m_iJudgmentGeneration = 0;
+
 	m_pAttackDisplay = nullptr;
 	if( bVisibleParts )
 	{
@@ -290,10 +314,7 @@ Player::~Player()
 		RageUtil::SafeDelete( m_vpHoldJudgment[i] );
 	RageUtil::SafeDelete( m_pJudgedRows );
 	RageUtil::SafeDelete( m_pIterNeedsTapJudging );
-	RageUtil::SafeDelete( m_pIterNeedsHoldJudging );
 	RageUtil::SafeDelete( m_pIterUncrossedRows );
-	RageUtil::SafeDelete( m_pIterUnjudgedRows );
-	RageUtil::SafeDelete( m_pIterUnjudgedMineRows );
 
 }
 
@@ -578,29 +599,6 @@ static bool NeedsTapJudging( const TapNote &tn )
 	}
 }
 
-/**
- * @brief Determine if a TapNote needs a hold note style judgment.
- * @param tn the TapNote in question.
- * @return true if it does, false otherwise. */
-static bool NeedsHoldJudging( const TapNote &tn )
-{
-	switch( tn.type )
-	{
-	DEFAULT_FAIL( tn.type );
-	case TapNoteType_HoldHead:
-		return tn.HoldResult.hns == HNS_None;
-	case TapNoteType_Tap:
-	case TapNoteType_HoldTail:
-	case TapNoteType_Mine:
-	case TapNoteType_Lift:
-	case TapNoteType_Attack:
-	case TapNoteType_AutoKeysound:
-	case TapNoteType_Fake:
-	case TapNoteType_Empty:
-		return false;
-	}
-}
-
 static void GenerateCacheDataStructure(PlayerState *pPlayerState, const NoteData &notes) {
 
 	pPlayerState->m_CacheDisplayedBeat.clear();
@@ -776,17 +774,14 @@ void Player::Load()
 	RageUtil::SafeDelete( m_pIterNeedsTapJudging );
 	m_pIterNeedsTapJudging = new NoteData::all_tracks_iterator( m_NoteData.GetTapNoteRangeAllTracks(iNoteRow, MAX_NOTE_ROW) );
 
-	RageUtil::SafeDelete( m_pIterNeedsHoldJudging );
-	m_pIterNeedsHoldJudging = new NoteData::all_tracks_iterator( m_NoteData.GetTapNoteRangeAllTracks(iNoteRow, MAX_NOTE_ROW ) );
+	m_ActiveHolds.Reset( iNoteRow );
 
 	RageUtil::SafeDelete( m_pIterUncrossedRows );
 	m_pIterUncrossedRows = new NoteData::all_tracks_iterator( m_NoteData.GetTapNoteRangeAllTracks(iNoteRow, MAX_NOTE_ROW ) );
 
-	RageUtil::SafeDelete( m_pIterUnjudgedRows );
-	m_pIterUnjudgedRows = new NoteData::all_tracks_iterator( m_NoteData.GetTapNoteRangeAllTracks(iNoteRow, MAX_NOTE_ROW ) );
+	m_vJudgedNotes.clear();
 
-	RageUtil::SafeDelete( m_pIterUnjudgedMineRows );
-	m_pIterUnjudgedMineRows = new NoteData::all_tracks_iterator( m_NoteData.GetTapNoteRangeAllTracks(iNoteRow, MAX_NOTE_ROW ) );
+	RebuildJudgmentIndex();
 }
 
 void Player::SendComboMessages( unsigned int iOldCombo, unsigned int iOldMissCombo )
@@ -807,12 +802,13 @@ void Player::SendComboMessages( unsigned int iOldCombo, unsigned int iOldMissCom
 			msg.SetParam( "PlayerState", LuaReference::CreateFromPush(*m_pPlayerState) );
 		if( m_pPlayerStageStats )
 			msg.SetParam( "PlayerStageStats", LuaReference::CreateFromPush(*m_pPlayerStageStats) );
-		MESSAGEMAN->Broadcast( msg );
+		MESSAGEMAN->BroadcastDeferred( msg );
 	}
 }
 
 void Player::Update( float fDeltaTime )
 {
+	GameplayTelemetryScope telemetry( GameplayTelemetry::TIMER_PLAYER_UPDATE );
 	const RageTimer now;
 	// Don't update if we haven't been loaded yet.
 	if( !m_bLoaded )
@@ -825,6 +821,9 @@ void Player::Update( float fDeltaTime )
 
 	ActorFrame::Update( fDeltaTime );
 
+	// Mods can disable windows as the song plays.
+	m_StepJudgeParams = MakeStepJudgeParams( m_pPlayerState );
+
 	if(m_pPlayerState->m_mp != MultiPlayer_Invalid)
 	{
 		/* In multiplayer, it takes too long to run player updates for every player each frame;
@@ -945,6 +944,9 @@ void Player::Update( float fDeltaTime )
 			m_pActorWithComboPosition->SetZoom( m_pActorWithComboPosition->GetZoom() * fJudgmentZoom );
 	}
 
+	if( m_pJudgmentThread != nullptr )
+		UpdateThreadedJudgment();
+
 	// If we're paused, don't update tap or hold note logic, so hold notes can be released
 	// during pause.
 	if( m_bPaused )
@@ -1072,26 +1074,16 @@ void Player::Update( float fDeltaTime )
 
 	// update HoldNotes logic
 	{
-
-		// Fast forward to the first that needs hold judging.
-		{
-			NoteData::all_tracks_iterator &iter = *m_pIterNeedsHoldJudging;
-			while( !iter.IsAtEnd()  &&  iter.Row() <= iSongRow  &&  !NeedsHoldJudging(*iter) )
-				++iter;
-		}
+		m_ActiveHolds.Update( m_NoteData, iSongRow );
 
 		std::vector<TrackRowTapNote> vHoldNotesToGradeTogether;
 		int iRowOfLastHoldNote = -1;
-		NoteData::all_tracks_iterator iter = *m_pIterNeedsHoldJudging;	// copy
-		for( ; !iter.IsAtEnd() &&  iter.Row() <= iSongRow; ++iter )
+		for( const TrackRowTapNote &trtn : m_ActiveHolds.Get() )
 		{
-			TapNote &tn = *iter;
-			if( tn.type != TapNoteType_HoldHead )
-				continue;
-
-			int iTrack = iter.Track();
-			int iRow = iter.Row();
-			TrackRowTapNote trtn = { iTrack, iRow, &tn };
+			TapNote &tn = *trtn.pTN;
+			int iRow = trtn.iRow;
+			if( iRow > iSongRow )
+				break;
 
 			/* All holds must be of the same subType because fLife is handled
 			 * in different ways depending on the SubType. Handle Rolls one at
@@ -1577,6 +1569,11 @@ void Player::UpdateHoldNotes( int iSongRow, float fDeltaTime, std::vector<TrackR
 
 void Player::ApplyWaitingTransforms()
 {
+	if( m_pPlayerState->m_ModsToApply.empty() )
+		return;
+
+	int iFirstChangedRow = MAX_NOTE_ROW;
+
 	for( unsigned j=0; j<m_pPlayerState->m_ModsToApply.size(); j++ )
 	{
 		const Attack &mod = m_pPlayerState->m_ModsToApply[j];
@@ -1594,8 +1591,119 @@ void Player::ApplyWaitingTransforms()
 		// if re-adding noteskin changes, this is one place to edit -aj
 
 		NoteDataUtil::TransformNoteData(m_NoteData, *m_Timing, po, GAMESTATE->GetCurrentStyle(GetPlayerState()->m_PlayerNumber)->m_StepsType, BeatToNoteRow(fStartBeat), BeatToNoteRow(fEndBeat));
+		iFirstChangedRow = std::min( iFirstChangedRow, BeatToNoteRow(fStartBeat) );
 	}
 	m_pPlayerState->m_ModsToApply.clear();
+
+	// The notes may have moved.
+	RebuildJudgmentIndex();
+	m_ActiveHolds.Rebuild( m_NoteData, iFirstChangedRow );
+	QueueJudgedNotes( iFirstChangedRow );
+}
+
+void Player::SetPaused( bool bPaused )
+{
+	m_bPaused = bPaused;
+
+	// Stop the thread taking steps now, not on the next update.
+	if( m_pJudgmentThread != nullptr && m_bLoaded )
+		PublishJudgmentPosition();
+}
+
+void Player::RebuildJudgmentIndex()
+{
+	m_JudgmentIndex.Load( m_NoteData, *m_Timing );
+	m_StepJudgeParams = MakeStepJudgeParams( m_pPlayerState );
+	RebuildJudgmentSnapshot();
+}
+
+void Player::RebuildJudgmentSnapshot()
+{
+	if( m_pJudgmentThread == nullptr )
+		return;
+
+	const PlayerNumber pn = m_pPlayerState->m_PlayerNumber;
+	m_pJudgmentSnapshot.reset();
+
+	std::vector<std::vector<JudgmentSnapshot::Note>> vvNotes( m_JudgmentIndex.GetNumTracks() );
+	for( int t=0; t<m_JudgmentIndex.GetNumTracks(); t++ )
+	{
+		for( const JudgmentIndex::Note &in : m_JudgmentIndex.GetNotes(t) )
+		{
+			const TapNote &tn = *in.pTN;
+
+			// Attacks are launched from Step; leave them all to the main thread.
+			if( tn.type == TapNoteType_Attack )
+			{
+				m_pJudgmentThread->SetSnapshot( pn, nullptr );
+				return;
+			}
+
+			JudgmentSnapshot::Note note;
+			note.iRow = in.iRow;
+			note.fSeconds = m_JudgmentIndex.GetSeconds( in );
+			note.type = tn.type;
+			note.bJudged = tn.result.tns != TNS_None;
+			vvNotes[t].push_back( note );
+		}
+	}
+
+	m_pJudgmentSnapshot = std::make_shared<JudgmentSnapshot>( vvNotes, *m_Timing, PREFSMAN->m_fGlobalOffsetSeconds,
+		MakeStepJudgeParams(m_pPlayerState), ++m_iJudgmentGeneration );
+	m_pJudgmentThread->SetSnapshot( pn, m_pJudgmentSnapshot );
+}
+
+void Player::UpdateThreadedJudgment()
+{
+	/* Autosync and the sync overlay move the song's offset mid-song.  Steps
+	 * judged against the old note times are from an old generation, so
+	 * they're judged again below. */
+	if( m_pJudgmentSnapshot != nullptr && m_pJudgmentSnapshot->GetBeat0OffsetSeconds() != m_Timing->m_fBeat0OffsetInSeconds )
+		RebuildJudgmentSnapshot();
+
+	// Score the steps judged since the last update, in the order they were made.
+	ThreadedStep step;
+	while( m_pJudgmentThread->GetJudgedStep(m_pPlayerState->m_PlayerNumber, step) )
+	{
+		/* If it was judged against notes we've since replaced, judge it
+		 * again here. */
+		bool bCurrent = m_pJudgmentSnapshot != nullptr && step.iGeneration == m_pJudgmentSnapshot->GetGeneration();
+		if( bCurrent && step.iRow != -1 && m_NoteData.FindTapNote(step.iCol, step.iRow) == m_NoteData.end(step.iCol) )
+			bCurrent = false;
+		Step( step.iCol, -1, step.tm, false, step.bRelease, bCurrent? &step:nullptr );
+	}
+
+	PublishJudgmentPosition();
+}
+
+void Player::PublishJudgmentPosition()
+{
+	// Only take steps that ScreenGameplay::Input would pass to Step.
+	const bool bLive = m_pJudgmentSnapshot != nullptr && !m_bPaused &&
+		m_pPlayerState->m_PlayerController == PC_HUMAN &&
+		GamePreferences::m_AutoPlay == PC_HUMAN &&
+		m_pPlayerState->m_PlayerOptions.GetCurrent().m_fPlayerAutoPlay == 0 &&
+		GAMESTATE->m_SongOptions.GetCurrent().m_AutosyncType == AutosyncType_Off;
+
+	const SongPosition &pos = m_pPlayerState->m_Position;
+	m_pJudgmentThread->SetPosition( m_pPlayerState->m_PlayerNumber, pos.m_fMusicSeconds, pos.m_LastBeatUpdate,
+		GAMESTATE->m_SongOptions.GetCurrent().m_fMusicRate, bLive );
+}
+
+bool Player::ClaimNote( int col, int row )
+{
+	if( m_pJudgmentSnapshot == nullptr )
+		return true;
+	const int iNote = m_pJudgmentSnapshot->FindNote( col, row );
+	return iNote == -1 || m_pJudgmentSnapshot->Claim( iNote );
+}
+
+bool Player::IsNoteClaimed( int col, int row ) const
+{
+	if( m_pJudgmentSnapshot == nullptr )
+		return false;
+	const int iNote = m_pJudgmentSnapshot->FindNote( col, row );
+	return iNote != -1 && m_pJudgmentSnapshot->IsClaimed( iNote );
 }
 
 void Player::DrawPrimitives()
@@ -1839,59 +1947,13 @@ void Player::ChangeLifeRecord()
 			m_pPlayerStageStats->SetLifeRecordAt( fLife, STATSMAN->m_CurStageStats.m_fStepsSeconds );
 }
 
-int Player::GetClosestNoteDirectional( int col, int iStartRow, int iEndRow, bool bAllowGraded, bool bForward ) const
+// Find the closest note to iNoteRow.
+const JudgmentIndex::Note *Player::GetClosestNote( int col, int iNoteRow, int iMaxRowsAhead, int iMaxRowsBehind, bool bAllowGraded ) const
 {
-	NoteData::const_iterator begin, end;
-	m_NoteData.GetTapNoteRange( col, iStartRow, iEndRow, begin, end );
-
-	if( !bForward )
-		swap( begin, end );
-
-	while( begin != end )
-	{
-		if( !bForward )
-			--begin;
-
-		// Is this the row we want?
-		do {
-			const TapNote &tn = begin->second;
-			if (!m_Timing->IsJudgableAtRow( begin->first ))
-				break;
-			// unsure if autoKeysounds should be excluded. -Wolfman2000
-			if( tn.type == TapNoteType_Empty || tn.type == TapNoteType_AutoKeysound )
-				break;
-			if( !bAllowGraded && tn.result.tns != TNS_None )
-				break;
-
-			return begin->first;
-		} while(0);
-
-		if( bForward )
-			++begin;
-	}
-
-	return -1;
-}
-
-// Find the closest note to fBeat.
-int Player::GetClosestNote( int col, int iNoteRow, int iMaxRowsAhead, int iMaxRowsBehind, bool bAllowGraded ) const
-{
-	// Start at iIndexStartLookingAt and search outward.
-	int iNextIndex = GetClosestNoteDirectional( col, iNoteRow, iNoteRow+iMaxRowsAhead, bAllowGraded, true );
-	int iPrevIndex = GetClosestNoteDirectional( col, iNoteRow-iMaxRowsBehind, iNoteRow, bAllowGraded, false );
-
-	if( iNextIndex == -1 && iPrevIndex == -1 )
-		return -1;
-	if( iNextIndex == -1 )
-		return iPrevIndex;
-	if( iPrevIndex == -1 )
-		return iNextIndex;
-
-	/* Figure out which row is closer. */
-	if( std::abs(iNoteRow-iNextIndex) > std::abs(iNoteRow-iPrevIndex) )
-		return iPrevIndex;
-	else
-		return iNextIndex;
+	return m_JudgmentIndex.GetClosestNote( col, iNoteRow, iMaxRowsAhead, iMaxRowsBehind,
+		[this, col, bAllowGraded]( const JudgmentIndex::Note &note ) {
+			return !bAllowGraded && (note.pTN->result.tns != TNS_None || IsNoteClaimed(col, note.iRow));
+		} );
 }
 
 int Player::GetClosestNonEmptyRowDirectional( int iStartRow, int iEndRow, bool /* bAllowGraded */, bool bForward ) const
@@ -2058,7 +2120,7 @@ void Player::PlayKeysound( const TapNote &tn, TapNoteScore score )
 	}
 }
 
-void Player::Step( int col, int row, const RageTimer &tm, bool bHeld, bool bRelease )
+void Player::Step( int col, int row, const RageTimer &tm, bool bHeld, bool bRelease, const ThreadedStep *pThreaded )
 {
 	if( IsOniDead() )
 		return;
@@ -2210,8 +2272,14 @@ void Player::Step( int col, int row, const RageTimer &tm, bool bHeld, bool bRele
 		iSongRow - BeatToNoteRow( m_Timing->GetBeatFromElapsedTime( m_pPlayerState->m_Position.m_fMusicSeconds - StepSearchDistance ) )
 	) + ROWS_PER_BEAT;
 	int iRowOfOverlappingNoteOrRow = row;
-	if( row == -1 )
-		iRowOfOverlappingNoteOrRow = GetClosestNote( col, iSongRow, iStepSearchRows, iStepSearchRows, false );
+	const JudgmentIndex::Note *pClosestNote = nullptr;
+	if( pThreaded != nullptr )
+		iRowOfOverlappingNoteOrRow = pThreaded->iRow;
+	else if( row == -1 )
+	{
+		pClosestNote = GetClosestNote( col, iSongRow, iStepSearchRows, iStepSearchRows, false );
+		iRowOfOverlappingNoteOrRow = pClosestNote != nullptr? pClosestNote->iRow:-1;
+	}
 
 	// calculate TapNoteScore
 	TapNoteScore score = TNS_None;
@@ -2224,7 +2292,11 @@ void Player::Step( int col, int row, const RageTimer &tm, bool bHeld, bool bRele
 		const float fStepBeat = NoteRowToBeat( iRowOfOverlappingNoteOrRow );
 		const float fStepSeconds = m_Timing->GetElapsedTimeFromBeat(fStepBeat);
 
-		if( row == -1 )
+		if( pThreaded != nullptr )
+		{
+			fNoteOffset = pThreaded->fNoteOffset;
+		}
+		else if( row == -1 )
 		{
 			// We actually stepped on the note this long ago:
 			//fTimeSinceStep
@@ -2249,59 +2321,25 @@ void Player::Step( int col, int row, const RageTimer &tm, bool bHeld, bool bRele
 
 		TapNote tnDummy = TAP_ORIGINAL_TAP;
 		TapNote *pTN = nullptr;
-		NoteData::iterator iter = m_NoteData.FindTapNote( col, iRowOfOverlappingNoteOrRow );
-		DEBUG_ASSERT( iter!= m_NoteData.end(col) );
-		pTN = &iter->second;
+		if( pClosestNote != nullptr )
+		{
+			pTN = pClosestNote->pTN;
+		}
+		else
+		{
+			NoteData::iterator iter = m_NoteData.FindTapNote( col, iRowOfOverlappingNoteOrRow );
+			DEBUG_ASSERT( iter!= m_NoteData.end(col) );
+			pTN = &iter->second;
+		}
 
-		switch( m_pPlayerState->m_PlayerController )
+		// Steps judged on the JudgmentThread were a human's.
+		switch( pThreaded != nullptr? PC_HUMAN : m_pPlayerState->m_PlayerController )
 		{
 		case PC_HUMAN:
-			switch( pTN->type )
-			{
-			case TapNoteType_Mine:
-				// Stepped too close to mine?
-				if(!bRelease &&
-					(!REQUIRE_STEP_ON_MINES || REQUIRE_STEP_ON_MINES == !bHeld ) &&
-					fSecondsFromExact <= GetWindowSeconds(TW_Mine))
-					score = TNS_HitMine;
-				break;
-			case TapNoteType_Attack:
-				if( !bRelease && fSecondsFromExact <= GetWindowSeconds(TW_Attack) && !pTN->result.bHidden )
-					score = AllowW1() ? TNS_W1 : TNS_W2; // sentinel
-				break;
-			case TapNoteType_HoldHead:
-				// oh wow, this was causing the trigger before the hold heads
-				// bug. (It was fNoteOffset > 0.f before) -DaisuMaster
-				if( !REQUIRE_STEP_ON_HOLD_HEADS && ( fNoteOffset <= GetWindowSeconds( TW_W5 ) && GetWindowSeconds( TW_W5 ) != 0 ) )
-				{
-					// Set it to the first non-disabled window.
-					const auto &disabledWindows = m_pPlayerState->m_PlayerOptions.GetCurrent().m_twDisabledWindows;
-					if (!disabledWindows[TW_W1])
-						score = TNS_W1;
-					else if (!disabledWindows[TW_W2])
-						score = TNS_W2;
-					else if (!disabledWindows[TW_W3])
-						score = TNS_W3;
-					else if (!disabledWindows[TW_W4])
-						score = TNS_W4;
-					else if (!disabledWindows[TW_W5])
-						score = TNS_W5;
-
-					break;
-				}
-				[[fallthrough]];
-			default:
-				if( (pTN->type == TapNoteType_Lift) == bRelease )
-				{
-					const auto &disabledWindows = m_pPlayerState->m_PlayerOptions.GetCurrent().m_twDisabledWindows;
-					if(	fSecondsFromExact <= GetWindowSeconds(TW_W1) && !disabledWindows[TW_W1] )	score = TNS_W1;
-					else if( fSecondsFromExact <= GetWindowSeconds(TW_W2) && !disabledWindows[TW_W2] )	score = TNS_W2;
-					else if( fSecondsFromExact <= GetWindowSeconds(TW_W3) && !disabledWindows[TW_W3] )	score = TNS_W3;
-					else if( fSecondsFromExact <= GetWindowSeconds(TW_W4) && !disabledWindows[TW_W4] )	score = TNS_W4;
-					else if( fSecondsFromExact <= GetWindowSeconds(TW_W5) && !disabledWindows[TW_W5] )	score = TNS_W5;
-				}
-				break;
-			}
+			if( pThreaded != nullptr )
+				score = pThreaded->tns;
+			else
+				score = JudgeHumanStep( m_StepJudgeParams, pTN->type, pTN->result.bHidden, fNoteOffset, bHeld, bRelease );
 			break;
 
 		case PC_CPU:
@@ -2428,6 +2466,10 @@ void Player::Step( int col, int row, const RageTimer &tm, bool bHeld, bool bRele
 			FAIL_M(ssprintf("Invalid player controller type: %i", m_pPlayerState->m_PlayerController));
 		}
 
+		// The JudgmentThread may have judged this note while we were.
+		if( pThreaded == nullptr && score != TNS_None && !ClaimNote(col, iRowOfOverlappingNoteOrRow) )
+			score = TNS_None;
+
 		// handle attack notes
 		if( pTN->type == TapNoteType_Attack && score == TNS_W2 )
 		{
@@ -2470,8 +2512,10 @@ void Player::Step( int col, int row, const RageTimer &tm, bool bHeld, bool bRele
 
 		if( score != TNS_None )
 		{
-			pTN->result.tns = score;
+			SetTapNoteScore( col, iRowOfOverlappingNoteOrRow, *pTN, score );
 			pTN->result.fTapNoteOffset = -fNoteOffset;
+			if( m_pPlayerState->m_PlayerController == PC_HUMAN && !bHeld )
+				GameplayTelemetry::AddStepLatency( pThreaded != nullptr? pThreaded->fLatency:fTimeSinceStep );
 		}
 
 		m_LastTapNoteScore = score;
@@ -2521,7 +2565,8 @@ void Player::Step( int col, int row, const RageTimer &tm, bool bHeld, bool bRele
 		else
 		{
 			// or else find the closest note.
-			iRowOfOverlappingNoteOrRow = GetClosestNote( col, iSongRow, MAX_NOTE_ROW, MAX_NOTE_ROW, true );
+			const JudgmentIndex::Note *pNote = GetClosestNote( col, iSongRow, MAX_NOTE_ROW, MAX_NOTE_ROW, true );
+			iRowOfOverlappingNoteOrRow = pNote != nullptr? pNote->iRow:-1;
 		}
 		if( iRowOfOverlappingNoteOrRow != -1 )
 		{
@@ -2540,10 +2585,10 @@ void Player::Step( int col, int row, const RageTimer &tm, bool bHeld, bool bRele
 		msg.SetParam( "PlayerNumber", m_pPlayerState->m_PlayerNumber );
 		msg.SetParam( "MultiPlayer", m_pPlayerState->m_mp );
 		msg.SetParam( "Column", col );
-		MESSAGEMAN->Broadcast( msg );
+		MESSAGEMAN->BroadcastDeferred( msg );
 		// Backwards compatibility
 		Message msg2( ssprintf("StepP%d", m_pPlayerState->m_PlayerNumber + 1) );
-		MESSAGEMAN->Broadcast( msg2 );
+		MESSAGEMAN->BroadcastDeferred( msg2 );
 	}
 }
 
@@ -2581,9 +2626,13 @@ void Player::UpdateTapNotesMissedOlderThan( float fMissIfOlderThanSeconds )
 		if (!m_Timing->IsJudgableAtRow(iter.Row()))
 			continue;
 
+		// A step judged on the JudgmentThread will score it.
+		if( !ClaimNote(iter.Track(), iter.Row()) )
+			continue;
+
 		if( tn.type == TapNoteType_Mine )
 		{
-			tn.result.tns = TNS_AvoidMine;
+			SetTapNoteScore( iter.Track(), iter.Row(), tn, TNS_AvoidMine );
 			/* The only real way to tell if a mine has been scored is if it has disappeared
 			 * but this only works for hit mines so update the scores for avoided mines here. */
 			if( m_pPrimaryScoreKeeper )
@@ -2593,24 +2642,51 @@ void Player::UpdateTapNotesMissedOlderThan( float fMissIfOlderThanSeconds )
 		}
 		else
 		{
-			tn.result.tns = TNS_Miss;
+			SetTapNoteScore( iter.Track(), iter.Row(), tn, TNS_Miss );
 		}
 	}
 }
 
+/* Every tap score is set here, so UpdateJudgedRows, which only looks at the
+ * rows of notes judged since it last ran, hears of it. */
+void Player::SetTapNoteScore( int iTrack, int iRow, TapNote &tn, TapNoteScore tns )
+{
+	tn.result.tns = tns;
+	m_vJudgedNotes.push_back( std::make_pair(iRow, iTrack) );
+}
+
+/* A transform can move judged notes to other tracks, or remove the last
+ * unjudged note of a row, without scoring anything; look at the judged notes
+ * it may have touched again.  Rows already reported are skipped as before. */
+void Player::QueueJudgedNotes( int iStartRow )
+{
+	NoteData::all_tracks_iterator iter = m_NoteData.GetTapNoteRangeAllTracks( iStartRow, MAX_NOTE_ROW );
+	for( ; !iter.IsAtEnd(); ++iter )
+	{
+		if( iter->result.tns != TNS_None )
+			m_vJudgedNotes.push_back( std::make_pair(iter.Row(), iter.Track()) );
+	}
+}
+
 void Player::UpdateJudgedRows()
 {
 	// Look ahead far enough to catch any rows judged early.
 	const int iEndRow = BeatToNoteRow( m_Timing->GetBeatFromElapsedTime( m_pPlayerState->m_Position.m_fMusicSeconds + GetMaxStepDistanceSeconds() ) );
-	bool bAllJudged = true;
 	const bool bSeparately = GAMESTATE->GetCurrentGame()->m_bCountNotesSeparately;
 
+	/* Only a row with a note judged since the last update can have become
+	 * completely judged, so look at those instead of every row up to iEndRow.
+	 * Report them in row order, as the rows come; notes judged beyond iEndRow
+	 * wait for a later update. */
+	std::sort( m_vJudgedNotes.begin(), m_vJudgedNotes.end() );
+	const std::vector<std::pair<int,int>>::iterator itEnd =
+		std::upper_bound( m_vJudgedNotes.begin(), m_vJudgedNotes.end(), std::make_pair(iEndRow, INT_MAX) );
+
 	{
-		NoteData::all_tracks_iterator iter = *m_pIterUnjudgedRows;
 		int iLastSeenRow = -1;
-		for( ; !iter.IsAtEnd()  &&  iter.Row() <= iEndRow; ++iter )
+		for( std::vector<std::pair<int,int>>::iterator it = m_vJudgedNotes.begin(); it != itEnd; ++it )
 		{
-			int iRow = iter.Row();
+			int iRow = it->first;
 
 			// Do not judge arrows in WarpSegments or FakeSegments
 			if (!m_Timing->IsJudgableAtRow(iRow))
@@ -2620,14 +2696,8 @@ void Player::UpdateJudgedRows()
 			{
 				iLastSeenRow = iRow;
 
-				// crossed a nonempty row
 				if( !NoteDataWithScoring::IsRowCompletelyJudged(m_NoteData, iRow) )
-				{
-					bAllJudged = false;
 					continue;
-				}
-				if( bAllJudged )
-					*m_pIterUnjudgedRows = iter;
 				if( m_pJudgedRows->JudgeRow(iRow) )
 					continue;
 				const TapNoteResult &lastTNR = NoteDataWithScoring::LastTapNoteWithResult( m_NoteData, iRow ).result;
@@ -2656,27 +2726,22 @@ void Player::UpdateJudgedRows()
 
 	// handle mines.
 	{
-		bAllJudged = true;
 		std::set<RageSound *> setSounds;
-		NoteData::all_tracks_iterator iter = *m_pIterUnjudgedMineRows;	// copy
-		int iLastSeenRow = -1;
-		for( ; !iter.IsAtEnd()  &&  iter.Row() <= iEndRow; ++iter )
+		for( std::vector<std::pair<int,int>>::iterator it = m_vJudgedNotes.begin(); it != itEnd; ++it )
 		{
-			int iRow = iter.Row();
+			int iRow = it->first;
+			int iTrack = it->second;
 
 			// Do not worry about mines in WarpSegments or FakeSegments
 			if (!m_Timing->IsJudgableAtRow(iRow))
 				continue;
 
-			TapNote &tn = *iter;
-
-			if( iRow != iLastSeenRow )
-			{
-				iLastSeenRow = iRow;
-				if( bAllJudged )
-					*m_pIterUnjudgedMineRows = iter;
-			}
+			NoteData::iterator iter = m_NoteData.FindTapNote( iTrack, iRow );
+			if( iter == m_NoteData.end(iTrack) )
+				continue;
+			TapNote &tn = iter->second;
 
+			// A mine judged twice is hidden the first time.
 			bool bMineNotHidden = tn.type == TapNoteType_Mine && !tn.result.bHidden;
 			if( !bMineNotHidden )
 				continue;
@@ -2685,18 +2750,17 @@ void Player::UpdateJudgedRows()
 			{
 			DEFAULT_FAIL( tn.result.tns );
 			case TNS_None:
-				bAllJudged = false;
 				continue;
 			case TNS_AvoidMine:
-				SetMineJudgment( tn.result.tns , iter.Track() );
+				SetMineJudgment( tn.result.tns , iTrack );
 				tn.result.bHidden= true;
 				continue;
 			case TNS_HitMine:
-				SetMineJudgment( tn.result.tns , iter.Track() );
+				SetMineJudgment( tn.result.tns , iTrack );
 				break;
 			}
 			if( m_pNoteField )
-				m_pNoteField->DidTapNote( iter.Track(), tn.result.tns, false );
+				m_pNoteField->DidTapNote( iTrack, tn.result.tns, false );
 
 			if( tn.iKeysoundIndex >= 0 && tn.iKeysoundIndex < (int) m_vKeysounds.size() )
 				setSounds.insert( &m_vKeysounds[tn.iKeysoundIndex] );
@@ -2733,12 +2797,6 @@ void Player::UpdateJudgedRows()
 				m_pSecondaryScoreKeeper->HandleTapScore( tn );
 			tn.result.bHidden = true;
 		}
-		// If we hit the end of the loop, m_pIterUnjudgedMineRows needs to be
-		// updated. -Kyz
-		if((iter.IsAtEnd() || iLastSeenRow == iEndRow) && bAllJudged)
-		{
-			*m_pIterUnjudgedMineRows= iter;
-		}
 
 		for (RageSound *sound : setSounds)
 		{
@@ -2747,8 +2805,41 @@ void Player::UpdateJudgedRows()
 			sound->Play(false);
 		}
 	}
+
+	m_vJudgedNotes.erase( m_vJudgedNotes.begin(), itEnd );
+
+#ifdef DEBUG
+	CheckJudgedRows( iEndRow );
+#endif
 }
 
+#ifdef DEBUG
+/* Walk every row up to iEndRow, as UpdateJudgedRows used to, and check that
+ * each row it would have reported, and each judged mine, was reported from
+ * m_vJudgedNotes.  A score set without SetTapNoteScore shows up here. */
+void Player::CheckJudgedRows( int iEndRow )
+{
+	NoteData::all_tracks_iterator iter = m_NoteData.GetTapNoteRangeAllTracks( 0, iEndRow+1 );
+	for( ; !iter.IsAtEnd(); ++iter )
+	{
+		const int iRow = iter.Row();
+		if( !m_Timing->IsJudgableAtRow(iRow) )
+			continue;
+
+		if( iter->type == TapNoteType_Mine )
+		{
+			DEBUG_ASSERT_M( iter->result.tns == TNS_None || iter->result.bHidden,
+				ssprintf("mine at %i,%i judged but not reported", iter.Track(), iRow) );
+		}
+		else if( NoteDataWithScoring::IsRowCompletelyJudged(m_NoteData, iRow) &&
+			NoteDataWithScoring::LastTapNoteWithResult(m_NoteData, iRow).result.tns >= TNS_Miss )
+		{
+			DEBUG_ASSERT_M( m_pJudgedRows->IsRowJudged(iRow), ssprintf("row %i judged but not reported", iRow) );
+		}
+	}
+}
+#endif
+
 void Player::FlashGhostRow( int iRow )
 {
 	TapNoteScore lastTNS = NoteDataWithScoring::LastTapNoteWithResult( m_NoteData, iRow ).result.tns;
@@ -3188,7 +3279,7 @@ void Player::SetMineJudgment( TapNoteScore tns , int iTrack )
 		msg.SetParam( "Player", m_pPlayerState->m_PlayerNumber );
 		msg.SetParam( "TapNoteScore", tns );
 		msg.SetParam( "FirstTrack", iTrack );
-		MESSAGEMAN->Broadcast( msg );
+		MESSAGEMAN->BroadcastDeferred( msg );
 		if( m_pPlayerStageStats &&
 			( ( tns == TNS_AvoidMine && AVOID_MINE_INCREMENTS_COMBO ) ||
 				( tns == TNS_HitMine && MINE_HIT_INCREMENTS_MISS_COMBO ))
@@ -3241,7 +3332,7 @@ void Player::SetJudgment( int iRow, int iTrack, const TapNote &tn, TapNoteScore
 		msg.SetParamFromStack( L, "Notes" );
 
 		LUA->Release( L );
-		MESSAGEMAN->Broadcast( msg );
+		MESSAGEMAN->BroadcastDeferred( msg );
 	}
 }
 
@@ -3266,7 +3357,7 @@ void Player::SetHoldJudgment( TapNote &tn, int iTrack )
 		msg.SetParamFromStack( L, "TapNote" );
 		LUA->Release( L );
 
-		MESSAGEMAN->Broadcast( msg );
+		MESSAGEMAN->BroadcastDeferred( msg );
 	}
 }
 
@@ -10,8 +10,11 @@
 #include "ScreenMessage.h"
 #include "ThemeMetric.h"
 #include "InputEventPlus.h"
+#include "JudgmentIndex.h"
+#include "ActiveHolds.h"
 #include "TimingData.h"
 
+#include <memory>
 #include <vector>
 
 
@@ -24,6 +27,9 @@ class RageTimer;
 class NoteField;
 class PlayerStageStats;
 class JudgedRows;
+class JudgmentThread;
+class JudgmentSnapshot;
+struct ThreadedStep;
 
 // todo: replace these with a Message and MESSAGEMAN? -aj
 AutoScreenMessage( SM_100Combo );
@@ -73,12 +79,6 @@ public:
 		float y_offset;
 	};
 
-	struct TrackRowTapNote
-	{
-		int iTrack;
-		int iRow;
-		TapNote *pTN;
-	};
 	void UpdateHoldNotes( int iSongRow, float fDeltaTime, std::vector<TrackRowTapNote> &vTN );
 
 	void Init(
@@ -109,13 +109,16 @@ public:
 	void ScoreAllActiveHoldsLetGo();
 	void DoTapScoreNone();
 
-	void Step( int col, int row, const RageTimer &tm, bool bHeld, bool bRelease );
+	// pThreaded is a step already judged by the JudgmentThread, to score.
+	void Step( int col, int row, const RageTimer &tm, bool bHeld, bool bRelease, const ThreadedStep *pThreaded = nullptr );
 
 	void FadeToFail();
 	void CacheAllUsedNoteSkins();
 	TapNoteScore GetLastTapNoteScore() const { return m_LastTapNoteScore; }
 	void ApplyWaitingTransforms();
-	void SetPaused( bool bPaused ) { m_bPaused = bPaused; }
+	void SetPaused( bool bPaused );
+	// Judge this player's steps on pThread while a human is playing.
+	void SetJudgmentThread( JudgmentThread *pThread ) { m_pJudgmentThread = pThread; }
 
 	static float GetMaxStepDistanceSeconds();
 	static float GetWindowSeconds( TimingWindow tw );
@@ -144,6 +147,11 @@ public:
 protected:
 	void UpdateTapNotesMissedOlderThan( float fMissIfOlderThanThisBeat );
 	void UpdateJudgedRows();
+	void SetTapNoteScore( int iTrack, int iRow, TapNote &tn, TapNoteScore tns );
+	void QueueJudgedNotes( int iStartRow );
+#ifdef DEBUG
+	void CheckJudgedRows( int iEndRow );
+#endif
 	void FlashGhostRow( int iRow );
 	void HandleTapRowScore( unsigned row );
 	void HandleHoldScore( const TapNote &tn );
@@ -166,8 +174,14 @@ protected:
 	void ChangeLife( HoldNoteScore hns, TapNoteScore tns );
 	void ChangeLifeRecord();
 
-	int GetClosestNoteDirectional( int col, int iStartRow, int iMaxRowsAhead, bool bAllowGraded, bool bForward ) const;
-	int GetClosestNote( int col, int iNoteRow, int iMaxRowsAhead, int iMaxRowsBehind, bool bAllowGraded ) const;
+	void RebuildJudgmentIndex();
+	void RebuildJudgmentSnapshot();
+	void UpdateThreadedJudgment();
+	void PublishJudgmentPosition();
+	bool ClaimNote( int col, int row );
+	bool IsNoteClaimed( int col, int row ) const;
+
+	const JudgmentIndex::Note *GetClosestNote( int col, int iNoteRow, int iMaxRowsAhead, int iMaxRowsBehind, bool bAllowGraded ) const;
 	int GetClosestNonEmptyRowDirectional( int iStartRow, int iMaxRowsAhead, bool bAllowGraded, bool bForward ) const;
 	int GetClosestNonEmptyRow( int iNoteRow, int iMaxRowsAhead, int iMaxRowsBehind, bool bAllowGraded ) const;
 
@@ -215,10 +229,12 @@ protected:
 
 	int			m_iFirstUncrossedRow;	// used by hold checkpoints logic
 	NoteData::all_tracks_iterator *m_pIterNeedsTapJudging;
-	NoteData::all_tracks_iterator *m_pIterNeedsHoldJudging;
+	ActiveHolds		m_ActiveHolds;
 	NoteData::all_tracks_iterator *m_pIterUncrossedRows;
-	NoteData::all_tracks_iterator *m_pIterUnjudgedRows;
-	NoteData::all_tracks_iterator *m_pIterUnjudgedMineRows;
+	/* (row, track) of each note judged since UpdateJudgedRows last reported
+	 * its row, so finished rows don't have to be searched for.  Only
+	 * SetTapNoteScore and QueueJudgedNotes add to it. */
+	std::vector<std::pair<int,int>> m_vJudgedNotes;
 	unsigned int	m_iLastSeenCombo;
 	bool	m_bSeenComboYet;
 	JudgedRows		*m_pJudgedRows;
@@ -233,6 +249,15 @@ protected:
 
 	std::vector<RageSound>	m_vKeysounds;
 
+	/* The notes Step can land on, and what it judges them with; the windows
+	 * are read once an update rather than once a step. */
+	JudgmentIndex		m_JudgmentIndex;
+	StepJudgeParams		m_StepJudgeParams;
+
+	JudgmentThread		*m_pJudgmentThread;
+	std::shared_ptr<JudgmentSnapshot> m_pJudgmentSnapshot;
+	int			m_iJudgmentGeneration;
+
 	ThemeMetric<float>	GRAY_ARROWS_Y_STANDARD;
 	ThemeMetric<float>	GRAY_ARROWS_Y_REVERSE;
 	ThemeMetric2D<float>	ATTACK_DISPLAY_X;
@@ -128,13 +128,7 @@ void PlayerStageStats::AddStats( const PlayerStageStats& other )
 	const float fOtherLastSecond = other.m_fLastSecond + m_fLastSecond + 1.0f;
 	m_fLastSecond = fOtherLastSecond;
 
-	std::map<float, float>::const_iterator it;
-	for( it = other.m_fLifeRecord.begin(); it != other.m_fLifeRecord.end(); ++it )
-	{
-		const float pos = it->first;
-		const float life = it->second;
-		m_fLifeRecord[fOtherFirstSecond+pos] = life;
-	}
+	m_LifeRecord.Append( other.m_LifeRecord, fOtherFirstSecond );
 
 	for( unsigned i=0; i<other.m_ComboList.size(); ++i )
 	{
@@ -162,6 +156,9 @@ void PlayerStageStats::AddStats( const PlayerStageStats& other )
 		m_ComboList.erase( m_ComboList.begin()+i );
 		--i;
 	}
+
+	if( m_ComboList.size() > MAX_COMBOS )
+		PruneComboList();
 }
 
 Grade GetGradeFromPercent( float fPercent )
@@ -361,10 +358,6 @@ void PlayerStageStats::ResetScoreForLesson()
 
 void PlayerStageStats::SetLifeRecordAt( float fLife, float fStepsSecond )
 {
-	// Don't save life stats in endless courses, or could run OOM in a few hours.
-	if( GAMESTATE->m_pCurCourse && GAMESTATE->m_pCurCourse->IsEndless() )
-		return;
-
 	if( fStepsSecond < 0 )
 		return;
 
@@ -372,119 +365,43 @@ void PlayerStageStats::SetLifeRecordAt( float fLife, float fStepsSecond )
 	m_fLastSecond = std::max( fStepsSecond, m_fLastSecond );
 	//LOG->Trace( "fLastSecond = %f", m_fLastSecond );
 
-	// fStepsSecond will usually be greater than any value already in the map,
-	// but if a tap and a hold both set the life on the same frame, it won't.
-	// Check whether an entry already exists for the current time, and move it
-	// back a tiny bit if it does and the new value is not the same as the old.
-	// Otherwise, you get the rare bug where the life graph shows a gradual
-	// decline when the lifebar was actually full up to a miss.  This occurs
-	// because the first call has full life, and removes the previous full life
-	// entry.  Then the second call of the frame occurs and sets the life for
-	// the current time to a lower value.
-	// -Kyz
-	std::map<float, float>::iterator curr= m_fLifeRecord.find(fStepsSecond);
-	if(curr != m_fLifeRecord.end())
-	{
-		if(curr->second != fLife)
-		{
-			// 2^-8
-			m_fLifeRecord[fStepsSecond - 0.00390625]= curr->second;
-		}
-	}
-	m_fLifeRecord[fStepsSecond] = fLife;
+	m_LifeRecord.Add( fStepsSecond, fLife );
 
 	Message msg(static_cast<MessageID>(Message_LifeMeterChangedP1+Enum::to_integral(m_player_number)));
 	msg.SetParam("Life", fLife);
 	msg.SetParam("StepsSecond", fStepsSecond);
-	MESSAGEMAN->Broadcast(msg);
-
-	// Memory optimization:
-	// If we have three consecutive records A, B, and C all with the same fLife,
-	// we can eliminate record B without losing data. Only check the last three
-	// records in the map since we're only inserting at the end, and we know all
-	// earlier redundant records have already been removed.
-	std::map<float, float>::iterator C = m_fLifeRecord.end();
-	--C;
-	if( C == m_fLifeRecord.begin() ) // no earlier records left
-		return;
-
-	std::map<float, float>::iterator B = C;
-	--B;
-	if( B == m_fLifeRecord.begin() ) // no earlier records left
-		return;
-
-	std::map<float, float>::iterator A = B;
-	--A;
-
-	if( A->second == B->second && B->second == C->second )
-		m_fLifeRecord.erase(B);
+	MESSAGEMAN->BroadcastDeferred(msg, this);
 }
 
 float PlayerStageStats::GetLifeRecordAt( float fStepsSecond ) const
 {
-	if( m_fLifeRecord.empty() )
-		return 0;
-
-	// Find the first element whose key is greater than k.
-	std::map<float, float>::const_iterator it = m_fLifeRecord.upper_bound( fStepsSecond );
-
-	// Find the last element whose key is less than or equal to k.
-	if( it != m_fLifeRecord.begin() )
-		--it;
-
-	return it->second;
-
+	return m_LifeRecord.GetAt( fStepsSecond );
 }
 
 float PlayerStageStats::GetLifeRecordLerpAt( float fStepsSecond ) const
 {
-	if( m_fLifeRecord.empty() )
-		return 0;
-
-	// Find the first element whose key is greater than k.
-	std::map<float, float>::const_iterator later = m_fLifeRecord.upper_bound( fStepsSecond );
-
-	// Find the last element whose key is less than or equal to k.
-	std::map<float, float>::const_iterator earlier = later;
-	if( earlier != m_fLifeRecord.begin() )
-		--earlier;
-
-	if( later == m_fLifeRecord.end() )
-		return earlier->second;
-
-	if( earlier->first == later->first ) // two samples from the same time.  Don't divide by zero in SCALE
-		return earlier->second;
-
-	// earlier <= pos <= later
-	return SCALE( fStepsSecond, earlier->first, later->first, earlier->second, later->second );
+	return m_LifeRecord.GetLerpAt( fStepsSecond );
 }
 
 void PlayerStageStats::GetLifeRecord( float *fLifeOut, int iNumSamples, float fStepsEndSecond ) const
 {
-	for( int i = 0; i < iNumSamples; ++i )
-	{
-		float from = SCALE( i, 0, (float)iNumSamples, 0.0f, fStepsEndSecond );
-		fLifeOut[i] = GetLifeRecordLerpAt( from );
-	}
+	m_LifeRecord.GetLerpSamples( fLifeOut, iNumSamples, fStepsEndSecond, (float)iNumSamples );
+}
+
+void PlayerStageStats::GetLifeRecordRange( float *fMinOut, float *fMaxOut, int iNumSamples, float fStepsEndSecond ) const
+{
+	m_LifeRecord.GetRangeSamples( fMinOut, fMaxOut, iNumSamples, fStepsEndSecond );
 }
 
 float PlayerStageStats::GetCurrentLife() const
 {
-	if( m_fLifeRecord.empty() )
-		return 0;
-	std::map<float, float>::const_iterator iter = m_fLifeRecord.end();
-	--iter;
-	return iter->second;
+	return m_LifeRecord.GetLast();
 }
 
 /* If bRollover is true, we're being called before gameplay begins, so we can
  * record the amount of the first combo that comes from the previous song. */
 void PlayerStageStats::UpdateComboList( float fSecond, bool bRollover )
 {
-	// Don't save combo stats in endless courses, or could run OOM in a few hours.
-	if( GAMESTATE->m_pCurCourse && GAMESTATE->m_pCurCourse->IsEndless() )
-		return;
-
 	if( fSecond < 0 )
 		return;
 
@@ -516,6 +433,8 @@ void PlayerStageStats::UpdateComboList( float fSecond, bool bRollover )
 			NewCombo.m_fStartSecond = -9999;
 		else
 			NewCombo.m_fStartSecond = fSecond;
+		if( m_ComboList.size() >= MAX_COMBOS )
+			PruneComboList();
 		m_ComboList.push_back( NewCombo );
 	}
 
@@ -530,6 +449,32 @@ void PlayerStageStats::UpdateComboList( float fSecond, bool bRollover )
 		combo.m_rollover = cnt;
 }
 
+/* Endless play can break combos forever.  Drop the shortest combos, doubling
+ * the length dropped until the list is half full.  The first combo holds the
+ * rollover, and the last may still be growing, so they're kept, as is the
+ * longest. */
+void PlayerStageStats::PruneComboList()
+{
+	for( int iDropUpTo = 1; m_ComboList.size() > MAX_COMBOS/2; iDropUpTo *= 2 )
+	{
+		unsigned iLongest = 0;
+		for( unsigned i = 1; i < m_ComboList.size(); ++i )
+		{
+			if( m_ComboList[i].m_cnt > m_ComboList[iLongest].m_cnt )
+				iLongest = i;
+		}
+
+		unsigned iOut = 1;
+		for( unsigned i = 1; i+1 < m_ComboList.size(); ++i )
+		{
+			if( i == iLongest || m_ComboList[i].GetStageCnt() > iDropUpTo )
+				m_ComboList[iOut++] = m_ComboList[i];
+		}
+		m_ComboList[iOut++] = m_ComboList.back();
+		m_ComboList.resize( iOut );
+	}
+}
+
 /* This returns the largest combo contained within the song, as if
  * m_bComboContinuesBetweenSongs is turned off. */
 PlayerStageStats::Combo_t PlayerStageStats::GetMaxCombo() const
@@ -831,17 +776,46 @@ public:
 				samples= 100;
 			}
 		}
+		// The scale from range is [0, samples-1] because that is i's range.
+		std::vector<float> life( samples );
+		p->m_LifeRecord.GetLerpSamples( &life[0], samples, last_second, (float)samples-1.0f );
 		lua_createtable(L, samples, 0);
 		for(int i= 0; i < samples; ++i)
 		{
-			// The scale from range is [0, samples-1] because that is i's range.
-			float from= SCALE(i, 0, (float)samples-1.0f, 0.0f, last_second);
-			float curr= p->GetLifeRecordLerpAt(from);
-			lua_pushnumber(L, curr);
+			lua_pushnumber(L, life[i]);
 			lua_rawseti(L, -2, i+1);
 		}
 		return 1;
 	}
+	static int GetLifeRecordRange( T* p, lua_State *L )
+	{
+		float last_second= FArg(1);
+		int samples= 100;
+		if (lua_gettop(L) >= 2 && !lua_isnil(L,2))
+		{
+			samples= IArg(2);
+			if(samples <= 0)
+			{
+				LOG->Trace("PlayerStageStats:GetLifeRecordRange requires an integer greater than 0.  Defaulting to 100.");
+				samples= 100;
+			}
+		}
+		std::vector<float> low( samples ), high( samples );
+		p->GetLifeRecordRange( &low[0], &high[0], samples, last_second );
+		lua_createtable(L, samples, 0);
+		for(int i= 0; i < samples; ++i)
+		{
+			lua_pushnumber(L, low[i]);
+			lua_rawseti(L, -2, i+1);
+		}
+		lua_createtable(L, samples, 0);
+		for(int i= 0; i < samples; ++i)
+		{
+			lua_pushnumber(L, high[i]);
+			lua_rawseti(L, -2, i+1);
+		}
+		return 2;
+	}
 
 	static int GetRadarPossible( T* p, lua_State *L ) { p->m_radarPossible.PushSelf(L); return 1; }
 	static int GetRadarActual( T* p, lua_State *L ) { p->m_radarActual.PushSelf(L); return 1; }
@@ -923,6 +897,7 @@ public:
 		ADD_METHOD( GetPossibleSteps );
 		ADD_METHOD( GetComboList );
 		ADD_METHOD( GetLifeRecord );
+		ADD_METHOD( GetLifeRecordRange );
 		ADD_METHOD( GetAliveSeconds );
 		ADD_METHOD( GetPercentageOfTaps );
 		ADD_METHOD( GetRadarActual );
@@ -4,9 +4,9 @@
 #include "Grade.h"
 #include "RadarValues.h"
 #include "HighScore.h"
+#include "LifeRecord.h"
 #include "PlayerNumber.h"
 
-#include <map>
 #include <vector>
 
 
@@ -102,9 +102,10 @@ public:
 	float		m_iNumControllerSteps;
 	float		m_fCaloriesBurned;
 
-	std::map<float,float> m_fLifeRecord;
+	LifeRecord m_LifeRecord;
 	void	SetLifeRecordAt( float fLife, float fStepsSecond );
 	void	GetLifeRecord( float *fLifeOut, int iNumSamples, float fStepsEndSecond ) const;
+	void	GetLifeRecordRange( float *fMinOut, float *fMaxOut, int iNumSamples, float fStepsEndSecond ) const;
 	float	GetLifeRecordAt( float fStepsSecond ) const;
 	float	GetLifeRecordLerpAt( float fStepsSecond ) const;
 	float	GetCurrentLife() const;
@@ -141,7 +142,9 @@ public:
 		Combo_t(): m_fStartSecond(0), m_fSizeSeconds(0), m_cnt(0), m_rollover(0) { }
 		bool IsZero() const { return m_fStartSecond < 0; }
 	};
+	/* At most MAX_COMBOS long; when full, the shortest combos are dropped. */
 	std::vector<Combo_t> m_ComboList;
+	static const unsigned MAX_COMBOS = 1024;
 	float	m_fFirstSecond;
 	float	m_fLastSecond;
 
@@ -154,6 +157,7 @@ public:
 	int		GetTotalTaps() const;
 	float	GetPercentageOfTaps( TapNoteScore tns ) const;
 	void	UpdateComboList( float fSecond, bool rollover );
+	void	PruneComboList();
 	Combo_t GetMaxCombo() const;
 
 	float GetSurvivalSeconds() const { return m_fAliveSeconds + m_fLifeRemainingSeconds; }
@@ -192,6 +192,8 @@ PrefsManager::PrefsManager() :
 	m_bInterlaced			( "Interlaced",			false ),
 	m_bPAL				( "PAL",			false ),
 	m_bDelayedTextureDelete		( "DelayedTextureDelete",	false ),
+	m_bBackgroundTextureLoading	( "BackgroundTextureLoading",	false ),
+	m_bTextureDiskCache		( "TextureDiskCache",		false ),
 	m_bDelayedModelDelete		( "DelayedModelDelete",		false ),
 	m_ImageCache			( "ImageCache",			IMGCACHE_LOW_RES_PRELOAD ),
 	m_bFastLoad			( "FastLoad",			true ),
@@ -191,6 +191,8 @@ public:
 	Preference<bool>	m_bInterlaced;
 	Preference<bool>	m_bPAL;
 	Preference<bool>	m_bDelayedTextureDelete;
+	Preference<bool>	m_bBackgroundTextureLoading;
+	Preference<bool>	m_bTextureDiskCache;
 	Preference<bool>	m_bDelayedModelDelete;
 	Preference<ImageCacheMode>		m_ImageCache;
 	Preference<bool>	m_bFastLoad;
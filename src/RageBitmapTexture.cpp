@@ -10,10 +10,18 @@
 #include "RageSurfaceUtils_Zoom.h"
 #include "RageSurfaceUtils_Dither.h"
 #include "RageSurface_Load.h"
+#include "RageProfiler.h"
+#include "RageFile.h"
+#include "RageFileManager.h"
+#include "RageThreads.h"
+#include "RageTimer.h"
 #include "arch/Dialog/Dialog.h"
 #include "StepMania.h"
+#include "SpecialFiles.h"
 
+#include <algorithm>
 #include <cmath>
+#include <cstring>
 #include <vector>
 
 
@@ -41,23 +49,220 @@ static void GetResolutionFromFileName( RString sPath, int &iWidth, int &iHeight
 	iHeight = maybe_height;
 }
 
-RageBitmapTexture::RageBitmapTexture( RageTextureID name ) :
-	RageTexture( name ), m_uTexHandle(0)
+RageBitmapTexture::RageBitmapTexture( RageTextureID name, bool bLoadInBackground ) :
+	RageTexture( name ), m_uTexHandle(0), m_bLoadPending(false)
 {
-	Create();
+	/* The screen texture is grabbed from the renderer, so it can't be
+	 * loaded in the background. */
+	if( bLoadInBackground && name.filename != TEXTUREMAN->GetScreenTextureID().filename && CreatePlaceholder() )
+	{
+		m_bLoadPending = true;
+		TEXTUREMAN->QueueBackgroundLoad( this );
+	}
+	else
+	{
+		Create();
+	}
+}
+
+/* Until the real texture is uploaded, act like a blank one of the size it will
+ * be, so anything sized against us before then, such as with zoomto, comes out
+ * the same.  The image fills the placeholder, so texture coordinates taken from
+ * it are in image coordinates.  Only PNG and JPEG headers can be read without
+ * decoding the image; anything else is loaded here instead. */
+bool RageBitmapTexture::CreatePlaceholder()
+{
+	const RageTextureID &ID = GetID();
+	RString sExt = GetExtension( ID.filename );
+	MakeLower( sExt );
+	if( sExt != "png" && sExt != "jpg" && sExt != "jpeg" )
+		return false;
+
+	RString sError;
+	RageSurface *pHeader = RageSurfaceUtils::LoadFile( ID.filename, sError, true );
+	if( pHeader == nullptr )
+		return false;
+
+	// As Upload does, with the image and texture at the source's size.
+	m_iSourceWidth = m_iImageWidth = m_iTextureWidth = pHeader->w;
+	m_iSourceHeight = m_iImageHeight = m_iTextureHeight = pHeader->h;
+	delete pHeader;
+	CreateFrameRects();
+
+	GetResolutionFromFileName( ID.filename, m_iSourceWidth, m_iSourceHeight );
+	RString sHintString = ID.filename + ID.AdditionalTextureHints;
+	MakeLower( sHintString );
+	if( sHintString.find("doubleres") != std::string::npos )
+	{
+		m_iSourceWidth = m_iSourceWidth / 2;
+		m_iSourceHeight = m_iSourceHeight / 2;
+	}
+	return true;
 }
 
 RageBitmapTexture::~RageBitmapTexture()
 {
+	if( m_bLoadPending )
+		TEXTUREMAN->CancelBackgroundLoad( this );
 	Destroy();
 }
 
 void RageBitmapTexture::Reload()
 {
+	if( m_bLoadPending )
+	{
+		TEXTUREMAN->CancelBackgroundLoad( this );
+		m_bLoadPending = false;
+	}
 	Destroy();
 	Create();
 }
 
+void RageBitmapTexture::DecodeCaps::Capture()
+{
+	iMaxTextureSize = DISPLAY->GetMaxTextureSize();
+	bHighResolutionTextures = StepMania::GetHighResolutionTextures();
+	for( int i = 0; i < NUM_RagePixelFormat; ++i )
+		bSupportsFormat[i] = DISPLAY->SupportsTextureFormat( (RagePixelFormat) i );
+	bUseDiskCache = TEXTUREMAN->GetPrefs().m_bDiskCache;
+}
+
+bool RageBitmapTexture::DecodeCaps::operator==( const DecodeCaps &rhs ) const
+{
+	return iMaxTextureSize == rhs.iMaxTextureSize &&
+		bHighResolutionTextures == rhs.bHighResolutionTextures &&
+		std::equal( bSupportsFormat, bSupportsFormat+NUM_RagePixelFormat, rhs.bSupportsFormat ) &&
+		bUseDiskCache == rhs.bUseDiskCache;
+}
+
+/* Converted images are cached in TEXTURE_CACHE_DIR.  The cache file name is
+ * a hash of everything that affects the conversion except for the file's
+ * contents; the file hash (size and date) is stored in the header, so a
+ * changed image overwrites its old cache file instead of leaving it behind. */
+#define TEXTURE_CACHE_DIR (SpecialFiles::CACHE_DIR + "Textures/")
+static const int TEXTURE_CACHE_VERSION = 1;
+
+struct TextureCacheHeader
+{
+	int iVersion;
+	unsigned iFileHash;
+	int iAlphaBits, iGrayscaleBits, iColorDepth, iMaxSize;
+	int bMipMaps, bDither, bStretch;
+	int iPixFmt;
+	int iSourceWidth, iSourceHeight;
+	int iImageWidth, iImageHeight;
+	int iTextureWidth, iTextureHeight;
+	int bDoubleRes;
+};
+
+static RageMutex g_DiskCacheStatsLock( "TextureDiskCacheStats" );
+static int g_iDiskCacheHits = 0, g_iDiskCacheMisses = 0;
+static float g_fDiskCacheHitSeconds = 0, g_fDiskCacheMissSeconds = 0;
+
+void RageBitmapTexture::GetDiskCacheStats( int &iHits, float &fHitSeconds, int &iMisses, float &fMissSeconds )
+{
+	LockMut( g_DiskCacheStatsLock );
+	iHits = g_iDiskCacheHits;
+	fHitSeconds = g_fDiskCacheHitSeconds;
+	iMisses = g_iDiskCacheMisses;
+	fMissSeconds = g_fDiskCacheMissSeconds;
+}
+
+static bool ShouldUseDiskCache( const RageTextureID &ID )
+{
+	/* Only cache images that are loaded on every boot.  Song graphics come and
+	 * go, and banners already have ImageCache. */
+	RString sPath = ID.filename;
+	if( BeginsWith(sPath, "/") )
+		sPath.erase( 0, 1 );
+	return BeginsWith( sPath, SpecialFiles::THEMES_DIR ) || BeginsWith( sPath, SpecialFiles::NOTESKINS_DIR );
+}
+
+static RString GetDiskCachePath( const RageTextureID &ID, const RageBitmapTexture::DecodeCaps &caps )
+{
+	RString sKey = ssprintf( "%s|%i|%i|%i|%i|%i|%i|%i|%i|%s|%i|%i",
+		ID.filename.c_str(), ID.iMaxSize, ID.bMipMaps, ID.iAlphaBits,
+		ID.iGrayscaleBits, ID.iColorDepth, ID.bDither, ID.bStretch,
+		ID.bHotPinkColorKey, ID.AdditionalTextureHints.c_str(),
+		caps.iMaxTextureSize, caps.bHighResolutionTextures );
+	for( int i = 0; i < NUM_RagePixelFormat; ++i )
+		sKey += caps.bSupportsFormat[i]? '1':'0';
+
+	return TEXTURE_CACHE_DIR + ssprintf( "%08x", GetHashForString(sKey) );
+}
+
+static bool LoadFromDiskCache( const RString &sCachePath, unsigned iFileHash, RageBitmapTexture::DecodedImage &out )
+{
+	RageFile f;
+	if( !f.Open(sCachePath) )
+		return false;
+
+	TextureCacheHeader h;
+	if( f.Read(&h, sizeof(h)) != sizeof(h) )
+		return false;
+	if( h.iVersion != TEXTURE_CACHE_VERSION || h.iFileHash != iFileHash )
+		return false;
+
+	/* The surface is read straight into its final buffer; no conversion is needed. */
+	RageSurface *pImg = RageSurfaceUtils::LoadSurface( f, sCachePath );
+	if( pImg == nullptr )
+		return false;
+
+	out.actualID.iAlphaBits = h.iAlphaBits;
+	out.actualID.iGrayscaleBits = h.iGrayscaleBits;
+	out.actualID.iColorDepth = h.iColorDepth;
+	out.actualID.iMaxSize = h.iMaxSize;
+	out.actualID.bMipMaps = !!h.bMipMaps;
+	out.actualID.bDither = !!h.bDither;
+	out.actualID.bStretch = !!h.bStretch;
+	out.pixfmt = (RagePixelFormat) h.iPixFmt;
+	out.iSourceWidth = h.iSourceWidth;
+	out.iSourceHeight = h.iSourceHeight;
+	out.iImageWidth = h.iImageWidth;
+	out.iImageHeight = h.iImageHeight;
+	out.iTextureWidth = h.iTextureWidth;
+	out.iTextureHeight = h.iTextureHeight;
+	out.bDoubleRes = !!h.bDoubleRes;
+	out.pImg = pImg;
+	return true;
+}
+
+static void SaveToDiskCache( const RString &sCachePath, unsigned iFileHash, const RageBitmapTexture::DecodedImage &img )
+{
+	RageFile f;
+	if( !f.Open(sCachePath, RageFile::WRITE) )
+	{
+		LOG->Trace( "Couldn't write texture cache file \"%s\": %s", sCachePath.c_str(), f.GetError().c_str() );
+		return;
+	}
+
+	TextureCacheHeader h;
+	memset( &h, 0, sizeof(h) );
+	h.iVersion = TEXTURE_CACHE_VERSION;
+	h.iFileHash = iFileHash;
+	h.iAlphaBits = img.actualID.iAlphaBits;
+	h.iGrayscaleBits = img.actualID.iGrayscaleBits;
+	h.iColorDepth = img.actualID.iColorDepth;
+	h.iMaxSize = img.actualID.iMaxSize;
+	h.bMipMaps = img.actualID.bMipMaps;
+	h.bDither = img.actualID.bDither;
+	h.bStretch = img.actualID.bStretch;
+	h.iPixFmt = img.pixfmt;
+	h.iSourceWidth = img.iSourceWidth;
+	h.iSourceHeight = img.iSourceHeight;
+	h.iImageWidth = img.iImageWidth;
+	h.iImageHeight = img.iImageHeight;
+	h.iTextureWidth = img.iTextureWidth;
+	h.iTextureHeight = img.iTextureHeight;
+	h.bDoubleRes = img.bDoubleRes;
+
+	if( f.Write(&h, sizeof(h)) == -1 || !RageSurfaceUtils::SaveSurface(img.pImg, f) || f.Flush() == -1 )
+	{
+		f.Close();
+		FILEMAN->Remove( sCachePath );
+	}
+}
+
 /*
  * Each dwMaxSize, dwTextureColorDepth and iAlphaBits are maximums; we may
  * use less.  iAlphaBits must be 0, 1 or 4.
@@ -70,29 +275,69 @@ void RageBitmapTexture::Reload()
  */
 void RageBitmapTexture::Create()
 {
-	RageTextureID actualID = GetID();
+	const RageTextureID &ID = GetID();
 
-	ASSERT( actualID.filename != "" );
+	ASSERT( ID.filename != "" );
+
+	DecodeCaps caps;
+	caps.Capture();
 
-	/* Load the image into a RageSurface. */
-	RString error;
 	RageSurface *pImg = nullptr;
-	if(actualID.filename == TEXTUREMAN->GetScreenTextureID().filename)
-	{
-		pImg= TEXTUREMAN->GetScreenSurface();
-	}
-	else
+	if( ID.filename == TEXTUREMAN->GetScreenTextureID().filename )
+		pImg = TEXTUREMAN->GetScreenSurface();
+
+	/* If the image was prefetched, it only needs uploading. */
+	RageTimer tm;
+	DecodedImage img;
+	const bool bPrefetched = pImg == nullptr && TEXTUREMAN->TakePrefetchedTexture( ID, caps, img );
+	if( !bPrefetched )
+		Decode( ID, caps, pImg, img );
+	const float fDecodeSeconds = tm.GetDeltaTime();
+	Upload( img );
+	TEXTUREMAN->AddLoadTime( bPrefetched, fDecodeSeconds, tm.GetDeltaTime() );
+}
+
+void RageBitmapTexture::FinishBackgroundLoad( DecodedImage &img )
+{
+	ASSERT( m_bLoadPending );
+	m_bLoadPending = false;
+	Upload( img );
+}
+
+void RageBitmapTexture::Decode( const RageTextureID &ID, const DecodeCaps &caps, RageSurface *pImg, DecodedImage &out )
+{
+	PROFILE_SCOPE( "RageBitmapTexture::Decode" );
+
+	RageTextureID &actualID = out.actualID;
+	actualID = ID;
+
+	RageTimer tmDecode;
+	RString sCachePath;
+	unsigned iFileHash = 0;
+	if( pImg == nullptr && caps.bUseDiskCache && ShouldUseDiskCache(ID) )
 	{
-		pImg= RageSurfaceUtils::LoadFile(actualID.filename, error);
+		sCachePath = GetDiskCachePath( ID, caps );
+		iFileHash = GetHashForFile( ID.filename );
+		if( LoadFromDiskCache(sCachePath, iFileHash, out) )
+		{
+			LockMut( g_DiskCacheStatsLock );
+			++g_iDiskCacheHits;
+			g_fDiskCacheHitSeconds += tmDecode.Ago();
+			return;
+		}
 	}
 
+	/* Load the image into a RageSurface. */
+	RString error;
+	if( pImg == nullptr )
+		pImg = RageSurfaceUtils::LoadFile( actualID.filename, error );
+
 	/* Tolerate corrupt/unknown images. */
 	if( pImg == nullptr )
 	{
-		RString warning = ssprintf("RageBitmapTexture: Couldn't load %s: %s",
+		out.sWarning = ssprintf("RageBitmapTexture: Couldn't load %s: %s",
 			actualID.filename.c_str(), error.c_str());
-		LOG->Warn("%s", warning.c_str());
-		Dialog::OK(warning, "missing_texture");
+		LOG->Warn("%s", out.sWarning.c_str());
 		pImg = RageSurfaceUtils::MakeDummySurface( 64, 64 );
 		ASSERT( pImg != nullptr );
 	}
@@ -111,7 +356,7 @@ void RageBitmapTexture::Create()
 	}
 
 	// look in the file name for a format hints
-	RString sHintString = GetID().filename + actualID.AdditionalTextureHints;
+	RString sHintString = ID.filename + actualID.AdditionalTextureHints;
 	MakeLower(sHintString);
 
 	if( sHintString.find("32bpp") != std::string::npos )			actualID.iColorDepth = 32;
@@ -136,58 +381,64 @@ void RageBitmapTexture::Create()
 	if( actualID.iGrayscaleBits != -1 && pImg->format->BitsPerPixel == 8 )
 		actualID.iGrayscaleBits = -1;
 
+	out.bDoubleRes = sHintString.find("doubleres") != std::string::npos;
+
 	/* Cap the max texture size to the hardware max. */
-	actualID.iMaxSize = std::min( actualID.iMaxSize, DISPLAY->GetMaxTextureSize() );
+	actualID.iMaxSize = std::min( actualID.iMaxSize, caps.iMaxTextureSize );
 
 	/* Save information about the source. */
-	m_iSourceWidth = pImg->w;
-	m_iSourceHeight = pImg->h;
+	out.iSourceWidth = pImg->w;
+	out.iSourceHeight = pImg->h;
 
 	/* in-game image dimensions are the same as the source graphic */
-	m_iImageWidth = m_iSourceWidth;
-	m_iImageHeight = m_iSourceHeight;
+	int &iImageWidth = out.iImageWidth;
+	int &iImageHeight = out.iImageHeight;
+	iImageWidth = out.iSourceWidth;
+	iImageHeight = out.iSourceHeight;
 
 	/* if "doubleres" (high resolution) and we're not allowing high res textures, then image dimensions are half of the source */
-	if( sHintString.find("doubleres") != std::string::npos )
+	if( out.bDoubleRes )
 	{
-		if( !StepMania::GetHighResolutionTextures() )
+		if( !caps.bHighResolutionTextures )
 		{
-			m_iImageWidth = m_iImageWidth / 2;
-			m_iImageHeight = m_iImageHeight / 2;
+			iImageWidth = iImageWidth / 2;
+			iImageHeight = iImageHeight / 2;
 		}
 	}
 
 	/* image size cannot exceed max size */
-	m_iImageWidth = std::min( m_iImageWidth, actualID.iMaxSize );
-	m_iImageHeight = std::min( m_iImageHeight, actualID.iMaxSize );
+	iImageWidth = std::min( iImageWidth, actualID.iMaxSize );
+	iImageHeight = std::min( iImageHeight, actualID.iMaxSize );
 
 	/* Texture dimensions need to be a power of two; jump to the next. */
-	m_iTextureWidth = power_of_two(m_iImageWidth);
-	m_iTextureHeight = power_of_two(m_iImageHeight);
+	int &iTextureWidth = out.iTextureWidth;
+	int &iTextureHeight = out.iTextureHeight;
+	iTextureWidth = power_of_two(iImageWidth);
+	iTextureHeight = power_of_two(iImageHeight);
 
 	/* If we're under 8x8, increase it, to avoid filtering problems on odd hardware. */
-	if( m_iTextureWidth < 8 || m_iTextureHeight < 8 )
+	if( iTextureWidth < 8 || iTextureHeight < 8 )
 	{
 		actualID.bStretch = true;
-		m_iTextureWidth = std::max( 8, m_iTextureWidth );
-		m_iTextureHeight = std::max( 8, m_iTextureHeight );
+		iTextureWidth = std::max( 8, iTextureWidth );
+		iTextureHeight = std::max( 8, iTextureHeight );
 	}
 
-	ASSERT_M( m_iTextureWidth <= actualID.iMaxSize, ssprintf("w %i, %i", m_iTextureWidth, actualID.iMaxSize) );
-	ASSERT_M( m_iTextureHeight <= actualID.iMaxSize, ssprintf("h %i, %i", m_iTextureHeight, actualID.iMaxSize) );
+	ASSERT_M( iTextureWidth <= actualID.iMaxSize, ssprintf("w %i, %i", iTextureWidth, actualID.iMaxSize) );
+	ASSERT_M( iTextureHeight <= actualID.iMaxSize, ssprintf("h %i, %i", iTextureHeight, actualID.iMaxSize) );
 
 	if( actualID.bStretch )
 	{
 		/* The hints asked for the image to be stretched to the texture size,
 		 * probably for tiling. */
-		m_iImageWidth = m_iTextureWidth;
-		m_iImageHeight = m_iTextureHeight;
+		iImageWidth = iTextureWidth;
+		iImageHeight = iTextureHeight;
 	}
 
-	if( pImg->w != m_iImageWidth || pImg->h != m_iImageHeight )
-		RageSurfaceUtils::Zoom( pImg, m_iImageWidth, m_iImageHeight );
+	if( pImg->w != iImageWidth || pImg->h != iImageHeight )
+		RageSurfaceUtils::Zoom( pImg, iImageWidth, iImageHeight );
 
-	if( actualID.iGrayscaleBits != -1 && DISPLAY->SupportsTextureFormat(RagePixelFormat_PAL) )
+	if( actualID.iGrayscaleBits != -1 && caps.bSupportsFormat[RagePixelFormat_PAL] )
 	{
 		RageSurface *pGrayscale = RageSurfaceUtils::PalettizeToGrayscale( pImg, actualID.iGrayscaleBits, actualID.iAlphaBits );
 
@@ -196,10 +447,10 @@ void RageBitmapTexture::Create()
 	}
 
 	// Figure out which texture format we want the renderer to use.
-	RagePixelFormat pixfmt;
+	RagePixelFormat &pixfmt = out.pixfmt;
 
 	// If the source is palleted, always load as paletted if supported.
-	if( pImg->format->BitsPerPixel == 8 && DISPLAY->SupportsTextureFormat(RagePixelFormat_PAL) )
+	if( pImg->format->BitsPerPixel == 8 && caps.bSupportsFormat[RagePixelFormat_PAL] )
 	{
 		pixfmt = RagePixelFormat_PAL;
 	}
@@ -236,10 +487,10 @@ void RageBitmapTexture::Create()
 	}
 
 	// Make we're using a supported format. Every card supports either RGBA8 or RGBA4.
-	if( !DISPLAY->SupportsTextureFormat(pixfmt) )
+	if( !caps.bSupportsFormat[pixfmt] )
 	{
 		pixfmt = RagePixelFormat_RGBA8;
-		if( !DISPLAY->SupportsTextureFormat(pixfmt) )
+		if( !caps.bSupportsFormat[pixfmt] )
 			pixfmt = RagePixelFormat_RGBA4;
 	}
 
@@ -267,10 +518,40 @@ void RageBitmapTexture::Create()
 	RageSurfaceUtils::FixHiddenAlpha( pImg );
 
 	/* Scale up to the texture size, if needed. */
-	RageSurfaceUtils::ConvertSurface( pImg, m_iTextureWidth, m_iTextureHeight,
+	RageSurfaceUtils::ConvertSurface( pImg, iTextureWidth, iTextureHeight,
 		pImg->fmt.BitsPerPixel, pImg->fmt.Mask[0], pImg->fmt.Mask[1], pImg->fmt.Mask[2], pImg->fmt.Mask[3] );
 
-	m_uTexHandle = DISPLAY->CreateTexture( pixfmt, pImg, actualID.bMipMaps );
+	out.pImg = pImg;
+
+	if( !sCachePath.empty() )
+	{
+		/* Don't cache the placeholder for an image that failed to load. */
+		if( out.sWarning.empty() )
+			SaveToDiskCache( sCachePath, iFileHash, out );
+
+		LockMut( g_DiskCacheStatsLock );
+		++g_iDiskCacheMisses;
+		g_fDiskCacheMissSeconds += tmDecode.Ago();
+	}
+}
+
+void RageBitmapTexture::Upload( DecodedImage &img )
+{
+	PROFILE_SCOPE( "RageBitmapTexture::Upload" );
+
+	const RageTextureID &actualID = img.actualID;
+
+	if( !img.sWarning.empty() )
+		Dialog::OK( img.sWarning, "missing_texture" );
+
+	m_iSourceWidth = img.iSourceWidth;
+	m_iSourceHeight = img.iSourceHeight;
+	m_iImageWidth = img.iImageWidth;
+	m_iImageHeight = img.iImageHeight;
+	m_iTextureWidth = img.iTextureWidth;
+	m_iTextureHeight = img.iTextureHeight;
+
+	m_uTexHandle = DISPLAY->CreateTexture( img.pixfmt, img.pImg, actualID.bMipMaps );
 
 	CreateFrameRects();
 
@@ -280,7 +561,7 @@ void RageBitmapTexture::Create()
 		// Otherwise, pixel/texel alignment will be off.
 		int iDimensionMultiple = 2;
 
-		if( sHintString.find("doubleres") != std::string::npos )
+		if( img.bDoubleRes )
 		{
 			iDimensionMultiple = 4;
 		}
@@ -314,7 +595,7 @@ void RageBitmapTexture::Create()
 	}
 
 
-	delete pImg;
+	RageUtil::SafeDelete( img.pImg );
 
 	// Check for hints that override the apparent "size".
 	GetResolutionFromFileName( actualID.filename, m_iSourceWidth, m_iSourceHeight );
@@ -323,7 +604,7 @@ void RageBitmapTexture::Create()
 	 * with dimensions 1/2 of the source. So, cut down the source dimension here
 	 * after everything above is finished operating with the real image
 	 * source dimensions. */
-	if( sHintString.find("doubleres") != std::string::npos )
+	if( img.bDoubleRes )
 	{
 		m_iSourceWidth = m_iSourceWidth / 2;
 		m_iSourceHeight = m_iSourceHeight / 2;
@@ -331,7 +612,7 @@ void RageBitmapTexture::Create()
 
 
 	RString sProperties;
-	sProperties += RagePixelFormatToString( pixfmt ) + " ";
+	sProperties += RagePixelFormatToString( img.pixfmt ) + " ";
 	if( actualID.iAlphaBits == 0 ) sProperties += "opaque ";
 	if( actualID.iAlphaBits == 1 ) sProperties += "matte ";
 	if( actualID.bStretch ) sProperties += "stretch ";
@@ -346,6 +627,7 @@ void RageBitmapTexture::Create()
 void RageBitmapTexture::Destroy()
 {
 	DISPLAY->DeleteTexture( m_uTexHandle );
+	m_uTexHandle = 0;
 }
 
 /*
@@ -4,23 +4,80 @@
 #define RAGEBITMAPTEXTURE_H
 
 #include "RageTexture.h"
+#include "RageDisplay.h"
 
 #include <cstddef>
 
+struct RageSurface;
 class RageBitmapTexture : public RageTexture
 {
 public:
-	RageBitmapTexture( RageTextureID name );
+	/* If bLoadInBackground is set, the image is decoded in a
+	 * RageTextureManager worker thread and the texture is blank, but of the
+	 * right size, until it is uploaded. */
+	RageBitmapTexture( RageTextureID name, bool bLoadInBackground = false );
 	virtual ~RageBitmapTexture();
 	/* only called by RageTextureManager::InvalidateTextures */
 	virtual void Invalidate() { m_uTexHandle = 0; /* don't Destroy() */}
 	virtual void Reload();
 	virtual uintptr_t GetTexHandle() const { return m_uTexHandle; };	// accessed by RageDisplay
+	virtual bool IsLoadPending() const { return m_bLoadPending; }
+
+	/* Display capabilities and settings that affect decoding.  These are read
+	 * on the main thread, so the decode itself doesn't need to touch the
+	 * renderer. */
+	struct DecodeCaps
+	{
+		int iMaxTextureSize;
+		bool bHighResolutionTextures;
+		bool bSupportsFormat[NUM_RagePixelFormat];
+		bool bUseDiskCache;
+
+		void Capture();
+		bool operator==( const DecodeCaps &rhs ) const;
+	};
+
+	/* An image that has been loaded, resized and converted, and only needs
+	 * to be handed to the renderer. */
+	struct DecodedImage
+	{
+		DecodedImage(): pImg(nullptr), pixfmt(RagePixelFormat_Invalid),
+			iSourceWidth(0), iSourceHeight(0), iImageWidth(0), iImageHeight(0),
+			iTextureWidth(0), iTextureHeight(0), bDoubleRes(false) {}
+
+		RageTextureID actualID;
+		RageSurface *pImg;
+		RagePixelFormat pixfmt;
+		RString sWarning;	// set if the file couldn't be loaded
+		int iSourceWidth, iSourceHeight;
+		int iImageWidth, iImageHeight;
+		int iTextureWidth, iTextureHeight;
+		bool bDoubleRes;
+	};
+
+	/* Load and convert the image for ID.  This doesn't touch the renderer or
+	 * any main thread state, so it's safe to call from any thread.  If pImg
+	 * is nullptr, the image is loaded from ID.filename; otherwise, ownership
+	 * of pImg is taken. */
+	static void Decode( const RageTextureID &ID, const DecodeCaps &caps, RageSurface *pImg, DecodedImage &out );
+
+	/* Theme and noteskin images are cached on disk after conversion, so
+	 * they don't need to be decoded again next time.  These are the number
+	 * of decodes that did and didn't find a cached image, and the total time
+	 * they took. */
+	static void GetDiskCacheStats( int &iHits, float &fHitSeconds, int &iMisses, float &fMissSeconds );
+
+	/* Called by RageTextureManager in the main thread when a background
+	 * decode has finished. */
+	void FinishBackgroundLoad( DecodedImage &img );
 
 private:
 	void Create();	// called by constructor and Reload
+	bool CreatePlaceholder();
+	void Upload( DecodedImage &img );
 	void Destroy();
 	uintptr_t m_uTexHandle;	// treat as unsigned in OpenGL, IDirect3DTexture9* for D3D
+	bool m_bLoadPending;
 };
 
 #endif
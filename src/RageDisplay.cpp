@@ -24,7 +24,7 @@
 // Statistics stuff
 RageTimer	g_LastCheckTimer;
 int		g_iNumVerts;
-int		g_iFPS, g_iVPF, g_iCFPS;
+int		g_iFPS, g_iVPF, g_iCFPS, g_iBPF, g_iStatesPF, g_iStateChangesPF;
 
 int RageDisplay::GetFPS() const { return g_iFPS; }
 int RageDisplay::GetVPF() const { return g_iVPF; }
@@ -33,7 +33,11 @@ int RageDisplay::GetCumFPS() const { return g_iCFPS; }
 static int g_iFramesRenderedSinceLastCheck,
 	   g_iFramesRenderedSinceLastReset,
 	   g_iVertsRenderedSinceLastCheck,
+	   g_iTextureBindsSinceLastCheck,
+	   g_iRenderStatesSinceLastCheck,
+	   g_iStateChangesSinceLastCheck,
 	   g_iNumChecksSinceLastReset;
+static uintptr_t g_iLastBoundTexture[NUM_TextureUnit];
 static RageTimer g_LastFrameEndedAt( RageZeroTimer );
 
 struct Centering
@@ -143,7 +147,12 @@ void RageDisplay::ProcessStatsOnFlip()
 		g_iCFPS = g_iFramesRenderedSinceLastReset / g_iNumChecksSinceLastReset;
 		g_iCFPS = std::lrint( g_iCFPS / fActualTime );
 		g_iVPF = g_iVertsRenderedSinceLastCheck / g_iFramesRenderedSinceLastCheck;
+		g_iBPF = g_iTextureBindsSinceLastCheck / g_iFramesRenderedSinceLastCheck;
+		g_iStatesPF = g_iRenderStatesSinceLastCheck / g_iFramesRenderedSinceLastCheck;
+		g_iStateChangesPF = g_iStateChangesSinceLastCheck / g_iFramesRenderedSinceLastCheck;
 		g_iFramesRenderedSinceLastCheck = g_iVertsRenderedSinceLastCheck = 0;
+		g_iTextureBindsSinceLastCheck = 0;
+		g_iRenderStatesSinceLastCheck = g_iStateChangesSinceLastCheck = 0;
 		if( LOG_FPS )
 		{
 			RString sStats = GetStats();
@@ -155,10 +164,12 @@ void RageDisplay::ProcessStatsOnFlip()
 
 void RageDisplay::ResetStats()
 {
-	g_iFPS = g_iVPF = 0;
+	g_iFPS = g_iVPF = g_iBPF = g_iStatesPF = g_iStateChangesPF = 0;
 	g_iFramesRenderedSinceLastCheck = g_iFramesRenderedSinceLastReset = 0;
 	g_iNumChecksSinceLastReset = 0;
 	g_iVertsRenderedSinceLastCheck = 0;
+	g_iTextureBindsSinceLastCheck = 0;
+	g_iRenderStatesSinceLastCheck = g_iStateChangesSinceLastCheck = 0;
 	g_LastCheckTimer.GetDeltaTime();
 }
 
@@ -167,9 +178,10 @@ RString RageDisplay::GetStats() const
 	RString s;
 	// If FPS == 0, we don't have stats yet.
 	if( !GetFPS() )
-		s = "-- FPS\n-- av FPS\n-- VPF";
+		s = "-- FPS\n-- av FPS\n-- VPF\n-- binds/frame\n-- state changes/frame";
 
-	s = ssprintf( "%i FPS\n%i av FPS\n%i VPF", GetFPS(), GetCumFPS(), GetVPF() );
+	s = ssprintf( "%i FPS\n%i av FPS\n%i VPF\n%i binds/frame\n%i/%i state changes/frame",
+		GetFPS(), GetCumFPS(), GetVPF(), g_iBPF, g_iStateChangesPF, g_iStatesPF );
 
 //	#if defined(_WIN32)
 	s += "\n"+this->GetApiDescription();
@@ -196,6 +208,38 @@ void RageDisplay::BeginConcurrentRendering()
 }
 
 void RageDisplay::StatsAddVerts( int iNumVertsRendered ) { g_iVertsRenderedSinceLastCheck += iNumVertsRendered; }
+void RageDisplay::StatsAddTextureBind( TextureUnit tu, uintptr_t iTexture )
+{
+	if( iTexture == 0 || g_iLastBoundTexture[tu] == iTexture )
+		return;
+	g_iLastBoundTexture[tu] = iTexture;
+	++g_iTextureBindsSinceLastCheck;
+}
+
+void RageDisplay::StatsAddRenderState( bool bChanged )
+{
+	++g_iRenderStatesSinceLastCheck;
+	if( bChanged )
+		++g_iStateChangesSinceLastCheck;
+}
+
+int RageDisplay::GetRenderStatesSinceLastCheck() const { return g_iRenderStatesSinceLastCheck; }
+int RageDisplay::GetRenderStateChangesSinceLastCheck() const { return g_iStateChangesSinceLastCheck; }
+
+void RageDisplay::InvalidateRenderStates()
+{
+	m_CachedBlendMode.bKnown = false;
+	m_bCachedZWrite.bKnown = false;
+	m_CachedZTestMode.bKnown = false;
+	m_CachedCullMode.bKnown = false;
+	InvalidateTextureBindings();
+}
+
+void RageDisplay::InvalidateTextureBindings()
+{
+	FOREACH_ENUM( TextureUnit, tu )
+		m_CachedTexture[tu].bKnown = false;
+}
 
 /* Draw a line as a quad.  GL_LINES with SmoothLines off can draw line
  * ends at odd angles--they're forced to axis-alignment regardless of the
@@ -268,6 +312,9 @@ void RageDisplay::DrawCircleInternal( const RageSpriteVertex &p, float radius )
 
 void RageDisplay::SetDefaultRenderStates()
 {
+	/* This is called at the start of each frame, and whenever the device
+	 * state is unknown, so send everything. */
+	InvalidateRenderStates();
 	SetLighting( false );
 	SetCullMode( CULL_NONE );
 	SetZWrite( false );
@@ -387,6 +387,35 @@ protected:
 	// Stuff in RageDisplay.cpp
 	void SetDefaultRenderStates();
 
+	/* The render states last sent to the device.  Backend setters call
+	 * RenderStateChanged first, and return if the device already has the
+	 * state.  Call InvalidateRenderStates when the device state may have
+	 * changed behind our back (another context, a device reset), and
+	 * InvalidateTextureBindings after binding a texture outside SetTexture. */
+	template<class T>
+	struct CachedRenderState
+	{
+		T value;
+		bool bKnown = false;
+	};
+	CachedRenderState<BlendMode> m_CachedBlendMode;
+	CachedRenderState<bool> m_bCachedZWrite;
+	CachedRenderState<ZTestMode> m_CachedZTestMode;
+	CachedRenderState<CullMode> m_CachedCullMode;
+	CachedRenderState<uintptr_t> m_CachedTexture[NUM_TextureUnit];
+
+	template<class T>
+	bool RenderStateChanged( CachedRenderState<T> &state, T value )
+	{
+		const bool bChanged = !state.bKnown || state.value != value;
+		state.value = value;
+		state.bKnown = true;
+		StatsAddRenderState( bChanged );
+		return bChanged;
+	}
+	void InvalidateRenderStates();
+	void InvalidateTextureBindings();
+
 public:
 	// Statistics
 	int GetFPS() const;
@@ -396,6 +425,15 @@ public:
 	virtual void ProcessStatsOnFlip();
 	virtual RString GetStats() const;
 	void StatsAddVerts( int iNumVertsRendered );
+	/* Call when binding a texture; only changes from the last texture bound
+	 * to the unit are counted. */
+	void StatsAddTextureBind( TextureUnit tu, uintptr_t iTexture );
+	/* Call for each render state set, with whether it differed from what the
+	 * device already had. */
+	void StatsAddRenderState( bool bChanged );
+	// Render states set, and those that changed, since the stats were last updated.
+	int GetRenderStatesSinceLastCheck() const;
+	int GetRenderStateChangesSinceLastCheck() const;
 
 	// World matrix stack functions.
 	void PushMatrix();
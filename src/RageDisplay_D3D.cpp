@@ -393,6 +393,7 @@ RString SetD3DParams( bool &bNewDeviceOut )
 
 	// Palettes were lost by Reset(), so mark them unloaded.
 	g_TexResourceToPaletteIndex.clear();
+	InvalidateRenderStates();
 
 	return RString();
 }
@@ -1058,6 +1059,8 @@ void RageDisplay_D3D::SetTexture( TextureUnit tu, uintptr_t iTexture )
 //	g_DeviceCaps.MaxSimultaneousTextures = 1;
 	if( tu >= (int) g_DeviceCaps.MaxSimultaneousTextures )	// not supported
 		return;
+	if( !RenderStateChanged(m_CachedTexture[tu], iTexture) )
+		return;
 
 	if( iTexture == 0 )
 	{
@@ -1072,6 +1075,7 @@ void RageDisplay_D3D::SetTexture( TextureUnit tu, uintptr_t iTexture )
 	{
 		IDirect3DTexture9* pTex = reinterpret_cast<IDirect3DTexture9*>(iTexture);
 		g_pd3dDevice->SetTexture( tu, pTex );
+		StatsAddTextureBind( tu, iTexture );
 
 		/* Intentionally commented out. Don't mess with texture stage state
 		 * when just setting the texture. Model sets its texture modes before
@@ -1080,6 +1084,11 @@ void RageDisplay_D3D::SetTexture( TextureUnit tu, uintptr_t iTexture )
 
 		// Set palette (if any)
 		SetPalette( iTexture );
+
+		/* The current palette isn't per-stage, so rebind everything after
+		 * a paletted texture, to select the right palette again. */
+		if( g_TexResourceToTexturePalette.find(iTexture) != g_TexResourceToTexturePalette.end() )
+			InvalidateTextureBindings();
 	}
 }
 
@@ -1131,6 +1140,9 @@ void RageDisplay_D3D::SetTextureFiltering( TextureUnit tu, bool b )
 
 void RageDisplay_D3D::SetBlendMode( BlendMode mode )
 {
+	if( !RenderStateChanged(m_CachedBlendMode, mode) )
+		return;
+
 	g_pd3dDevice->SetRenderState( D3DRS_ALPHABLENDENABLE, TRUE );
 
 	if( mode == BLEND_INVERT_DEST )
@@ -1232,11 +1244,15 @@ bool RageDisplay_D3D::IsZTestEnabled() const
 
 void RageDisplay_D3D::SetZWrite( bool b )
 {
+	if( !RenderStateChanged(m_bCachedZWrite, b) )
+		return;
 	g_pd3dDevice->SetRenderState( D3DRS_ZWRITEENABLE, b );
 }
 
 void RageDisplay_D3D::SetZTestMode( ZTestMode mode )
 {
+	if( !RenderStateChanged(m_CachedZTestMode, mode) )
+		return;
 	g_pd3dDevice->SetRenderState( D3DRS_ZENABLE, D3DZB_TRUE );
 	DWORD dw;
 	switch( mode )
@@ -1345,6 +1361,8 @@ void RageDisplay_D3D::SetLightDirectional(
 
 void RageDisplay_D3D::SetCullMode( CullMode mode )
 {
+	if( !RenderStateChanged(m_CachedCullMode, mode) )
+		return;
 	switch( mode )
 	{
 	case CULL_BACK:
@@ -1368,6 +1386,7 @@ void RageDisplay_D3D::DeleteTexture( uintptr_t iTexHandle )
 
 	IDirect3DTexture9* pTex = reinterpret_cast<IDirect3DTexture9*>(iTexHandle);
 	pTex->Release();
+	InvalidateTextureBindings();
 
 	// Delete palette (if any)
 	if( g_TexResourceToPaletteIndex.find(iTexHandle) != g_TexResourceToPaletteIndex.end() )
@@ -1426,8 +1445,8 @@ void RageDisplay_D3D::UpdateTexture(
 	RECT rect;
 	rect.left = xoffset;
 	rect.top = yoffset;
-	rect.right = width - xoffset;
-	rect.bottom = height - yoffset;
+	rect.right = xoffset + width;
+	rect.bottom = yoffset + height;
 
 	D3DLOCKED_RECT lr;
 	pTex->LockRect( 0, &lr, &rect, 0 );
@@ -620,13 +620,18 @@ SetTextureUnit( TextureUnit tu )
 void
 RageDisplay_GLES2::SetTexture( TextureUnit tu, uintptr_t iTexture )
 {
+	/* Select the unit even if the texture is already bound: texture mode,
+	 * filtering and wrapping calls that follow apply to the active unit. */
 	if (!SetTextureUnit( tu ))
 		return;
+	if (!RenderStateChanged( m_CachedTexture[tu], iTexture ))
+		return;
 
 	if (iTexture)
 	{
 		glEnable( GL_TEXTURE_2D );
 		glBindTexture( GL_TEXTURE_2D, static_cast<GLuint>(iTexture) );
+		StatsAddTextureBind( tu, iTexture );
 	}
 	else
 	{
@@ -694,11 +699,10 @@ RageDisplay_GLES2::IsZTestEnabled() const
 void
 RageDisplay_GLES2::SetZWrite( bool b )
 {
-	if (State::bZWriteEnabled != b)
-	{
-		State::bZWriteEnabled = b;
-		glDepthMask( b );
-	}
+	if (!RenderStateChanged( m_bCachedZWrite, b ))
+		return;
+	State::bZWriteEnabled = b;
+	glDepthMask( b );
 }
 
 void
@@ -713,6 +717,8 @@ RageDisplay_GLES2::SetZBias( float f )
 void
 RageDisplay_GLES2::SetZTestMode( ZTestMode mode )
 {
+	if (!RenderStateChanged( m_CachedZTestMode, mode ))
+		return;
 	glEnable( GL_DEPTH_TEST );
 	switch( mode )
 	{
@@ -825,6 +831,8 @@ RageDisplay_GLES2::ClearZBuffer()
 void
 RageDisplay_GLES2::SetCullMode( CullMode mode )
 {
+	if (!RenderStateChanged( m_CachedCullMode, mode ))
+		return;
 	if (mode != CULL_NONE)
 		glEnable(GL_CULL_FACE);
 	switch( mode )
@@ -18,7 +18,8 @@ public:
 	bool BeginFrame() { return true; }
 	void EndFrame();
 	ActualVideoModeParams GetActualVideoModeParams() const { return m_Params; }
-	void SetBlendMode( BlendMode ) { }
+	// Nothing to set, but track the states so the stats count changes.
+	void SetBlendMode( BlendMode mode ) { RenderStateChanged( m_CachedBlendMode, mode ); }
 	bool SupportsTextureFormat( RagePixelFormat, bool /* realtime */ =false ) { return true; }
 	bool SupportsPerVertexMatrixScale() { return false; }
 	uintptr_t CreateTexture(
@@ -33,18 +34,18 @@ public:
 	void DeleteTexture( uintptr_t /* iTexHandle */ ) { }
 	void ClearAllTextures() { }
 	int GetNumTextureUnits() { return 1; }
-	void SetTexture( TextureUnit, uintptr_t /* iTexture */ ) { }
+	void SetTexture( TextureUnit tu, uintptr_t iTexture ) { RenderStateChanged( m_CachedTexture[tu], iTexture ); }
 	void SetTextureMode( TextureUnit, TextureMode ) { }
 	void SetTextureWrapping( TextureUnit, bool ) { }
 	int GetMaxTextureSize() const { return 2048; }
 	void SetTextureFiltering( TextureUnit, bool ) { }
 	bool IsZWriteEnabled() const { return false; }
 	bool IsZTestEnabled() const { return false; }
-	void SetZWrite( bool ) { }
+	void SetZWrite( bool b ) { RenderStateChanged( m_bCachedZWrite, b ); }
 	void SetZBias( float ) { }
-	void SetZTestMode( ZTestMode ) { }
+	void SetZTestMode( ZTestMode mode ) { RenderStateChanged( m_CachedZTestMode, mode ); }
 	void ClearZBuffer() { }
-	void SetCullMode( CullMode ) { }
+	void SetCullMode( CullMode mode ) { RenderStateChanged( m_CachedCullMode, mode ); }
 	void SetAlphaTest( bool ) { }
 	void SetMaterial(
 		const RageColor & /* unreferenced: emissive */,
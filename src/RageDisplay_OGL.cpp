@@ -935,6 +935,7 @@ RageSurface *RageDisplay_Legacy::GetTexture( uintptr_t iTexture )
 	FlushGLErrors();
 
 	glBindTexture( GL_TEXTURE_2D, static_cast<GLuint>(iTexture) );
+	InvalidateTextureBindings();
 	GLint iHeight, iWidth, iAlphaBits;
 	glGetTexLevelParameteriv( GL_TEXTURE_2D, 0, GL_TEXTURE_HEIGHT, &iHeight );
 	glGetTexLevelParameteriv( GL_TEXTURE_2D, 0, GL_TEXTURE_WIDTH, &iWidth );
@@ -1689,13 +1690,18 @@ int RageDisplay_Legacy::GetNumTextureUnits()
 
 void RageDisplay_Legacy::SetTexture( TextureUnit tu, uintptr_t iTexture )
 {
+	/* Select the unit even if the texture is already bound: texture mode,
+	 * filtering and wrapping calls that follow apply to the active unit. */
 	if (!SetTextureUnit( tu ))
 		return;
+	if (!RenderStateChanged( m_CachedTexture[tu], iTexture ))
+		return;
 
 	if (iTexture)
 	{
 		glEnable( GL_TEXTURE_2D );
 		glBindTexture( GL_TEXTURE_2D, static_cast<GLuint>(iTexture) );
+		StatsAddTextureBind( tu, iTexture );
 	}
 	else
 	{
@@ -1723,6 +1729,7 @@ void RageDisplay_Legacy::SetTextureMode( TextureUnit tu, TextureMode tm )
 				/* This is changing blend state, instead of texture state, which
 				 * isn't great, but it's better than doing nothing. */
 				glBlendFunc( GL_SRC_ALPHA, GL_ONE );
+				m_CachedBlendMode.bKnown = false;
 				return;
 			}
 
@@ -1868,6 +1875,9 @@ bool RageDisplay_Legacy::IsEffectModeSupported( EffectMode effect )
 
 void RageDisplay_Legacy::SetBlendMode( BlendMode mode )
 {
+	if (!RenderStateChanged( m_CachedBlendMode, mode ))
+		return;
+
 	glEnable(GL_BLEND);
 
 	if (glBlendEquation != nullptr)
@@ -1957,6 +1967,8 @@ void RageDisplay_Legacy::ClearZBuffer()
 
 void RageDisplay_Legacy::SetZWrite( bool b )
 {
+	if (!RenderStateChanged( m_bCachedZWrite, b ))
+		return;
 	glDepthMask( b );
 }
 
@@ -1970,6 +1982,8 @@ void RageDisplay_Legacy::SetZBias( float f )
 
 void RageDisplay_Legacy::SetZTestMode( ZTestMode mode )
 {
+	if (!RenderStateChanged( m_CachedZTestMode, mode ))
+		return;
 	glEnable( GL_DEPTH_TEST );
 	switch( mode )
 	{
@@ -2064,6 +2078,8 @@ void RageDisplay_Legacy::SetLightDirectional(
 
 void RageDisplay_Legacy::SetCullMode( CullMode mode )
 {
+	if (!RenderStateChanged( m_CachedCullMode, mode ))
+		return;
 	if (mode != CULL_NONE)
 		glEnable(GL_CULL_FACE);
 	switch( mode )
@@ -2112,6 +2128,9 @@ void RageDisplay_Legacy::BeginConcurrentRendering()
 void RageDisplay_Legacy::EndConcurrentRendering()
 {
 	g_pWind->EndConcurrentRendering();
+
+	// The state we cached was the rendering thread's context.
+	InvalidateRenderStates();
 }
 
 void RageDisplay_Legacy::DeleteTexture( uintptr_t iTexture )
@@ -2119,6 +2138,9 @@ void RageDisplay_Legacy::DeleteTexture( uintptr_t iTexture )
 	if (iTexture == 0)
 		return;
 
+	/* Deleting a bound texture unbinds it, and the name may be reused. */
+	InvalidateTextureBindings();
+
 	if (g_mapRenderTargets.find(iTexture) != g_mapRenderTargets.end())
 	{
 		delete g_mapRenderTargets[iTexture];
@@ -2249,6 +2271,7 @@ uintptr_t RageDisplay_Legacy::CreateTexture(
 	ASSERT( iTexHandle != 0 );
 
 	glBindTexture( GL_TEXTURE_2D, static_cast<GLuint>(iTexHandle) );
+	InvalidateTextureBindings();
 
 	if (g_pWind->GetActualVideoModeParams().bAnisotropicFiltering &&
 		GLEW_EXT_texture_filter_anisotropic )
@@ -2415,6 +2438,7 @@ void RageDisplay_Legacy::UpdateTexture(
 	int iXOffset, int iYOffset, int iWidth, int iHeight )
 {
 	glBindTexture( GL_TEXTURE_2D, static_cast<GLuint>(iTexHandle) );
+	InvalidateTextureBindings();
 
 	bool bFreeImg;
 	RagePixelFormat SurfacePixFmt = GetImgPixelFormat( pImg, bFreeImg, iWidth, iHeight, false );
@@ -2593,6 +2617,7 @@ uintptr_t RageDisplay_Legacy::CreateRenderTarget( const RenderTargetParam &param
 		pTarget = g_pWind->CreateRenderTarget();
 
 	pTarget->Create( param, iTextureWidthOut, iTextureHeightOut );
+	InvalidateTextureBindings();
 
 	uintptr_t iTexture = pTarget->GetTexture();
 
@@ -2627,6 +2652,10 @@ void RageDisplay_Legacy::SetRenderTarget( uintptr_t iTexture, bool bPreserveText
 		if (g_pCurrentRenderTarget)
 			g_pCurrentRenderTarget->FinishRenderingTo();
 		g_pCurrentRenderTarget = nullptr;
+
+		/* The render target may have had its own context, and finishing may
+		 * bind its texture. */
+		InvalidateRenderStates();
 		return;
 	}
 
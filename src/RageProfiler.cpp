@@ -0,0 +1,294 @@
+#include "global.h"
+
+#include "RageProfiler.h"
+#include "RageFile.h"
+#include "RageLog.h"
+#include "RageThreads.h"
+#include "RageTimer.h"
+#include "RageUtil.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <mutex>
+#include <vector>
+
+std::atomic<bool> RageProfiler::g_bEnabled( false );
+
+namespace
+{
+	const int RING_SIZE = 1 << 15;
+	const int MAX_DEPTH = 64;
+
+	struct Event
+	{
+		const char *sName;
+		uint64_t iStart;
+		uint32_t iDuration;
+	};
+
+	struct ScopeTotal
+	{
+		const char *sName;
+		uint64_t iFrameUs;	// this frame
+		uint64_t iSumUs;	// this reporting period
+		uint64_t iMaxUs;
+	};
+
+	struct ThreadProfile
+	{
+		RString sThreadName;
+		int iIndex;
+		bool bFinished;
+
+		/* Guards the ring.  Only the owning thread writes to it, so this is only
+		 * ever contended while a trace is being written. */
+		std::mutex Lock;
+		std::vector<Event> vEvents;
+		uint64_t iNumEvents;
+
+		// Everything else is only touched by the owning thread.
+		struct Open
+		{
+			const char *sName;
+			uint64_t iStart;
+		};
+		Open Stack[MAX_DEPTH];
+		int iDepth;
+
+		std::vector<ScopeTotal> vTotals;
+	};
+
+	std::mutex g_ThreadsLock;
+	std::vector<ThreadProfile *> g_vThreads;
+
+	/* Mark the thread's profile as reusable when the thread exits, so threads
+	 * that come and go (movie decoders) don't each leave a ring behind. */
+	struct ThreadSlot
+	{
+		ThreadProfile *p = nullptr;
+		~ThreadSlot()
+		{
+			if( p == nullptr )
+				return;
+			std::lock_guard<std::mutex> lock( g_ThreadsLock );
+			p->bFinished = true;
+		}
+	};
+	thread_local ThreadSlot t_Slot;
+
+	ThreadProfile *GetThreadProfile()
+	{
+		if( t_Slot.p != nullptr )
+			return t_Slot.p;
+
+		std::lock_guard<std::mutex> lock( g_ThreadsLock );
+		ThreadProfile *p = nullptr;
+		for( ThreadProfile *pOld : g_vThreads )
+		{
+			if( pOld->bFinished )
+			{
+				p = pOld;
+				break;
+			}
+		}
+		if( p == nullptr )
+		{
+			p = new ThreadProfile;
+			p->iIndex = g_vThreads.size();
+			p->vEvents.resize( RING_SIZE );
+			g_vThreads.push_back( p );
+		}
+
+		std::lock_guard<std::mutex> ringlock( p->Lock );
+		p->sThreadName = RageThread::GetCurrentThreadName();
+		p->bFinished = false;
+		p->iNumEvents = 0;
+		p->iDepth = 0;
+		p->vTotals.clear();
+		t_Slot.p = p;
+		return p;
+	}
+
+	// The breakdown shown by the stats overlay; only touched by the game loop.
+	RString g_sBreakdown;
+	RageTimer g_BreakdownTimer;
+	int g_iFramesInPeriod = 0;
+}
+
+void RageProfiler::SetEnabled( bool bEnabled )
+{
+	g_bEnabled.store( bEnabled, std::memory_order_relaxed );
+	if( !bEnabled )
+		g_sBreakdown = RString();
+	LOG->Trace( "Frame profiler %s", bEnabled? "enabled":"disabled" );
+}
+
+void RageProfiler::BeginScope( const char *sName )
+{
+	ThreadProfile *p = GetThreadProfile();
+	if( p->iDepth < MAX_DEPTH )
+	{
+		p->Stack[p->iDepth].sName = sName;
+		p->Stack[p->iDepth].iStart = RageTimer::GetTimeSinceStartMicroseconds();
+	}
+	++p->iDepth;
+}
+
+void RageProfiler::EndScope()
+{
+	ThreadProfile *p = GetThreadProfile();
+
+	// The profiler was enabled inside this scope.
+	if( p->iDepth == 0 )
+		return;
+
+	--p->iDepth;
+	if( p->iDepth >= MAX_DEPTH )
+		return;
+
+	const ThreadProfile::Open &open = p->Stack[p->iDepth];
+	Event e;
+	e.sName = open.sName;
+	e.iStart = open.iStart;
+	e.iDuration = uint32_t( RageTimer::GetTimeSinceStartMicroseconds() - open.iStart );
+
+	{
+		std::lock_guard<std::mutex> lock( p->Lock );
+		p->vEvents[p->iNumEvents % RING_SIZE] = e;
+		++p->iNumEvents;
+	}
+
+	for( int i = 0; i < p->iDepth; ++i )
+	{
+		if( p->Stack[i].sName == e.sName )
+			return;
+	}
+
+	auto it = std::find_if( p->vTotals.begin(), p->vTotals.end(),
+		[&]( const ScopeTotal &t ) { return t.sName == e.sName; } );
+	if( it == p->vTotals.end() )
+	{
+		p->vTotals.push_back( ScopeTotal{ e.sName, 0, 0, 0 } );
+		it = p->vTotals.end() - 1;
+	}
+	it->iFrameUs += e.iDuration;
+}
+
+void RageProfiler::EndFrame()
+{
+	if( !IsEnabled() )
+		return;
+
+	ThreadProfile *p = GetThreadProfile();
+	for( ScopeTotal &t : p->vTotals )
+	{
+		t.iSumUs += t.iFrameUs;
+		t.iMaxUs = std::max( t.iMaxUs, t.iFrameUs );
+		t.iFrameUs = 0;
+	}
+	++g_iFramesInPeriod;
+
+	if( g_BreakdownTimer.Ago() < 1.0f )
+		return;
+	g_BreakdownTimer.Touch();
+
+	std::vector<ScopeTotal> vSorted = p->vTotals;
+	std::sort( vSorted.begin(), vSorted.end(),
+		[]( const ScopeTotal &a, const ScopeTotal &b ) { return a.iSumUs > b.iSumUs; } );
+
+	g_sBreakdown = RString();
+	for( const ScopeTotal &t : vSorted )
+	{
+		if( t.iSumUs == 0 )
+			continue;
+		const float fAvgMs = t.iSumUs / 1000.0f / g_iFramesInPeriod;
+		const float fMaxMs = t.iMaxUs / 1000.0f;
+		g_sBreakdown += ssprintf( "%s %.2fms (max %.2f)\n", t.sName, fAvgMs, fMaxMs );
+	}
+
+	for( ScopeTotal &t : p->vTotals )
+		t.iSumUs = t.iMaxUs = 0;
+	g_iFramesInPeriod = 0;
+}
+
+RString RageProfiler::GetFrameBreakdown( int iMaxLines )
+{
+	if( !IsEnabled() )
+		return RString();
+
+	size_t iPos = 0;
+	for( int i = 0; i < iMaxLines && iPos != RString::npos; ++i )
+	{
+		iPos = g_sBreakdown.find( '\n', iPos );
+		if( iPos != RString::npos )
+			++iPos;
+	}
+	RString sRet = g_sBreakdown.substr( 0, iPos );
+	TrimRight( sRet, "\n" );
+	return sRet;
+}
+
+static RString JsonEscape( const RString &s )
+{
+	RString sRet;
+	for( char c : s )
+	{
+		if( c == '"' || c == '\\' )
+			sRet += '\\';
+		if( (unsigned char) c < 0x20 )
+			continue;
+		sRet += c;
+	}
+	return sRet;
+}
+
+bool RageProfiler::WriteChromeTrace( const RString &sPath )
+{
+	RageFile f;
+	if( !f.Open(sPath, RageFile::WRITE) )
+	{
+		LOG->Warn( "Couldn't write profile to \"%s\": %s", sPath.c_str(), f.GetError().c_str() );
+		return false;
+	}
+
+	std::vector<Event> vEvents;
+	int iTotalEvents = 0;
+
+	f.PutLine( "{\"traceEvents\":[" );
+	bool bFirst = true;
+	std::lock_guard<std::mutex> lock( g_ThreadsLock );
+	for( ThreadProfile *p : g_vThreads )
+	{
+		RString sThreadName;
+		{
+			std::lock_guard<std::mutex> ringlock( p->Lock );
+			const uint64_t iCount = std::min<uint64_t>( p->iNumEvents, RING_SIZE );
+			vEvents.clear();
+			for( uint64_t i = p->iNumEvents - iCount; i < p->iNumEvents; ++i )
+				vEvents.push_back( p->vEvents[i % RING_SIZE] );
+			sThreadName = p->sThreadName;
+		}
+
+		RString sLine = ssprintf( "%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%i,\"args\":{\"name\":\"%s\"}}",
+			bFirst? "":",", p->iIndex, JsonEscape(sThreadName).c_str() );
+		f.PutLine( sLine );
+		bFirst = false;
+
+		for( const Event &e : vEvents )
+		{
+			f.PutLine( ssprintf( ",{\"name\":\"%s\",\"ph\":\"X\",\"pid\":1,\"tid\":%i,\"ts\":%llu,\"dur\":%u}",
+				JsonEscape(e.sName).c_str(), p->iIndex, (unsigned long long) e.iStart, e.iDuration ) );
+		}
+		iTotalEvents += vEvents.size();
+	}
+	f.PutLine( "]}" );
+
+	if( f.Flush() == -1 )
+	{
+		LOG->Warn( "Couldn't write profile to \"%s\": %s", sPath.c_str(), f.GetError().c_str() );
+		return false;
+	}
+
+	LOG->Trace( "Wrote %i profiler events to \"%s\"", iTotalEvents, sPath.c_str() );
+	return true;
+}
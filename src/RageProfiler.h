@@ -0,0 +1,61 @@
+/* RageProfiler - Scoped timers for finding out where a frame went. */
+
+#ifndef RAGE_PROFILER_H
+#define RAGE_PROFILER_H
+
+#include <atomic>
+
+/* Wrap a block in PROFILE_SCOPE("Name") to time it.  When the profiler is
+ * disabled, a scope costs one relaxed atomic load.  When enabled, each thread
+ * records completed scopes into its own ring buffer, keeping the most recent
+ * ones; the names must be string literals (or otherwise outlive the program),
+ * since only the pointer is stored.
+ *
+ * Scopes on the thread that calls EndFrame() (the game loop) are also totaled
+ * per frame for the stats overlay.  A scope nested inside another scope of the
+ * same name is only counted once, so recursive scopes like Actor::Draw give
+ * the time of the outermost call. */
+namespace RageProfiler
+{
+	extern std::atomic<bool> g_bEnabled;
+	inline bool IsEnabled() { return g_bEnabled.load( std::memory_order_relaxed ); }
+	void SetEnabled( bool bEnabled );
+
+	void BeginScope( const char *sName );
+	void EndScope();
+
+	/* Call once per frame from the game loop. */
+	void EndFrame();
+
+	/* Average and worst time per frame of each scope over the last second,
+	 * one per line, most expensive first.  Empty if disabled. */
+	RString GetFrameBreakdown( int iMaxLines );
+
+	/* Write every buffered scope on every thread as a Chrome trace (load it in
+	 * chrome://tracing or Perfetto). */
+	bool WriteChromeTrace( const RString &sPath );
+}
+
+class RageProfileScope
+{
+public:
+	RageProfileScope( const char *sName ): m_bActive( RageProfiler::IsEnabled() )
+	{
+		if( m_bActive )
+			RageProfiler::BeginScope( sName );
+	}
+	~RageProfileScope()
+	{
+		if( m_bActive )
+			RageProfiler::EndScope();
+	}
+
+private:
+	bool m_bActive;
+};
+
+#define PROFILE_SCOPE_CONCAT2( a, b ) a##b
+#define PROFILE_SCOPE_CONCAT( a, b ) PROFILE_SCOPE_CONCAT2( a, b )
+#define PROFILE_SCOPE( sName ) RageProfileScope PROFILE_SCOPE_CONCAT( profile_scope_, __LINE__ )( sName )
+
+#endif
@@ -1,5 +1,6 @@
 #include "global.h"
 #include "RageSurfaceUtils.h"
+#include "RageSurfaceUtils_SIMD.h"
 #include "RageSurface.h"
 #include "RageUtil.h"
 #include "RageLog.h"
@@ -508,6 +509,165 @@ static bool blit_same_type( const RageSurface *src_surf, const RageSurface *dst_
 	return true;
 }
 
+/* Fast path for blits from a 24- or 32-bit source whose channels are each a
+ * whole byte (RGBA8, BGRA8, RGB8 and so on, which is what the image loaders
+ * give us) to any format with channels of 8 bits or less (every texture
+ * format). Each channel then converts with a shift and a mask, which gives
+ * the same results as the tables in blit_rgba_to_rgba, since reducing 8 bits
+ * to n there is i >> (8-n). */
+namespace
+{
+	struct ByteChannelBlit
+	{
+		int iSrcShift[4];	// shift the channel to the bottom, dropping precision
+		uint32_t iMax[4];	// mask for the destination channel, unshifted; 0 to skip
+		int iDstShift[4];
+		uint32_t iConstant;	// channels missing from the source
+
+		bool Init( const RageSurfaceFormat &src, const RageSurfaceFormat &dst )
+		{
+			if( src.BytesPerPixel != 3 && src.BytesPerPixel != 4 )
+				return false;
+			if( dst.BytesPerPixel != 2 && dst.BytesPerPixel != 4 )
+				return false;
+
+			iConstant = 0;
+			for( int c = 0; c < 4; ++c )
+			{
+				iMax[c] = dst.Mask[c] >> dst.Shift[c];
+				iSrcShift[c] = iDstShift[c] = 0;
+				if( iMax[c] == 0 )
+					continue;
+				if( iMax[c] > 0xFF )
+					return false;
+
+				if( src.Mask[c] == 0 )
+				{
+					// The source is missing a channel. Alpha defaults to opaque, others to 0.
+					if( c == 3 )
+						iConstant |= dst.Mask[c];
+					iMax[c] = 0;
+					continue;
+				}
+
+				if( src.Mask[c] != (0xFFu << src.Shift[c]) || (src.Shift[c] % 8) != 0 )
+					return false;
+
+				int iDstBits = 0;
+				while( iMax[c] >> iDstBits )
+					++iDstBits;
+				iSrcShift[c] = src.Shift[c] + (8 - iDstBits);
+				iDstShift[c] = dst.Shift[c];
+			}
+			return true;
+		}
+
+		uint32_t Convert( uint32_t pixel ) const
+		{
+			uint32_t ret = iConstant;
+			for( int c = 0; c < 4; ++c )
+				ret |= ((pixel >> iSrcShift[c]) & iMax[c]) << iDstShift[c];
+			return ret;
+		}
+
+		/* Convert as many pixels of a row as we can four at a time; returns the
+		 * number converted. */
+		int ConvertRow4( const uint8_t *src, uint8_t *dst, int width, int iDstBytesPerPixel ) const
+		{
+			int x = 0;
+#if defined(RAGE_SURFACE_SSE2)
+			__m128i srcshift[4], dstshift[4], max[4];
+			for( int c = 0; c < 4; ++c )
+			{
+				srcshift[c] = _mm_cvtsi32_si128( iSrcShift[c] );
+				dstshift[c] = _mm_cvtsi32_si128( iDstShift[c] );
+				max[c] = _mm_set1_epi32( int(iMax[c]) );
+			}
+			const __m128i constant = _mm_set1_epi32( int(iConstant) );
+			const __m128i bias32 = _mm_set1_epi32( 0x8000 );
+			const __m128i bias16 = _mm_set1_epi16( short(0x8000) );
+
+			for( ; x + 4 <= width; x += 4 )
+			{
+				const __m128i pixels = _mm_loadu_si128( (const __m128i *) (src + x*4) );
+				__m128i out = constant;
+				for( int c = 0; c < 4; ++c )
+				{
+					__m128i v = _mm_and_si128( _mm_srl_epi32(pixels, srcshift[c]), max[c] );
+					out = _mm_or_si128( out, _mm_sll_epi32(v, dstshift[c]) );
+				}
+
+				if( iDstBytesPerPixel == 4 )
+				{
+					_mm_storeu_si128( (__m128i *) (dst + x*4), out );
+				}
+				else
+				{
+					// SSE2 only packs with signed saturation; bias into signed range and back.
+					__m128i packed = _mm_packs_epi32( _mm_sub_epi32(out, bias32), _mm_sub_epi32(out, bias32) );
+					packed = _mm_add_epi16( packed, bias16 );
+					_mm_storel_epi64( (__m128i *) (dst + x*2), packed );
+				}
+			}
+#elif defined(RAGE_SURFACE_NEON)
+			int32x4_t srcshift[4], dstshift[4];
+			uint32x4_t max[4];
+			for( int c = 0; c < 4; ++c )
+			{
+				srcshift[c] = vdupq_n_s32( -iSrcShift[c] );
+				dstshift[c] = vdupq_n_s32( iDstShift[c] );
+				max[c] = vdupq_n_u32( iMax[c] );
+			}
+			const uint32x4_t constant = vdupq_n_u32( iConstant );
+
+			for( ; x + 4 <= width; x += 4 )
+			{
+				const uint32x4_t pixels = vreinterpretq_u32_u8( vld1q_u8(src + x*4) );
+				uint32x4_t out = constant;
+				for( int c = 0; c < 4; ++c )
+				{
+					uint32x4_t v = vandq_u32( vshlq_u32(pixels, srcshift[c]), max[c] );
+					out = vorrq_u32( out, vshlq_u32(v, dstshift[c]) );
+				}
+
+				if( iDstBytesPerPixel == 4 )
+					vst1q_u8( dst + x*4, vreinterpretq_u8_u32(out) );
+				else
+					vst1_u8( dst + x*2, vreinterpret_u8_u16(vmovn_u32(out)) );
+			}
+#endif
+			return x;
+		}
+	};
+}
+
+static bool blit_byte_channels( const RageSurface *src_surf, const RageSurface *dst_surf, int width, int height )
+{
+	ByteChannelBlit blit;
+	if( !blit.Init(src_surf->fmt, dst_surf->fmt) )
+		return false;
+
+	const int iSrcBPP = src_surf->fmt.BytesPerPixel;
+	const int iDstBPP = dst_surf->fmt.BytesPerPixel;
+	for( int y = 0; y < height; ++y )
+	{
+		const uint8_t *src = src_surf->pixels + y*src_surf->pitch;
+		uint8_t *dst = dst_surf->pixels + y*dst_surf->pitch;
+
+		int x = 0;
+		if( iSrcBPP == 4 )
+			x = blit.ConvertRow4( src, dst, width, iDstBPP );
+
+		for( ; x < width; ++x )
+		{
+			uint32_t pixel = RageSurfaceUtils::decodepixel( src + x*iSrcBPP, iSrcBPP );
+			RageSurfaceUtils::encodepixel( dst + x*iDstBPP, iDstBPP, blit.Convert(pixel) );
+		}
+	}
+
+	return true;
+}
+
 /* Rescaling blit with no ckey. This is used to update movies in
  * D3D, so optimization is very important. */
 static bool blit_rgba_to_rgba( const RageSurface *src_surf, const RageSurface *dst_surf, int width, int height )
@@ -667,6 +827,10 @@ void RageSurfaceUtils::Blit( const RageSurface *src, RageSurface *dst, int width
 		if( blit_same_type(src, dst, width, height) )
 			break;
 
+		// RGBA->RGBA with byte-sized source channels; most image loads.
+		if( blit_byte_channels(src, dst, width, height) )
+			break;
+
 		// RGBA->RGBA with different formats.
 		if( blit_rgba_to_rgba(src, dst, width, height) )
 			break;
@@ -747,6 +911,11 @@ bool RageSurfaceUtils::SaveSurface( const RageSurface *img, RString file )
 	if( !f.Open( file, RageFile::WRITE ) )
 		return false;
 
+	return SaveSurface( img, f );
+}
+
+bool RageSurfaceUtils::SaveSurface( const RageSurface *img, RageFileBasic &f )
+{
 	SurfaceHeader h;
 	memset( &h, 0, sizeof(h) );
 
@@ -759,7 +928,8 @@ bool RageSurfaceUtils::SaveSurface( const RageSurface *img, RString file )
 	h.Amask = img->format->Amask;
 	h.bpp = img->format->BitsPerPixel;
 
-	f.Write( &h, sizeof(h) );
+	if( f.Write( &h, sizeof(h) ) == -1 )
+		return false;
 
 	if( h.bpp == 8 )
 	{
@@ -767,9 +937,7 @@ bool RageSurfaceUtils::SaveSurface( const RageSurface *img, RString file )
 		f.Write( img->format->palette->colors, img->format->palette->ncolors * sizeof(RageSurfaceColor) );
 	}
 
-	f.Write( img->pixels, static_cast<size_t>(img->h) * img->pitch );
-
-	return true;
+	return f.Write( img->pixels, static_cast<size_t>(img->h) * img->pitch ) != -1;
 }
 
 RageSurface *RageSurfaceUtils::LoadSurface( RString file )
@@ -778,6 +946,11 @@ RageSurface *RageSurfaceUtils::LoadSurface( RString file )
 	if( !f.Open( file ) )
 		return nullptr;
 
+	return LoadSurface( f, file );
+}
+
+RageSurface *RageSurfaceUtils::LoadSurface( RageFileBasic &f, const RString &sName )
+{
 	SurfaceHeader h;
 	if( f.Read( &h, sizeof(h) ) != sizeof(h) )
 		return nullptr;
@@ -803,7 +976,7 @@ RageSurface *RageSurfaceUtils::LoadSurface( RString file )
 	if( h.pitch != img->pitch )
 	{
 		LOG->Trace( "Error loading \"%s\": expected pitch %i, got %i (%ibpp, %i width)",
-				file.c_str(), h.pitch, img->pitch, h.bpp, h.width );
+				sName.c_str(), h.pitch, img->pitch, h.bpp, h.width );
 		delete img;
 		return nullptr;
 	}
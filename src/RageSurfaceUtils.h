@@ -5,6 +5,8 @@
 
 #include <cstdint>
 
+class RageFileBasic;
+
 struct RageSurfaceColor;
 struct RageSurfacePalette;
 struct RageSurfaceFormat;
@@ -56,6 +58,10 @@ namespace RageSurfaceUtils
 	bool SaveSurface( const RageSurface *img, RString file );
 	RageSurface *LoadSurface( RString file );
 
+	/* As above, reading or writing at the current position of an open file. */
+	bool SaveSurface( const RageSurface *img, RageFileBasic &f );
+	RageSurface *LoadSurface( RageFileBasic &f, const RString &sName );
+
 	/* Quickly palettize to an gray/alpha texture. */
 	RageSurface *PalettizeToGrayscale( const RageSurface *src_surf, unsigned int GrayBits, unsigned int AlphaBits );
 
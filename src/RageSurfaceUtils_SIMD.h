@@ -0,0 +1,21 @@
+/* RageSurfaceUtils_SIMD - Select the vector instruction set for the surface
+ * conversion and scaling fast paths.
+ *
+ * We only use what every CPU for the target can run: SSE2 on x86-64 (and
+ * x86 builds that enable it), NEON on little-endian ARM64.  That needs no
+ * runtime CPU detection.  These loops are limited by memory bandwidth, so
+ * wider units don't buy enough to justify per-CPU dispatch.  Anything else
+ * uses the plain C++ loops, which give identical results. */
+
+#ifndef RAGE_SURFACE_UTILS_SIMD_H
+#define RAGE_SURFACE_UTILS_SIMD_H
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define RAGE_SURFACE_SSE2
+#elif defined(__ARM_NEON) && !defined(__ARM_BIG_ENDIAN)
+#include <arm_neon.h>
+#define RAGE_SURFACE_NEON
+#endif
+
+#endif
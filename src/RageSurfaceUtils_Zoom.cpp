@@ -2,6 +2,7 @@
 #include "RageSurfaceUtils_Zoom.h"
 #include "RageSurface.h"
 #include "RageSurfaceUtils.h"
+#include "RageSurfaceUtils_SIMD.h"
 #include "RageUtil.h"
 
 #include <cmath>
@@ -80,8 +81,78 @@ static void InitVectors( std::vector<int> &s0, std::vector<int> &s1, std::vector
 	}
 }
 
+/* Halving in both dimensions is by far the most common case, since ImageCache
+ * and oversized textures both shrink by powers of two.  ZoomSurface then
+ * samples exactly the four source pixels under each destination pixel with
+ * weights of 1/2, so this is a box filter with the same rounding: floor the
+ * average of each pair of columns, and round the average of the two rows. */
+static inline uint8_t HalfAverage( uint8_t a, uint8_t b, uint8_t c, uint8_t d )
+{
+	const unsigned x0 = (unsigned(a) + b) >> 1;
+	const unsigned x1 = (unsigned(c) + d) >> 1;
+	return uint8_t( (x0 + x1 + 1) >> 1 );
+}
+
+static void ZoomSurfaceHalf( const RageSurface *src, RageSurface *dst )
+{
+	const int width = dst->w;
+	for( int y = 0; y < dst->h; y++ )
+	{
+		const uint8_t *row0 = src->pixels + src->pitch * (y*2);
+		const uint8_t *row1 = row0 + src->pitch;
+		uint8_t *dp = dst->pixels + dst->pitch * y;
+
+		int x = 0;
+#if defined(RAGE_SURFACE_SSE2)
+		const __m128i ones = _mm_set1_epi8( 1 );
+		for( ; x + 4 <= width; x += 4 )
+		{
+			const __m128i a0 = _mm_loadu_si128( (const __m128i *) (row0 + x*8) );
+			const __m128i b0 = _mm_loadu_si128( (const __m128i *) (row0 + x*8 + 16) );
+			const __m128i a1 = _mm_loadu_si128( (const __m128i *) (row1 + x*8) );
+			const __m128i b1 = _mm_loadu_si128( (const __m128i *) (row1 + x*8 + 16) );
+
+			// Split each row into even and odd pixels.
+			const __m128 fa0 = _mm_castsi128_ps(a0), fb0 = _mm_castsi128_ps(b0);
+			const __m128 fa1 = _mm_castsi128_ps(a1), fb1 = _mm_castsi128_ps(b1);
+			const __m128i even0 = _mm_castps_si128( _mm_shuffle_ps(fa0, fb0, _MM_SHUFFLE(2,0,2,0)) );
+			const __m128i odd0 = _mm_castps_si128( _mm_shuffle_ps(fa0, fb0, _MM_SHUFFLE(3,1,3,1)) );
+			const __m128i even1 = _mm_castps_si128( _mm_shuffle_ps(fa1, fb1, _MM_SHUFFLE(2,0,2,0)) );
+			const __m128i odd1 = _mm_castps_si128( _mm_shuffle_ps(fa1, fb1, _MM_SHUFFLE(3,1,3,1)) );
+
+			// _mm_avg_epu8 rounds up; subtract the carry to round down.
+			const __m128i x0 = _mm_sub_epi8( _mm_avg_epu8(even0, odd0), _mm_and_si128(_mm_xor_si128(even0, odd0), ones) );
+			const __m128i x1 = _mm_sub_epi8( _mm_avg_epu8(even1, odd1), _mm_and_si128(_mm_xor_si128(even1, odd1), ones) );
+			_mm_storeu_si128( (__m128i *) (dp + x*4), _mm_avg_epu8(x0, x1) );
+		}
+#elif defined(RAGE_SURFACE_NEON)
+		for( ; x + 4 <= width; x += 4 )
+		{
+			const uint32x4x2_t r0 = vld2q_u32( (const uint32_t *) (row0 + x*8) );
+			const uint32x4x2_t r1 = vld2q_u32( (const uint32_t *) (row1 + x*8) );
+			const uint8x16_t x0 = vhaddq_u8( vreinterpretq_u8_u32(r0.val[0]), vreinterpretq_u8_u32(r0.val[1]) );
+			const uint8x16_t x1 = vhaddq_u8( vreinterpretq_u8_u32(r1.val[0]), vreinterpretq_u8_u32(r1.val[1]) );
+			vst1q_u8( dp + x*4, vrhaddq_u8(x0, x1) );
+		}
+#endif
+		for( ; x < width; x++ )
+		{
+			const uint8_t *c00 = row0 + x*8, *c01 = c00 + 4;
+			const uint8_t *c10 = row1 + x*8, *c11 = c10 + 4;
+			for( int c = 0; c < 4; ++c )
+				dp[x*4+c] = HalfAverage( c00[c], c01[c], c10[c], c11[c] );
+		}
+	}
+}
+
 static void ZoomSurface( const RageSurface * src, RageSurface * dst )
 {
+	if( src->w == dst->w*2 && src->h == dst->h*2 )
+	{
+		ZoomSurfaceHalf( src, dst );
+		return;
+	}
+
 	/* For each destination coordinate, two source rows, two source columns
 	 * and the percentage of the first row and first column: */
 	std::vector<int> esx0, esx1, esy0, esy1;
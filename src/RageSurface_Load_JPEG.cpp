@@ -107,7 +107,7 @@ void RageFile_JPEG_term_source( j_decompress_ptr cinfo )
 {
 }
 
-static RageSurface *RageSurface_Load_JPEG( RageFile *f, const char *fn, char errorbuf[JMSG_LENGTH_MAX] )
+static RageSurface *RageSurface_Load_JPEG( RageFile *f, const char *fn, char errorbuf[JMSG_LENGTH_MAX], bool bHeaderOnly )
 {
 	struct jpeg_decompress_struct cinfo;
 
@@ -161,6 +161,15 @@ static RageSurface *RageSurface_Load_JPEG( RageFile *f, const char *fn, char err
 		break;
 	}
 
+	/* As PNG: if bHeaderOnly is true, return an empty surface with only the
+	 * width and height set. */
+	if( bHeaderOnly )
+	{
+		img = CreateSurfaceFrom( cinfo.image_width, cinfo.image_height, 32, 0, 0, 0, 0, nullptr, cinfo.image_width*4 );
+		jpeg_destroy_decompress( &cinfo );
+		return img;
+	}
+
 	jpeg_start_decompress( &cinfo );
 
 	if( cinfo.out_color_space == JCS_GRAYSCALE )
@@ -206,7 +215,7 @@ RageSurfaceUtils::OpenResult RageSurface_Load_JPEG( const RString &sPath, RageSu
 	}
 
 	char errorbuf[1024];
-	ret = RageSurface_Load_JPEG( &f, sPath.c_str(), errorbuf );
+	ret = RageSurface_Load_JPEG( &f, sPath.c_str(), errorbuf, bHeaderOnly );
 	if( ret == nullptr )
 	{
 		error = errorbuf;
@@ -13,7 +13,8 @@ RageTexture::RageTexture( RageTextureID name ):
 	m_iSourceWidth(0), m_iSourceHeight(0),
 	m_iTextureWidth(0), m_iTextureHeight(0),
 	m_iImageWidth(0), m_iImageHeight(0),
-	m_iFramesWide(1), m_iFramesHigh(1) {}
+	m_iFramesWide(1), m_iFramesHigh(1),
+	m_bInAtlas(false), m_AtlasRect(0, 0, 1, 1) {}
 
 
 RageTexture::~RageTexture()
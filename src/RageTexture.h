@@ -28,6 +28,18 @@ public:
 	virtual bool IsAMovie() const { return false; }
 	virtual void SetLooping(bool) { }
 
+	/* True while the image is still being decoded in the background; the
+	 * texture is blank and 1x1 until then. */
+	virtual bool IsLoadPending() const { return false; }
+
+	/* If the texture shares a page in a RageTextureAtlas, GetTexHandle() is
+	 * the page, and texture coordinates need to be mapped into GetAtlasRect().
+	 * Coordinates outside [0,1] (wrapping) can't be mapped; RemoveFromAtlas
+	 * gives the texture a page of its own. */
+	bool IsInAtlas() const { return m_bInAtlas; }
+	const RectF &GetAtlasRect() const { return m_AtlasRect; }
+	virtual void RemoveFromAtlas() { }
+
 	int GetSourceWidth() const	{return m_iSourceWidth;}
 	int GetSourceHeight() const {return m_iSourceHeight;}
 	int GetTextureWidth() const {return m_iTextureWidth;}
@@ -82,6 +94,8 @@ protected:
 	int		m_iImageWidth,		m_iImageHeight;		// dimensions of the image in the texture
 	int		m_iFramesWide,		m_iFramesHigh;		// The number of frames of animation in each row and column of this texture
 	std::vector<RectF>	m_TextureCoordRects;	// size = m_iFramesWide * m_iFramesHigh
+	bool	m_bInAtlas;
+	RectF	m_AtlasRect;
 
 	virtual void CreateFrameRects();
 };
@@ -0,0 +1,251 @@
+#include "global.h"
+
+#include "RageTextureAtlas.h"
+#include "RageDisplay.h"
+#include "RageLog.h"
+#include "RageSurface.h"
+#include "RageSurfaceUtils.h"
+#include "RageUtil.h"
+
+#include <algorithm>
+#include <cstring>
+#include <vector>
+
+static std::vector<RageTextureAtlas *> g_vAtlases;
+
+/* The image is one pixel in from the top-left of its cell, and the gutter is
+ * one pixel on each side. */
+static const int GUTTER = 1;
+
+static RageSurface *CreateSubSurface( RageSurface *pSurface, int iX, int iY, int iWidth, int iHeight )
+{
+	const RageSurfaceFormat &fmt = pSurface->fmt;
+	uint8_t *pPixels = pSurface->pixels + iY*pSurface->pitch + iX*fmt.BytesPerPixel;
+	return CreateSurfaceFrom( iWidth, iHeight, fmt.BitsPerPixel,
+		fmt.Mask[0], fmt.Mask[1], fmt.Mask[2], fmt.Mask[3], pPixels, pSurface->pitch );
+}
+
+RageTextureAtlas::RageTextureAtlas( const RString &sName, int iPageSize, RagePixelFormat pixfmt ):
+	m_sName(sName), m_iPageSize(iPageSize), m_PixelFormat(pixfmt)
+{
+	g_vAtlases.push_back( this );
+}
+
+RageTextureAtlas::~RageTextureAtlas()
+{
+	for( unsigned i = 0; i < m_vPages.size(); ++i )
+		DeletePage( i );
+
+	auto it = std::find( g_vAtlases.begin(), g_vAtlases.end(), this );
+	ASSERT( it != g_vAtlases.end() );
+	g_vAtlases.erase( it );
+}
+
+RageTextureAtlas::Page *RageTextureAtlas::CreatePage( int iImageWidth, int iImageHeight )
+{
+	Page *pPage = new Page;
+	pPage->iCellWidth = iImageWidth + GUTTER*2;
+	pPage->iCellHeight = iImageHeight + GUTTER*2;
+	pPage->iCellsWide = m_iPageSize / pPage->iCellWidth;
+	pPage->iCellsHigh = m_iPageSize / pPage->iCellHeight;
+	pPage->vbCellUsed.resize( pPage->iCellsWide * pPage->iCellsHigh, false );
+	pPage->iNumUsed = 0;
+	pPage->uTexHandle = 0;
+
+	const RageDisplay::RagePixelFormatDesc *pfd = DISPLAY->GetPixelFormatDesc( m_PixelFormat );
+	pPage->pSurface = CreateSurface( m_iPageSize, m_iPageSize, pfd->bpp,
+		pfd->masks[0], pfd->masks[1], pfd->masks[2], pfd->masks[3] );
+	memset( pPage->pSurface->pixels, 0, pPage->pSurface->pitch * pPage->pSurface->h );
+
+	auto it = std::find( m_vPages.begin(), m_vPages.end(), nullptr );
+	if( it != m_vPages.end() )
+		*it = pPage;
+	else
+		m_vPages.push_back( pPage );
+
+	LOG->Trace( "RageTextureAtlas(%s): new %ix%i page for %ix%i images (%i cells)",
+		m_sName.c_str(), m_iPageSize, m_iPageSize, iImageWidth, iImageHeight, int(pPage->vbCellUsed.size()) );
+	return pPage;
+}
+
+void RageTextureAtlas::DeletePage( int iPage )
+{
+	Page *pPage = m_vPages[iPage];
+	if( pPage == nullptr )
+		return;
+
+	if( pPage->uTexHandle )
+		DISPLAY->DeleteTexture( pPage->uTexHandle );
+	delete pPage->pSurface;
+	delete pPage;
+	m_vPages[iPage] = nullptr;
+}
+
+bool RageTextureAtlas::Add( const RageSurface *pImg, Slot &out )
+{
+	ASSERT( !out.IsValid() );
+
+	if( m_iPageSize > DISPLAY->GetMaxTextureSize() )
+		return false;
+
+	/* Sharing a page with only one other image doesn't save anything. */
+	const int iCellWidth = pImg->w + GUTTER*2, iCellHeight = pImg->h + GUTTER*2;
+	if( (m_iPageSize / iCellWidth) * (m_iPageSize / iCellHeight) < 4 )
+		return false;
+
+	int iPage = -1;
+	for( unsigned i = 0; i < m_vPages.size(); ++i )
+	{
+		const Page *p = m_vPages[i];
+		if( p == nullptr || p->iCellWidth != iCellWidth || p->iCellHeight != iCellHeight )
+			continue;
+		if( p->iNumUsed == int(p->vbCellUsed.size()) )
+			continue;
+		iPage = i;
+		break;
+	}
+
+	if( iPage == -1 )
+	{
+		Page *pNew = CreatePage( pImg->w, pImg->h );
+		iPage = std::find( m_vPages.begin(), m_vPages.end(), pNew ) - m_vPages.begin();
+	}
+
+	Page &page = *m_vPages[iPage];
+	int iCell = std::find( page.vbCellUsed.begin(), page.vbCellUsed.end(), false ) - page.vbCellUsed.begin();
+	ASSERT( iCell < int(page.vbCellUsed.size()) );
+	page.vbCellUsed[iCell] = true;
+	++page.iNumUsed;
+
+	const int iX = (iCell % page.iCellsWide) * page.iCellWidth;
+	const int iY = (iCell / page.iCellsWide) * page.iCellHeight;
+
+	/* Copy the image into the cell, converting to the page format. */
+	RageSurface *pDest = CreateSubSurface( page.pSurface, iX+GUTTER, iY+GUTTER, pImg->w, pImg->h );
+	RageSurfaceUtils::Blit( pImg, pDest );
+	delete pDest;
+
+	/* Fill in the gutter: left and right columns, then the top and bottom
+	 * rows (which also fills the corners). */
+	RageSurface *pSurf = page.pSurface;
+	const int iBPP = pSurf->fmt.BytesPerPixel;
+	for( int y = iY+GUTTER; y < iY+GUTTER+pImg->h; ++y )
+	{
+		uint8_t *pRow = pSurf->pixels + y*pSurf->pitch;
+		memcpy( pRow + iX*iBPP, pRow + (iX+GUTTER)*iBPP, iBPP );
+		memcpy( pRow + (iX+GUTTER+pImg->w)*iBPP, pRow + (iX+GUTTER+pImg->w-1)*iBPP, iBPP );
+	}
+	memcpy( pSurf->pixels + iY*pSurf->pitch + iX*iBPP,
+		pSurf->pixels + (iY+GUTTER)*pSurf->pitch + iX*iBPP, page.iCellWidth*iBPP );
+	memcpy( pSurf->pixels + (iY+GUTTER+pImg->h)*pSurf->pitch + iX*iBPP,
+		pSurf->pixels + (iY+GUTTER+pImg->h-1)*pSurf->pitch + iX*iBPP, page.iCellWidth*iBPP );
+
+	UploadCell( page, iCell );
+
+	out.iPage = iPage;
+	out.iCell = iCell;
+	return true;
+}
+
+void RageTextureAtlas::UploadCell( Page &page, int iCell )
+{
+	/* If the page has no texture yet (new, or lost with the rendering context),
+	 * upload all of it; this restores the other cells, too. */
+	if( page.uTexHandle == 0 )
+	{
+		page.uTexHandle = DISPLAY->CreateTexture( m_PixelFormat, page.pSurface, false );
+		return;
+	}
+
+	const int iX = (iCell % page.iCellsWide) * page.iCellWidth;
+	const int iY = (iCell / page.iCellsWide) * page.iCellHeight;
+	RageSurface *pCell = CreateSubSurface( page.pSurface, iX, iY, page.iCellWidth, page.iCellHeight );
+	DISPLAY->UpdateTexture( page.uTexHandle, pCell, iX, iY, page.iCellWidth, page.iCellHeight );
+	delete pCell;
+}
+
+void RageTextureAtlas::Remove( Slot &slot )
+{
+	if( !slot.IsValid() )
+		return;
+
+	Page *pPage = m_vPages[slot.iPage];
+	ASSERT( pPage != nullptr && pPage->vbCellUsed[slot.iCell] );
+	pPage->vbCellUsed[slot.iCell] = false;
+	--pPage->iNumUsed;
+
+	/* The stale pixels are left in place; nothing draws from a free cell. */
+	if( pPage->iNumUsed == 0 )
+		DeletePage( slot.iPage );
+
+	slot = Slot();
+}
+
+uintptr_t RageTextureAtlas::GetTexHandle( const Slot &slot ) const
+{
+	ASSERT( slot.IsValid() );
+	return m_vPages[slot.iPage]->uTexHandle;
+}
+
+RectF RageTextureAtlas::GetTextureRect( const Slot &slot ) const
+{
+	ASSERT( slot.IsValid() );
+	const Page &page = *m_vPages[slot.iPage];
+	const float fX = float( (slot.iCell % page.iCellsWide) * page.iCellWidth + GUTTER );
+	const float fY = float( (slot.iCell / page.iCellsWide) * page.iCellHeight + GUTTER );
+	const float fWidth = float( page.iCellWidth - GUTTER*2 );
+	const float fHeight = float( page.iCellHeight - GUTTER*2 );
+	const float fPageSize = float( m_iPageSize );
+	return RectF( fX / fPageSize, fY / fPageSize, (fX+fWidth) / fPageSize, (fY+fHeight) / fPageSize );
+}
+
+void RageTextureAtlas::Invalidate()
+{
+	for( Page *p : m_vPages )
+	{
+		if( p != nullptr )
+			p->uTexHandle = 0; /* don't delete it */
+	}
+}
+
+int RageTextureAtlas::GetNumPages() const
+{
+	return std::count_if( m_vPages.begin(), m_vPages.end(), []( const Page *p ) { return p != nullptr; } );
+}
+
+int RageTextureAtlas::GetNumUsedCells() const
+{
+	int iRet = 0;
+	for( const Page *p : m_vPages )
+	{
+		if( p != nullptr )
+			iRet += p->iNumUsed;
+	}
+	return iRet;
+}
+
+int RageTextureAtlas::GetNumCells() const
+{
+	int iRet = 0;
+	for( const Page *p : m_vPages )
+	{
+		if( p != nullptr )
+			iRet += p->vbCellUsed.size();
+	}
+	return iRet;
+}
+
+RString RageTextureAtlas::GetStats()
+{
+	int iPages = 0, iUsed = 0, iCells = 0;
+	for( const RageTextureAtlas *pAtlas : g_vAtlases )
+	{
+		iPages += pAtlas->GetNumPages();
+		iUsed += pAtlas->GetNumUsedCells();
+		iCells += pAtlas->GetNumCells();
+	}
+
+	if( iPages == 0 )
+		return RString();
+	return ssprintf( "%i atlas pages, %i%% used", iPages, iUsed * 100 / iCells );
+}
@@ -0,0 +1,78 @@
+/* RageTextureAtlas - Packs small images into shared texture pages. */
+
+#ifndef RAGE_TEXTURE_ATLAS_H
+#define RAGE_TEXTURE_ATLAS_H
+
+#include "RageTypes.h"
+#include "RageDisplay.h"
+
+#include <cstdint>
+#include <vector>
+
+struct RageSurface;
+
+/* Each page is a single texture divided into a grid of equally-sized cells,
+ * so a page only ever holds images of one size.  That fits what we put in
+ * here (ImageCache thumbnails are always power-of-two sized), and keeps
+ * allocation and freeing trivial.
+ *
+ * Every cell has a one pixel gutter around the image holding a copy of its
+ * edge pixels, so bilinear filtering doesn't pull in the neighboring image. */
+class RageTextureAtlas
+{
+public:
+	struct Slot
+	{
+		Slot(): iPage(-1), iCell(-1) { }
+		bool IsValid() const { return iPage != -1; }
+		int iPage, iCell;
+	};
+
+	RageTextureAtlas( const RString &sName, int iPageSize, RagePixelFormat pixfmt );
+	~RageTextureAtlas();
+
+	/* Copy pImg into a free cell, creating a page if needed.  Returns false if
+	 * the image is too large to share a page; the caller should give it a
+	 * texture of its own. */
+	bool Add( const RageSurface *pImg, Slot &out );
+	void Remove( Slot &slot );
+
+	uintptr_t GetTexHandle( const Slot &slot ) const;
+
+	// The area of the page covered by the image, in texture coordinates.
+	RectF GetTextureRect( const Slot &slot ) const;
+
+	/* Called when the rendering context has been lost; the CPU copies of each
+	 * page are kept, and the textures are recreated on the next Add. */
+	void Invalidate();
+
+	int GetNumPages() const;
+	int GetNumUsedCells() const;
+	int GetNumCells() const;
+
+	/* Page count and occupancy across every atlas, for the stats display.
+	 * Returns an empty string if no atlas has any pages. */
+	static RString GetStats();
+
+private:
+	struct Page
+	{
+		RageSurface *pSurface;
+		uintptr_t uTexHandle;
+		int iCellWidth, iCellHeight;	// including the gutter
+		int iCellsWide, iCellsHigh;
+		std::vector<bool> vbCellUsed;
+		int iNumUsed;
+	};
+
+	Page *CreatePage( int iImageWidth, int iImageHeight );
+	void DeletePage( int iPage );
+	void UploadCell( Page &page, int iCell );
+
+	RString m_sName;
+	int m_iPageSize;
+	RagePixelFormat m_PixelFormat;
+	std::vector<Page *> m_vPages;	// may contain nullptr for deleted pages
+};
+
+#endif
@@ -54,17 +54,23 @@ struct RageTextureID
 	 * a different policy. */
 	enum TexPolicy { TEX_VOLATILE, TEX_DEFAULT } Policy;
 
+	/* If true, and background texture loading is enabled, the image is decoded
+	 * in a worker thread and the texture is blank until it's ready.  Like
+	 * Policy, this is not considered for ordering/equality. */
+	bool bLoadInBackground;
+
 	void Init();
 
 	RageTextureID(): filename(RString()), iMaxSize(0), bMipMaps(false),
 		iAlphaBits(0), iGrayscaleBits(0), iColorDepth(0),
 		bDither(false), bStretch(false), bHotPinkColorKey(false),
-		AdditionalTextureHints(RString()), Policy(TEX_DEFAULT)  { Init(); }
+		AdditionalTextureHints(RString()), Policy(TEX_DEFAULT),
+		bLoadInBackground(false) { Init(); }
 	RageTextureID( const RString &fn ): filename(RString()), iMaxSize(0),
 		bMipMaps(false), iAlphaBits(0), iGrayscaleBits(0),
 		iColorDepth(0), bDither(false), bStretch(false),
 		bHotPinkColorKey(false), AdditionalTextureHints(RString()),
-		Policy(TEX_DEFAULT) { Init(); SetFilename(fn); }
+		Policy(TEX_DEFAULT), bLoadInBackground(false) { Init(); SetFilename(fn); }
 	void SetFilename( const RString &fn );
 };
 
@@ -83,6 +89,7 @@ inline bool operator==(RageTextureID const &lhs, RageTextureID const &rhs)
 		EQUAL(bHotPinkColorKey) &&
 		EQUAL(AdditionalTextureHints);
 		// EQUAL(Policy); // don't do this
+		// EQUAL(bLoadInBackground); // or this
 #undef EQUAL
 }
 
@@ -105,6 +112,7 @@ inline bool operator<(RageTextureID const &lhs, RageTextureID const &rhs)
   COMP(bHotPinkColorKey);
   COMP(AdditionalTextureHints);
   // COMP(Policy); // don't do this
+  // COMP(bLoadInBackground); // or this
 #undef COMP
   return false;
 }
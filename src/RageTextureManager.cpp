@@ -25,10 +25,16 @@
 #include "RageUtil.h"
 #include "RageLog.h"
 #include "RageDisplay.h"
+#include "RageThreads.h"
+#include "RageTimer.h"
+#include "RageProfiler.h"
 #include "ActorUtil.h"
 
+#include <algorithm>
 #include <cstdint>
+#include <deque>
 #include <map>
+#include <vector>
 
 RageTextureManager*		TEXTUREMAN		= nullptr; // global and accessible from anywhere in our program
 
@@ -39,9 +45,267 @@ namespace
 	std::map<RageTexture*, RageTextureID> m_texture_ids_by_pointer;
 };
 
+/* Decoding (loading, resizing and format conversion) of textures loaded with
+ * bLoadInBackground happens in these threads; the finished images are uploaded
+ * in the main thread by RageTextureManager::Update.  Prefetches are decoded
+ * here too, and kept until a texture is created with the same ID. */
+namespace
+{
+	const int NUM_DECODE_THREADS = 2;
+
+	/* Don't spend more than this much of a frame uploading finished textures.
+	 * At least one texture is always uploaded per frame. */
+	const float UPLOAD_SECONDS_PER_FRAME = 0.004f;
+
+	struct BackgroundLoadJob
+	{
+		/* nullptr for prefetches. */
+		RageBitmapTexture *pTexture;
+		/* Set if the texture was deleted, or the prefetch was dropped, while
+		 * it was being decoded. */
+		bool bCancelled;
+		RageTextureID ID;
+		RageBitmapTexture::DecodeCaps caps;
+		RageBitmapTexture::DecodedImage img;
+		RageTimer tmQueued;
+		float fWaitSeconds;
+		float fDecodeSeconds;
+	};
+
+	class BackgroundTextureLoader
+	{
+	public:
+		BackgroundTextureLoader();
+		~BackgroundTextureLoader();
+
+		void Queue( BackgroundLoadJob *pJob );
+		void Cancel( RageBitmapTexture *pTexture );
+
+		/* Return the oldest finished job, or nullptr.  The caller owns it. */
+		BackgroundLoadJob *GetFinishedJob();
+
+		bool HasPrefetch( const RageTextureID &ID );
+
+		/* Return the finished prefetch for ID, waiting for it if it's being
+		 * decoded right now, or nullptr if there isn't one.  A prefetch that
+		 * hasn't started is dropped, since the caller can decode it just as
+		 * quickly itself.  The caller owns the result. */
+		BackgroundLoadJob *TakePrefetch( const RageTextureID &ID );
+		void CancelPrefetches();
+
+	private:
+		static int DecodeThread_Start( void *p ) { ((BackgroundTextureLoader *) p)->DecodeThread(); return 0; }
+		void DecodeThread();
+
+		RageThread m_Threads[NUM_DECODE_THREADS];
+		RageSemaphore m_WorkSem;
+
+		/* Lock before accessing any of the job lists.  Don't keep this locked
+		 * while decoding.  Signalled whenever a decode finishes. */
+		RageEvent m_Mutex;
+		std::deque<BackgroundLoadJob *> m_Queued;
+		std::vector<BackgroundLoadJob *> m_Decoding;
+		std::deque<BackgroundLoadJob *> m_Finished;
+		std::vector<BackgroundLoadJob *> m_Prefetched;
+		bool m_bShutdown;
+	};
+
+	BackgroundTextureLoader *g_pBackgroundLoader = nullptr;
+
+	void DeleteJob( BackgroundLoadJob *pJob )
+	{
+		RageUtil::SafeDelete( pJob->img.pImg );
+		delete pJob;
+	}
+}
+
+BackgroundTextureLoader::BackgroundTextureLoader():
+	m_WorkSem( "BackgroundTextureLoaderSem" ),
+	m_Mutex( "BackgroundTextureLoaderMutex" ),
+	m_bShutdown( false )
+{
+	for( int i = 0; i < NUM_DECODE_THREADS; ++i )
+	{
+		m_Threads[i].SetName( ssprintf("Texture decode %i", i) );
+		m_Threads[i].Create( DecodeThread_Start, this );
+	}
+}
+
+BackgroundTextureLoader::~BackgroundTextureLoader()
+{
+	m_Mutex.Lock();
+	m_bShutdown = true;
+	m_Mutex.Unlock();
+
+	for( int i = 0; i < NUM_DECODE_THREADS; ++i )
+		m_WorkSem.Post();
+	for( int i = 0; i < NUM_DECODE_THREADS; ++i )
+		m_Threads[i].Wait();
+
+	for( BackgroundLoadJob *pJob : m_Queued )
+		DeleteJob( pJob );
+	for( BackgroundLoadJob *pJob : m_Finished )
+		DeleteJob( pJob );
+	for( BackgroundLoadJob *pJob : m_Prefetched )
+		DeleteJob( pJob );
+	ASSERT( m_Decoding.empty() );
+}
+
+void BackgroundTextureLoader::Queue( BackgroundLoadJob *pJob )
+{
+	LockMut( m_Mutex );
+	m_Queued.push_back( pJob );
+	m_WorkSem.Post();
+}
+
+void BackgroundTextureLoader::Cancel( RageBitmapTexture *pTexture )
+{
+	LockMut( m_Mutex );
+
+	for( std::deque<BackgroundLoadJob *>::iterator it = m_Queued.begin(); it != m_Queued.end(); ++it )
+	{
+		if( (*it)->pTexture != pTexture )
+			continue;
+		DeleteJob( *it );
+		m_Queued.erase( it );
+		return;
+	}
+
+	for( std::deque<BackgroundLoadJob *>::iterator it = m_Finished.begin(); it != m_Finished.end(); ++it )
+	{
+		if( (*it)->pTexture != pTexture )
+			continue;
+		DeleteJob( *it );
+		m_Finished.erase( it );
+		return;
+	}
+
+	/* If it's being decoded right now, let the decode thread throw it away. */
+	for( BackgroundLoadJob *pJob : m_Decoding )
+	{
+		if( pJob->pTexture == pTexture )
+			pJob->bCancelled = true;
+	}
+}
+
+BackgroundLoadJob *BackgroundTextureLoader::GetFinishedJob()
+{
+	LockMut( m_Mutex );
+	if( m_Finished.empty() )
+		return nullptr;
+
+	BackgroundLoadJob *pJob = m_Finished.front();
+	m_Finished.pop_front();
+	return pJob;
+}
+
+namespace
+{
+	template<class C>
+	typename C::iterator FindPrefetch( C &jobs, const RageTextureID &ID )
+	{
+		return std::find_if( jobs.begin(), jobs.end(), [&]( const BackgroundLoadJob *pJob ) {
+			return pJob->pTexture == nullptr && !pJob->bCancelled && pJob->ID == ID;
+		} );
+	}
+}
+
+bool BackgroundTextureLoader::HasPrefetch( const RageTextureID &ID )
+{
+	LockMut( m_Mutex );
+	return FindPrefetch( m_Queued, ID ) != m_Queued.end() ||
+		FindPrefetch( m_Decoding, ID ) != m_Decoding.end() ||
+		FindPrefetch( m_Prefetched, ID ) != m_Prefetched.end();
+}
+
+BackgroundLoadJob *BackgroundTextureLoader::TakePrefetch( const RageTextureID &ID )
+{
+	LockMut( m_Mutex );
+
+	auto queued = FindPrefetch( m_Queued, ID );
+	if( queued != m_Queued.end() )
+	{
+		DeleteJob( *queued );
+		m_Queued.erase( queued );
+		return nullptr;
+	}
+
+	while( FindPrefetch(m_Decoding, ID) != m_Decoding.end() )
+		m_Mutex.Wait();
+
+	auto finished = FindPrefetch( m_Prefetched, ID );
+	if( finished == m_Prefetched.end() )
+		return nullptr;
+	BackgroundLoadJob *pJob = *finished;
+	m_Prefetched.erase( finished );
+	return pJob;
+}
+
+void BackgroundTextureLoader::CancelPrefetches()
+{
+	LockMut( m_Mutex );
+
+	for( auto it = m_Queued.begin(); it != m_Queued.end(); )
+	{
+		if( (*it)->pTexture != nullptr )
+		{
+			++it;
+			continue;
+		}
+		DeleteJob( *it );
+		it = m_Queued.erase( it );
+	}
+
+	for( BackgroundLoadJob *pJob : m_Decoding )
+	{
+		if( pJob->pTexture == nullptr )
+			pJob->bCancelled = true;
+	}
+
+	for( BackgroundLoadJob *pJob : m_Prefetched )
+		DeleteJob( pJob );
+	m_Prefetched.clear();
+}
+
+void BackgroundTextureLoader::DecodeThread()
+{
+	while( true )
+	{
+		/* It's normal for this to wait for a long time; don't fail on timeout. */
+		m_WorkSem.Wait( false );
+
+		BackgroundLoadJob *pJob;
+		{
+			LockMut( m_Mutex );
+			if( m_bShutdown )
+				return;
+			if( m_Queued.empty() )
+				continue;
+			pJob = m_Queued.front();
+			m_Queued.pop_front();
+			m_Decoding.push_back( pJob );
+		}
+
+		pJob->fWaitSeconds = pJob->tmQueued.Ago();
+		RageBitmapTexture::Decode( pJob->ID, pJob->caps, nullptr, pJob->img );
+		pJob->fDecodeSeconds = pJob->tmQueued.Ago() - pJob->fWaitSeconds;
+
+		LockMut( m_Mutex );
+		m_Decoding.erase( std::find(m_Decoding.begin(), m_Decoding.end(), pJob) );
+		if( pJob->bCancelled )
+			DeleteJob( pJob );
+		else if( pJob->pTexture == nullptr )
+			m_Prefetched.push_back( pJob );
+		else
+			m_Finished.push_back( pJob );
+		m_Mutex.Broadcast();
+	}
+}
+
 RageTextureManager::RageTextureManager():
 	m_iNoWarnAboutOddDimensions(0),
-	m_TexturePolicy(RageTextureID::TEX_DEFAULT) {}
+	m_TexturePolicy(RageTextureID::TEX_DEFAULT),
+	m_pLoadRecord(nullptr) {}
 
 RageTextureManager::~RageTextureManager()
 {
@@ -54,10 +318,19 @@ RageTextureManager::~RageTextureManager()
 	}
 	m_textures_to_update.clear();
 	m_texture_ids_by_pointer.clear();
+
+	// All textures are gone, so any remaining jobs are orphans.
+	RageUtil::SafeDelete( g_pBackgroundLoader );
+
+	LogDiskCacheStats();
 }
 
 void RageTextureManager::Update( float fDeltaTime )
 {
+	PROFILE_SCOPE( "RageTextureManager::Update" );
+
+	FinishBackgroundLoads();
+
 	for(std::pair<RageTextureID const &, RageTexture *> i : m_textures_to_update)
 	{
 		RageTexture* pTexture = i.second;
@@ -146,6 +419,9 @@ RageTexture* RageTextureManager::LoadTextureInternal( RageTextureID ID )
 
 	AdjustTextureID(ID);
 
+	if( m_pLoadRecord != nullptr )
+		m_pLoadRecord->insert( ID );
+
 	/* We could have two copies of the same bitmap if there are equivalent but
 	 * different paths, e.g. "Bitmaps\me.bmp" and "..\Rage PC Edition\Bitmaps\me.bmp". */
 	std::map<RageTextureID, RageTexture*>::iterator p = m_mapPathToTexture.find(ID);
@@ -170,7 +446,7 @@ RageTexture* RageTextureManager::LoadTextureInternal( RageTextureID ID )
 	}
 	else
 	{
-		pTexture = new RageBitmapTexture( ID );
+		pTexture = new RageBitmapTexture( ID, ID.bLoadInBackground && m_Prefs.m_bBackgroundLoading );
 	}
 
 	m_mapPathToTexture[ID] = pTexture;
@@ -182,6 +458,8 @@ RageTexture* RageTextureManager::LoadTextureInternal( RageTextureID ID )
 /* Load a normal texture.  Use this call to actually use a texture. */
 RageTexture* RageTextureManager::LoadTexture( RageTextureID ID )
 {
+	PROFILE_SCOPE( "RageTextureManager::LoadTexture" );
+
 	RageTexture* pTexture = LoadTextureInternal( ID );
 	if( pTexture )
 		pTexture->m_bWasUsed = true;
@@ -351,10 +629,146 @@ bool RageTextureManager::SetPrefs( RageTextureManagerPrefs prefs )
 	return bNeedReload;
 }
 
+void RageTextureManager::QueueBackgroundLoad( RageBitmapTexture *pTexture )
+{
+	if( g_pBackgroundLoader == nullptr )
+		g_pBackgroundLoader = new BackgroundTextureLoader;
+
+	BackgroundLoadJob *pJob = new BackgroundLoadJob;
+	pJob->pTexture = pTexture;
+	pJob->bCancelled = false;
+	pJob->ID = pTexture->GetID();
+	pJob->caps.Capture();
+	pJob->fWaitSeconds = pJob->fDecodeSeconds = 0;
+	g_pBackgroundLoader->Queue( pJob );
+}
+
+void RageTextureManager::CancelBackgroundLoad( RageBitmapTexture *pTexture )
+{
+	if( g_pBackgroundLoader != nullptr )
+		g_pBackgroundLoader->Cancel( pTexture );
+}
+
+void RageTextureManager::FinishBackgroundLoads()
+{
+	if( g_pBackgroundLoader == nullptr )
+		return;
+
+	RageTimer tmFrame;
+	while( tmFrame.Ago() < UPLOAD_SECONDS_PER_FRAME )
+	{
+		BackgroundLoadJob *pJob = g_pBackgroundLoader->GetFinishedJob();
+		if( pJob == nullptr )
+			break;
+
+		RageTimer tmUpload;
+		pJob->pTexture->FinishBackgroundLoad( pJob->img );
+		LOG->Trace( "Loaded texture \"%s\" in the background: %.1fms total; waited %.1fms, decoded in %.1fms, uploaded in %.1fms.",
+			pJob->ID.filename.c_str(), pJob->tmQueued.Ago() * 1000,
+			pJob->fWaitSeconds * 1000, pJob->fDecodeSeconds * 1000, tmUpload.Ago() * 1000 );
+		DeleteJob( pJob );
+	}
+}
+
+void RageTextureManager::PrefetchTexture( RageTextureID ID )
+{
+	AdjustTextureID( ID );
+
+	/* Only bitmaps that will be decoded in the main thread are worth it.
+	 * Textures loaded in the background are already decoded here. */
+	if( m_mapPathToTexture.find(ID) != m_mapPathToTexture.end() )
+		return;
+	if( ID.filename == g_sDefaultTextureName || ID.filename == GetScreenTextureID().filename )
+		return;
+	if( ActorUtil::GetFileType(ID.filename) == FT_Movie )
+		return;
+	if( ID.bLoadInBackground && m_Prefs.m_bBackgroundLoading )
+		return;
+
+	if( g_pBackgroundLoader == nullptr )
+		g_pBackgroundLoader = new BackgroundTextureLoader;
+	if( g_pBackgroundLoader->HasPrefetch(ID) )
+		return;
+
+	BackgroundLoadJob *pJob = new BackgroundLoadJob;
+	pJob->pTexture = nullptr;
+	pJob->bCancelled = false;
+	pJob->ID = ID;
+	pJob->caps.Capture();
+	pJob->fWaitSeconds = pJob->fDecodeSeconds = 0;
+	g_pBackgroundLoader->Queue( pJob );
+}
+
+bool RageTextureManager::TakePrefetchedTexture( const RageTextureID &ID, const RageBitmapTexture::DecodeCaps &caps, RageBitmapTexture::DecodedImage &out )
+{
+	if( g_pBackgroundLoader == nullptr )
+		return false;
+
+	BackgroundLoadJob *pJob = g_pBackgroundLoader->TakePrefetch( ID );
+	if( pJob == nullptr )
+		return false;
+
+	/* If the display changed since the prefetch, it was decoded for the
+	 * wrong settings. */
+	const bool bUsable = pJob->caps == caps;
+	if( bUsable )
+	{
+		out = pJob->img;
+		pJob->img.pImg = nullptr;
+	}
+	DeleteJob( pJob );
+	return bUsable;
+}
+
+void RageTextureManager::ClearPrefetchedTextures()
+{
+	if( g_pBackgroundLoader != nullptr )
+		g_pBackgroundLoader->CancelPrefetches();
+}
+
+void RageTextureManager::AddLoadTime( bool bPrefetched, float fDecodeSeconds, float fUploadSeconds )
+{
+	++m_LoadStats.iLoaded;
+	if( bPrefetched )
+		++m_LoadStats.iPrefetched;
+	m_LoadStats.fDecodeSeconds += fDecodeSeconds;
+	m_LoadStats.fUploadSeconds += fUploadSeconds;
+}
+
+int RageTextureManager::GetNumPendingTextures() const
+{
+	int iPending = 0;
+	for( auto const &i : m_mapPathToTexture )
+	{
+		if( i.second->IsLoadPending() )
+			++iPending;
+	}
+	return iPending;
+}
+
+int RageTextureManager::GetNumResidentTextures() const
+{
+	return (int) m_mapPathToTexture.size() - GetNumPendingTextures();
+}
+
+void RageTextureManager::LogDiskCacheStats() const
+{
+	int iHits, iMisses;
+	float fHitSeconds, fMissSeconds;
+	RageBitmapTexture::GetDiskCacheStats( iHits, fHitSeconds, iMisses, fMissSeconds );
+	if( iHits + iMisses == 0 )
+		return;
+
+	LOG->Trace( "Texture disk cache: %i hits in %.0fms (%.2fms each), %i misses in %.0fms (%.2fms each).",
+		iHits, fHitSeconds * 1000, iHits? fHitSeconds * 1000 / iHits : 0.0f,
+		iMisses, fMissSeconds * 1000, iMisses? fMissSeconds * 1000 / iMisses : 0.0f );
+}
+
 void RageTextureManager::DiagnosticOutput() const
 {
 	unsigned iCount = distance( m_mapPathToTexture.begin(), m_mapPathToTexture.end() );
-	LOG->Trace( "%u textures loaded:", iCount );
+	LOG->Trace( "%u textures loaded (%i resident, %i pending):", iCount,
+		GetNumResidentTextures(), GetNumPendingTextures() );
 
 	int iTotal = 0;
 	for (auto const &i : m_mapPathToTexture)
@@ -365,6 +779,8 @@ void RageTextureManager::DiagnosticOutput() const
 		RString sDiags = DISPLAY->GetTextureDiagnostics( pTex->GetTexHandle() );
 		RString sStr = ssprintf( "%3ix%3i (%2i)", pTex->GetTextureHeight(), pTex->GetTextureWidth(),
 			pTex->m_iRefCount );
+		if( pTex->IsLoadPending() )
+			sStr += " pending";
 
 		if( sDiags != "" )
 			sStr += " " + sDiags;
@@ -373,6 +789,7 @@ void RageTextureManager::DiagnosticOutput() const
 		iTotal += pTex->GetTextureHeight() * pTex->GetTextureWidth();
 	}
 	LOG->Trace( "total %3i texels", iTotal );
+	LogDiskCacheStats();
 }
 
 /*
@@ -5,6 +5,9 @@
 
 #include "RageTexture.h"
 #include "RageSurface.h"
+#include "RageBitmapTexture.h"
+
+#include <set>
 
 struct RageTextureManagerPrefs
 {
@@ -14,24 +17,31 @@ struct RageTextureManagerPrefs
 	int m_iMaxTextureResolution;
 	bool m_bHighResolutionTextures;
 	bool m_bMipMaps;
+	bool m_bBackgroundLoading;
+	bool m_bDiskCache;
 	
 	RageTextureManagerPrefs(): m_iTextureColorDepth(16),
 		m_iMovieColorDepth(16), m_bDelayedDelete(false),
 		m_iMaxTextureResolution(1024),
-		m_bHighResolutionTextures(true), m_bMipMaps(false) {}
+		m_bHighResolutionTextures(true), m_bMipMaps(false),
+		m_bBackgroundLoading(false), m_bDiskCache(false) {}
 	RageTextureManagerPrefs( 
 		int iTextureColorDepth,
 		int iMovieColorDepth,
 		bool bDelayedDelete,
 		int iMaxTextureResolution,
 		bool bHighResolutionTextures,
-		bool bMipMaps ):
+		bool bMipMaps,
+		bool bBackgroundLoading,
+		bool bDiskCache ):
 		m_iTextureColorDepth(iTextureColorDepth),
 		m_iMovieColorDepth(iMovieColorDepth),
 		m_bDelayedDelete(bDelayedDelete),
 		m_iMaxTextureResolution(iMaxTextureResolution),
 		m_bHighResolutionTextures(bHighResolutionTextures),
-		m_bMipMaps(bMipMaps) {}
+		m_bMipMaps(bMipMaps),
+		m_bBackgroundLoading(bBackgroundLoading),
+		m_bDiskCache(bDiskCache) {}
 
 	bool operator!=( const RageTextureManagerPrefs& rhs ) const
 	{
@@ -42,6 +52,7 @@ struct RageTextureManagerPrefs
 			m_iMaxTextureResolution != rhs.m_iMaxTextureResolution ||
 			m_bHighResolutionTextures != rhs.m_bHighResolutionTextures ||
 			m_bMipMaps != rhs.m_bMipMaps;
+		// m_bBackgroundLoading and m_bDiskCache don't require reloading textures.
 	}
 };
 
@@ -87,15 +98,49 @@ public:
 	RageTextureID GetScreenTextureID();
 	RageSurface* GetScreenSurface();
 
+	/* Background loading, used by RageBitmapTexture.  Decoded textures are
+	 * uploaded in Update(). */
+	void QueueBackgroundLoad( RageBitmapTexture *pTexture );
+	void CancelBackgroundLoad( RageBitmapTexture *pTexture );
+
+	// Textures still decoding in the background, and textures ready to draw.
+	int GetNumPendingTextures() const;
+	int GetNumResidentTextures() const;
+
+	/* Prefetching: decode an image in the background before anything asks for
+	 * it, so loading it later only has to upload it.  Prefetched images that
+	 * haven't been used by ClearPrefetchedTextures() are thrown away. */
+	void PrefetchTexture( RageTextureID ID );
+	bool TakePrefetchedTexture( const RageTextureID &ID, const RageBitmapTexture::DecodeCaps &caps, RageBitmapTexture::DecodedImage &out );
+	void ClearPrefetchedTextures();
+
+	/* While set, the ID of every texture loaded is added to pRecord, so the
+	 * same textures can be prefetched next time. */
+	void SetLoadRecord( std::set<RageTextureID> *pRecord ) { m_pLoadRecord = pRecord; }
+	std::set<RageTextureID> *GetLoadRecord() const { return m_pLoadRecord; }
+
+	/* Time spent creating bitmap textures in the main thread. */
+	struct LoadStats
+	{
+		int iLoaded = 0, iPrefetched = 0;
+		float fDecodeSeconds = 0, fUploadSeconds = 0;
+	};
+	const LoadStats &GetLoadStats() const { return m_LoadStats; }
+	void AddLoadTime( bool bPrefetched, float fDecodeSeconds, float fUploadSeconds );
+
 private:
 	void DeleteTexture( RageTexture *t );
 	enum GCType { screen_changed, delayed_delete };
 	void GarbageCollect( GCType type );
 	RageTexture* LoadTextureInternal( RageTextureID ID );
+	void FinishBackgroundLoads();
+	void LogDiskCacheStats() const;
 
 	RageTextureManagerPrefs m_Prefs;
 	int m_iNoWarnAboutOddDimensions;
 	RageTextureID::TexPolicy m_TexturePolicy;
+	std::set<RageTextureID> *m_pLoadRecord;
+	LoadStats m_LoadStats;
 };
 
 extern RageTextureManager*	TEXTUREMAN;	// global and accessible from anywhere in our program
@@ -67,8 +67,23 @@ uint64_t RageTimer::GetTimeSinceStartMicroseconds()
 	return (GetTime() - g_iStartTime);
 }
 
+static thread_local const RageTimer *g_pThreadClock = nullptr;
+
+const RageTimer *RageTimer::SetThreadClock( const RageTimer *pClock )
+{
+	const RageTimer *pOld = g_pThreadClock;
+	g_pThreadClock = pClock;
+	return pOld;
+}
+
 void RageTimer::Touch()
 {
+	if( g_pThreadClock != nullptr )
+	{
+		*this = *g_pThreadClock;
+		return;
+	}
+
 	uint64_t usecs = GetTime();
 
 	this->m_secs = uint64_t(usecs / ONE_SECOND_IN_MICROSECONDS_ULL);
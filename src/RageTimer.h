@@ -25,6 +25,12 @@ public:
 	static int GetTimeSinceStartSeconds(); 	// This is used where GetTimeSinceStart would be cast to an int without rounding.
 	static uint64_t GetTimeSinceStartMicroseconds();
 
+	/* While set, RageTimers touched on this thread read *pClock as the current
+	 * time, so replays can run gameplay on recorded time.  GetTimeSinceStart()
+	 * is unaffected.  Pass nullptr to go back to the system clock.  Returns the
+	 * previous setting. */
+	static const RageTimer *SetThreadClock( const RageTimer *pClock );
+
 	/* Get a timer representing half of the time ago as this one. */
 	RageTimer Half() const;
 
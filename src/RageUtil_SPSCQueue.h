@@ -0,0 +1,67 @@
+/* SPSCQueue - A fixed-size, lock-free queue of elements, for one producer and one consumer. */
+
+#ifndef RAGE_UTIL_SPSC_QUEUE_H
+#define RAGE_UTIL_SPSC_QUEUE_H
+
+#include <atomic>
+#include <vector>
+
+/* One thread may push and one other thread may pop, without locking.  Unlike
+ * CircBuf, the element copy is ordered against the index update, so this is
+ * safe on weakly-ordered CPUs.  Elements are preallocated; push never
+ * allocates, and fails if the queue is full. */
+template<class T>
+class SPSCQueue
+{
+public:
+	explicit SPSCQueue( unsigned iCapacity ):
+		m_vBuf( iCapacity+1 ), m_iRead(0), m_iWrite(0) { }
+
+	unsigned capacity() const { return m_vBuf.size() - 1; }
+
+	/* Producer: */
+	bool push( const T &t )
+	{
+		const unsigned iWrite = m_iWrite.load( std::memory_order_relaxed );
+		const unsigned iNext = Next( iWrite );
+		if( iNext == m_iRead.load(std::memory_order_acquire) )
+			return false;
+		m_vBuf[iWrite] = t;
+		m_iWrite.store( iNext, std::memory_order_release );
+		return true;
+	}
+	bool full() const
+	{
+		return Next( m_iWrite.load(std::memory_order_relaxed) ) == m_iRead.load( std::memory_order_acquire );
+	}
+
+	/* Consumer: */
+	bool pop( T &out )
+	{
+		const unsigned iRead = m_iRead.load( std::memory_order_relaxed );
+		if( iRead == m_iWrite.load(std::memory_order_acquire) )
+			return false;
+		out = m_vBuf[iRead];
+		m_iRead.store( Next(iRead), std::memory_order_release );
+		return true;
+	}
+	bool empty() const
+	{
+		return m_iRead.load( std::memory_order_relaxed ) == m_iWrite.load( std::memory_order_acquire );
+	}
+
+private:
+	unsigned Next( unsigned i ) const { return i+1 == m_vBuf.size()? 0:i+1; }
+
+	std::vector<T> m_vBuf;
+
+	/* Keep the indexes on separate cache lines, so the two threads don't
+	 * fight over one. */
+	alignas(64) std::atomic<unsigned> m_iRead;
+	alignas(64) std::atomic<unsigned> m_iWrite;
+
+	SPSCQueue( const SPSCQueue &rhs );
+	SPSCQueue &operator=( const SPSCQueue &rhs );
+};
+
+#endif
@@ -412,7 +412,7 @@ void ScoreKeeperNormal::HandleTapScore( const TapNote &tn )
 		Message msg( "ScoreChanged" );
 		msg.SetParam( "PlayerNumber", m_pPlayerState->m_PlayerNumber );
 		msg.SetParam( "MultiPlayer", m_pPlayerState->m_mp );
-		MESSAGEMAN->Broadcast( msg );
+		MESSAGEMAN->BroadcastDeferred( msg, this );
 	}
 
 	AddTapScore( tns );
@@ -604,7 +604,7 @@ void ScoreKeeperNormal::HandleTapRowScore( const NoteData &nd, int iRow )
 	msg.SetParam( "PlayerNumber", m_pPlayerState->m_PlayerNumber );
 	msg.SetParam( "MultiPlayer", m_pPlayerState->m_mp );
 	msg.SetParam( "ToastyCombo", m_cur_toasty_combo );
-	MESSAGEMAN->Broadcast( msg );
+	MESSAGEMAN->BroadcastDeferred( msg, this );
 }
 
 
@@ -626,7 +626,7 @@ void ScoreKeeperNormal::HandleHoldScore( const TapNote &tn )
 	Message msg( "ScoreChanged" );
 	msg.SetParam( "PlayerNumber", m_pPlayerState->m_PlayerNumber );
 	msg.SetParam( "MultiPlayer", m_pPlayerState->m_mp );
-	MESSAGEMAN->Broadcast( msg );
+	MESSAGEMAN->BroadcastDeferred( msg, this );
 }
 
 
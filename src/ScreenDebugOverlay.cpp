@@ -26,6 +26,7 @@
 #include "Profile.h"
 #include "SongManager.h"
 #include "GameLoop.h"
+#include "RageProfiler.h"
 #include "Song.h"
 #include "ScreenSyncOverlay.h"
 #include "ThemeMetric.h"
@@ -606,6 +607,8 @@ static LocalizedString WRITE_PROFILES	( "ScreenDebugOverlay", "Write Profiles" )
 static LocalizedString WRITE_PREFERENCES	( "ScreenDebugOverlay", "Write Preferences" );
 static LocalizedString MENU_TIMER		( "ScreenDebugOverlay", "Menu Timer" );
 static LocalizedString FLUSH_LOG		( "ScreenDebugOverlay", "Flush Log" );
+static LocalizedString FRAME_PROFILER	( "ScreenDebugOverlay", "Frame Profiler" );
+static LocalizedString WRITE_FRAME_PROFILE	( "ScreenDebugOverlay", "Write Frame Profile" );
 static LocalizedString PULL_BACK_CAMERA	( "ScreenDebugOverlay", "Pull Back Camera" );
 static LocalizedString VISUAL_DELAY_UP		( "ScreenDebugOverlay", "Visual Delay Up" );
 static LocalizedString VISUAL_DELAY_DOWN	( "ScreenDebugOverlay", "Visual Delay Down" );
@@ -1247,6 +1250,29 @@ class DebugLineFlushLog : public IDebugLine
 	}
 };
 
+class DebugLineFrameProfiler : public IDebugLine
+{
+	virtual RString GetDisplayTitle() { return FRAME_PROFILER.GetValue(); }
+	virtual bool IsEnabled() { return RageProfiler::IsEnabled(); }
+	virtual void DoAndLog( RString &sMessageOut )
+	{
+		RageProfiler::SetEnabled( !RageProfiler::IsEnabled() );
+		IDebugLine::DoAndLog( sMessageOut );
+	}
+};
+
+class DebugLineWriteFrameProfile : public IDebugLine
+{
+	virtual RString GetDisplayTitle() { return WRITE_FRAME_PROFILE.GetValue(); }
+	virtual RString GetDisplayValue() { return RString(); }
+	virtual bool IsEnabled() { return RageProfiler::IsEnabled(); }
+	virtual void DoAndLog( RString &sMessageOut )
+	{
+		RageProfiler::WriteChromeTrace( "/Logs/profile.json" );
+		IDebugLine::DoAndLog( sMessageOut );
+	}
+};
+
 class DebugLinePullBackCamera : public IDebugLine
 {
 	virtual RString GetDisplayTitle() { return PULL_BACK_CAMERA.GetValue(); }
@@ -1410,6 +1436,8 @@ DECLARE_ONE( DebugLineWritePreferences );
 DECLARE_ONE(DebugLineReloadPreferences);
 DECLARE_ONE( DebugLineMenuTimer );
 DECLARE_ONE( DebugLineFlushLog );
+DECLARE_ONE( DebugLineFrameProfiler );
+DECLARE_ONE( DebugLineWriteFrameProfile );
 DECLARE_ONE( DebugLinePullBackCamera );
 DECLARE_ONE( DebugLineVolumeDown );
 DECLARE_ONE( DebugLineVolumeUp );
@@ -1481,6 +1481,8 @@ void ScreenEdit::Init()
 	this->originalPlayerOptions.FromString(ModsLevel_Stage, EDIT_MODIFIERS);
 
 	m_pSteps->GetNoteData( m_NoteDataEdit );
+	// The info pane counts the notes every time it's updated.
+	m_NoteDataEdit.SetCacheCounts( true );
 	m_NoteFieldEdit.SetXY( EDIT_X, EDIT_Y );
 	m_NoteFieldEdit.SetZoom( SCREEN_HEIGHT/480*0.5 );
 	m_NoteFieldEdit.Init( &m_PlayerStateEdit, PLAYER_HEIGHT*2, false );
@@ -58,6 +58,9 @@
 #include "SongUtil.h"
 #include "Song.h"
 #include "XmlFileUtil.h"
+#include "JudgmentThread.h"
+#include "GameplayReplay.h"
+#include "GameplayTelemetry.h"
 #include "Profile.h" // for replay data stuff
 #include "RageDisplay.h"
 #include "GameplayHelpers.h"
@@ -98,6 +101,7 @@ AutoScreenMessage( SM_BattleTrickLevel3 );
 static Preference<bool> g_bCenter1Player( "Center1Player", false );
 static Preference<bool> g_bShowLyrics( "ShowLyrics", true );
 static Preference<bool> g_bEasterEggs( "EasterEggs", true );
+static Preference<bool> g_bThreadedJudgment( "ThreadedJudgment", false );
 
 
 PlayerInfo::PlayerInfo(): m_pn(PLAYER_INVALID), m_mp(MultiPlayer_Invalid),
@@ -327,6 +331,9 @@ ScreenGameplay::ScreenGameplay()
 {
 	m_pSongBackground = nullptr;
 	m_pSongForeground = nullptr;
+	m_pJudgmentThread = nullptr;
+	m_pReplay = nullptr;
+	m_bMeasureSoundDrift = false;
 	m_delaying_ready_announce= false;
 	GAMESTATE->m_AdjustTokensBySongCostForFinalStageCheck= false;
 }
@@ -412,7 +419,7 @@ void ScreenGameplay::Init()
 	 * user doesn't have full control; saving would force profiles to Difficulty_Hard
 	 * and save over their default modifiers every time someone got an extra stage.
 	 * Do this before course modifiers are set up. */
-	if( !GAMESTATE->IsAnExtraStage() )
+	if( !GAMESTATE->IsAnExtraStage() && GameplayReplay::GetPlayback() == nullptr )
 	{
 		FOREACH_HumanPlayer( pn )
 			GAMESTATE->SaveCurrentSettingsToProfile(pn);
@@ -421,6 +428,19 @@ void ScreenGameplay::Init()
 	/* Called once per stage (single song or single course). */
 	GAMESTATE->BeginStage();
 
+	/* Replays are of a single song, stepped on by humans. */
+	if( GameplayReplay::GetPlayback() != nullptr )
+	{
+		m_pReplay = GameplayReplay::GetPlayback();
+		m_pReplay->ApplyStage();
+	}
+	else if( GAMESTATE->m_SongOptions.GetCurrent().m_bSaveReplay && !GAMESTATE->IsCourseMode() &&
+		!GAMESTATE->m_bMultiplayer && !GAMESTATE->m_bDemonstrationOrJukebox )
+	{
+		m_pReplay = new GameplayReplay;
+		m_pReplay->BeginRecording( m_sName );
+	}
+
 	int player = 1;
 	FOREACH_EnabledPlayerInfo( m_vPlayerInfo, pi )
 	{
@@ -479,6 +499,13 @@ void ScreenGameplay::Init()
 		STATSMAN->m_CurStageStats.m_multiPlayer[pn].m_pStyle= GAMESTATE->GetCurrentStyle(PLAYER_INVALID);
 	}
 
+	/* Replays compare every life record, not the downsampled ones. */
+	if( m_pReplay != nullptr )
+	{
+		FOREACH_EnabledPlayerInfoNotDummy( m_vPlayerInfo, pi )
+			pi->GetPlayerStageStats()->m_LifeRecord.SetKeepSamples( true );
+	}
+
 	/* Record combo rollover. */
 	FOREACH_EnabledPlayerInfoNotDummy( m_vPlayerInfo, pi )
 		pi->GetPlayerStageStats()->UpdateComboList( 0, true );
@@ -803,6 +830,8 @@ void ScreenGameplay::Init()
 			pi->m_pSecondaryScoreKeeper );
 	}
 
+	StartJudgmentThread();
+
 	// fill in m_apSongsQueue, m_vpStepsQueue, m_asModifiersQueue
 	InitSongQueues();
 
@@ -837,6 +866,50 @@ void ScreenGameplay::Init()
 	m_skipped_song= false;
 }
 
+/* Judge human players' steps on a thread of their own, as soon as they're
+ * reported, rather than once a frame. */
+void ScreenGameplay::StartJudgmentThread()
+{
+	/* Replays time steps by the update they arrive after, so judge them there. */
+	if( !g_bThreadedJudgment || GAMESTATE->m_bMultiplayer || GAMESTATE->m_bDemonstrationOrJukebox || m_pReplay != nullptr )
+		return;
+
+	// Find every button Input would pass to a Player's Step.
+	std::vector<JudgmentThread::StepButton> vButtons;
+	FOREACH_ENUM( GameController, gc )
+	{
+		FOREACH_GameButtonInScheme( INPUTMAPPER->GetInputScheme(), gb )
+		{
+			InputEventPlus input;
+			input.GameI = GameInput( gc, gb );
+			input.pn = INPUTMAPPER->ControllerToPlayerNumber( gc );
+			if( !GAMESTATE->IsHumanPlayer(input.pn) )
+				continue;
+			if( GAMESTATE->m_pCurGame->GetPerButtonInfo(gb)->m_gbt != GameButtonType_Step )
+				continue;
+			const int iCol = GAMESTATE->GetCurrentStyle(input.pn)->GameInputToColumn( input.GameI );
+			if( iCol == Column_Invalid )
+				continue;
+
+			const PlayerInfo &pi = GetPlayerInfoForInput( input );
+			for( int iSlot = 0; iSlot < NUM_GAME_TO_DEVICE_SLOTS; ++iSlot )
+			{
+				JudgmentThread::StepButton button;
+				if( !INPUTMAPPER->GameToDevice(input.GameI, iSlot, button.di) )
+					continue;
+				button.pn = pi.m_pn;
+				button.iCol = iCol;
+				vButtons.push_back( button );
+			}
+		}
+	}
+
+	m_pJudgmentThread = new JudgmentThread;
+	m_pJudgmentThread->Start( vButtons );
+	FOREACH_EnabledPlayerInfoNotDummy( m_vPlayerInfo, pi )
+		pi->m_pPlayer->SetJudgmentThread( m_pJudgmentThread );
+}
+
 bool ScreenGameplay::Center1Player() const
 {
 	/* Perhaps this should be handled better by defining a new
@@ -977,6 +1050,10 @@ ScreenGameplay::~ScreenGameplay()
 
 	LOG->Trace( "ScreenGameplay::~ScreenGameplay()" );
 
+	GameplayTelemetry::EndStage();
+	RageUtil::SafeDelete( m_pJudgmentThread );
+	if( m_pReplay != nullptr && !m_pReplay->IsPlayback() )
+		delete m_pReplay;
 	RageUtil::SafeDelete( m_pSongBackground );
 	RageUtil::SafeDelete( m_pSongForeground );
 
@@ -1110,6 +1187,7 @@ void ScreenGameplay::ReloadCurrentSong()
 void ScreenGameplay::LoadNextSong()
 {
 	GAMESTATE->ResetMusicStatistics();
+	m_bMeasureSoundDrift = false;
 
 	FOREACH_EnabledPlayerInfo( m_vPlayerInfo, pi )
 	{
@@ -1540,12 +1618,43 @@ void ScreenGameplay::PlayAnnouncer( const RString &type, float fSeconds, float *
 
 void ScreenGameplay::UpdateSongPosition( float fDeltaTime )
 {
+	if( m_pReplay != nullptr && m_pReplay->IsPlayback() )
+	{
+		float fSeconds;
+		RageTimer tm;
+		if( m_pReplay->GetSongPosition(fSeconds, tm) )
+			GAMESTATE->UpdateSongPosition( fSeconds, GAMESTATE->m_pCurSong->m_SongTiming, tm );
+		return;
+	}
+
 	if( !m_pSoundMusic->IsPlaying() )
+	{
+		m_bMeasureSoundDrift = false;
+		if( m_pReplay != nullptr )
+			m_pReplay->RecordSongPosition( false, 0, RageTimer() );
 		return;
+	}
 
 	RageTimer tm;
 	const float fSeconds = m_pSoundMusic->GetPositionSeconds( &tm );
 	const float fAdjust = SOUND->GetFrameTimingAdjustment( fDeltaTime );
+	if( m_pReplay != nullptr )
+		m_pReplay->RecordSongPosition( true, fSeconds+fAdjust, tm+fAdjust );
+	if( GameplayTelemetry::IsRecording() )
+	{
+		/* How far the music moved from where the last position and the clock
+		 * put it, as GameSoundManager's LogSkips measures it.  As there, only
+		 * measure from a position this song's music set, and not across a
+		 * loop. */
+		const SongPosition &pos = GAMESTATE->m_Position;
+		const float fSoundTimePassed = fSeconds+fAdjust - pos.m_fMusicSeconds;
+		if( m_bMeasureSoundDrift && !pos.m_LastBeatUpdate.IsZero() && fSoundTimePassed >= 0 )
+		{
+			const float fExpectedTimePassed = ((tm+fAdjust) - pos.m_LastBeatUpdate) * m_pSoundMusic->GetPlaybackRate();
+			GameplayTelemetry::SetSoundDrift( fSoundTimePassed - fExpectedTimePassed );
+		}
+	}
+	m_bMeasureSoundDrift = true;
 	GAMESTATE->UpdateSongPosition( fSeconds+fAdjust, GAMESTATE->m_pCurSong->m_SongTiming, tm+fAdjust );
 }
 
@@ -1554,8 +1663,17 @@ void ScreenGameplay::BeginScreen()
 	if( GAMESTATE->m_pCurSong == nullptr  )
 		return;
 
+	if( m_pReplay != nullptr )
+		m_pReplay->BeginScreen();
+	GameplayReplay::ClockScope clock( m_pReplay );
+
 	ScreenWithMenuElements::BeginScreen();
 
+	/* Frame times mean nothing when a replay is played back as fast as it can be. */
+	if( !GAMESTATE->m_bDemonstrationOrJukebox && (m_pReplay == nullptr || !m_pReplay->IsPlayback()) )
+		GameplayTelemetry::BeginStage();
+	m_bMeasureSoundDrift = false;
+
 	SOUND->PlayOnceFromAnnouncer( "gameplay intro" );	// crowd cheer
 
 	StartPlayingSong( MIN_SECONDS_TO_STEP, MIN_SECONDS_TO_MUSIC );
@@ -1601,6 +1719,24 @@ void ScreenGameplay::GetMusicEndTiming( float &fSecondsToStartFadingOutMusic, fl
 }
 
 void ScreenGameplay::Update( float fDeltaTime )
+{
+	GameplayTelemetry::NextFrame();
+
+	if( m_pReplay == nullptr )
+	{
+		UpdateGameplay( fDeltaTime );
+		return;
+	}
+
+	m_pReplay->BeginFrame( fDeltaTime );
+	{
+		GameplayReplay::ClockScope clock( m_pReplay );
+		UpdateGameplay( fDeltaTime );
+	}
+	m_pReplay->EndFrame();
+}
+
+void ScreenGameplay::UpdateGameplay( float fDeltaTime )
 {
 	if( GAMESTATE->m_pCurSong == nullptr  )
 	{
@@ -2357,6 +2493,10 @@ bool ScreenGameplay::Input( const InputEventPlus &input )
 {
 	//LOG->Trace( "ScreenGameplay::Input()" );
 
+	if( m_pReplay != nullptr )
+		m_pReplay->BeginInput( input );
+	GameplayReplay::ClockScope clock( m_pReplay );
+
 	Message msg("");
 	if( m_Codes.InputMessage(input, msg) )
 		this->HandleMessage( msg );
@@ -2511,8 +2651,13 @@ bool ScreenGameplay::Input( const InputEventPlus &input )
 				case GameButtonType_Menu:
 					return false;
 				case GameButtonType_Step:
-					if( iCol != -1 )
+					// If the JudgmentThread took it, the Player will get it from there.
+					if( iCol != -1 && !input.bTapped )
+					{
+						if( m_pReplay != nullptr && !m_pReplay->IsPlayback() )
+							m_pReplay->RecordStep( input );
 						pi.m_pPlayer->Step( iCol, -1, input.DeviceI.ts, false, bRelease );
+					}
 					return true;
 				}
 			}
@@ -2582,6 +2727,8 @@ void ScreenGameplay::SongFinished()
 
 void ScreenGameplay::StageFinished( bool bBackedOut )
 {
+	GameplayTelemetry::EndStage();
+
 	if( GAMESTATE->IsCourseMode() && GAMESTATE->m_PlayMode != PLAY_MODE_ENDLESS )
 	{
 		LOG->Trace("Stage finished at index %i/%i", GAMESTATE->GetCourseSongIndex(), (int) m_apSongsQueue.size() );
@@ -2678,6 +2825,7 @@ void ScreenGameplay::HandleScreenMessage( const ScreenMessage SM )
 		}
 
 		GAMESTATE->m_DanceStartTime.Touch();
+		m_timerGameplaySeconds.Touch();
 
 		GAMESTATE->m_bGameplayLeadIn.Set( false );
 		m_DancingState = STATE_DANCING; // STATE CHANGE!  Now the user is allowed to press Back
@@ -2937,6 +3085,8 @@ void ScreenGameplay::HandleScreenMessage( const ScreenMessage SM )
 	}
 	else if( SM == SM_DoPrevScreen )
 	{
+		if( m_pReplay != nullptr && m_pReplay->IsPlayback() )
+			m_pReplay->FinishPlayback( false );
 		SongFinished();
 		this->StageFinished( true );
 
@@ -2950,10 +3100,17 @@ void ScreenGameplay::HandleScreenMessage( const ScreenMessage SM )
 	else if( SM == SM_DoNextScreen )
 	{
 		SongFinished();
-		this->StageFinished( false );
+		if( m_pReplay != nullptr && m_pReplay->IsPlayback() )
+		{
+			/* Compare before StageFinished finalizes the scores, as recording does. */
+			m_pReplay->FinishPlayback( true );
+			this->StageFinished( false );
+			return;
+		}
 		// only save replays if the player chose to
-		if( GAMESTATE->m_SongOptions.GetCurrent().m_bSaveReplay )
+		if( m_pReplay != nullptr )
 			SaveReplay();
+		this->StageFinished( false );
 
 		if( AdjustSync::IsSyncDataChanged() )
 			ScreenSaveSync::PromptSaveSync( SM_GoToNextScreen );
@@ -3089,76 +3246,37 @@ PlayerInfo *ScreenGameplay::GetDummyPlayerInfo( int iDummyIndex )
 
 void ScreenGameplay::SaveReplay()
 {
-	/* Replay data TODO:
-	 * Add more player information (?)
-	 * Add AutoGen flag if steps were autogen?
-	 * Add proper steps hash?
-	 * Add modifiers used
-	 * Add date played, machine played on, etc.
-	 * Hash of some stuff to validate data (see Profile)
-	 */
-	FOREACH_HumanPlayer( pn )
-	{
-		FOREACH_EnabledPlayerInfo( m_vPlayerInfo, pi )
-		{
-			Profile *pTempProfile = PROFILEMAN->GetProfile(pn);
-
-			XNode *p = new XNode("ReplayData");
-			// append version number (in case the format changes)
-			p->AppendAttr("Version",0);
-
-			// song information node
-			SongID songID;
-			songID.FromSong(GAMESTATE->m_pCurSong);
-			XNode *pSongInfoNode = songID.CreateNode();
-			pSongInfoNode->AppendChild("Title", GAMESTATE->m_pCurSong->GetDisplayFullTitle());
-			pSongInfoNode->AppendChild("Artist", GAMESTATE->m_pCurSong->GetDisplayArtist());
-			p->AppendChild(pSongInfoNode);
-
-			// steps information
-			StepsID stepsID;
-			stepsID.FromSteps( GAMESTATE->m_pCurSteps[pn] );
-			XNode *pStepsInfoNode = stepsID.CreateNode();
-			// hashing = argh
-			//pStepsInfoNode->AppendChild("StepsHash", stepsID.ToSteps(GAMESTATE->m_pCurSong,false)->GetHash());
-			p->AppendChild(pStepsInfoNode);
-
-			// player information node (rival data sup)
-			XNode *pPlayerInfoNode = new XNode("Player");
-			pPlayerInfoNode->AppendChild("DisplayName", pTempProfile->m_sDisplayName);
-			pPlayerInfoNode->AppendChild("Guid", pTempProfile->m_sGuid);
-			p->AppendChild(pPlayerInfoNode);
-
-			// the timings.
-			p->AppendChild( pi->m_pPlayer->GetNoteData().CreateNode() );
-
-			// Find a file name for the replay
-			std::vector<RString> files;
-			GetDirListing( "Save/Replays/replay*", files, false, false );
-			sort( files.begin(), files.end() );
-
-			// Files should be of the form "replay#####.xml".
-			int iIndex = 0;
-
-			for( int i = files.size()-1; i >= 0; --i )
-			{
-				static Regex re( "^replay([0-9]{5})\\....$" );
-				std::vector<RString> matches;
-				if( !re.Compare( files[i], matches ) )
-					continue;
+	/* A replay of a stage someone gave up on or let autoplay finish wouldn't
+	 * tell us anything. */
+	if( STATSMAN->m_CurStageStats.m_bGaveUp || STATSMAN->m_CurStageStats.m_bUsedAutoplay )
+		return;
 
-				ASSERT( matches.size() == 1 );
-				iIndex = StringToInt( matches[0] )+1;
-				break;
-			}
+	XNode *p = m_pReplay->CreateNode();
 
-			RString sFileName = ssprintf( "replay%05d.xml", iIndex );
+	// Find a file name for the replay
+	std::vector<RString> files;
+	GetDirListing( "Save/Replays/replay*", files, false, false );
+	sort( files.begin(), files.end() );
 
-			XmlFileUtil::SaveToFile( p, "Save/Replays/"+sFileName );
-			RageUtil::SafeDelete( p );
-			return;
-		}
+	// Files should be of the form "replay#####.xml".
+	int iIndex = 0;
+
+	for( int i = files.size()-1; i >= 0; --i )
+	{
+		static Regex re( "^replay([0-9]{5})\\....$" );
+		std::vector<RString> matches;
+		if( !re.Compare( files[i], matches ) )
+			continue;
+
+		ASSERT( matches.size() == 1 );
+		iIndex = StringToInt( matches[0] )+1;
+		break;
 	}
+
+	RString sFileName = ssprintf( "replay%05d.xml", iIndex );
+
+	XmlFileUtil::SaveToFile( p, "Save/Replays/"+sFileName );
+	RageUtil::SafeDelete( p );
 }
 
 /*
@@ -31,6 +31,8 @@ class Inventory;
 class ScoreKeeper;
 class Background;
 class Foreground;
+class JudgmentThread;
+class GameplayReplay;
 
 AutoScreenMessage( SM_NotesEnded );
 AutoScreenMessage( SM_BeginFailed );
@@ -232,6 +234,7 @@ protected:
 
 	void PlayTicks();
 	void UpdateSongPosition( float fDeltaTime );
+	void UpdateGameplay( float fDeltaTime );
 	void UpdateLyrics( float fDeltaTime );
 	void SongFinished();
 	virtual void SaveStats();
@@ -327,6 +330,16 @@ protected:
 	virtual void FillPlayerInfo( std::vector<PlayerInfo> &vPlayerInfoOut ) = 0;
 	virtual PlayerInfo &GetPlayerInfoForInput( const InputEventPlus& iep )  { return m_vPlayerInfo[iep.pn]; }
 
+	void StartJudgmentThread();
+	JudgmentThread		*m_pJudgmentThread;
+
+	/* The replay being recorded or played back, if any.  Playback replays
+	 * belong to GameplayReplay. */
+	GameplayReplay		*m_pReplay;
+	/* Whether the last song position came from the music that's playing now,
+	 * so the next can be checked against it for GameplayTelemetry. */
+	bool			m_bMeasureSoundDrift;
+
 	RageTimer		m_timerGameplaySeconds;
 
 	// m_delaying_ready_announce is for handling a case where the ready
@@ -72,7 +72,15 @@
 #include "ScreenDimensions.h"
 #include "ActorUtil.h"
 #include "InputEventPlus.h"
-
+#include "MessageManager.h"
+#include "RageProfiler.h"
+#include "RageThreads.h"
+#include "RageTimer.h"
+#include "LuaManager.h"
+
+#include <atomic>
+#include <map>
+#include <set>
 #include <vector>
 
 
@@ -124,6 +132,35 @@ namespace ScreenManagerUtil
 	std::vector<LoadedScreen>    g_vPreparedScreens;
 	std::vector<Actor*>          g_vPreparedBackgrounds;
 
+	/* What each screen loaded the last time it was prepared, so next time its
+	 * images can be decoded and its scripts compiled while the previous screen
+	 * is still tweening off. */
+	struct ScreenDependencies
+	{
+		std::set<RageTextureID> setTextures;
+		std::set<RString> setScripts;
+	};
+	std::map<RString, ScreenDependencies> g_mapScreenDependencies;
+
+	RString g_sPrefetchingScreen;
+	RageTimer g_PrefetchTimer;
+
+	/* Textures are decoded by RageTextureManager's threads; this compiles the
+	 * scripts.  Only one batch runs at a time. */
+	RageThread g_PrefetchThread;
+	std::atomic<bool> g_bPrefetchThreadRunning( false );
+	std::vector<RString> g_vPrefetchScripts;
+
+	int PrefetchThread_Start( void * )
+	{
+		RageTimer tm;
+		for( const RString &sFile : g_vPrefetchScripts )
+			LuaHelpers::PrecompileScriptFile( sFile );
+		LOG->Trace( "Prefetch: checked %i scripts in %.1fms", (int) g_vPrefetchScripts.size(), tm.Ago() * 1000 );
+		g_bPrefetchThreadRunning = false;
+		return 0;
+	}
+
 	// Add a screen to g_ScreenStack. This is the only function that adds to g_ScreenStack.
 	void PushLoadedScreen( const LoadedScreen &ls )
 	{
@@ -177,6 +214,10 @@ namespace ScreenManagerUtil
 	{
 		// Deleting a screen can take enough time to cause a frame skip.
 		SCREENMAN->ZeroNextUpdate();
+
+		/* Deliver anything the screen deferred while its actors (which may be
+		 * in the params) are still around. */
+		MESSAGEMAN->DispatchDeferred();
 	}
 
 	/* If we're deleting a screen, it's probably releasing texture and other
@@ -278,6 +319,8 @@ ScreenManager::~ScreenManager()
 		RageUtil::SafeDelete(overlayScreen);
 	}
 	g_OverlayScreens.clear();
+	if( g_PrefetchThread.IsCreated() )
+		g_PrefetchThread.Wait();
 
 	// Unregister with Lua.
 	LUA->UnsetGlobal("SCREENMAN");
@@ -288,6 +331,11 @@ void ScreenManager::ThemeChanged()
 {
 	LOG->Trace( "ScreenManager::ThemeChanged" );
 
+	// The new theme's screens load different files.
+	g_mapScreenDependencies.clear();
+	TEXTUREMAN->ClearPrefetchedTextures();
+	g_sPrefetchingScreen = RString();
+
 	// reload common sounds
 	m_soundStart.Load( THEME->GetPathS("Common","start") );
 	m_soundCoin.Load( THEME->GetPathS("Common","coin"), true );
@@ -427,6 +475,8 @@ ScreenMessage ScreenManager::PopTopScreenInternal( bool bSendLoseFocus )
 
 void ScreenManager::Update( float fDeltaTime )
 {
+	PROFILE_SCOPE( "ScreenManager::Update" );
+
 	// Pop the top screen, if PopTopScreen was called.
 	if( m_PopTopScreen != SM_Invalid )
 	{
@@ -501,6 +551,8 @@ void ScreenManager::Draw()
 	if( g_ScreenStack.size() && g_ScreenStack.back().m_pScreen->IsFirstUpdate() )
 		return;
 
+	PROFILE_SCOPE( "ScreenManager::Draw" );
+
 	if( !DISPLAY->BeginFrame() )
 		return;
 
@@ -515,6 +567,8 @@ void ScreenManager::Draw()
 	for (Screen* overlayScreen : g_OverlayScreens)
 		overlayScreen->Draw();
 
+	// This includes waiting for vsync.
+	PROFILE_SCOPE( "RageDisplay::EndFrame" );
 	DISPLAY->EndFrame();
 }
 
@@ -583,12 +637,88 @@ Screen* ScreenManager::MakeNewScreen( const RString &sScreenName )
 	return ret;
 }
 
+void ScreenManager::PrefetchScreen( const RString &sScreenName )
+{
+	if( sScreenName == g_sPrefetchingScreen || ScreenIsPrepped(sScreenName) )
+		return;
+
+	std::map<RString, ScreenDependencies>::const_iterator it = g_mapScreenDependencies.find( sScreenName );
+	if( it == g_mapScreenDependencies.end() )
+		return;
+	const ScreenDependencies &deps = it->second;
+
+	// Drop anything prefetched for a screen we didn't go to.
+	TEXTUREMAN->ClearPrefetchedTextures();
+	g_sPrefetchingScreen = sScreenName;
+	g_PrefetchTimer.Touch();
+
+	for( const RageTextureID &ID : deps.setTextures )
+		TEXTUREMAN->PrefetchTexture( ID );
+
+	/* If the last batch is still compiling, don't wait for it. */
+	if( !g_bPrefetchThreadRunning )
+	{
+		if( g_PrefetchThread.IsCreated() )
+			g_PrefetchThread.Wait();
+		g_vPrefetchScripts.assign( deps.setScripts.begin(), deps.setScripts.end() );
+		g_bPrefetchThreadRunning = true;
+		g_PrefetchThread.SetName( "Screen prefetch" );
+		g_PrefetchThread.Create( PrefetchThread_Start, nullptr );
+	}
+
+	LOG->Trace( "Prefetching \"%s\": %i textures, %i scripts", sScreenName.c_str(),
+		(int) deps.setTextures.size(), (int) deps.setScripts.size() );
+}
+
 void ScreenManager::PrepareScreen( const RString &sScreenName )
 {
 	// If the screen is already prepared, stop.
 	if( ScreenIsPrepped(sScreenName) )
 		return;
 
+	// If nothing started it earlier, the decode threads can still get ahead.
+	PrefetchScreen( sScreenName );
+
+	/* Record what the screen loads for next time.  If we're being prepared
+	 * while another screen loads, that screen loads it all too. */
+	ScreenDependencies deps;
+	std::set<RageTextureID> *pOuterTextures = TEXTUREMAN->GetLoadRecord();
+	std::set<RString> *pOuterScripts = LuaHelpers::GetScriptFileRecord();
+	TEXTUREMAN->SetLoadRecord( &deps.setTextures );
+	LuaHelpers::SetScriptFileRecord( &deps.setScripts );
+	const RageTextureManager::LoadStats StartStats = TEXTUREMAN->GetLoadStats();
+	RageTimer tm;
+
+	PrepareScreenAndBackground( sScreenName );
+
+	TEXTUREMAN->SetLoadRecord( pOuterTextures );
+	LuaHelpers::SetScriptFileRecord( pOuterScripts );
+	if( pOuterTextures != nullptr )
+		pOuterTextures->insert( deps.setTextures.begin(), deps.setTextures.end() );
+	if( pOuterScripts != nullptr )
+		pOuterScripts->insert( deps.setScripts.begin(), deps.setScripts.end() );
+
+	const RageTextureManager::LoadStats &EndStats = TEXTUREMAN->GetLoadStats();
+	const float fDecodeSeconds = EndStats.fDecodeSeconds - StartStats.fDecodeSeconds;
+	const float fUploadSeconds = EndStats.fUploadSeconds - StartStats.fUploadSeconds;
+	const float fTotalSeconds = tm.Ago();
+	LOG->Trace( "Prepared \"%s\" in %.1fms: %i textures (%i prefetched %.0fms ahead), decoded in %.1fms, uploaded in %.1fms; %.1fms constructing.",
+		sScreenName.c_str(), fTotalSeconds * 1000,
+		EndStats.iLoaded - StartStats.iLoaded, EndStats.iPrefetched - StartStats.iPrefetched,
+		sScreenName == g_sPrefetchingScreen? g_PrefetchTimer.Ago() * 1000 - fTotalSeconds * 1000 : 0.0f,
+		fDecodeSeconds * 1000, fUploadSeconds * 1000,
+		(fTotalSeconds - fDecodeSeconds - fUploadSeconds) * 1000 );
+
+	g_mapScreenDependencies[sScreenName] = std::move( deps );
+	if( pOuterTextures == nullptr )
+	{
+		TEXTUREMAN->ClearPrefetchedTextures();
+		g_sPrefetchingScreen = RString();
+	}
+}
+
+void ScreenManager::PrepareScreenAndBackground( const RString &sScreenName )
+{
 	Screen* pNewScreen = MakeNewScreen(sScreenName);
 	if(pNewScreen == nullptr)
 	{
@@ -35,6 +35,10 @@ public:
 	 * will be very quick.
 	 * @param sScreenName the Screen to prepare. */
 	void PrepareScreen( const RString &sScreenName );
+	/* Start decoding the images and compiling the scripts the screen used
+	 * the last time it was prepared, so preparing it takes less time.  Does
+	 * nothing for screens that haven't been prepared before. */
+	void PrefetchScreen( const RString &sScreenName );
 	void GroupScreen( const RString &sScreenName );
 	void PersistantScreen( const RString &sScreenName );
 	void PopTopScreen( ScreenMessage SM );
@@ -94,6 +98,7 @@ private:
 	bool m_bReloadOverlayScreensAfterInput;
 
 	Screen *MakeNewScreen( const RString &sName );
+	void PrepareScreenAndBackground( const RString &sScreenName );
 	void LoadDelayedScreen();
 	bool ActivatePreparedScreenAndBackground( const RString &sScreenName );
 	ScreenMessage PopTopScreenInternal( bool bSendLoseFocus = true );
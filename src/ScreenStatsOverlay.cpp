@@ -1,10 +1,15 @@
 #include "global.h"
 #include "ScreenStatsOverlay.h"
 #include "ActorUtil.h"
+#include "LuaManager.h"
+#include "MessageManager.h"
 #include "PrefsManager.h"
 #include "RageDisplay.h"
 #include "RageLog.h"
+#include "RageProfiler.h"
+#include "RageTextureAtlas.h"
 #include "ScreenDimensions.h"
+#include "ThemeManager.h"
 
 REGISTER_SCREEN_CLASS( ScreenStatsOverlay );
 
@@ -77,7 +82,27 @@ void ScreenStatsOverlay::Update( float fDeltaTime )
 	this->SetVisible( PREFSMAN->m_bShowStats );
 	if( PREFSMAN->m_bShowStats )
 	{
-		m_textStats.SetText( DISPLAY->GetStats() );
+		RString sStats = DISPLAY->GetStats();
+		RString sAtlasStats = RageTextureAtlas::GetStats();
+		if( !sAtlasStats.empty() )
+			sStats += "\n" + sAtlasStats;
+		if( RageProfiler::IsEnabled() )
+		{
+			sStats += "\n" + Actor::GetUpdateStats();
+			RString sMetricStats = THEME->GetMetricCacheStats();
+			if( !sMetricStats.empty() )
+				sStats += "\n" + sMetricStats;
+		}
+		RString sLockStats = LUA->GetLockStats();
+		if( !sLockStats.empty() )
+			sStats += "\n" + sLockStats;
+		RString sDeferredStats = MESSAGEMAN->GetDeferredStats();
+		if( !sDeferredStats.empty() )
+			sStats += "\n" + sDeferredStats;
+		RString sProfile = RageProfiler::GetFrameBreakdown( 12 );
+		if( !sProfile.empty() )
+			sStats += "\n" + sProfile;
+		m_textStats.SetText( sStats );
 		if ( SHOW_SKIPS )
 			UpdateSkips();
 	}
@@ -273,6 +273,15 @@ void ScreenWithMenuElements::StartTransitioningScreen( ScreenMessage smSendWhenD
 {
 	TweenOffScreen();
 
+	/* Get a head start on loading the next screen while this one tweens off. */
+	if( !SCREENMAN->IsStackedScreen(this) )
+	{
+		if( smSendWhenDone == SM_GoToNextScreen )
+			SCREENMAN->PrefetchScreen( GetNextScreenName() );
+		else if( smSendWhenDone == SM_GoToPrevScreen )
+			SCREENMAN->PrefetchScreen( GetPrevScreen() );
+	}
+
 	m_Out.StartTransitioning( smSendWhenDone );
 	if( WAIT_FOR_CHILDREN_BEFORE_TWEENING_OUT )
 	{
@@ -11,13 +11,16 @@
 #include "LuaBinding.h"
 #include "LuaManager.h"
 #include "ImageCache.h"
+#include "Quad.h"
 #include "ThemeMetric.h"
+#include <algorithm>
 #include <numeric>
 
 #include <cassert>
 #include <cfloat>
 #include <cmath>
 #include <cstddef>
+#include <typeinfo>
 #include <vector>
 
 REGISTER_ACTOR_CLASS( Sprite );
@@ -27,6 +30,7 @@ const float min_state_delay= 0.0001f;
 Sprite::Sprite()
 {
 	m_pTexture = nullptr;
+	m_bTextureLoadPending = false;
 	m_iCurState = 0;
 	m_fSecsIntoState = 0.0f;
 	m_animation_length_seconds= 0.0f;
@@ -81,6 +85,7 @@ Sprite::Sprite( const Sprite &cpy ):
 	CPY( m_fTexCoordVelocityX );
 	CPY( m_fTexCoordVelocityY );
 	CPY(m_use_effect_clock_for_texcoords);
+	CPY( m_bTextureLoadPending );
 #undef CPY
 
 	if( cpy.m_pTexture != nullptr )
@@ -110,6 +115,7 @@ Sprite &Sprite::operator=( Sprite other )
 	SWAP( m_fTexCoordVelocityY );
 	SWAP(m_use_effect_clock_for_texcoords);
 	SWAP(m_pTexture);
+	SWAP( m_bTextureLoadPending );
 #undef SWAP
 	return *this;
 }
@@ -145,6 +151,10 @@ RageTextureID Sprite::SongBGTexture( RageTextureID ID )
 
 	ID.bDither = true;
 
+	/* Song backgrounds are large and loaded on screen transitions; decode them
+	 * in the background if enabled. */
+	ID.bLoadInBackground = true;
+
 	return ID;
 }
 
@@ -170,6 +180,8 @@ RageTextureID Sprite::SongBannerTexture( RageTextureID ID )
 
 	ID.Policy = RageTextureID::TEX_VOLATILE;
 
+	ID.bLoadInBackground = true;
+
 	return ID;
 }
 
@@ -293,6 +305,7 @@ void Sprite::UnloadTexture()
 	{
 		TEXTUREMAN->UnloadTexture( m_pTexture ); // Unload it.
 		m_pTexture = nullptr;
+		m_bTextureLoadPending = false;
 
 		/* Make sure we're reset to frame 0, so if we're reused, we aren't left
 		 * on a frame number that may be greater than the number of frames in
@@ -341,6 +354,9 @@ void Sprite::SetTexture( RageTexture *pTexture )
 	ASSERT( m_pTexture->GetTextureWidth() >= 0 );
 	ASSERT( m_pTexture->GetTextureHeight() >= 0 );
 
+	m_bTextureLoadPending = m_pTexture->IsLoadPending();
+	WakeUp();
+
 	// the size of the sprite is the size of the image before it was scaled
 	Sprite::m_size.x = (float)m_pTexture->GetSourceFrameWidth();
 	Sprite::m_size.y = (float)m_pTexture->GetSourceFrameHeight();
@@ -401,6 +417,7 @@ void Sprite::LoadStatesFromTexture()
 {
 	// Assume the frames of this animation play in sequential order with 0.1 second delay.
 	m_States.clear();
+	WakeUp();
 
 	if( m_pTexture == nullptr )
 	{
@@ -460,6 +477,19 @@ void Sprite::UpdateAnimationState()
  * (I'd like to handle sprite and movie animation as consistently as possible;
  * the above is just documentation of current practice.) -glenn */
 // todo: see if "current" practice is just that. -aj
+bool Sprite::CanSleep() const
+{
+	if( typeid(*this) != typeid(Sprite) && typeid(*this) != typeid(Quad) )
+		return false;
+	if( HasUpdateWork() || m_bTextureLoadPending || m_DecodeMovie )
+		return false;
+	if( m_fTexCoordVelocityX != 0 || m_fTexCoordVelocityY != 0 )
+		return false;
+
+	// A single state doesn't animate.
+	return !m_bIsAnimating || m_States.size() <= 1;
+}
+
 void Sprite::Update( float fDelta )
 {
 	Actor::Update( fDelta ); // do tweening
@@ -467,6 +497,33 @@ void Sprite::Update( float fDelta )
 	const bool bSkipThisMovieUpdate = m_bSkipNextUpdate;
 	m_bSkipNextUpdate = false;
 
+	/* If the texture was loading in the background when we got it, our states
+	 * and custom coordinates are in the placeholder's texture coordinates,
+	 * where the image filled the texture.  Move them to where the image is in
+	 * the real one.  The placeholder was the real size, so any size or zoom
+	 * set against it still holds. */
+	if( m_bTextureLoadPending && !m_pTexture->IsLoadPending() )
+	{
+		m_bTextureLoadPending = false;
+		const float fX = m_pTexture->GetImageWidth() / (float)m_pTexture->GetTextureWidth();
+		const float fY = m_pTexture->GetImageHeight() / (float)m_pTexture->GetTextureHeight();
+		for( State &s : m_States )
+		{
+			s.rect.left *= fX;
+			s.rect.right *= fX;
+			s.rect.top *= fY;
+			s.rect.bottom *= fY;
+		}
+		if( m_bUsingCustomTexCoords )
+		{
+			for( int i = 0; i < 8; i += 2 )
+			{
+				m_CustomTexCoords[i+0] *= fX;
+				m_CustomTexCoords[i+1] *= fY;
+			}
+		}
+	}
+
 	if( !m_bIsAnimating )
 		return;
 
@@ -586,6 +643,15 @@ void Sprite::DrawTexture( const TweenState *state )
 		}
 	}
 
+	// Wrapping doesn't work within an atlas page.
+	if( m_pTexture && m_pTexture->IsInAtlas() && m_bUsingCustomTexCoords )
+	{
+		float f[8];
+		GetActiveTextureCoords( f );
+		if( std::any_of(f, f+8, [](float c) { return c < 0 || c > 1; }) )
+			m_pTexture->RemoveFromAtlas();
+	}
+
 	DISPLAY->ClearAllTextures();
 	DISPLAY->SetTexture( TextureUnit_1, m_pTexture? m_pTexture->GetTexHandle():0 );
 
@@ -628,6 +694,16 @@ void Sprite::DrawTexture( const TweenState *state )
 			v[2].t = RageVector2( f[4], f[5] );	// bottom right
 			v[3].t = RageVector2( f[6], f[7] );	// top right
 		}
+
+		if( m_pTexture->IsInAtlas() )
+		{
+			const RectF &rect = m_pTexture->GetAtlasRect();
+			for( int i = 0; i < 4; ++i )
+			{
+				v[i].t.x = SCALE( v[i].t.x, 0.f, 1.f, rect.left, rect.right );
+				v[i].t.y = SCALE( v[i].t.y, 0.f, 1.f, rect.top, rect.bottom );
+			}
+		}
 	}
 	else
 	{
@@ -969,6 +1045,7 @@ void Sprite::SetTexCoordVelocity(float fVelX, float fVelY)
 {
 	m_fTexCoordVelocityX = fVelX;
 	m_fTexCoordVelocityY = fVelY;
+	WakeUp();
 }
 
 void Sprite::ScaleToClipped( float fWidth, float fHeight )
@@ -1309,6 +1386,7 @@ public:
 	static int SetDecodeMovie(T* p, lua_State *L)
 	{
 		p->m_DecodeMovie= BArg(1);
+		p->WakeUp();
 		COMMON_RETURN_SELF;
 	}
 	static int LoadFromCached( T* p, lua_State *L )
@@ -38,6 +38,7 @@ public:
 	virtual bool EarlyAbortDraw() const override;
 	virtual void DrawPrimitives() override;
 	virtual void Update( float fDeltaTime ) override;
+	virtual bool CanSleep() const override;
 
 	void UpdateAnimationState();	// take m_fSecondsIntoState, and move to a new state
 
@@ -63,7 +64,7 @@ public:
 	virtual void RecalcAnimationLengthSeconds();
 	virtual void SetSecondsIntoAnimation( float fSeconds ) override;
 	void SetStateProperties(const std::vector<State>& new_states)
-	{ m_States= new_states; RecalcAnimationLengthSeconds(); SetState(0); }
+	{ m_States= new_states; RecalcAnimationLengthSeconds(); SetState(0); WakeUp(); }
 
 	RString	GetTexturePath() const;
 
@@ -111,6 +112,9 @@ private:
 	void DrawTexture( const TweenState *state );
 
 	RageTexture* m_pTexture;
+	/* True if m_pTexture was still loading in the background when it was set,
+	 * so our states' texture coordinates came from the placeholder. */
+	bool m_bTextureLoadPending;
 
 	std::vector<State> m_States;
 	int		m_iCurState;
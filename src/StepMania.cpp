@@ -64,6 +64,7 @@
 #include "MessageManager.h"
 #include "StatsManager.h"
 #include "GameLoop.h"
+#include "GameplayReplay.h"
 #include "SpecialFiles.h"
 #include "Profile.h"
 #include "ActorUtil.h"
@@ -212,7 +213,9 @@ static void StartDisplay()
 			PREFSMAN->m_bDelayedTextureDelete,
 			PREFSMAN->m_iMaxTextureResolution,
 			StepMania::GetHighResolutionTextures(),
-			PREFSMAN->m_bForceMipMaps
+			PREFSMAN->m_bForceMipMaps,
+			PREFSMAN->m_bBackgroundTextureLoading,
+			PREFSMAN->m_bTextureDiskCache
 			)
 		);
 
@@ -243,7 +246,9 @@ void StepMania::ApplyGraphicOptions()
 			PREFSMAN->m_bDelayedTextureDelete,
 			PREFSMAN->m_iMaxTextureResolution,
 			StepMania::GetHighResolutionTextures(),
-			PREFSMAN->m_bForceMipMaps
+			PREFSMAN->m_bForceMipMaps,
+			PREFSMAN->m_bBackgroundTextureLoading,
+			PREFSMAN->m_bTextureDiskCache
 			)
 		);
 
@@ -873,6 +878,10 @@ int sm_main(int argc, char* argv[])
 	PREFSMAN->ReadPrefsFromDisk();
 	ApplyLogPreferences();
 
+	/* This overrides preferences the display and sound are set up with, so do
+	 * it before either. */
+	GameplayReplay::ParseCommandLine();
+
 	// This needs PREFSMAN.
 	Dialog::Init();
 
@@ -993,7 +1002,10 @@ int sm_main(int argc, char* argv[])
 	/* Now that GAMESTATE is reset, tell SCREENMAN to update the theme (load
 	 * overlay screens and global sounds), and load the initial screen. */
 	SCREENMAN->ThemeChanged();
-	SCREENMAN->SetNewScreen( StepMania::GetInitialScreen() );
+	if( GameplayReplay::GetPlayback() != nullptr )
+		GameplayReplay::StartPlayback();
+	else
+		SCREENMAN->SetNewScreen( StepMania::GetInitialScreen() );
 
 	// Do this after ThemeChanged so that we can show a system message
 	RString sMessage;
@@ -1005,11 +1017,13 @@ int sm_main(int argc, char* argv[])
 	// Run the main loop.
 	GameLoop::RunGameLoop();
 
+	const int iExitCode = GameplayReplay::EndPlayback();
+
 	PREFSMAN->SavePrefsToDisk();
 
 	ShutdownGame();
 
-	return 0;
+	return iExitCode;
 }
 
 RString StepMania::SaveScreenshot( RString Dir, bool SaveCompressed, bool MakeSignature, RString NamePrefix, RString NameSuffix )
@@ -1314,6 +1328,7 @@ void HandleInputEvents(float fDeltaTime)
 		input.DeviceI = ieArray[i].di;
 		input.type = ieArray[i].type;
 		swap( input.InputList, ieArray[i].m_ButtonState );
+		input.bTapped = ieArray[i].m_bTapped;
 
 		// hack for testing (MultiPlayer) with only one joystick
 		/*
@@ -2,6 +2,7 @@
 #include "ThemeManager.h"
 #include "RageFileManager.h"
 #include "RageLog.h"
+#include "RageThreads.h"
 #include "RageTimer.h"
 #include "RageUtil.h"
 #include "IniFile.h"
@@ -27,8 +28,12 @@
 #include "PrefsManager.h"
 #include "XmlFileUtil.h"
 
+#include <algorithm>
+#include <atomic>
 #include <cstddef>
 #include <deque>
+#include <map>
+#include <unordered_map>
 #include <vector>
 
 
@@ -58,14 +63,36 @@ class LoadedThemeData
 public:
 	IniFile iniMetrics;
 	IniFile iniStrings;
+
+	/* Metrics are Lua expressions, so they have to be evaluated on every fetch,
+	 * but they don't have to be compiled every time.  Keep the compiled chunk of
+	 * each metric PushMetric has seen, keyed by "Group::Name".  Plain numbers and
+	 * booleans are kept as values, and don't need to be run at all.  Each
+	 * group's Fallback is also only evaluated once.  These are only touched while
+	 * holding the Lua lock, and are cleared with the metrics they came from. */
+	struct CompiledMetric
+	{
+		LuaReference Value;	// the chunk, or the value itself if bConstant
+		bool bConstant;
+		bool bCommand;
+	};
+	std::map<RString, CompiledMetric> mapCompiledMetrics;
+	std::map<RString, RString> mapGroupFallbacks;
+
 	void ClearAll()
 	{
 		iniMetrics.Clear();
 		iniStrings.Clear();
+		mapCompiledMetrics.clear();
+		mapGroupFallbacks.clear();
 	}
 };
 LoadedThemeData *g_pLoadedThemeData = nullptr;
 
+static int g_iMetricFetches = 0;
+static int g_iMetricCacheHits = 0;
+static int g_iMetricCompiles = 0;
+
 
 // For self-registering metrics
 #include "SubscriptionManager.h"
@@ -128,6 +155,230 @@ void ThemeManager::ClearThemePathCache()
 		g_ThemePathCache[i].clear();
 }
 
+/* An index of every file under each theme's element directories, so resolving
+ * an element doesn't list a directory for every theme and metrics group
+ * fallback it tries.  Each theme in the fallback chain is indexed in a thread
+ * while its metrics load; lookups wait for that to finish.  The index is
+ * rebuilt whenever the metrics are, since that also flushes the dir cache. */
+namespace
+{
+	const int MAX_INDEX_DEPTH = 8;
+
+	struct IndexedFile
+	{
+		RString sLower;
+		RString sName;
+		bool bDir;
+		bool operator<( const IndexedFile &rhs ) const { return sLower < rhs.sLower; }
+	};
+	typedef std::vector<IndexedFile> IndexedDir;	// sorted
+
+	class ThemePathIndex
+	{
+	public:
+		ThemePathIndex(): m_Lock( "ThemePathIndex" ) {}
+
+		void Clear();
+		void Queue( const RString &sThemeDir );
+
+		/* Return the entries of sDir, which must end in a slash, or nullptr if
+		 * it isn't in the index. */
+		const IndexedDir *GetDir( const RString &sDir );
+
+		/* Lookups answered, and directory listings and file checks made to
+		 * build the index. */
+		int m_iLookups = 0;
+		std::atomic<int> m_iCallsToBuild{ 0 };
+
+	private:
+		void Finish();
+		static int BuildThread_Start( void *p ) { ((ThemePathIndex *) p)->BuildThread(); return 0; }
+		void BuildThread();
+		void IndexDir( const RString &sDir, int iDepth, std::unordered_map<std::string, IndexedDir> &mapOut );
+
+		RageThread m_Thread;
+		RageMutex m_Lock;	// guards m_vPending and m_bBuilding
+		std::vector<RString> m_vPending;
+		bool m_bBuilding = false;
+
+		/* Keyed by lowercase path.  Only written by the build thread, and only
+		 * read once it has finished. */
+		std::unordered_map<std::string, IndexedDir> m_mapDirs;
+	};
+	ThemePathIndex g_PathIndex;
+
+	void ThemePathIndex::Clear()
+	{
+		Finish();
+		m_mapDirs.clear();
+	}
+
+	void ThemePathIndex::Queue( const RString &sThemeDir )
+	{
+		LockMut( m_Lock );
+		m_vPending.push_back( sThemeDir );
+		if( m_bBuilding )
+			return;
+
+		if( m_Thread.IsCreated() )
+			m_Thread.Wait();
+		m_bBuilding = true;
+		m_Thread.SetName( "Theme path index" );
+		m_Thread.Create( BuildThread_Start, this );
+	}
+
+	void ThemePathIndex::Finish()
+	{
+		if( m_Thread.IsCreated() )
+			m_Thread.Wait();
+	}
+
+	void ThemePathIndex::BuildThread()
+	{
+		for(;;)
+		{
+			RString sThemeDir;
+			{
+				LockMut( m_Lock );
+				if( m_vPending.empty() )
+				{
+					m_bBuilding = false;
+					return;
+				}
+				sThemeDir = m_vPending.back();
+				m_vPending.pop_back();
+			}
+
+			RageTimer tm;
+			std::unordered_map<std::string, IndexedDir> mapDirs;
+			FOREACH_ElementCategory( ec )
+				IndexDir( sThemeDir + ElementCategoryToString(ec) + "/", 0, mapDirs );
+			LOG->Trace( "Indexed \"%s\" (%i directories) in %.1fms", sThemeDir.c_str(), (int) mapDirs.size(), tm.Ago() * 1000 );
+
+			for( auto &dir : mapDirs )
+				m_mapDirs[dir.first] = std::move( dir.second );
+		}
+	}
+
+	void ThemePathIndex::IndexDir( const RString &sDir, int iDepth, std::unordered_map<std::string, IndexedDir> &mapOut )
+	{
+		std::vector<RString> asNames;
+		GetDirListing( sDir + "*", asNames );
+		++m_iCallsToBuild;
+
+		IndexedDir dir;
+		for( const RString &sName : asNames )
+		{
+			IndexedFile f;
+			f.sName = sName;
+			f.sLower = sName;
+			MakeLower( f.sLower );
+			f.bDir = IsADirectory( sDir + sName );
+			++m_iCallsToBuild;
+			dir.push_back( f );
+		}
+		std::sort( dir.begin(), dir.end() );
+
+		if( iDepth < MAX_INDEX_DEPTH )
+		{
+			for( const IndexedFile &f : dir )
+			{
+				if( f.bDir )
+					IndexDir( sDir + f.sName + "/", iDepth+1, mapOut );
+			}
+		}
+
+		RString sLowerDir = sDir;
+		MakeLower( sLowerDir );
+		mapOut[sLowerDir] = std::move( dir );
+	}
+
+	const IndexedDir *ThemePathIndex::GetDir( const RString &sDir )
+	{
+		Finish();
+		RString sLowerDir = sDir;
+		MakeLower( sLowerDir );
+		auto it = m_mapDirs.find( sLowerDir );
+		if( it == m_mapDirs.end() )
+			return nullptr;
+		++m_iLookups;
+		return &it->second;
+	}
+
+	/* Split sPath into its directory's index and the lowercase file name. */
+	const IndexedDir *GetIndexedDirForPath( const RString &sPath, RString &sDirOut, RString &sLowerNameOut )
+	{
+		const size_t iSlash = sPath.rfind( '/' );
+		if( iSlash == RString::npos || iSlash+1 == sPath.size() )
+			return nullptr;
+		sDirOut = sPath.substr( 0, iSlash+1 );
+		sLowerNameOut = sPath.substr( iSlash+1 );
+		MakeLower( sLowerNameOut );
+		return g_PathIndex.GetDir( sDirOut );
+	}
+
+	IndexedFile MakeKey( const RString &sLower )
+	{
+		IndexedFile f;
+		f.sLower = sLower;
+		return f;
+	}
+}
+
+bool ThemeManager::GetIndexedFiles( const RString &sPath, bool bExact, std::vector<RString> &asOut )
+{
+	RString sDir, sLowerName;
+	const IndexedDir *pDir = GetIndexedDirForPath( sPath, sDir, sLowerName );
+	if( pDir == nullptr )
+		return false;
+
+	for( auto it = std::lower_bound(pDir->begin(), pDir->end(), MakeKey(sLowerName)); it != pDir->end(); ++it )
+	{
+		if( bExact? it->sLower != sLowerName : it->sLower.compare(0, sLowerName.size(), sLowerName) != 0 )
+			break;
+		asOut.push_back( sDir + it->sName );
+	}
+	return true;
+}
+
+bool ThemeManager::GetIndexedFileType( const RString &sPath, RageFileManager::FileType &ftOut )
+{
+	RString sDir, sLowerName;
+	const IndexedDir *pDir = GetIndexedDirForPath( sPath, sDir, sLowerName );
+	if( pDir == nullptr )
+		return false;
+
+	auto it = std::lower_bound( pDir->begin(), pDir->end(), MakeKey(sLowerName) );
+	if( it == pDir->end() || it->sLower != sLowerName )
+		ftOut = RageFileManager::TYPE_NONE;
+	else
+		ftOut = it->bDir? RageFileManager::TYPE_DIR:RageFileManager::TYPE_FILE;
+	return true;
+}
+
+bool ThemeManager::DoesIndexedFileExist( const RString &sPath )
+{
+	RageFileManager::FileType ft;
+	if( GetIndexedFileType(sPath, ft) )
+		return ft == RageFileManager::TYPE_FILE;
+	return DoesFileExist( sPath );
+}
+
+void ThemeManager::RebuildPathIndex()
+{
+	g_PathIndex.Clear();
+	for( const Theme &t : g_vThemes )
+		g_PathIndex.Queue( GetThemeDirFromName(t.sThemeName) );
+}
+
+static void LogPathIndexStats()
+{
+	if( g_PathIndex.m_iLookups == 0 )
+		return;
+	LOG->Trace( "Theme path index: answered %i lookups without the filesystem, using %i calls to build.",
+		g_PathIndex.m_iLookups, g_PathIndex.m_iCallsToBuild.load() );
+}
+
 static void FileNameToMetricsGroupAndElement( const RString &sFileName, RString &sMetricsGroupOut, RString &sElementOut )
 {
 	// split into class name and file name
@@ -178,6 +429,9 @@ ThemeManager::~ThemeManager()
 {
 	g_vThemes.clear();
 	RageUtil::SafeDelete( g_pLoadedThemeData );
+	g_PathIndex.Clear();
+	LogPathIndexStats();
+	LuaHelpers::LogScriptFileCacheStats();
 
 	// Unregister with Lua.
 	LUA->UnsetGlobal( "THEME" );
@@ -290,6 +544,7 @@ void ThemeManager::LoadThemeMetrics( const RString &sThemeName_, const RString &
 	// on the stack, so Clear them instead.
 	g_pLoadedThemeData->ClearAll();
 	g_vThemes.clear();
+	g_PathIndex.Clear();
 
 	RString sThemeName(sThemeName_);
 	RString sLanguage(sLanguage_);
@@ -305,6 +560,7 @@ void ThemeManager::LoadThemeMetrics( const RString &sThemeName_, const RString &
 		g_vThemes.push_back( Theme() );
 		Theme &t = g_vThemes.back();
 		t.sThemeName = sThemeName;
+		g_PathIndex.Queue( GetThemeDirFromName(sThemeName) );
 
 		IniFile iniMetrics;
 		IniFile iniStrings;
@@ -442,6 +698,8 @@ void ThemeManager::SwitchThemeAndLanguage( const RString &sThemeName_, const RSt
 	ClearThemePathCache();
 	if(bThemeChanging || bForceThemeReload)
 	{
+		LuaHelpers::ClearScriptFileCache();
+
 #if !defined(SMPACKAGE)
 		// reload common sounds
 		if( SCREENMAN != nullptr )
@@ -630,15 +888,17 @@ bool ThemeManager::GetPathInfoToRaw( PathInfo &out, const RString &sThemeName_,
 	// If sFileName already has an extension, we're looking for a specific file
 	bool bLookingForSpecificFile = sElement.find_last_of('.') != sElement.npos;
 
+	const RString sElementPath = sThemeDir + sCategory + "/" + MetricsGroupAndElementToFileName(sMetricsGroup,sElement);
 	if( bLookingForSpecificFile )
 	{
-		GetDirListing( sThemeDir + sCategory+"/"+MetricsGroupAndElementToFileName(sMetricsGroup,sElement), asElementPaths, false, true );
+		if( !GetIndexedFiles(sElementPath, true, asElementPaths) )
+			GetDirListing( sElementPath, asElementPaths, false, true );
 	}
 	else	// look for all files starting with sFileName that have types we can use
 	{
 		std::vector<RString> asPaths;
-		GetDirListing( sThemeDir + sCategory + "/" + MetricsGroupAndElementToFileName(sMetricsGroup,sElement) + "*",
-						asPaths, false, true );
+		if( !GetIndexedFiles(sElementPath, false, asPaths) )
+			GetDirListing( sElementPath + "*", asPaths, false, true );
 
 		for( unsigned p = 0; p < asPaths.size(); ++p )
 		{
@@ -665,13 +925,13 @@ bool ThemeManager::GetPathInfoToRaw( PathInfo &out, const RString &sThemeName_,
 					case FT_Directory:
 						{
 							RString sXMLPath = asPaths[p] + "/default.xml";
-							if(DoesFileExist(sXMLPath))
+							if(DoesIndexedFileExist(sXMLPath))
 							{
 								asElementPaths.push_back(sXMLPath);
 								break;
 							}
 							RString sLuaPath = asPaths[p] + "/default.lua";
-							if(DoesFileExist(sLuaPath))
+							if(DoesIndexedFileExist(sLuaPath))
 							{
 								asElementPaths.push_back(sLuaPath);
 								break;
@@ -935,6 +1195,7 @@ void ThemeManager::ReloadMetrics()
 	ReloadSubscribers();
 
 	ClearThemePathCache();
+	LuaHelpers::ClearScriptFileCache();
 }
 
 
@@ -942,15 +1203,25 @@ RString ThemeManager::GetMetricsGroupFallback( const RString &sMetricsGroup )
 {
 	ASSERT( g_pLoadedThemeData != nullptr );
 
-	// always look in iniMetrics for "Fallback"
-	RString sFallback;
-	if( !GetMetricRawRecursive(g_pLoadedThemeData->iniMetrics,sMetricsGroup,"Fallback",sFallback) )
-		return RString();
+	Lua *L = LUA->Get( "ThemeManager::GetMetricsGroupFallback" );
+	std::map<RString, RString> &mapFallbacks = g_pLoadedThemeData->mapGroupFallbacks;
+	auto it = mapFallbacks.find( sMetricsGroup );
+	if( it != mapFallbacks.end() )
+	{
+		RString sRet = it->second;
+		LUA->Release( L );
+		return sRet;
+	}
 
-	Lua *L = LUA->Get();
-	LuaHelpers::RunExpression( L, sFallback );
+	// always look in iniMetrics for "Fallback"
 	RString sRet;
-	LuaHelpers::Pop( L, sRet );
+	RString sFallback;
+	if( GetMetricRawRecursive(g_pLoadedThemeData->iniMetrics,sMetricsGroup,"Fallback",sFallback) )
+	{
+		LuaHelpers::RunExpression( L, sFallback );
+		LuaHelpers::Pop( L, sRet );
+	}
+	mapFallbacks[sMetricsGroup] = sRet;
 	LUA->Release( L );
 
 	return sRet;
@@ -1040,7 +1311,7 @@ RString ThemeManager::GetMetricRaw( const IniFile &ini, const RString &sMetricsG
 template<typename T>
 void GetAndConvertMetric( const RString &sMetricsGroup, const RString &sValueName, T &out )
 {
-	Lua *L = LUA->Get();
+	Lua *L = LUA->Get( "ThemeManager::GetMetric" );
 
 	THEME->PushMetric( L, sMetricsGroup, sValueName );
 	LuaHelpers::FromStack( L, out, -1 );
@@ -1092,6 +1363,19 @@ LuaReference ThemeManager::GetMetricR( const RString &sMetricsGroup, const RStri
 	return ref;
 }
 
+/* True if the expression is a number or boolean literal, which will give the
+ * same value every time. */
+static bool IsConstantExpression( const RString &sExpression )
+{
+	if( sExpression == "true" || sExpression == "false" )
+		return true;
+	if( sExpression.empty() || sExpression.find_first_not_of("0123456789.-eE") != RString::npos )
+		return false;
+	char *pEnd;
+	strtod( sExpression.c_str(), &pEnd );
+	return *pEnd == '\0' && pEnd != sExpression.c_str();
+}
+
 void ThemeManager::PushMetric( Lua *L, const RString &sMetricsGroup, const RString &sValueName )
 {
 	if(sMetricsGroup == "" || sValueName == "")
@@ -1100,26 +1384,84 @@ void ThemeManager::PushMetric( Lua *L, const RString &sMetricsGroup, const RStri
 		lua_pushnil(L);
 		return;
 	}
-	RString sValue = GetMetricRaw( g_pLoadedThemeData->iniMetrics, sMetricsGroup, sValueName );
+	++g_iMetricFetches;
 
 	RString sName = ssprintf( "%s::%s", sMetricsGroup.c_str(), sValueName.c_str() );
-	if( EndsWith(sValueName, "Command") )
+	std::map<RString, LoadedThemeData::CompiledMetric> &mapCompiled = g_pLoadedThemeData->mapCompiledMetrics;
+	auto it = mapCompiled.find( sName );
+	if( it != mapCompiled.end() )
 	{
-		LuaHelpers::ParseCommandList( L, sValue, sName, false );
+		++g_iMetricCacheHits;
 	}
 	else
 	{
-		// Remove unary +, eg. "+50"; Lua doesn't support that.
-		if( sValue.size() >= 1 && sValue[0] == '+' )
-			sValue.erase( 0, 1 );
+		RString sValue = GetMetricRaw( g_pLoadedThemeData->iniMetrics, sMetricsGroup, sValueName );
+
+		const bool bCommand = EndsWith( sValueName, "Command" );
+		RString sScript;
+		if( bCommand )
+		{
+			sScript = LuaHelpers::CommandListToScript( sValue, false );
+		}
+		else
+		{
+			// Remove unary +, eg. "+50"; Lua doesn't support that.
+			if( sValue.size() >= 1 && sValue[0] == '+' )
+				sValue.erase( 0, 1 );
+			sScript = "return " + sValue;
+		}
+
+		++g_iMetricCompiles;
+		RString sError;
+		if( !LuaHelpers::LoadScript(L, sScript, sName, sError) )
+		{
+			/* Don't cache errors; compile it the old way, so it's reported
+			 * the same way it always has been. */
+			if( bCommand )
+				LuaHelpers::ParseCommandList( L, sValue, sName, false );
+			else
+				LuaHelpers::RunExpression( L, sValue, sName );
+			return;
+		}
+
+		it = mapCompiled.emplace( sName, LoadedThemeData::CompiledMetric() ).first;
+		LoadedThemeData::CompiledMetric &m = it->second;
+		m.bCommand = bCommand;
+		m.bConstant = !bCommand && IsConstantExpression( sValue );
+		if( m.bConstant )
+			LuaHelpers::RunScriptOnStack( L, sError, 0, 1 );
+		m.Value.SetFromStack( L );
+	}
 
-		LuaHelpers::RunExpression( L, sValue, sName );
+	const LoadedThemeData::CompiledMetric &m = it->second;
+	m.Value.PushSelf( L );
+	if( m.bConstant )
+		return;
+
+	if( m.bCommand )
+	{
+		RString sError;
+		if( !LuaHelpers::RunScriptOnStack(L, sError, 0, 1) )
+			LOG->Warn( "Compiling \"%s\": %s", sName.c_str(), sError.c_str() );
 	}
+	else
+	{
+		RString sError = ssprintf( "Lua runtime error parsing \"%s\": ", sName.c_str() );
+		LuaHelpers::RunScriptOnStack( L, sError, 0, 1, true );
+	}
+}
+
+RString ThemeManager::GetMetricCacheStats() const
+{
+	if( g_iMetricFetches == 0 )
+		return RString();
+	return ssprintf( "%i metric fetches, %i%% cached, %i compiled",
+		g_iMetricFetches, int(int64_t(g_iMetricCacheHits) * 100 / g_iMetricFetches), g_iMetricCompiles );
 }
 
 void ThemeManager::GetMetric( const RString &sMetricsGroup, const RString &sValueName, LuaReference &valueOut )
 {
-	Lua *L = LUA->Get();
+	Lua *L = LUA->Get( "ThemeManager::GetMetric" );
 	PushMetric( L, sMetricsGroup, sValueName );
 	valueOut.SetFromStack( L );
 	LUA->Release( L );
@@ -3,6 +3,7 @@
 
 #include "RageTypes.h"
 #include "LuaReference.h"
+#include "RageFileManager.h"
 
 #include <set>
 #include <vector>
@@ -76,6 +77,15 @@ public:
 	RString GetPathO( const RString &sMetricsGroup, const RString &sElement, bool bOptional=false ) { return GetPath(EC_OTHER,sMetricsGroup,sElement,bOptional); };
 	void ClearThemePathCache();
 
+	/* Answer GetDirListing( sPath + "*", out, false, true ) (or sPath alone
+	 * if bExact) and FILEMAN->GetFileType( sPath ) from the index of the
+	 * loaded themes' element directories.  These return false if sPath isn't
+	 * in one, and the caller should ask the filesystem. */
+	bool GetIndexedFiles( const RString &sPath, bool bExact, std::vector<RString> &asOut );
+	bool GetIndexedFileType( const RString &sPath, RageFileManager::FileType &ftOut );
+	bool DoesIndexedFileExist( const RString &sPath );
+	void RebuildPathIndex();
+
 	bool		HasMetric( const RString &sMetricsGroup, const RString &sValueName );
 	void		PushMetric( Lua *L, const RString &sMetricsGroup, const RString &sValueName );
 	RString		GetMetric( const RString &sMetricsGroup, const RString &sValueName );
@@ -100,6 +110,10 @@ public:
 
 	RString GetMetricsGroupFallback( const RString &sMetricsGroup );
 
+	/* Fetch, cache hit and compile counts for PushMetric, for the stats
+	 * display.  Empty if no metrics have been fetched. */
+	RString GetMetricCacheStats() const;
+
 	static RString GetBlankGraphicPath();
 
 	//needs to be public for its binding to work
@@ -19,22 +19,18 @@ LuaXType( TweenType );
 struct TweenLinear: public ITween
 {
 	float Tween( float f ) const { return f; }
-	ITween *Copy() const { return new TweenLinear(*this); }
 };
 struct TweenAccelerate: public ITween
 {
 	float Tween( float f ) const { return f*f; }
-	ITween *Copy() const { return new TweenAccelerate(*this); }
 };
 struct TweenDecelerate: public ITween
 {
 	float Tween( float f ) const { return 1 - (1-f) * (1-f); }
-	ITween *Copy() const { return new TweenDecelerate(*this); }
 };
 struct TweenSpring: public ITween
 {
 	float Tween( float f ) const { return 1 - std::cos( f*PI*2.5f )/(1+f*3); }
-	ITween *Copy() const { return new TweenSpring(*this); }
 };
 
 
@@ -44,7 +40,6 @@ struct TweenSpring: public ITween
 struct InterpolateBezier1D: public ITween
 {
 	float Tween( float f ) const;
-	ITween *Copy() const { return new InterpolateBezier1D(*this); }
 
 	RageQuadratic m_Bezier;
 };
@@ -60,7 +55,6 @@ float InterpolateBezier1D::Tween( float f ) const
 struct InterpolateBezier2D: public ITween
 {
 	float Tween( float f ) const;
-	ITween *Copy() const { return new InterpolateBezier2D(*this); }
 
 	RageBezier2D m_Bezier;
 };
@@ -76,20 +70,25 @@ float InterpolateBezier2D::Tween( float f ) const
  * used with Bezier to create spline tweens. */
 // InterpolateCompound
 
-ITween *ITween::CreateFromType( TweenType tt )
+ITweenPtr ITween::CreateFromType( TweenType tt )
 {
+	static const ITweenPtr pLinear = std::make_shared<TweenLinear>();
+	static const ITweenPtr pAccelerate = std::make_shared<TweenAccelerate>();
+	static const ITweenPtr pDecelerate = std::make_shared<TweenDecelerate>();
+	static const ITweenPtr pSpring = std::make_shared<TweenSpring>();
+
 	switch( tt )
 	{
-	case TWEEN_LINEAR: return new TweenLinear;
-	case TWEEN_ACCELERATE: return new TweenAccelerate;
-	case TWEEN_DECELERATE: return new TweenDecelerate;
-	case TWEEN_SPRING: return new TweenSpring;
+	case TWEEN_LINEAR: return pLinear;
+	case TWEEN_ACCELERATE: return pAccelerate;
+	case TWEEN_DECELERATE: return pDecelerate;
+	case TWEEN_SPRING: return pSpring;
 	default:
 		FAIL_M(ssprintf("Invalid TweenType: %i", tt));
 	}
 }
 
-ITween *ITween::CreateFromStack( Lua *L, int iStackPos )
+ITweenPtr ITween::CreateFromStack( Lua *L, int iStackPos )
 {
 	TweenType iType = Enum::Check<TweenType>( L, iStackPos );
 	if( iType == TWEEN_BEZIER )
@@ -112,13 +111,13 @@ ITween *ITween::CreateFromStack( Lua *L, int iStackPos )
 		lua_pop( L, iArgs );
 		if( iArgs == 4 )
 		{
-			InterpolateBezier1D *pBezier = new InterpolateBezier1D;
+			auto pBezier = std::make_shared<InterpolateBezier1D>();
 			pBezier->m_Bezier.SetFromBezier( fC[0], fC[1], fC[2], fC[3] );
 			return pBezier;
 		}
 		else if( iArgs == 8 )
 		{
-			InterpolateBezier2D *pBezier = new InterpolateBezier2D;
+			auto pBezier = std::make_shared<InterpolateBezier2D>();
 			pBezier->m_Bezier.SetFromBezier( fC[0], fC[1], fC[2], fC[3], fC[4], fC[5], fC[6], fC[7] );
 			return pBezier;
 		}
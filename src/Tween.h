@@ -3,6 +3,8 @@
 
 #include "EnumHelper.h"
 
+#include <memory>
+
 struct lua_State;
 typedef lua_State Lua;
 
@@ -21,6 +23,10 @@ enum TweenType
 #define FOREACH_TweenType( tt ) FOREACH_ENUM( TweenType, tt )
 LuaDeclareType( TweenType );
 
+class ITween;
+/** @brief Interpolators are immutable, so tweens share them instead of copying. */
+typedef std::shared_ptr<const ITween> ITweenPtr;
+
 /** 
  * @brief The interface for simple interpolation.
  *
@@ -31,10 +37,10 @@ public:
 	/** @brief Create the initial interface. */
 	virtual ~ITween() { }
 	virtual float Tween( float f ) const = 0;
-	virtual ITween *Copy() const = 0;
 
-	static ITween *CreateFromType( TweenType iType );
-	static ITween *CreateFromStack( Lua *L, int iStackPos );
+	/* The plain types return one shared instance each, so they don't allocate. */
+	static ITweenPtr CreateFromType( TweenType iType );
+	static ITweenPtr CreateFromStack( Lua *L, int iStackPos );
 };
 
 #endif
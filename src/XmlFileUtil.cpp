@@ -555,21 +555,21 @@ void XNodeLuaValue::PushValue( lua_State *L ) const
 	m_Value.PushSelf( L );
 }
 
-void XNodeLuaValue::GetValue( RString &out ) const { Lua *L = LUA->Get(); PushValue( L ); LuaHelpers::Pop( L, out ); LUA->Release( L ); }
-void XNodeLuaValue::GetValue( int &out ) const { Lua *L = LUA->Get(); PushValue( L ); LuaHelpers::Pop( L, out ); LUA->Release( L ); }
-void XNodeLuaValue::GetValue( float &out ) const { Lua *L = LUA->Get(); PushValue( L ); LuaHelpers::Pop( L, out ); LUA->Release( L ); }
-void XNodeLuaValue::GetValue( bool &out ) const { Lua *L = LUA->Get(); PushValue( L ); LuaHelpers::Pop( L, out ); LUA->Release( L ); }
-void XNodeLuaValue::GetValue( unsigned &out ) const { Lua *L = LUA->Get(); PushValue( L ); float fVal; LuaHelpers::Pop( L, fVal ); out = unsigned(fVal); LUA->Release( L ); }
+void XNodeLuaValue::GetValue( RString &out ) const { LuaHandle L( "XNodeLuaValue::GetValue" ); PushValue( L ); LuaHelpers::Pop( L, out ); }
+void XNodeLuaValue::GetValue( int &out ) const { LuaHandle L( "XNodeLuaValue::GetValue" ); PushValue( L ); LuaHelpers::Pop( L, out ); }
+void XNodeLuaValue::GetValue( float &out ) const { LuaHandle L( "XNodeLuaValue::GetValue" ); PushValue( L ); LuaHelpers::Pop( L, out ); }
+void XNodeLuaValue::GetValue( bool &out ) const { LuaHandle L( "XNodeLuaValue::GetValue" ); PushValue( L ); LuaHelpers::Pop( L, out ); }
+void XNodeLuaValue::GetValue( unsigned &out ) const { LuaHandle L( "XNodeLuaValue::GetValue" ); PushValue( L ); float fVal; LuaHelpers::Pop( L, fVal ); out = unsigned(fVal); }
 
 void XNodeLuaValue::SetValueFromStack( lua_State *L )
 {
 	m_Value.SetFromStack( L );
 }
 
-void XNodeLuaValue::SetValue( const RString &v ) { Lua *L = LUA->Get(); LuaHelpers::Push( L, v ); SetValueFromStack( L ); LUA->Release( L ); }
-void XNodeLuaValue::SetValue( int v ) { Lua *L = LUA->Get(); LuaHelpers::Push( L, v ); SetValueFromStack( L ); LUA->Release( L ); }
-void XNodeLuaValue::SetValue( float v ) { Lua *L = LUA->Get(); LuaHelpers::Push( L, v ); SetValueFromStack( L ); LUA->Release( L ); }
-void XNodeLuaValue::SetValue( unsigned v ) { Lua *L = LUA->Get(); LuaHelpers::Push( L, (float) v ); SetValueFromStack( L ); LUA->Release( L ); }
+void XNodeLuaValue::SetValue( const RString &v ) { LuaHandle L( "XNodeLuaValue::SetValue" ); LuaHelpers::Push( L, v ); SetValueFromStack( L ); }
+void XNodeLuaValue::SetValue( int v ) { LuaHandle L( "XNodeLuaValue::SetValue" ); LuaHelpers::Push( L, v ); SetValueFromStack( L ); }
+void XNodeLuaValue::SetValue( float v ) { LuaHandle L( "XNodeLuaValue::SetValue" ); LuaHelpers::Push( L, v ); SetValueFromStack( L ); }
+void XNodeLuaValue::SetValue( unsigned v ) { LuaHandle L( "XNodeLuaValue::SetValue" ); LuaHelpers::Push( L, (float) v ); SetValueFromStack( L ); }
 
 namespace
 {
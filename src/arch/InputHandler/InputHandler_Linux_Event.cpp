@@ -4,6 +4,7 @@
 #include "RageUtil.h"
 #include "LinuxInputManager.h"
 #include "GamePreferences.h" //needed for Axis Fix
+#include "Preference.h"
 
 #include <cerrno>
 #include <cstdint>
@@ -24,6 +25,20 @@
 
 REGISTER_INPUT_HANDLER_CLASS2( LinuxEvent, Linux_Event );
 
+/* Log how long events waited between the kernel stamping them and us reading
+ * them, every LATENCY_REPORT_SECONDS. */
+static Preference<bool> g_bLogInputLatency( "LogInputLatency", false );
+static const float LATENCY_REPORT_SECONDS = 10.0f;
+
+/* Newer headers hide the timeval on 32-bit systems with 64-bit time_t. */
+#if defined(input_event_sec)
+#define EVENT_SEC( ev ) (ev).input_event_sec
+#define EVENT_USEC( ev ) (ev).input_event_usec
+#else
+#define EVENT_SEC( ev ) (ev).time.tv_sec
+#define EVENT_USEC( ev ) (ev).time.tv_usec
+#endif
+
 static RString BustypeToString( int iBus )
 {
 	switch( iBus )
@@ -64,6 +79,7 @@ struct EventDevice
 	RString m_sPath;
 	RString m_sName;
 	InputDevice m_Dev;
+	bool m_bKernelTimestamps;
 
 	int aiAbsMin[ABS_MAX];
 	int aiAbsMax[ABS_MAX];
@@ -81,6 +97,7 @@ static bool BitIsSet( const uint8_t *pArray, uint32_t iBit )
 EventDevice::EventDevice()
 {
 	m_iFD = -1;
+	m_bKernelTimestamps = false;
 }
 
 bool EventDevice::Open( RString sFile, InputDevice dev )
@@ -258,6 +275,10 @@ bool EventDevice::Open( RString sFile, InputDevice dev )
 	}
 	LOG->Info( "    Total keys: %i; total axes: %i", iTotalKeys, iTotalAxes );
 
+	m_bKernelTimestamps = LinuxEventClock::SetDeviceClock( m_iFD );
+	if( !m_bKernelTimestamps )
+		LOG->Info( "    Couldn't set the event clock (%s); events are timed when read", strerror(errno) );
+
 	return true;
 }
 
@@ -363,6 +384,7 @@ int InputHandler_Linux_Event::InputThread_Start( void *p )
 
 void InputHandler_Linux_Event::InputThread()
 {
+	RageTimer tmLatencyReport;
 	while( !m_bShutdown )
 	{
 		fd_set fdset;
@@ -391,7 +413,6 @@ void InputHandler_Linux_Event::InputThread()
 		struct timeval zero = {0,100000};
 		if( select(iMaxFD+1, &fdset, nullptr, nullptr, &zero) <= 0 )
 			continue;
-		RageTimer now;
 
 		if( FD_ISSET(m_udev_fd, &fdset) )
 		{
@@ -426,8 +447,9 @@ void InputHandler_Linux_Event::InputThread()
 			if( !FD_ISSET(g_apEventDevices[i]->m_iFD, &fdset) )
 				continue;
 
-			input_event event;
-			int ret = read( g_apEventDevices[i]->m_iFD, &event, sizeof(event) );
+			/* Read everything that's waiting; each event keeps its own time. */
+			input_event events[64];
+			int ret = read( g_apEventDevices[i]->m_iFD, events, sizeof(events) );
 			if( ret == -1 )
 			{
 				LOG->Warn( "Error reading from %s: %s; disabled", g_apEventDevices[i]->m_sPath.c_str(), strerror(errno) );
@@ -438,9 +460,9 @@ void InputHandler_Linux_Event::InputThread()
 				continue;
 			}
 
-			if( ret != sizeof(event) )
+			if( ret == 0 || ret % sizeof(input_event) != 0 )
 			{
-				LOG->Warn("Unexpected packet (size %i != %i) from joystick %i; disabled", ret, (int)sizeof(event), i);
+				LOG->Warn("Unexpected packet (size %i != %i) from joystick %i; disabled", ret, (int)sizeof(input_event), i);
 				g_apEventDevices[i]->Close();
 				m_InputMutex.Lock();
 				m_bDevicesChanged = true;
@@ -448,52 +470,73 @@ void InputHandler_Linux_Event::InputThread()
 				continue;
 			}
 
-			switch (event.type) {
-			case EV_KEY: {
-				int iNum;
-				if (event.code >= BTN_JOYSTICK && event.code <= BTN_JOYSTICK + 0xf) {
-					// These guys have arbitrary names, but the kernel code in hid-input.c maps exactly 0xf of them.
-					iNum = event.code - BTN_JOYSTICK;
-				} else if (event.code >= BTN_GAMEPAD && event.code <= BTN_GAMEPAD + 0x0f) {
-					iNum = event.code - BTN_GAMEPAD;
-				} else if (event.code >= BTN_TRIGGER_HAPPY1 && event.code <= BTN_TRIGGER_HAPPY40) {
-					// Actually, we only have 32 buttons defined.
-					iNum = event.code - BTN_TRIGGER_HAPPY1 + 0x10;
-				} else {
-					// If the button number is >40+0xf, it gets mapped to a code with no #define.
-					// I don't know if this is appropriate at all, but what else to do?
-					iNum = event.code;
-				}
-				wrap( iNum, 32 );	// max number of joystick buttons.  Make this a constant?
-				ButtonPressed( DeviceInput(g_apEventDevices[i]->m_Dev, enum_add2(JOY_BUTTON_1, iNum), event.value != 0, now) );
-				break;
+			m_Clock.Sample();
+			for( int iEvent = 0; iEvent < ret / (int) sizeof(input_event); ++iEvent )
+			{
+				const input_event &event = events[iEvent];
+				RageTimer tm = m_Clock.GetReadTime();
+				if( g_apEventDevices[i]->m_bKernelTimestamps )
+					tm = m_Clock.GetEventTime( EVENT_SEC(event), EVENT_USEC(event) );
+				HandleEvent( i, event, tm );
 			}
+		}
 
-			case EV_ABS: {
-				ASSERT_M( event.code < ABS_MAX, ssprintf("%i", event.code) );
-				DeviceButton neg = g_apEventDevices[i]->aiAbsMappingLow[event.code];
-				DeviceButton pos = g_apEventDevices[i]->aiAbsMappingHigh[event.code];
+		m_Clock.SetCollectLatency( g_bLogInputLatency.Get() );
+		if( tmLatencyReport.Ago() >= LATENCY_REPORT_SECONDS )
+		{
+			tmLatencyReport.Touch();
+			RString sReport = m_Clock.GetLatencyReport();
+			if( g_bLogInputLatency.Get() && !sReport.empty() )
+				LOG->Info( "LinuxEvent: %s", sReport.c_str() );
+		}
+	}
 
-				float l = SCALE( int(event.value), (float) g_apEventDevices[i]->aiAbsMin[event.code], (float) g_apEventDevices[i]->aiAbsMax[event.code], -1.0f, 1.0f );
-				if (GamePreferences::m_AxisFix)
-				{
-				  ButtonPressed( DeviceInput(g_apEventDevices[i]->m_Dev, neg, (l < -0.5)||((l > 0.0001)&&(l < 0.5)), now) ); //Up if between 0.0001 and 0.5 or if less than -0.5
-				  ButtonPressed( DeviceInput(g_apEventDevices[i]->m_Dev, pos, (l > 0.5)||((l > 0.0001)&&(l < 0.5)) , now) ); //Down if between 0.0001 and 0.5 or if more than 0.5
-				}
-				else
-				{
-				  ButtonPressed( DeviceInput(g_apEventDevices[i]->m_Dev, neg, std::max(-l, 0.0f), now) );
-				  ButtonPressed( DeviceInput(g_apEventDevices[i]->m_Dev, pos, std::max(+l, 0.0f), now) );
-				}
-				break;
-			}
-			}
+	InputHandler::UpdateTimer();
+}
 
+void InputHandler_Linux_Event::HandleEvent( int iDevice, const input_event &event, const RageTimer &tm )
+{
+	EventDevice *pDev = g_apEventDevices[iDevice];
+	switch (event.type) {
+	case EV_KEY: {
+		int iNum;
+		if (event.code >= BTN_JOYSTICK && event.code <= BTN_JOYSTICK + 0xf) {
+			// These guys have arbitrary names, but the kernel code in hid-input.c maps exactly 0xf of them.
+			iNum = event.code - BTN_JOYSTICK;
+		} else if (event.code >= BTN_GAMEPAD && event.code <= BTN_GAMEPAD + 0x0f) {
+			iNum = event.code - BTN_GAMEPAD;
+		} else if (event.code >= BTN_TRIGGER_HAPPY1 && event.code <= BTN_TRIGGER_HAPPY40) {
+			// Actually, we only have 32 buttons defined.
+			iNum = event.code - BTN_TRIGGER_HAPPY1 + 0x10;
+		} else {
+			// If the button number is >40+0xf, it gets mapped to a code with no #define.
+			// I don't know if this is appropriate at all, but what else to do?
+			iNum = event.code;
 		}
-
+		wrap( iNum, 32 );	// max number of joystick buttons.  Make this a constant?
+		ButtonPressed( DeviceInput(pDev->m_Dev, enum_add2(JOY_BUTTON_1, iNum), event.value != 0, tm) );
+		break;
 	}
 
-	InputHandler::UpdateTimer();
+	case EV_ABS: {
+		ASSERT_M( event.code < ABS_MAX, ssprintf("%i", event.code) );
+		DeviceButton neg = pDev->aiAbsMappingLow[event.code];
+		DeviceButton pos = pDev->aiAbsMappingHigh[event.code];
+
+		float l = SCALE( int(event.value), (float) pDev->aiAbsMin[event.code], (float) pDev->aiAbsMax[event.code], -1.0f, 1.0f );
+		if (GamePreferences::m_AxisFix)
+		{
+		  ButtonPressed( DeviceInput(pDev->m_Dev, neg, (l < -0.5)||((l > 0.0001)&&(l < 0.5)), tm) ); //Up if between 0.0001 and 0.5 or if less than -0.5
+		  ButtonPressed( DeviceInput(pDev->m_Dev, pos, (l > 0.5)||((l > 0.0001)&&(l < 0.5)) , tm) ); //Down if between 0.0001 and 0.5 or if more than 0.5
+		}
+		else
+		{
+		  ButtonPressed( DeviceInput(pDev->m_Dev, neg, std::max(-l, 0.0f), tm) );
+		  ButtonPressed( DeviceInput(pDev->m_Dev, pos, std::max(+l, 0.0f), tm) );
+		}
+		break;
+	}
+	}
 }
 
 void InputHandler_Linux_Event::GetDevicesAndDescriptions( std::vector<InputDeviceInfo>& vDevicesOut )
@@ -5,10 +5,11 @@
 
 #include "InputHandler.h"
 #include "RageThreads.h"
+#include "LinuxEventClock.h"
 
 #include <vector>
 
-
+struct input_event;
 class InputHandler_Linux_Event: public InputHandler
 {
 public:
@@ -23,8 +24,10 @@ private:
 	void StopThread();
 	static int InputThread_Start( void *p );
 	void InputThread();
+	void HandleEvent( int iDevice, const input_event &event, const RageTimer &tm );
 
 	RageThread m_InputThread;
+	LinuxEventClock m_Clock;	// only used by the input thread
 	// Currently only m_bDevicesChanged is guarded by this mutex
 	RageMutex m_InputMutex;
 	InputDevice m_NextDevice;
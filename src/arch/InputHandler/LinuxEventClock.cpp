@@ -0,0 +1,92 @@
+#include "global.h"
+#include "LinuxEventClock.h"
+#include "RageUtil.h"
+
+#include <algorithm>
+#include <ctime>
+
+#include <sys/ioctl.h>
+#include <linux/input.h>
+
+/* Events older than this were stamped with some other clock.  Real input can
+ * sit unread for a while if the input thread stalls, but not this long. */
+static const int64_t MAX_LATENCY_US = 5000000;
+
+/* Sample() reads the clocks after read() returns, so a valid timestamp is never
+ * later than the read.  Allow for the two clock reads not being simultaneous. */
+static const int64_t MAX_EARLY_US = 1000;
+
+/* Don't let a forgotten report grow without bound. */
+static const size_t MAX_LATENCY_SAMPLES = 100000;
+
+static int64_t ToMicroseconds( const RageTimer &tm )
+{
+	return int64_t(tm.m_secs) * 1000000 + int64_t(tm.m_us);
+}
+
+LinuxEventClock::LinuxEventClock():
+	m_iOffsetUs(0), m_bCollectLatency(false), m_iRejected(0)
+{
+}
+
+bool LinuxEventClock::SetDeviceClock( int iFD )
+{
+#if defined(EVIOCSCLOCKID)
+	int iClock = CLOCK_MONOTONIC;
+	return ioctl( iFD, EVIOCSCLOCKID, &iClock ) == 0;
+#else
+	return false;
+#endif
+}
+
+void LinuxEventClock::Sample()
+{
+	timespec ts;
+	clock_gettime( CLOCK_MONOTONIC, &ts );
+	m_tmRead.Touch();
+	m_iOffsetUs = ToMicroseconds( m_tmRead ) - (int64_t(ts.tv_sec) * 1000000 + ts.tv_nsec / 1000);
+}
+
+RageTimer LinuxEventClock::GetEventTime( int64_t iSec, int64_t iUsec )
+{
+	const int64_t iEventUs = iSec * 1000000 + iUsec + m_iOffsetUs;
+	int64_t iLatencyUs = ToMicroseconds( m_tmRead ) - iEventUs;
+	if( iLatencyUs < -MAX_EARLY_US || iLatencyUs > MAX_LATENCY_US )
+	{
+		++m_iRejected;
+		return m_tmRead;
+	}
+
+	if( iLatencyUs < 0 )
+		return m_tmRead;
+
+	if( m_bCollectLatency && m_vfLatencies.size() < MAX_LATENCY_SAMPLES )
+		m_vfLatencies.push_back( iLatencyUs / 1000.0f );
+	return RageTimer( iEventUs / 1000000, iEventUs % 1000000 );
+}
+
+RString LinuxEventClock::GetLatencyReport()
+{
+	if( m_vfLatencies.empty() && m_iRejected == 0 )
+		return RString();
+
+	RString sRet;
+	if( !m_vfLatencies.empty() )
+	{
+		std::vector<float> &v = m_vfLatencies;
+		std::sort( v.begin(), v.end() );
+		auto Percentile = [&v]( float f ) { return v[std::min( v.size()-1, size_t(v.size() * f) )]; };
+		sRet = ssprintf( "Input latency over %i events: min %.2fms, median %.2fms, 95%% %.2fms, 99%% %.2fms, max %.2fms",
+			(int) v.size(), v.front(), Percentile(0.5f), Percentile(0.95f), Percentile(0.99f), v.back() );
+	}
+	if( m_iRejected != 0 )
+	{
+		if( !sRet.empty() )
+			sRet += "; ";
+		sRet += ssprintf( "%i events had unusable timestamps", m_iRejected );
+	}
+
+	m_vfLatencies.clear();
+	m_iRejected = 0;
+	return sRet;
+}
@@ -0,0 +1,48 @@
+/* LinuxEventClock - Convert evdev event timestamps to RageTimers. */
+
+#ifndef LINUX_EVENT_CLOCK_H
+#define LINUX_EVENT_CLOCK_H
+
+#include "RageTimer.h"
+
+#include <cstdint>
+#include <vector>
+
+/* The kernel stamps each input event when it arrives from the device.  Using
+ * that time, rather than the time we got around to reading it, keeps thread
+ * scheduling delay out of judgments, and gives each event read in a batch its
+ * own time. */
+class LinuxEventClock
+{
+public:
+	LinuxEventClock();
+
+	/* Ask the kernel to stamp iFD's events with CLOCK_MONOTONIC.  Older
+	 * kernels stamp them with the wall clock; GetEventTime notices that and
+	 * uses the read time instead. */
+	static bool SetDeviceClock( int iFD );
+
+	/* Call after each read, before GetEventTime for the events it returned. */
+	void Sample();
+	const RageTimer &GetReadTime() const { return m_tmRead; }
+
+	/* Return the time of an event stamped iSec and iUsec, in RageTimer's clock. */
+	RageTimer GetEventTime( int64_t iSec, int64_t iUsec );
+
+	/* Keep the latency (from the kernel's timestamp to the read) of each
+	 * event, for GetLatencyReport. */
+	void SetCollectLatency( bool bCollect ) { m_bCollectLatency = bCollect; }
+
+	/* Summarize the latencies since the last report, and start over.  Empty
+	 * if there weren't any events. */
+	RString GetLatencyReport();
+
+private:
+	RageTimer m_tmRead;
+	int64_t m_iOffsetUs;	// RageTimer's clock minus CLOCK_MONOTONIC
+	bool m_bCollectLatency;
+	std::vector<float> m_vfLatencies;
+	int m_iRejected;
+};
+
+#endif
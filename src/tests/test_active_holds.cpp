@@ -0,0 +1,209 @@
+#include "global.h"
+#include "ActiveHolds.h"
+#include "NoteData.h"
+#include "RageLog.h"
+#include "RageUtil.h"
+#include "test_misc.h"
+
+#include <cstdlib>
+#include <vector>
+
+/* Play through a chart of overlapping holds and rolls, judging holds as they
+ * end or are let go, with transform attacks midway.  Each frame, check that
+ * ActiveHolds gives the holds Player::Update used to find by walking
+ * NoteData, in the same order, so UpdateHoldNotes is called with the same
+ * holds. */
+
+static const int NUM_COLS = 4;
+static const int NUM_BEATS = 400;
+static const int ROWS_PER_FRAME = 3;
+
+/* The same numbers every run, whatever the global RNG is seeded with. */
+static unsigned g_iSeed = 12345;
+static int SeededInt( int iLow, int iHigh )
+{
+	g_iSeed = g_iSeed * 1103515245 + 12345;
+	return iLow + int((g_iSeed >> 8) % unsigned(iHigh - iLow + 1));
+}
+
+/* A roll of eight beats in column 0 every 32 beats, with holds in the other
+ * columns starting under it, several on the same row, and taps and mines
+ * between. */
+static void MakeChart( NoteData &nd )
+{
+	nd.SetNumTracks( NUM_COLS );
+	for( int iBeat = 0; iBeat < NUM_BEATS; iBeat += 32 )
+		nd.AddHoldNote( 0, BeatToNoteRow(iBeat), BeatToNoteRow(iBeat + 8), TAP_ORIGINAL_ROLL_HEAD );
+
+	for( int iRow = 0; iRow < BeatToNoteRow(NUM_BEATS); iRow += ROWS_PER_BEAT/2 )
+	{
+		for( int t = 1; t < NUM_COLS; ++t )
+		{
+			if( nd.IsHoldNoteAtRow(t, iRow) )
+				continue;
+			switch( SeededInt(0, 9) )
+			{
+			case 0:
+			case 1:
+				nd.AddHoldNote( t, iRow, iRow + SeededInt(1, 12) * ROWS_PER_BEAT/4, TAP_ORIGINAL_HOLD_HEAD );
+				break;
+			case 2:
+				nd.AddHoldNote( t, iRow, iRow + ROWS_PER_BEAT*2, TAP_ORIGINAL_ROLL_HEAD );
+				break;
+			case 3:
+				nd.SetTapNote( t, iRow, TAP_ORIGINAL_MINE );
+				break;
+			case 4:
+			case 5:
+				nd.SetTapNote( t, iRow, TAP_ORIGINAL_TAP );
+				break;
+			}
+		}
+	}
+}
+
+enum Transform
+{
+	TRANSFORM_MIRROR,
+	TRANSFORM_PLANTED
+};
+
+/* Copy nd into a new NoteData, replacing every TapNote, as
+ * NoteDataUtil::TransformNoteData does.  From iStartRow on, mirror the
+ * columns, or turn taps into short holds, as Planted does. */
+static void ApplyTransform( NoteData &nd, Transform transform, int iStartRow )
+{
+	NoteData out;
+	out.SetNumTracks( NUM_COLS );
+	for( int t = 0; t < NUM_COLS; ++t )
+	{
+		for( NoteData::const_iterator it = nd.begin(t); it != nd.end(t); ++it )
+		{
+			TapNote tn = it->second;
+			int iTrack = t;
+			if( it->first >= iStartRow && transform == TRANSFORM_MIRROR )
+			{
+				iTrack = NUM_COLS-1-t;
+			}
+			else if( it->first >= iStartRow && transform == TRANSFORM_PLANTED && tn.type == TapNoteType_Tap )
+			{
+				tn = TAP_ORIGINAL_HOLD_HEAD;
+				tn.iDuration = ROWS_PER_BEAT/4;
+			}
+			out.SetTapNote( iTrack, it->first, tn );
+		}
+	}
+	nd = out;
+}
+
+/* What Player::Update did: every hold head up to iSongRow from the first note
+ * that needs hold judging. */
+static std::vector<TrackRowTapNote> GetHoldsByScan( NoteData &nd, int iSongRow )
+{
+	std::vector<TrackRowTapNote> vHolds;
+	NoteData::all_tracks_iterator iter = nd.GetTapNoteRangeAllTracks( 0, MAX_NOTE_ROW );
+	while( !iter.IsAtEnd() && iter.Row() <= iSongRow &&
+		!(iter->type == TapNoteType_HoldHead && iter->HoldResult.hns == HNS_None) )
+		++iter;
+
+	for( ; !iter.IsAtEnd() && iter.Row() <= iSongRow; ++iter )
+	{
+		if( iter->type != TapNoteType_HoldHead )
+			continue;
+		TrackRowTapNote trtn = { iter.Track(), iter.Row(), &*iter };
+		vHolds.push_back( trtn );
+	}
+	return vHolds;
+}
+
+/* What Player::Update does now. */
+static std::vector<TrackRowTapNote> GetHoldsFromList( ActiveHolds &holds, NoteData &nd, int iSongRow )
+{
+	holds.Update( nd, iSongRow );
+	std::vector<TrackRowTapNote> vHolds;
+	for( const TrackRowTapNote &trtn : holds.Get() )
+	{
+		if( trtn.iRow > iSongRow )
+			break;
+		vHolds.push_back( trtn );
+	}
+	return vHolds;
+}
+
+/* Judge holds as they end, let some go early, and leave the odd hold
+ * unjudged for a while after it ends, so judged holds queue up behind it. */
+static void JudgeHolds( const std::vector<TrackRowTapNote> &vHolds, int iSongRow )
+{
+	for( const TrackRowTapNote &trtn : vHolds )
+	{
+		TapNote &tn = *trtn.pTN;
+		if( tn.HoldResult.hns != HNS_None )
+			continue;
+		const int iEndRow = trtn.iRow + tn.iDuration;
+		if( iSongRow >= iEndRow + (trtn.iRow % 5 == 0? ROWS_PER_BEAT*4 : 0) )
+			tn.HoldResult.hns = HNS_Held;
+		else if( SeededInt(0, 199) == 0 )
+			tn.HoldResult.hns = HNS_LetGo;
+	}
+}
+
+static void test_active_holds()
+{
+	NoteData nd;
+	MakeChart( nd );
+
+	/* Mirror from where the song is, and later add holds from a few beats
+	 * back, behind holds we've already reached. */
+	struct Attack
+	{
+		int iRow;
+		Transform transform;
+		int iStartRow;
+	};
+	const Attack attacks[] =
+	{
+		{ BeatToNoteRow(NUM_BEATS/2) + 7, TRANSFORM_MIRROR, BeatToNoteRow(NUM_BEATS/2) + 7 },
+		{ BeatToNoteRow(NUM_BEATS*3/4) + 5, TRANSFORM_PLANTED, BeatToNoteRow(NUM_BEATS*3/4 - 6) },
+	};
+	unsigned iNextAttack = 0;
+
+	ActiveHolds holds;
+	holds.Reset( 0 );
+	int iMostHolds = 0;
+	for( int iSongRow = 0; iSongRow < BeatToNoteRow(NUM_BEATS + 16); iSongRow += ROWS_PER_FRAME )
+	{
+		if( iNextAttack < ARRAYLEN(attacks) && iSongRow >= attacks[iNextAttack].iRow )
+		{
+			const Attack &a = attacks[iNextAttack++];
+			ApplyTransform( nd, a.transform, a.iStartRow );
+			holds.Rebuild( nd, a.iStartRow );
+		}
+
+		const std::vector<TrackRowTapNote> vExpected = GetHoldsByScan( nd, iSongRow );
+		const std::vector<TrackRowTapNote> vActual = GetHoldsFromList( holds, nd, iSongRow );
+		ASSERT_M( vActual.size() == vExpected.size(), ssprintf("row %i: %i holds, expected %i", iSongRow, (int) vActual.size(), (int) vExpected.size()) );
+		for( unsigned i = 0; i < vExpected.size(); ++i )
+		{
+			const TrackRowTapNote &a = vActual[i], &e = vExpected[i];
+			ASSERT_M( a.iTrack == e.iTrack && a.iRow == e.iRow && a.pTN == e.pTN,
+				ssprintf("row %i, hold %u: %i,%i; expected %i,%i", iSongRow, i, a.iTrack, a.iRow, e.iTrack, e.iRow) );
+		}
+		iMostHolds = std::max( iMostHolds, (int) vExpected.size() );
+
+		JudgeHolds( vExpected, iSongRow );
+	}
+
+	LOG->Info( "%i beats, %i transforms: at most %i holds in a frame",
+		NUM_BEATS, (int) ARRAYLEN(attacks), iMostHolds );
+}
+
+int main( int argc, char *argv[] )
+{
+	test_handle_args( argc, argv );
+	test_init();
+
+	test_active_holds();
+
+	test_deinit();
+	exit(0);
+}
@@ -0,0 +1,125 @@
+#include "global.h"
+#include "arch/InputHandler/LinuxEventClock.h"
+#include "RageLog.h"
+#include "RageTimer.h"
+#include "RageUtil.h"
+#include "test_misc.h"
+
+#include <cmath>
+#include <ctime>
+#include <vector>
+
+#include <unistd.h>
+#include <linux/input.h>
+
+/* Feed evdev events through a pipe, standing in for a device, and check that
+ * LinuxEventClock recovers the time each one was stamped rather than the time
+ * it was read. */
+
+#if defined(input_event_sec)
+#define EVENT_SEC( ev ) (ev).input_event_sec
+#define EVENT_USEC( ev ) (ev).input_event_usec
+#else
+#define EVENT_SEC( ev ) (ev).time.tv_sec
+#define EVENT_USEC( ev ) (ev).time.tv_usec
+#endif
+
+/* Stamp an event the way the kernel would with CLOCK_MONOTONIC, and note when
+ * that was in RageTimer's clock. */
+static input_event MakeEvent( clockid_t clock, RageTimer &tmStamped )
+{
+	input_event ev;
+	memset( &ev, 0, sizeof(ev) );
+	ev.type = EV_KEY;
+	ev.code = BTN_JOYSTICK;
+	ev.value = 1;
+
+	timespec ts;
+	clock_gettime( clock, &ts );
+	tmStamped.Touch();
+	EVENT_SEC( ev ) = ts.tv_sec;
+	EVENT_USEC( ev ) = ts.tv_nsec / 1000;
+	return ev;
+}
+
+static std::vector<RageTimer> ReadEvents( int iFD, LinuxEventClock &clock )
+{
+	input_event events[64];
+	int ret = read( iFD, events, sizeof(events) );
+	ASSERT( ret > 0 && ret % sizeof(input_event) == 0 );
+
+	clock.Sample();
+	std::vector<RageTimer> vRet;
+	for( int i = 0; i < ret / (int) sizeof(input_event); ++i )
+		vRet.push_back( clock.GetEventTime(EVENT_SEC(events[i]), EVENT_USEC(events[i])) );
+	return vRet;
+}
+
+/* Four presses 2ms apart, read in one batch 20ms later. */
+static void test_batched_events( int iRead, int iWrite )
+{
+	LinuxEventClock clock;
+	clock.SetCollectLatency( true );
+
+	const int iNumEvents = 4;
+	std::vector<RageTimer> vStamped( iNumEvents );
+	for( int i = 0; i < iNumEvents; ++i )
+	{
+		input_event ev = MakeEvent( CLOCK_MONOTONIC, vStamped[i] );
+		ASSERT( write(iWrite, &ev, sizeof(ev)) == sizeof(ev) );
+		usleep( 2000 );
+	}
+	usleep( 20000 );
+
+	std::vector<RageTimer> vTimes = ReadEvents( iRead, clock );
+	ASSERT( (int) vTimes.size() == iNumEvents );
+	for( int i = 0; i < iNumEvents; ++i )
+	{
+		const float fError = vTimes[i] - vStamped[i];
+		LOG->Info( "event %i: %.3fms after its stamp; read %.3fms later", i,
+			fError * 1000, (clock.GetReadTime() - vTimes[i]) * 1000 );
+		ASSERT( std::abs(fError) < 0.0005f );
+		if( i > 0 )
+			ASSERT( vTimes[i-1] < vTimes[i] );
+	}
+	ASSERT( clock.GetReadTime() - vTimes.back() >= 0.019f );
+
+	LOG->Info( "%s", clock.GetLatencyReport().c_str() );
+}
+
+/* Events stamped with the wall clock, as on kernels without EVIOCSCLOCKID,
+ * fall back on the read time. */
+static void test_wrong_clock( int iRead, int iWrite )
+{
+	LinuxEventClock clock;
+
+	RageTimer tmStamped;
+	input_event ev = MakeEvent( CLOCK_REALTIME, tmStamped );
+	ASSERT( write(iWrite, &ev, sizeof(ev)) == sizeof(ev) );
+
+	std::vector<RageTimer> vTimes = ReadEvents( iRead, clock );
+	ASSERT( vTimes.size() == 1 );
+	ASSERT( !(vTimes[0] < clock.GetReadTime()) && !(clock.GetReadTime() < vTimes[0]) );
+
+	RString sReport = clock.GetLatencyReport();
+	LOG->Info( "%s", sReport.c_str() );
+	ASSERT( sReport.find("1 events had unusable timestamps") != RString::npos );
+}
+
+int main( int argc, char *argv[] )
+{
+	test_handle_args( argc, argv );
+	test_init();
+
+	int aiPipe[2];
+	ASSERT( pipe(aiPipe) == 0 );
+
+	test_batched_events( aiPipe[0], aiPipe[1] );
+	test_wrong_clock( aiPipe[0], aiPipe[1] );
+
+	close( aiPipe[0] );
+	close( aiPipe[1] );
+
+	test_deinit();
+	exit(0);
+}
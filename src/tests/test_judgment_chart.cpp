@@ -0,0 +1,45 @@
+#include "global.h"
+#include "test_judgment_chart.h"
+
+#include "NoteData.h"
+#include "RageUtil.h"
+#include "TimingData.h"
+
+static unsigned g_iSeed = 12345;
+int SeededRandomInt( int iLow, int iHigh )
+{
+	g_iSeed = g_iSeed * 1103515245 + 12345;
+	return iLow + int((g_iSeed >> 8) % unsigned(iHigh - iLow + 1));
+}
+
+float SeededRandomFloat( float fLow, float fHigh )
+{
+	return SCALE( SeededRandomInt(0, 0xFFFF), 0, 0xFFFF, fLow, fHigh );
+}
+
+void MakeChart( NoteData &nd, TimingData &timing, int iNumNotes )
+{
+	timing.AddSegment( BPMSegment(0, 180) );
+	timing.AddSegment( WarpSegment(BeatToNoteRow(20), 4.0f) );
+	timing.AddSegment( FakeSegment(BeatToNoteRow(40), 8.0f) );
+	timing.AddSegment( BPMSegment(BeatToNoteRow(60), 90) );
+	timing.AddSegment( BPMSegment(BeatToNoteRow(100), 240) );
+	timing.AddSegment( BPMSegment(BeatToNoteRow(140), 150) );
+
+	nd.SetNumTracks( NUM_COLS );
+	for( int i = 0; i < iNumNotes; ++i )
+	{
+		const int iRow = i < 240? i * ROWS_PER_BEAT/4 : BeatToNoteRow(60) + (i-240) * ROWS_PER_BEAT/2;
+		const int iCol = SeededRandomInt( 0, NUM_COLS-1 );
+		if( i % 29 == 0 )
+			nd.SetTapNote( iCol, iRow, TAP_ORIGINAL_MINE );
+		else if( i % 37 == 0 )
+			nd.AddHoldNote( iCol, iRow, iRow + ROWS_PER_BEAT, TAP_ORIGINAL_HOLD_HEAD );
+		else if( i % 17 == 0 )
+			nd.SetTapNote( iCol, iRow, TAP_ORIGINAL_LIFT );
+		else
+			nd.SetTapNote( iCol, iRow, TAP_ORIGINAL_TAP );
+		if( i % 7 == 0 )
+			nd.SetTapNote( (iCol+2) % NUM_COLS, iRow, TAP_ORIGINAL_TAP );
+	}
+}
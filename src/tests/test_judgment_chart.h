@@ -0,0 +1,20 @@
+/* test_judgment_chart - The chart and random steps the judgment tests share. */
+
+#ifndef TEST_JUDGMENT_CHART_H
+#define TEST_JUDGMENT_CHART_H
+
+class NoteData;
+class TimingData;
+
+/* Random numbers that don't depend on the global RNG, so tests see the same
+ * sequence every run. */
+int SeededRandomInt( int iLow, int iHigh );
+float SeededRandomFloat( float fLow, float fHigh );
+
+/* iNumNotes notes in NUM_COLS columns, sixteenths at 180 BPM and then eighths
+ * through BPM changes, with mines, lifts, holds, a warp and a fake section to
+ * skip. */
+const int NUM_COLS = 4;
+void MakeChart( NoteData &nd, TimingData &timing, int iNumNotes );
+
+#endif
@@ -0,0 +1,221 @@
+#include "global.h"
+#include "JudgmentIndex.h"
+#include "NoteData.h"
+#include "RageLog.h"
+#include "RageTimer.h"
+#include "RageUtil.h"
+#include "TimingData.h"
+#include "test_judgment_chart.h"
+#include "test_misc.h"
+
+#include <cmath>
+#include <cstdlib>
+#include <vector>
+
+/* Step 100k times through a marathon chart, finding each step's note the way
+ * Player::Step used to, by searching NoteData, and with a JudgmentIndex.  Check
+ * that both find the same notes, and report how long each takes per step.
+ * Then check that the notes' times follow changes to the song's offset. */
+
+static const int NUM_STEPS = 100000;
+
+/* About two hours of a marathon chart. */
+static const int NUM_NOTES = 38000;
+
+struct Press
+{
+	int iCol;
+	int iRow;
+};
+
+/* Steps in song order, up to a beat off, with the odd one out of order. */
+static std::vector<Press> MakePresses( int iLastRow )
+{
+	std::vector<Press> vPresses;
+	for( int i = 0; i < NUM_STEPS; ++i )
+	{
+		Press p;
+		p.iCol = SeededRandomInt( 0, NUM_COLS-1 );
+		p.iRow = (int) ((int64_t) iLastRow * i / NUM_STEPS) + SeededRandomInt( -ROWS_PER_BEAT, ROWS_PER_BEAT );
+		if( i % 50 == 0 )
+			p.iRow -= ROWS_PER_BEAT * 8;
+		vPresses.push_back( p );
+	}
+	return vPresses;
+}
+
+/* What Player::GetClosestNoteDirectional did. */
+static int GetClosestNoteDirectional( const NoteData &nd, const TimingData &timing, int col, int iStartRow, int iEndRow, bool bForward )
+{
+	NoteData::const_iterator begin, end;
+	nd.GetTapNoteRange( col, iStartRow, iEndRow, begin, end );
+
+	if( !bForward )
+		swap( begin, end );
+
+	while( begin != end )
+	{
+		if( !bForward )
+			--begin;
+
+		do {
+			const TapNote &tn = begin->second;
+			if( !timing.IsJudgableAtRow(begin->first) )
+				break;
+			if( tn.type == TapNoteType_Empty || tn.type == TapNoteType_AutoKeysound )
+				break;
+			if( tn.result.tns != TNS_None )
+				break;
+
+			return begin->first;
+		} while(0);
+
+		if( bForward )
+			++begin;
+	}
+
+	return -1;
+}
+
+static int GetClosestNote( const NoteData &nd, const TimingData &timing, int col, int iNoteRow, int iMaxRowsAhead, int iMaxRowsBehind )
+{
+	int iNextIndex = GetClosestNoteDirectional( nd, timing, col, iNoteRow, iNoteRow+iMaxRowsAhead, true );
+	int iPrevIndex = GetClosestNoteDirectional( nd, timing, col, iNoteRow-iMaxRowsBehind, iNoteRow, false );
+
+	if( iNextIndex == -1 && iPrevIndex == -1 )
+		return -1;
+	if( iNextIndex == -1 )
+		return iPrevIndex;
+	if( iPrevIndex == -1 )
+		return iNextIndex;
+
+	if( std::abs(iNoteRow-iNextIndex) > std::abs(iNoteRow-iPrevIndex) )
+		return iPrevIndex;
+	else
+		return iNextIndex;
+}
+
+/* Judge every step against nd, searching with the method given, and return
+ * the row and time of each note found.  Every other note found is scored, so
+ * later steps have to skip it. */
+template<typename Find>
+static double RunPresses( NoteData &nd, const std::vector<Press> &vPresses, std::vector<float> &vOut, Find find )
+{
+	vOut.clear();
+	vOut.reserve( vPresses.size() * 2 );
+	const uint64_t iStart = RageTimer::GetTimeSinceStartMicroseconds();
+	for( unsigned i = 0; i < vPresses.size(); ++i )
+	{
+		const Press &p = vPresses[i];
+		int iRow;
+		float fSeconds;
+		TapNote *pTN = find( p, iRow, fSeconds );
+		vOut.push_back( float(iRow) );
+		vOut.push_back( fSeconds );
+		if( pTN != nullptr && i % 2 == 0 )
+			pTN->result.tns = TNS_W1;
+	}
+	const uint64_t iEnd = RageTimer::GetTimeSinceStartMicroseconds();
+
+	// Put it back for the next run.
+	for( int t = 0; t < nd.GetNumTracks(); ++t )
+		for( NoteData::iterator it = nd.begin(t); it != nd.end(t); ++it )
+			it->second.result.tns = TNS_None;
+
+	return (iEnd - iStart) * 1000.0 / vPresses.size();
+}
+
+static void test_index()
+{
+	NoteData nd;
+	TimingData timing;
+	MakeChart( nd, timing, NUM_NOTES );
+	const std::vector<Press> vPresses = MakePresses( nd.GetLastRow() );
+
+	/* About what Step searches either side of a step at 180 BPM. */
+	const int iSearchRows = BeatToNoteRow( 3 ) + ROWS_PER_BEAT;
+
+	std::vector<float> vExpected;
+	const double fMapNs = RunPresses( nd, vPresses, vExpected, [&]( const Press &p, int &iRow, float &fSeconds ) -> TapNote* {
+		iRow = GetClosestNote( nd, timing, p.iCol, p.iRow, iSearchRows, iSearchRows );
+		if( iRow == -1 )
+		{
+			fSeconds = 0;
+			return nullptr;
+		}
+		fSeconds = timing.GetElapsedTimeFromBeat( NoteRowToBeat(iRow) );
+		return &nd.FindTapNote( p.iCol, iRow )->second;
+	} );
+
+	const uint64_t iLoadStart = RageTimer::GetTimeSinceStartMicroseconds();
+	JudgmentIndex index;
+	index.Load( nd, timing );
+	const uint64_t iLoadEnd = RageTimer::GetTimeSinceStartMicroseconds();
+
+	std::vector<float> vActual;
+	const double fIndexNs = RunPresses( nd, vPresses, vActual, [&]( const Press &p, int &iRow, float &fSeconds ) -> TapNote* {
+		const JudgmentIndex::Note *pNote = index.GetClosestNote( p.iCol, p.iRow, iSearchRows, iSearchRows,
+			[]( const JudgmentIndex::Note &note ) { return note.pTN->result.tns != TNS_None; } );
+		iRow = pNote != nullptr? pNote->iRow:-1;
+		fSeconds = pNote != nullptr? index.GetSeconds(*pNote):0;
+		return pNote != nullptr? pNote->pTN:nullptr;
+	} );
+
+	ASSERT( vExpected.size() == vActual.size() );
+	int iFound = 0;
+	for( unsigned i = 0; i < vExpected.size(); i += 2 )
+	{
+		ASSERT_M( vExpected[i] == vActual[i] && vExpected[i+1] == vActual[i+1],
+			ssprintf("press %u: row %.0f at %f; expected row %.0f at %f", i/2, vActual[i], vActual[i+1], vExpected[i], vExpected[i+1]) );
+		if( vActual[i] != -1 )
+			++iFound;
+	}
+
+	LOG->Info( "%i presses, %i on notes: NoteData search %.0fns per press, JudgmentIndex %.0fns per press (loaded in %.1fms)",
+		(int) vPresses.size(), iFound, fMapNs, fIndexNs, (iLoadEnd - iLoadStart) / 1000.0 );
+}
+
+/* Autosync and the sync overlay move the song's offset after the index is
+ * loaded.  Step 10ms late on every note after each move, and check that the
+ * step is timed against where the note is now. */
+static void test_offset_change()
+{
+	NoteData nd;
+	TimingData timing;
+	MakeChart( nd, timing, 1000 );
+	JudgmentIndex index;
+	index.Load( nd, timing );
+
+	for( float fDelta : { 0.0f, 0.05f, -0.12f } )
+	{
+		timing.m_fBeat0OffsetInSeconds += fDelta;
+		for( int t = 0; t < index.GetNumTracks(); ++t )
+		{
+			for( const JudgmentIndex::Note &note : index.GetNotes(t) )
+			{
+				const float fStepSeconds = timing.GetElapsedTimeFromBeat( NoteRowToBeat(note.iRow) ) + 0.01f;
+				const int iStepRow = BeatToNoteRow( timing.GetBeatFromElapsedTime(fStepSeconds) );
+				const JudgmentIndex::Note *pNote = index.GetClosestNote( t, iStepRow, ROWS_PER_BEAT, ROWS_PER_BEAT,
+					[]( const JudgmentIndex::Note & ) { return false; } );
+				ASSERT_M( pNote == &note, ssprintf("offset %f: step at row %i found row %i, expected %i", timing.m_fBeat0OffsetInSeconds,
+					iStepRow, pNote != nullptr? pNote->iRow:-1, note.iRow) );
+
+				const float fNoteOffset = index.GetSeconds( *pNote ) - fStepSeconds;
+				ASSERT_M( std::abs(fNoteOffset + 0.01f) < 0.0001f, ssprintf("offset %f: row %i stepped on %f off, expected -0.01",
+					timing.m_fBeat0OffsetInSeconds, note.iRow, fNoteOffset) );
+			}
+		}
+	}
+}
+
+int main( int argc, char *argv[] )
+{
+	test_handle_args( argc, argv );
+	test_init();
+
+	test_index();
+	test_offset_change();
+
+	test_deinit();
+	exit(0);
+}
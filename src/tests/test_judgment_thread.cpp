@@ -0,0 +1,266 @@
+#include "global.h"
+#include "JudgmentThread.h"
+#include "NoteData.h"
+#include "RageLog.h"
+#include "RageTimer.h"
+#include "RageUtil.h"
+#include "TimingData.h"
+#include "test_judgment_chart.h"
+#include "test_misc.h"
+
+#include <algorithm>
+#include <cmath>
+#include <memory>
+#include <vector>
+
+/* Record a replay of steps against a chart, then judge it directly and play
+ * it back through the JudgmentThread with steady and badly dropped frames,
+ * and check that every step is judged the way Player::Step would. */
+
+/* A couple of minutes, through all of the chart's BPM changes. */
+static const int NUM_NOTES = 800;
+static const DeviceButton g_Keys[NUM_COLS] = { KEY_Ca, KEY_Cs, KEY_Cd, KEY_Cf };
+
+struct ReplayStep
+{
+	float fSeconds;
+	int iCol;
+	bool bRelease;
+};
+
+struct Chart
+{
+	TimingData timing;
+	std::vector<std::vector<JudgmentSnapshot::Note>> vvNotes;
+};
+
+static StepJudgeParams MakeParams()
+{
+	StepJudgeParams params;
+	for( int tw = 0; tw < NUM_TimingWindow; ++tw )
+		params.fWindowSeconds[tw] = 0.1f;
+	params.fWindowSeconds[TW_W1] = 0.0225f;
+	params.fWindowSeconds[TW_W2] = 0.045f;
+	params.fWindowSeconds[TW_W3] = 0.090f;
+	params.fWindowSeconds[TW_W4] = 0.135f;
+	params.fWindowSeconds[TW_W5] = 0.180f;
+	params.fWindowSeconds[TW_Mine] = 0.090f;
+	params.bRequireStepOnMines = false;
+	params.bRequireStepOnHoldHeads = true;
+	return params;
+}
+
+/* The notes a step can land on, as Player::RebuildJudgmentSnapshot lists
+ * them: everything but the warp and the fake section. */
+static void LoadChart( Chart &chart )
+{
+	NoteData nd;
+	MakeChart( nd, chart.timing, NUM_NOTES );
+
+	chart.vvNotes.assign( NUM_COLS, std::vector<JudgmentSnapshot::Note>() );
+	for( int t = 0; t < NUM_COLS; ++t )
+	{
+		for( NoteData::const_iterator it = nd.begin(t); it != nd.end(t); ++it )
+		{
+			if( !chart.timing.IsJudgableAtRow(it->first) )
+				continue;
+
+			JudgmentSnapshot::Note note;
+			note.iRow = it->first;
+			note.fSeconds = chart.timing.GetElapsedTimeFromBeatNoOffset( NoteRowToBeat(it->first) );
+			note.type = it->second.type;
+			note.bJudged = false;
+			chart.vvNotes[t].push_back( note );
+		}
+	}
+}
+
+/* Step on most notes, off by up to 150ms, let go 50ms later, and throw in some
+ * steps between notes. */
+static std::vector<ReplayStep> RecordReplay( const Chart &chart )
+{
+	std::vector<ReplayStep> vNotes;
+	for( int t = 0; t < NUM_COLS; ++t )
+		for( const JudgmentSnapshot::Note &note : chart.vvNotes[t] )
+			vNotes.push_back( ReplayStep{ note.fSeconds, t, false } );
+	std::stable_sort( vNotes.begin(), vNotes.end(), []( const ReplayStep &a, const ReplayStep &b ) { return a.fSeconds < b.fSeconds; } );
+
+	std::vector<ReplayStep> vSteps;
+	for( const ReplayStep &note : vNotes )
+	{
+		const float fNote = note.fSeconds;
+		const int iCol = note.iCol;
+		if( SeededRandomFloat(0, 1) < 0.3f )
+			vSteps.push_back( ReplayStep{ fNote + SeededRandomFloat(0, 0.4f), SeededRandomInt(0, NUM_COLS-1), false } );
+		if( SeededRandomFloat(0, 1) < 0.1f )
+			continue;
+
+		const float fPress = fNote + SeededRandomFloat( -0.15f, 0.15f );
+		vSteps.push_back( ReplayStep{ fPress, iCol, false } );
+		vSteps.push_back( ReplayStep{ fPress + 0.05f, iCol, true } );
+		if( SeededRandomFloat(0, 1) < 0.1f )
+			vSteps.push_back( ReplayStep{ fPress + 0.06f, (iCol+1) % NUM_COLS, false } );
+	}
+	std::stable_sort( vSteps.begin(), vSteps.end(), []( const ReplayStep &a, const ReplayStep &b ) { return a.fSeconds < b.fSeconds; } );
+	return vSteps;
+}
+
+/* What Player::Step does: put the step on a row, and score it against the
+ * closest unjudged note by row within the search distance, taking the note
+ * ahead if they're the same distance. */
+static std::vector<ThreadedStep> JudgeByRow( const Chart &chart, const std::vector<ReplayStep> &vSteps )
+{
+	const TimingData &timing = chart.timing;
+	std::vector<std::vector<JudgmentSnapshot::Note>> vvNotes = chart.vvNotes;
+	const StepJudgeParams params = MakeParams();
+	auto GetRow = [&timing]( float fSeconds ) { return BeatToNoteRow( timing.GetBeatFromElapsedTimeNoOffset(fSeconds) ); };
+
+	std::vector<ThreadedStep> vResults;
+	for( const ReplayStep &s : vSteps )
+	{
+		const int iStepRow = GetRow( s.fSeconds );
+		const int iSearchRows = std::max( GetRow(s.fSeconds + 1) - iStepRow, iStepRow - GetRow(s.fSeconds - 1) ) + ROWS_PER_BEAT;
+
+		JudgmentSnapshot::Note *pNext = nullptr, *pPrev = nullptr;
+		for( JudgmentSnapshot::Note &note : vvNotes[s.iCol] )
+		{
+			if( note.bJudged )
+				continue;
+			if( pNext == nullptr && note.iRow >= iStepRow && note.iRow < iStepRow + iSearchRows )
+				pNext = &note;
+			if( note.iRow < iStepRow && note.iRow >= iStepRow - iSearchRows )
+				pPrev = &note;
+		}
+
+		JudgmentSnapshot::Note *pNote = pNext;
+		if( pNext == nullptr || (pPrev != nullptr && pNext->iRow - iStepRow > iStepRow - pPrev->iRow) )
+			pNote = pPrev;
+
+		ThreadedStep step;
+		step.iCol = s.iCol;
+		step.bRelease = s.bRelease;
+		step.iRow = -1;
+		step.fNoteOffset = 0;
+		step.tns = TNS_None;
+		if( pNote != nullptr )
+		{
+			step.iRow = pNote->iRow;
+			step.fNoteOffset = pNote->fSeconds - s.fSeconds;
+			step.tns = JudgeHumanStep( params, pNote->type, false, step.fNoteOffset, false, s.bRelease );
+			if( step.tns != TNS_None )
+				pNote->bJudged = true;
+		}
+		vResults.push_back( step );
+	}
+	return vResults;
+}
+
+static std::vector<ThreadedStep> JudgeDirectly( const Chart &chart, const std::vector<ReplayStep> &vSteps )
+{
+	JudgmentSnapshot snapshot( chart.vvNotes, chart.timing, 0, MakeParams(), 1 );
+	std::vector<ThreadedStep> vResults;
+	for( const ReplayStep &s : vSteps )
+	{
+		ThreadedStep step;
+		step.iCol = s.iCol;
+		step.bRelease = s.bRelease;
+		snapshot.Judge( s.iCol, s.fSeconds, 1.0f, s.bRelease, step );
+		vResults.push_back( step );
+	}
+	return vResults;
+}
+
+/* Play the replay in frames as long as fMinFrame to fMaxFrame, with the music
+ * starting at tmStart.  Steps are reported as they happen, and the results
+ * collected once a frame, as Player does. */
+static std::vector<ThreadedStep> JudgeOnThread( const Chart &chart, const std::vector<ReplayStep> &vSteps, float fMinFrame, float fMaxFrame )
+{
+	std::vector<JudgmentThread::StepButton> vButtons;
+	for( int c = 0; c < NUM_COLS; ++c )
+		vButtons.push_back( JudgmentThread::StepButton{ DeviceInput(DEVICE_KEYBOARD, g_Keys[c]), PLAYER_1, c } );
+
+	JudgmentThread thread;
+	thread.Start( vButtons );
+	thread.SetSnapshot( PLAYER_1, std::make_shared<JudgmentSnapshot>(chart.vvNotes, chart.timing, 0, MakeParams(), 1) );
+
+	const RageTimer tmStart( 1000, 0 );
+	std::vector<ThreadedStep> vResults;
+	unsigned iNextStep = 0;
+	float fNow = 0;
+	RageTimer tmTimeout;
+	while( vResults.size() < vSteps.size() )
+	{
+		ASSERT( tmTimeout.Ago() < 30 );
+
+		thread.SetPosition( PLAYER_1, fNow, tmStart + fNow, 1.0f, true );
+
+		for( ; iNextStep < vSteps.size() && vSteps[iNextStep].fSeconds <= fNow; ++iNextStep )
+		{
+			const ReplayStep &s = vSteps[iNextStep];
+			InputEvent ie;
+			ie.di = DeviceInput( DEVICE_KEYBOARD, g_Keys[s.iCol], s.bRelease? 0.0f:1.0f, tmStart + s.fSeconds );
+			ie.type = s.bRelease? IET_RELEASE:IET_FIRST_PRESS;
+			while( !thread.TapInputEvent(ie) )
+				usleep( 1000 );
+		}
+
+		/* Give the thread a moment, so results arrive across frames. */
+		usleep( 200 );
+		ThreadedStep step;
+		while( thread.GetJudgedStep(PLAYER_1, step) )
+			vResults.push_back( step );
+
+		if( iNextStep < vSteps.size() )
+			fNow += SeededRandomFloat( fMinFrame, fMaxFrame );
+	}
+	thread.Stop();
+
+	ThreadedStep extra;
+	ASSERT( !thread.GetJudgedStep(PLAYER_1, extra) );
+	return vResults;
+}
+
+static void CompareResults( const RString &sTitle, const std::vector<ReplayStep> &vSteps,
+	const std::vector<ThreadedStep> &vExpected, const std::vector<ThreadedStep> &vActual )
+{
+	ASSERT( vExpected.size() == vActual.size() );
+	int aiCounts[NUM_TapNoteScore] = { 0 };
+	for( unsigned i = 0; i < vExpected.size(); ++i )
+	{
+		const ThreadedStep &e = vExpected[i];
+		const ThreadedStep &a = vActual[i];
+		ASSERT_M( a.iCol == vSteps[i].iCol && a.bRelease == vSteps[i].bRelease, ssprintf("step %u out of order", i) );
+		ASSERT_M( a.iRow == e.iRow && a.tns == e.tns,
+			ssprintf("step %u: row %i, %s; expected row %i, %s", i, a.iRow,
+				TapNoteScoreToString(a.tns).c_str(), e.iRow, TapNoteScoreToString(e.tns).c_str()) );
+		ASSERT_M( std::abs(a.fNoteOffset - e.fNoteOffset) < 0.0001f, ssprintf("step %u: offset %f, expected %f", i, a.fNoteOffset, e.fNoteOffset) );
+		++aiCounts[a.tns];
+	}
+
+	LOG->Info( "%s: %u steps; W1 %i, W2 %i, W3 %i, W4 %i, W5 %i, mines %i, unscored %i", sTitle.c_str(),
+		(unsigned) vActual.size(), aiCounts[TNS_W1], aiCounts[TNS_W2], aiCounts[TNS_W3],
+		aiCounts[TNS_W4], aiCounts[TNS_W5], aiCounts[TNS_HitMine], aiCounts[TNS_None] );
+}
+
+static void test_replay()
+{
+	Chart chart;
+	LoadChart( chart );
+	const std::vector<ReplayStep> vSteps = RecordReplay( chart );
+	const std::vector<ThreadedStep> vExpected = JudgeByRow( chart, vSteps );
+
+	CompareResults( "direct", vSteps, vExpected, JudgeDirectly(chart, vSteps) );
+	CompareResults( "60fps", vSteps, vExpected, JudgeOnThread(chart, vSteps, 1/60.0f, 1/60.0f) );
+	CompareResults( "5-250ms frames", vSteps, vExpected, JudgeOnThread(chart, vSteps, 0.005f, 0.25f) );
+}
+
+int main( int argc, char *argv[] )
+{
+	test_handle_args( argc, argv );
+	test_init();
+
+	test_replay();
+
+	test_deinit();
+	exit(0);
+}
@@ -0,0 +1,258 @@
+#include "global.h"
+#include "LifeRecord.h"
+#include "RageLog.h"
+#include "RageUtil.h"
+#include "test_misc.h"
+
+#include <cmath>
+#include <cstdlib>
+#include <map>
+#include <vector>
+
+/* Check that LifeRecord reads exactly as the map of every change it replaced
+ * for a song, keeps the lowest and highest life of each span once it has
+ * downsampled, and stays small over an hour of endless play. */
+
+/* PlayerStageStats' life record before LifeRecord. */
+class MapLifeRecord
+{
+public:
+	void Add( float fSecond, float fLife )
+	{
+		std::map<float, float>::iterator curr = m_Record.find( fSecond );
+		if( curr != m_Record.end() && curr->second != fLife )
+			m_Record[fSecond - 0.00390625f] = curr->second;
+		m_Record[fSecond] = fLife;
+
+		std::map<float, float>::iterator C = m_Record.end();
+		--C;
+		if( C == m_Record.begin() )
+			return;
+		std::map<float, float>::iterator B = C;
+		--B;
+		if( B == m_Record.begin() )
+			return;
+		std::map<float, float>::iterator A = B;
+		--A;
+		if( A->second == B->second && B->second == C->second )
+			m_Record.erase( B );
+	}
+
+	float GetAt( float fSecond ) const
+	{
+		std::map<float, float>::const_iterator it = m_Record.upper_bound( fSecond );
+		if( it != m_Record.begin() )
+			--it;
+		return it->second;
+	}
+
+	float GetLerpAt( float fSecond ) const
+	{
+		std::map<float, float>::const_iterator later = m_Record.upper_bound( fSecond );
+		std::map<float, float>::const_iterator earlier = later;
+		if( earlier != m_Record.begin() )
+			--earlier;
+		if( later == m_Record.end() || earlier->first == later->first )
+			return earlier->second;
+		return SCALE( fSecond, earlier->first, later->first, earlier->second, later->second );
+	}
+
+	unsigned GetSize() const { return (unsigned) m_Record.size(); }
+
+private:
+	std::map<float, float> m_Record;
+};
+
+/* The same numbers every run, whatever the global RNG is seeded with. */
+static unsigned g_iSeed = 12345;
+static float SeededFloat( float fLow, float fHigh )
+{
+	g_iSeed = g_iSeed * 1103515245 + 12345;
+	return SCALE( (g_iSeed >> 8) & 0xFFFF, 0, 0xFFFF, fLow, fHigh );
+}
+
+/* A life that always differs from the last, so no record is dropped as
+ * redundant. */
+static float NextLife( float fLast )
+{
+	float fLife = SeededFloat( 0, 1 );
+	if( fLife == fLast )
+		fLife = fLast * 0.5f;
+	return fLife;
+}
+
+/* Two minutes at 60fps: a judgment on most frames, life topping out at full
+ * for stretches, and now and then a tap and a hold judged on the same frame. */
+static void test_song()
+{
+	LifeRecord record;
+	MapLifeRecord ref;
+	std::vector<float> vSeconds;
+
+	float fLife = 0.5f;
+	for( int iFrame = 0; iFrame < 120*60; ++iFrame )
+	{
+		const float fSecond = iFrame / 60.0f;
+		int iJudgments = SeededFloat(0, 1) < 0.3f? 1:0;
+		if( iJudgments && SeededFloat(0, 1) < 0.05f )
+			++iJudgments;
+
+		for( int j = 0; j < iJudgments; ++j )
+		{
+			if( SeededFloat(0, 1) < 0.1f )
+				fLife = std::max( fLife - 0.08f, 0.0f );
+			else
+				fLife = std::min( fLife + 0.008f, 1.0f );
+			record.Add( fSecond, fLife );
+			ref.Add( fSecond, fLife );
+		}
+		vSeconds.push_back( fSecond );
+	}
+
+	ASSERT_M( record.GetBucketSeconds() == 1/256.0f, ssprintf("%f", record.GetBucketSeconds()) );
+	ASSERT_M( record.GetNumBuckets() == ref.GetSize(), ssprintf("%u buckets, %u records", record.GetNumBuckets(), ref.GetSize()) );
+
+	/* At every frame, a little after, and most of a frame after. */
+	for( float fSecond : vSeconds )
+	{
+		for( float fAfter : { 0.0f, 0.002f, 0.015f } )
+		{
+			const float f = fSecond + fAfter;
+			ASSERT_M( record.GetAt(f) == ref.GetAt(f), ssprintf("%f: %f, expected %f", f, record.GetAt(f), ref.GetAt(f)) );
+			ASSERT_M( record.GetLerpAt(f) == ref.GetLerpAt(f), ssprintf("%f: %f, expected %f", f, record.GetLerpAt(f), ref.GetLerpAt(f)) );
+		}
+	}
+
+	/* As PlayerStageStats::GetLifeRecord samples it. */
+	const int iSamples = 1000;
+	std::vector<float> vLife( iSamples );
+	record.GetLerpSamples( &vLife[0], iSamples, 120, (float) iSamples );
+	for( int i = 0; i < iSamples; ++i )
+	{
+		const float f = SCALE( i, 0, (float) iSamples, 0.0f, 120.0f );
+		ASSERT_M( vLife[i] == ref.GetLerpAt(f), ssprintf("sample %i: %f, expected %f", i, vLife[i], ref.GetLerpAt(f)) );
+	}
+
+	LOG->Info( "song: %u buckets", record.GetNumBuckets() );
+}
+
+/* The lowest and highest of the records in each of iNumSamples spans up to
+ * fEndSecond, and the life carried into it. */
+static void GetRangeReference( const std::vector<float> &vLives, float fRecordSeconds,
+	std::vector<float> &vMin, std::vector<float> &vMax, int iNumSamples, float fEndSecond )
+{
+	vMin.assign( iNumSamples, 0 );
+	vMax.assign( iNumSamples, 0 );
+	unsigned iRecord = 0;
+	float fLife = vLives[0];
+	for( int i = 0; i < iNumSamples; ++i )
+	{
+		const float fFrom = SCALE( i, 0, (float)iNumSamples, 0.0f, fEndSecond );
+		const float fTo = SCALE( i+1, 0, (float)iNumSamples, 0.0f, fEndSecond );
+		while( iRecord < vLives.size() && iRecord * fRecordSeconds < fFrom )
+			fLife = vLives[iRecord++];
+		vMin[i] = vMax[i] = fLife;
+		while( iRecord < vLives.size() && iRecord * fRecordSeconds < fTo )
+		{
+			fLife = vLives[iRecord++];
+			vMin[i] = std::min( vMin[i], fLife );
+			vMax[i] = std::max( vMax[i], fLife );
+		}
+	}
+}
+
+/* Check the ranges of spans fSpanSeconds wide, which must be a whole number of
+ * buckets, against records fRecordSeconds apart. */
+static void CheckRanges( const LifeRecord &record, const std::vector<float> &vLives, float fRecordSeconds, float fSpanSeconds )
+{
+	const int iNumSamples = (int) ceilf( vLives.size() * fRecordSeconds / fSpanSeconds );
+	const float fEndSecond = iNumSamples * fSpanSeconds;
+	std::vector<float> vMin( iNumSamples ), vMax( iNumSamples ), vExpectedMin, vExpectedMax;
+	record.GetRangeSamples( &vMin[0], &vMax[0], iNumSamples, fEndSecond );
+	GetRangeReference( vLives, fRecordSeconds, vExpectedMin, vExpectedMax, iNumSamples, fEndSecond );
+	for( int i = 0; i < iNumSamples; ++i )
+	{
+		ASSERT_M( vMin[i] == vExpectedMin[i] && vMax[i] == vExpectedMax[i],
+			ssprintf("span %i: %f-%f, expected %f-%f", i, vMin[i], vMax[i], vExpectedMin[i], vExpectedMax[i]) );
+	}
+}
+
+/* Records 1/128s apart fill a bucket each until MAX_BUCKETS; the next one
+ * doubles the width until neighbours merge. */
+static void test_downsample()
+{
+	const float fRecordSeconds = 1/128.0f;
+	LifeRecord record;
+	std::vector<float> vLives;
+	float fLife = 0.5f;
+	for( unsigned i = 0; i < LifeRecord::MAX_BUCKETS; ++i )
+	{
+		fLife = NextLife( fLife );
+		vLives.push_back( fLife );
+		record.Add( i * fRecordSeconds, fLife );
+	}
+
+	ASSERT_M( record.GetNumBuckets() == LifeRecord::MAX_BUCKETS, ssprintf("%u", record.GetNumBuckets()) );
+	ASSERT( record.GetBucketSeconds() == 1/256.0f );
+	CheckRanges( record, vLives, fRecordSeconds, 1/256.0f );
+
+	fLife = NextLife( fLife );
+	vLives.push_back( fLife );
+	record.Add( LifeRecord::MAX_BUCKETS * fRecordSeconds, fLife );
+
+	/* 1/128s still leaves a bucket per record, so it goes on to 1/64s. */
+	ASSERT_M( record.GetBucketSeconds() == 1/64.0f, ssprintf("%f", record.GetBucketSeconds()) );
+	ASSERT_M( record.GetNumBuckets() == LifeRecord::MAX_BUCKETS/2 + 1, ssprintf("%u", record.GetNumBuckets()) );
+	ASSERT( record.GetLast() == fLife );
+	CheckRanges( record, vLives, fRecordSeconds, 1/64.0f );
+	CheckRanges( record, vLives, fRecordSeconds, 0.5f );
+
+	/* The line goes through the last life of each pair. */
+	for( unsigned i = 1; i < vLives.size(); i += 2 )
+		ASSERT_M( record.GetLerpAt(i * fRecordSeconds) == vLives[i], ssprintf("%u", i) );
+}
+
+/* An hour of endless play at 8 life changes a second. */
+static void test_memory()
+{
+	const float fRecordSeconds = 1/8.0f;
+	const int iNumRecords = 3600*8;
+	LifeRecord record, lossless;
+	lossless.SetKeepSamples( true );
+	std::vector<float> vLives;
+	float fLife = 0.5f;
+	for( int i = 0; i < iNumRecords; ++i )
+	{
+		fLife = NextLife( fLife );
+		vLives.push_back( fLife );
+		record.Add( i * fRecordSeconds, fLife );
+		lossless.Add( i * fRecordSeconds, fLife );
+	}
+
+	ASSERT_M( record.GetNumBuckets() == 3600, ssprintf("%u", record.GetNumBuckets()) );
+	ASSERT_M( record.GetBucketSeconds() == 1, ssprintf("%f", record.GetBucketSeconds()) );
+	ASSERT( record.GetSamples().empty() );
+	ASSERT( record.GetLast() == fLife );
+	CheckRanges( record, vLives, fRecordSeconds, 60 );
+
+	ASSERT( lossless.GetNumBuckets() == record.GetNumBuckets() );
+	ASSERT( (int) lossless.GetSamples().size() == iNumRecords );
+	for( int i = 0; i < iNumRecords; ++i )
+		ASSERT( lossless.GetSamples()[i] == std::make_pair(i * fRecordSeconds, vLives[i]) );
+
+	LOG->Info( "an hour: %u buckets of %.0fs, %u bytes; the map would have %i nodes",
+		record.GetNumBuckets(), record.GetBucketSeconds(), record.GetNumBuckets() * 4 * (unsigned) sizeof(float), iNumRecords );
+}
+
+int main( int argc, char *argv[] )
+{
+	test_handle_args( argc, argv );
+	test_init();
+
+	test_song();
+	test_downsample();
+	test_memory();
+
+	test_deinit();
+	exit(0);
+}
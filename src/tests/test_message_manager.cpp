@@ -0,0 +1,122 @@
+#include "global.h"
+#include "MessageManager.h"
+#include "LuaManager.h"
+#include "RageLog.h"
+#include "RageTimer.h"
+#include "RageUtil.h"
+#include "test_misc.h"
+
+#include <vector>
+
+/* Check that subscribing and unsubscribing from inside a handler behaves, then
+ * time broadcasts to a message with 10000 subscribers, and to messages with
+ * one subscriber and none. */
+
+class CountingSubscriber: public IMessageSubscriber
+{
+public:
+	int m_iCount = 0;
+	void HandleMessage( const Message &msg ) { ++m_iCount; }
+};
+
+/* Unsubscribes a victim, and subscribes a newcomer, on the first message. */
+class MeddlingSubscriber: public CountingSubscriber
+{
+public:
+	CountingSubscriber *m_pVictim = nullptr;
+	CountingSubscriber *m_pNewcomer = nullptr;
+	void HandleMessage( const Message &msg )
+	{
+		CountingSubscriber::HandleMessage( msg );
+		if( m_pVictim != nullptr )
+			MESSAGEMAN->Unsubscribe( m_pVictim, msg.GetName() );
+		if( m_pNewcomer != nullptr )
+			MESSAGEMAN->Subscribe( m_pNewcomer, msg.GetName() );
+		m_pVictim = m_pNewcomer = nullptr;
+	}
+};
+
+static void test_dispatch_changes()
+{
+	CountingSubscriber before, victim, newcomer;
+	MeddlingSubscriber meddler;
+	meddler.m_pVictim = &victim;
+	meddler.m_pNewcomer = &newcomer;
+
+	MESSAGEMAN->Subscribe( &before, "TestDispatch" );
+	MESSAGEMAN->Subscribe( &meddler, "TestDispatch" );
+	MESSAGEMAN->Subscribe( &victim, "TestDispatch" );
+
+	MESSAGEMAN->Broadcast( "TestDispatch" );
+	ASSERT( before.m_iCount == 1 && meddler.m_iCount == 1 );
+	ASSERT( victim.m_iCount == 0 && newcomer.m_iCount == 0 );
+
+	MESSAGEMAN->Broadcast( "TestDispatch" );
+	ASSERT( before.m_iCount == 2 && meddler.m_iCount == 2 );
+	ASSERT( victim.m_iCount == 0 && newcomer.m_iCount == 1 );
+	ASSERT( !MESSAGEMAN->IsSubscribedToMessage(&victim, "TestDispatch") );
+
+	MESSAGEMAN->Unsubscribe( &before, "TestDispatch" );
+	MESSAGEMAN->Unsubscribe( &meddler, "TestDispatch" );
+	MESSAGEMAN->Unsubscribe( &newcomer, "TestDispatch" );
+
+	// Interned names and MessageIDs agree.
+	ASSERT( InternMessageName("CurrentSongChanged") == Message_CurrentSongChanged );
+	ASSERT( Message("CurrentSongChanged") == Message_CurrentSongChanged );
+}
+
+static void time_broadcasts( const RString &sTitle, int iIterations, MessageID id, const RString &sName )
+{
+	RageTimer timer;
+	for( int i = 0; i < iIterations; ++i )
+	{
+		if( id != MessageID_Invalid )
+			MESSAGEMAN->Broadcast( id );
+		else
+			MESSAGEMAN->Broadcast( sName );
+	}
+	LOG->Info( "%-32s %.3fus", sTitle.c_str(), timer.Ago() * 1000000 / iIterations );
+}
+
+static void test_broadcast_latency()
+{
+	const int iNumSubscribers = 10000;
+	std::vector<CountingSubscriber> vSubscribers( iNumSubscribers );
+
+	// Spread a few hundred other names around, as a running game would have.
+	for( int i = 0; i < 300; ++i )
+		MESSAGEMAN->Subscribe( &vSubscribers[i], ssprintf("Other%iMessage", i) );
+	for( CountingSubscriber &s : vSubscribers )
+		MESSAGEMAN->Subscribe( &s, Message_CurrentComboChangedP1 );
+	CountingSubscriber one;
+	MESSAGEMAN->Subscribe( &one, "Judgment" );
+
+	time_broadcasts( "10000 subscribers, by ID", 2000, Message_CurrentComboChangedP1, "" );
+	time_broadcasts( "1 subscriber, by name", 200000, MessageID_Invalid, "Judgment" );
+	time_broadcasts( "no subscribers, by name", 200000, MessageID_Invalid, "Unheard" );
+	ASSERT( vSubscribers[0].m_iCount == 2000 && one.m_iCount == 200000 );
+
+	for( int i = 0; i < 300; ++i )
+		MESSAGEMAN->Unsubscribe( &vSubscribers[i], ssprintf("Other%iMessage", i) );
+	for( CountingSubscriber &s : vSubscribers )
+		MESSAGEMAN->Unsubscribe( &s, Message_CurrentComboChangedP1 );
+	MESSAGEMAN->Unsubscribe( &one, "Judgment" );
+}
+
+int main( int argc, char *argv[] )
+{
+	test_handle_args( argc, argv );
+	test_init();
+
+	LUA = new LuaManager;
+	MESSAGEMAN = new MessageManager;
+
+	test_dispatch_changes();
+	test_broadcast_latency();
+
+	delete MESSAGEMAN;
+	delete LUA;
+
+	test_deinit();
+	exit(0);
+}
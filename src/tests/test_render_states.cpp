@@ -0,0 +1,81 @@
+#include "global.h"
+#include "LuaManager.h"
+#include "RageDisplay.h"
+#include "RageDisplay_Null.h"
+#include "RageLog.h"
+#include "test_misc.h"
+
+#include <cstdlib>
+
+/* Set render states on the Null renderer the way a screen full of sprites
+ * does, and check that only the states that differ from what the device
+ * already has are counted as changes. */
+
+static void SetSpriteStates( RageDisplay *pDisplay, uintptr_t iTexture )
+{
+	pDisplay->SetTexture( TextureUnit_1, iTexture );
+	pDisplay->SetBlendMode( BLEND_NORMAL );
+	pDisplay->SetCullMode( CULL_NONE );
+	pDisplay->SetZWrite( false );
+	pDisplay->SetZTestMode( ZTEST_OFF );
+}
+
+static void CheckCounts( RageDisplay *pDisplay, int iStates, int iChanges )
+{
+	const int iActualStates = pDisplay->GetRenderStatesSinceLastCheck();
+	const int iActualChanges = pDisplay->GetRenderStateChangesSinceLastCheck();
+	ASSERT_M( iActualStates == iStates && iActualChanges == iChanges,
+		ssprintf("%i states, %i changes (expected %i, %i)", iActualStates, iActualChanges, iStates, iChanges) );
+	pDisplay->ResetStats();
+}
+
+static void test_render_states()
+{
+	RageDisplay *pDisplay = new RageDisplay_Null;
+	pDisplay->ResetStats();
+
+	// The first sprite sends everything; the rest share its states.
+	for( int i = 0; i < 100; ++i )
+		SetSpriteStates( pDisplay, 1 );
+	CheckCounts( pDisplay, 500, 5 );
+
+	// Alternating textures rebinds each time, and nothing else.
+	for( int i = 0; i < 100; ++i )
+		SetSpriteStates( pDisplay, 1 + i%2 );
+	CheckCounts( pDisplay, 500, 99 );
+
+	// Each unit has its own binding.
+	pDisplay->SetTexture( TextureUnit_2, 2 );
+	pDisplay->SetTexture( TextureUnit_1, 2 );
+	pDisplay->SetTexture( TextureUnit_2, 2 );
+	CheckCounts( pDisplay, 3, 1 );
+
+	pDisplay->SetBlendMode( BLEND_ADD );
+	pDisplay->SetBlendMode( BLEND_ADD );
+	pDisplay->SetBlendMode( BLEND_NORMAL );
+	CheckCounts( pDisplay, 3, 2 );
+
+	/* Starting concurrent rendering resets the defaults, which must all be
+	 * sent, since the device state is unknown; the texture is unknown too. */
+	pDisplay->BeginConcurrentRendering();
+	CheckCounts( pDisplay, 4, 4 );
+	SetSpriteStates( pDisplay, 2 );
+	CheckCounts( pDisplay, 5, 1 );
+
+	delete pDisplay;
+}
+
+int main( int argc, char *argv[] )
+{
+	test_handle_args( argc, argv );
+	test_init();
+
+	LUA = new LuaManager;
+
+	test_render_states();
+
+	delete LUA;
+
+	test_deinit();
+	exit(0);
+}
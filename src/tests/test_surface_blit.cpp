@@ -0,0 +1,260 @@
+#include "global.h"
+#include "RageLog.h"
+#include "RageSurface.h"
+#include "RageSurfaceUtils.h"
+#include "RageSurfaceUtils_Zoom.h"
+#include "RageTimer.h"
+#include "RageUtil.h"
+#include "test_misc.h"
+
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+/* Check that the byte-channel Blit path and the 2:1 Zoom kernel give exactly
+ * what the table-driven blit and the bilinear filter give, and report how
+ * fast each is.  The reference versions below are the generic loops from
+ * RageSurfaceUtils.cpp and RageSurfaceUtils_Zoom.cpp, which the fast paths
+ * now hide. */
+
+struct Format
+{
+	const char *szName;
+	int iBPP;
+	uint32_t iMask[4];
+};
+
+/* Everything the image loaders hand to Blit. */
+static const Format g_SrcFormats[] =
+{
+	{ "RGBA8", 32, { 0x000000FF, 0x0000FF00, 0x00FF0000, 0xFF000000 } },
+	{ "BGRA8", 32, { 0x00FF0000, 0x0000FF00, 0x000000FF, 0xFF000000 } },
+	{ "ARGB8", 32, { 0x0000FF00, 0x00FF0000, 0xFF000000, 0x000000FF } },
+	{ "RGBX8", 32, { 0x000000FF, 0x0000FF00, 0x00FF0000, 0x00000000 } },
+	{ "RGB8", 24, { 0x0000FF, 0x00FF00, 0xFF0000, 0x000000 } },
+	{ "BGR8", 24, { 0xFF0000, 0x00FF00, 0x0000FF, 0x000000 } },
+};
+
+/* Every texture format. */
+static const Format g_DstFormats[] =
+{
+	{ "RGBA8", 32, { 0x000000FF, 0x0000FF00, 0x00FF0000, 0xFF000000 } },
+	{ "BGRA8", 32, { 0x00FF0000, 0x0000FF00, 0x000000FF, 0xFF000000 } },
+	{ "RGBX8", 32, { 0x000000FF, 0x0000FF00, 0x00FF0000, 0x00000000 } },
+	{ "RGBA4", 16, { 0xF000, 0x0F00, 0x00F0, 0x000F } },
+	{ "RGB5A1", 16, { 0xF800, 0x07C0, 0x003E, 0x0001 } },
+	{ "A1RGB5", 16, { 0x7C00, 0x03E0, 0x001F, 0x8000 } },
+	{ "RGB565", 16, { 0xF800, 0x07E0, 0x001F, 0x0000 } },
+};
+
+static RageSurface *CreateSurface( const Format &f, int iWidth, int iHeight )
+{
+	return CreateSurface( iWidth, iHeight, f.iBPP, f.iMask[0], f.iMask[1], f.iMask[2], f.iMask[3] );
+}
+
+static void FillSurface( RageSurface *pSurface )
+{
+	unsigned iSeed = 12345;
+	for( int i = 0; i < pSurface->pitch * pSurface->h; ++i )
+	{
+		iSeed = iSeed * 1103515245 + 12345;
+		pSurface->pixels[i] = uint8_t( iSeed >> 16 );
+	}
+}
+
+static bool SameSurface( const RageSurface *a, const RageSurface *b )
+{
+	for( int y = 0; y < a->h; ++y )
+		if( memcmp(a->pixels + y*a->pitch, b->pixels + y*b->pitch, a->w * a->fmt.BytesPerPixel) )
+			return false;
+	return true;
+}
+
+/* blit_rgba_to_rgba. */
+static void ReferenceBlit( const RageSurface *src, RageSurface *dst )
+{
+	uint8_t lookup[4][256];
+	for( int c = 0; c < 4; ++c )
+	{
+		const uint32_t max_src_val = src->fmt.Mask[c] >> src->fmt.Shift[c];
+		const uint32_t max_dst_val = dst->fmt.Mask[c] >> dst->fmt.Shift[c];
+		if( src->fmt.Mask[c] == 0 )
+			lookup[c][0] = c == 3? (uint8_t) max_dst_val:0;
+		else if( max_src_val > max_dst_val )
+			for( uint32_t i = 0; i <= max_src_val; ++i )
+				lookup[c][i] = (uint8_t) SCALE( i, 0, max_src_val+1, 0, max_dst_val+1 );
+		else
+			for( uint32_t i = 0; i <= max_src_val; ++i )
+				lookup[c][i] = (uint8_t) SCALE( i, 0, max_src_val, 0, max_dst_val );
+	}
+
+	const int iSrcBPP = src->fmt.BytesPerPixel;
+	const int iDstBPP = dst->fmt.BytesPerPixel;
+	for( int y = 0; y < src->h; ++y )
+	{
+		for( int x = 0; x < src->w; ++x )
+		{
+			const uint32_t pixel = RageSurfaceUtils::decodepixel( src->pixels + y*src->pitch + x*iSrcBPP, iSrcBPP );
+			uint32_t opixel = 0;
+			for( int c = 0; c < 4; ++c )
+				opixel |= lookup[c][(pixel & src->fmt.Mask[c]) >> src->fmt.Shift[c]] << dst->fmt.Shift[c];
+			RageSurfaceUtils::encodepixel( dst->pixels + y*dst->pitch + x*iDstBPP, iDstBPP, opixel );
+		}
+	}
+}
+
+/* ZoomSurface, for shrinking: each destination pixel is weighted from the two
+ * source pixels either side of its center, in each direction. */
+static void InitVectors( std::vector<int> &s0, std::vector<int> &s1, std::vector<uint32_t> &percent, int src, int dst )
+{
+	const float sx = float(src) / dst;
+	for( int x = 0; x < dst; x++ )
+	{
+		const float sax = sx*x + sx/2.0f;
+		const float xstep = sx/4.0f;
+		s0.push_back( int(sax-xstep) );
+		s1.push_back( int(sax+xstep) );
+		if( s0[x] == s1[x] )
+			percent.push_back( 1<<24 );
+		else
+			percent.push_back( uint32_t((1.0f - (sax - (s0[x] + .5f)) / (s1[x] - s0[x])) * 16777216.0f) );
+	}
+}
+
+static void ReferenceZoom( const RageSurface *src, RageSurface *dst )
+{
+	std::vector<int> esx0, esx1, esy0, esy1;
+	std::vector<uint32_t> ex0, ey0;
+	InitVectors( esx0, esx1, ex0, src->w, dst->w );
+	InitVectors( esy0, esy1, ey0, src->h, dst->h );
+
+	for( int y = 0; y < dst->h; y++ )
+	{
+		uint8_t *dp = dst->pixels + dst->pitch*y;
+		const uint8_t *csp = src->pixels + esy0[y] * src->pitch;
+		const uint8_t *ncsp = src->pixels + esy1[y] * src->pitch;
+		for( int x = 0; x < dst->w; x++ )
+		{
+			const uint8_t *c00 = csp + esx0[x]*4, *c01 = csp + esx1[x]*4;
+			const uint8_t *c10 = ncsp + esx0[x]*4, *c11 = ncsp + esx1[x]*4;
+			for( int c = 0; c < 4; ++c )
+			{
+				const uint32_t x0 = (uint32_t(c00[c]) * ex0[x] + uint32_t(c01[c]) * (16777216 - ex0[x])) >> 24;
+				const uint32_t x1 = (uint32_t(c10[c]) * ex0[x] + uint32_t(c11[c]) * (16777216 - ex0[x])) >> 24;
+				dp[c] = uint8_t( ((x0 * ey0[y]) + (x1 * (16777216-ey0[y])) + 8388608) >> 24 );
+			}
+			dp += 4;
+		}
+	}
+}
+
+static float MegapixelsPerSecond( int iPixels, float fSeconds )
+{
+	return iPixels / 1000000.0f / std::max( fSeconds, 0.000001f );
+}
+
+static bool SameFormat( const Format &a, const Format &b )
+{
+	return a.iBPP == b.iBPP && !memcmp( a.iMask, b.iMask, sizeof(a.iMask) );
+}
+
+/* Odd sizes, so both the vector loops and the leftover pixels are checked.
+ * Matching formats are a plain copy, which doesn't go through either path. */
+static void test_blit()
+{
+	for( const Format &s : g_SrcFormats )
+	{
+		for( const Format &d : g_DstFormats )
+		{
+			if( SameFormat(s, d) )
+				continue;
+
+			RageSurface *pSrc = CreateSurface( s, 37, 19 );
+			FillSurface( pSrc );
+			RageSurface *pDst = CreateSurface( d, 37, 19 );
+			RageSurface *pRef = CreateSurface( d, 37, 19 );
+
+			RageSurfaceUtils::Blit( pSrc, pDst );
+			ReferenceBlit( pSrc, pRef );
+			ASSERT_M( SameSurface(pDst, pRef), ssprintf("%s -> %s", s.szName, d.szName) );
+
+			delete pSrc;
+			delete pDst;
+			delete pRef;
+		}
+	}
+}
+
+static void test_zoom()
+{
+	static const int iSizes[][2] = { { 2, 2 }, { 10, 6 }, { 74, 38 }, { 512, 256 } };
+	for( const auto &size : iSizes )
+	{
+		RageSurface *pSrc = CreateSurface( g_SrcFormats[0], size[0], size[1] );
+		FillSurface( pSrc );
+		RageSurface *pRef = CreateSurface( g_SrcFormats[0], size[0]/2, size[1]/2 );
+		ReferenceZoom( pSrc, pRef );
+
+		RageSurfaceUtils::Zoom( pSrc, size[0]/2, size[1]/2 );
+		ASSERT_M( SameSurface(pSrc, pRef), ssprintf("%ix%i", size[0], size[1]) );
+
+		delete pSrc;
+		delete pRef;
+	}
+}
+
+static void test_speed()
+{
+	const int iSize = 2048;
+	for( const Format &s : g_SrcFormats )
+	{
+		RageSurface *pSrc = CreateSurface( s, iSize, iSize );
+		FillSurface( pSrc );
+		for( const Format &d : g_DstFormats )
+		{
+			if( SameFormat(s, d) )
+				continue;
+
+			RageSurface *pDst = CreateSurface( d, iSize, iSize );
+
+			RageTimer timer;
+			RageSurfaceUtils::Blit( pSrc, pDst );
+			const float fFast = timer.GetDeltaTime();
+			ReferenceBlit( pSrc, pDst );
+			const float fGeneric = timer.GetDeltaTime();
+
+			LOG->Info( "%s -> %s: %.0f MP/s (generic %.0f MP/s)", s.szName, d.szName,
+				MegapixelsPerSecond(iSize*iSize, fFast), MegapixelsPerSecond(iSize*iSize, fGeneric) );
+			delete pDst;
+		}
+		delete pSrc;
+	}
+
+	RageSurface *pSrc = CreateSurface( g_SrcFormats[0], iSize, iSize );
+	FillSurface( pSrc );
+	RageSurface *pRef = CreateSurface( g_SrcFormats[0], iSize/2, iSize/2 );
+
+	RageTimer timer;
+	ReferenceZoom( pSrc, pRef );
+	const float fGeneric = timer.GetDeltaTime();
+	RageSurfaceUtils::Zoom( pSrc, iSize/2, iSize/2 );
+	const float fFast = timer.GetDeltaTime();
+
+	LOG->Info( "zoom 1/2: %.0f MP/s (bilinear %.0f MP/s) in source pixels",
+		MegapixelsPerSecond(iSize*iSize, fFast), MegapixelsPerSecond(iSize*iSize, fGeneric) );
+	delete pSrc;
+	delete pRef;
+}
+
+int main( int argc, char *argv[] )
+{
+	test_handle_args( argc, argv );
+	test_init();
+
+	test_blit();
+	test_zoom();
+	test_speed();
+
+	test_deinit();
+	exit(0);
+}
@@ -0,0 +1,96 @@
+#include "global.h"
+#include "Actor.h"
+#include "LuaManager.h"
+#include "RageLog.h"
+#include "RageTimer.h"
+#include "RageUtil.h"
+#include "test_misc.h"
+
+#include <cstdlib>
+#include <new>
+#include <vector>
+
+/* Queue an OnCommand-style tween chain on 10000 actors and play it out,
+ * reporting how many allocations each step makes and how long it takes. */
+
+static int g_iAllocations = 0;
+
+void *operator new( std::size_t iSize )
+{
+	++g_iAllocations;
+	void *p = std::malloc( iSize? iSize:1 );
+	if( p == nullptr )
+		throw std::bad_alloc();
+	return p;
+}
+void *operator new[]( std::size_t iSize ) { return operator new( iSize ); }
+void operator delete( void *p ) noexcept { std::free( p ); }
+void operator delete[]( void *p ) noexcept { std::free( p ); }
+void operator delete( void *p, std::size_t ) noexcept { std::free( p ); }
+void operator delete[]( void *p, std::size_t ) noexcept { std::free( p ); }
+
+/* diffusealpha,0;sleep,0.25;linear,0.3;diffusealpha,1;decelerate,0.2;x,100;
+ * accelerate,0.2;zoom,2 */
+static void QueueChain( Actor &a )
+{
+	a.SetDiffuseAlpha( 0 );
+	a.Sleep( 0.25f );
+	a.BeginTweening( 0.3f, TWEEN_LINEAR );
+	a.SetDiffuseAlpha( 1 );
+	a.BeginTweening( 0.2f, TWEEN_DECELERATE );
+	a.SetX( 100 );
+	a.BeginTweening( 0.2f, TWEEN_ACCELERATE );
+	a.SetZoom( 2 );
+}
+
+static void test_tween_chain()
+{
+	const int iNumActors = 10000;
+	std::vector<Actor> vActors( iNumActors );
+
+	for( int iPass = 0; iPass < 2; ++iPass )
+	{
+		int iAllocations = g_iAllocations;
+		RageTimer timer;
+		for( Actor &a : vActors )
+			QueueChain( a );
+		LOG->Info( "queue (pass %i): %i allocations, %.3fms", iPass+1,
+			g_iAllocations - iAllocations, timer.Ago() * 1000 );
+
+		// Once the tween queues have grown, queueing again reuses them.
+		if( iPass > 0 )
+			ASSERT( g_iAllocations == iAllocations );
+
+		iAllocations = g_iAllocations;
+		timer.Touch();
+		int iFrames = 0;
+		while( vActors[0].GetTweenTimeLeft() > 0 )
+		{
+			for( Actor &a : vActors )
+				a.Update( 1/60.0f );
+			++iFrames;
+		}
+		LOG->Info( "play (pass %i): %i frames, %i allocations, %.3fms per frame", iPass+1,
+			iFrames, g_iAllocations - iAllocations, timer.Ago() * 1000 / iFrames );
+		if( iPass > 0 )
+			ASSERT( g_iAllocations == iAllocations );
+
+		ASSERT( vActors[0].GetX() == 100 && vActors[0].GetZoom() == 2 );
+		ASSERT( vActors[iNumActors-1].GetDiffuseAlpha() == 1 );
+	}
+}
+
+int main( int argc, char *argv[] )
+{
+	test_handle_args( argc, argv );
+	test_init();
+
+	LUA = new LuaManager;
+
+	test_tween_chain();
+
+	delete LUA;
+
+	test_deinit();
+	exit(0);
+}